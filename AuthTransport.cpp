@@ -0,0 +1,422 @@
+#include "AuthTransport.h"
+#include "DnsCache.h"
+#include <QSslCertificate>
+#include <QSslCipher>
+#include <QTimer>
+#include <QDebug>
+
+namespace {
+
+// RFC 8305建议的连接尝试间隔
+const int HappyEyeballsDelayMs = 250;
+
+QString protocolName(QSsl::SslProtocol protocol)
+{
+    switch (protocol) {
+    case QSsl::TlsV1_2:
+        return "TLS 1.2";
+    case QSsl::TlsV1_3:
+        return "TLS 1.3";
+    default:
+        return "Unknown";
+    }
+}
+
+QString sessionKeyFor(const QString& host, quint16 port)
+{
+    return host + ":" + QString::number(port);
+}
+
+} // namespace
+
+AuthTransport::AuthTransport(QObject* parent)
+    : QObject(parent),
+    m_socket(new QSslSocket(this)),
+    m_tlsEnabled(false),
+    m_dnsCache(nullptr),
+    m_port(0),
+    m_blocking(false),
+    m_racer(nullptr),
+    m_raceTimer(new QTimer(this)),
+    m_primaryFailed(false),
+    m_connecting(false),
+    m_ticketOffered(false),
+    m_tcpConnectMs(0)
+{
+    connect(m_socket, &QSslSocket::connected, this, &AuthTransport::onConnected);
+    connect(m_socket, &QSslSocket::encrypted, this, &AuthTransport::onEncrypted);
+    connect(m_socket, &QSslSocket::errorOccurred, this, &AuthTransport::onSocketError);
+    connect(m_socket, &QSslSocket::newSessionTicketReceived, this, &AuthTransport::onSessionTicketReceived);
+    
+    m_raceTimer->setSingleShot(true);
+    connect(m_raceTimer, &QTimer::timeout, this, &AuthTransport::onRaceTimeout);
+}
+
+AuthTransport::~AuthTransport()
+{
+}
+
+void AuthTransport::setTlsEnabled(bool enabled)
+{
+    if (m_tlsEnabled == enabled) {
+        return;
+    }
+    m_tlsEnabled = enabled;
+
+    // 切换模式后已有连接不再适用
+    if (m_socket->state() != QAbstractSocket::UnconnectedState) {
+        m_socket->disconnectFromHost();
+    }
+}
+
+bool AuthTransport::setCaCertificateFile(const QString& path)
+{
+    m_extraCaCertificates.clear();
+    if (path.isEmpty()) {
+        return true;
+    }
+
+    m_extraCaCertificates = QSslCertificate::fromPath(path, QSsl::Pem);
+    if (m_extraCaCertificates.isEmpty()) {
+        qDebug() << "无法加载CA证书:" << path;
+        return false;
+    }
+    return true;
+}
+
+bool AuthTransport::isReady() const
+{
+    if (m_socket->state() != QAbstractSocket::ConnectedState) {
+        return false;
+    }
+    return !m_tlsEnabled || m_socket->isEncrypted();
+}
+
+QSslConfiguration AuthTransport::tlsConfiguration(const QString& sessionKey) const
+{
+    QSslConfiguration config = QSslConfiguration::defaultConfiguration();
+    config.setProtocol(QSsl::TlsV1_2OrLater);
+    config.setPeerVerifyMode(QSslSocket::VerifyPeer);
+
+    if (!m_extraCaCertificates.isEmpty()) {
+        QList<QSslCertificate> caCertificates = config.caCertificates();
+        caCertificates.append(m_extraCaCertificates);
+        config.setCaCertificates(caCertificates);
+    }
+
+    // 会话票据需要关闭"禁用会话持久化"选项才能被导出和复用
+    config.setSslOption(QSsl::SslOptionDisableSessionTickets, false);
+    config.setSslOption(QSsl::SslOptionDisableSessionPersistence, false);
+
+    QByteArray ticket = m_sessionTickets.value(sessionKey);
+    if (!ticket.isEmpty()) {
+        config.setSessionTicket(ticket);
+    }
+    return config;
+}
+
+bool AuthTransport::connectToServer(const QString& host, quint16 port, int timeoutMs, QString* errorMessage)
+{
+    if (isReady()) {
+        return true;
+    }
+
+    // 调用方的等待从本次调用算起；加入的预连接可能早已开始，m_connectTimer只用于统计连接耗时
+    QDeadlineTimer deadline(timeoutMs);
+
+    // 预连接已在进行时直接等待；阻塞等待期间事件循环不运行，竞速改为顺序回退
+    m_blocking = true;
+    if (m_connecting && m_socket->state() != QAbstractSocket::UnconnectedState && host == m_host && port == m_port) {
+        m_raceTimer->stop();
+        discardRacer();
+    } else {
+        startConnect(host, port, false);
+    }
+
+    bool connected = m_socket->waitForConnected(timeoutMs);
+    int remainingMs = int(deadline.remainingTime());
+    if (!connected && m_connecting && !m_raceAlternate.isNull() && remainingMs > 0) {
+        // 首选地址族失败，在剩余时间内尝试另一地址族
+        qDebug() << "连接" << m_socket->peerName() << "失败，改用" << m_raceAlternate.toString();
+        QHostAddress alternate = m_raceAlternate;
+        m_raceAlternate = QHostAddress();
+        m_connecting = false;
+        m_socket->abort();
+        m_connecting = true;
+        connectSocketTo(alternate.toString());
+        connected = m_socket->waitForConnected(remainingMs);
+        if (connected && m_dnsCache) {
+            m_dnsCache->setPreferredFamily(host, alternate.protocol());
+            m_totals.familyFallbacks++;
+        }
+    }
+    m_blocking = false;
+
+    if (!connected) {
+        if (errorMessage) {
+            *errorMessage = m_socket->errorString();
+        }
+        m_connecting = false;
+        return false;
+    }
+
+    if (m_tlsEnabled) {
+        int remainingMs = int(qMax<qint64>(0, deadline.remainingTime()));
+        if (!m_socket->isEncrypted() && !m_socket->waitForEncrypted(remainingMs)) {
+            if (errorMessage) {
+                *errorMessage = "TLS握手失败: " + m_socket->errorString();
+            }
+            // 票据可能已过期或被服务器拒绝，下次改为完整握手
+            m_sessionTickets.remove(m_activeSessionKey);
+            m_connecting = false;
+            m_socket->abort();
+            return false;
+        }
+    }
+    return true;
+}
+
+void AuthTransport::beginConnect(const QString& host, quint16 port)
+{
+    startConnect(host, port, true);
+}
+
+void AuthTransport::startConnect(const QString& host, quint16 port, bool allowRace)
+{
+    m_raceTimer->stop();
+    discardRacer();
+    m_connecting = false;
+    if (m_socket->state() != QAbstractSocket::UnconnectedState) {
+        m_socket->abort();
+    }
+
+    m_connecting = true;
+    m_tcpConnectMs = 0;
+    m_connectTimer.start();
+    m_host = host;
+    m_port = port;
+    m_raceAlternate = QHostAddress();
+    m_primaryFailed = false;
+
+    QList<QHostAddress> addresses;
+    if (!m_dnsCache || !m_dnsCache->lookup(host, &addresses) || addresses.isEmpty()) {
+        // 尚无缓存时由套接字自行解析，缓存在后台填充
+        connectSocketTo(host);
+        return;
+    }
+
+    // 地址已按首选地址族排序，另一地址族的第一个地址作为竞速候选
+    for (const QHostAddress& address : addresses) {
+        if (address.protocol() != addresses.first().protocol()) {
+            m_raceAlternate = address;
+            break;
+        }
+    }
+    connectSocketTo(addresses.first().toString());
+    if (allowRace && !m_raceAlternate.isNull()) {
+        m_raceTimer->start(HappyEyeballsDelayMs);
+    }
+}
+
+void AuthTransport::cancelConnect()
+{
+    if (!m_connecting) {
+        return;
+    }
+    m_raceTimer->stop();
+    discardRacer();
+    m_connecting = false;
+    m_socket->abort();
+}
+
+void AuthTransport::connectSocketTo(const QString& connectHost)
+{
+    if (!m_tlsEnabled) {
+        m_activeSessionKey.clear();
+        m_ticketOffered = false;
+        m_socket->connectToHost(connectHost, m_port);
+        return;
+    }
+
+    // 会话票据和证书校验都按配置的主机名，而不是解析出的地址
+    m_activeSessionKey = sessionKeyFor(m_host, m_port);
+    m_ticketOffered = m_sessionTickets.contains(m_activeSessionKey);
+    m_socket->setSslConfiguration(tlsConfiguration(m_activeSessionKey));
+
+    QString peerName = m_peerVerifyName.isEmpty() ? m_host : m_peerVerifyName;
+    m_socket->connectToHostEncrypted(connectHost, m_port, peerName);
+}
+
+void AuthTransport::onRaceTimeout()
+{
+    if (m_connecting && m_socket->state() != QAbstractSocket::ConnectedState && !m_racer && !m_raceAlternate.isNull()) {
+        startRacer();
+    }
+}
+
+void AuthTransport::startRacer()
+{
+    // 竞速只需要TCP连通，胜出后主套接字直接连接该地址(TLS握手仍在主套接字上进行)
+    QHostAddress address = m_raceAlternate;
+    m_raceAlternate = QHostAddress();
+    m_racer = new QTcpSocket(this);
+    connect(m_racer, &QTcpSocket::connected, this, &AuthTransport::onRacerConnected);
+    connect(m_racer, &QTcpSocket::errorOccurred, this, &AuthTransport::onRacerError);
+    m_racer->connectToHost(address, m_port);
+}
+
+void AuthTransport::onRacerConnected()
+{
+    QHostAddress address = m_racer->peerAddress();
+    discardRacer();
+    if (!m_connecting || m_socket->state() == QAbstractSocket::ConnectedState) {
+        return;
+    }
+
+    qDebug() << "连接竞速:" << m_host << "的" << address.toString() << "先连通";
+    if (m_dnsCache) {
+        m_dnsCache->setPreferredFamily(m_host, address.protocol());
+    }
+    m_totals.familyFallbacks++;
+    m_primaryFailed = false;
+
+    // 放弃首选地址族的尝试，abort期间的错误不应报告为连接失败
+    m_connecting = false;
+    m_socket->abort();
+    m_connecting = true;
+    connectSocketTo(address.toString());
+}
+
+void AuthTransport::onRacerError()
+{
+    discardRacer();
+    if (m_connecting && m_primaryFailed) {
+        m_connecting = false;
+        emit connectionFailed(m_primaryError);
+    }
+}
+
+void AuthTransport::discardRacer()
+{
+    if (!m_racer) {
+        return;
+    }
+    m_racer->disconnect(this);
+    m_racer->abort();
+    m_racer->deleteLater();
+    m_racer = nullptr;
+}
+
+void AuthTransport::copySettingsFrom(const AuthTransport& other)
+{
+    setTlsEnabled(other.m_tlsEnabled);
+    m_peerVerifyName = other.m_peerVerifyName;
+    m_extraCaCertificates = other.m_extraCaCertificates;
+    m_sessionTickets = other.m_sessionTickets;
+    m_dnsCache = other.m_dnsCache;
+}
+
+void AuthTransport::clearSessionCache()
+{
+    m_sessionTickets.clear();
+}
+
+void AuthTransport::onConnected()
+{
+    m_raceTimer->stop();
+    discardRacer();
+    m_raceAlternate = QHostAddress();
+    m_tcpConnectMs = m_connectTimer.elapsed();
+    if (!m_tlsEnabled) {
+        finishConnection();
+    }
+}
+
+void AuthTransport::onEncrypted()
+{
+    finishConnection();
+}
+
+void AuthTransport::onSocketError(QAbstractSocket::SocketError error)
+{
+    if (!m_connecting) {
+        return;
+    }
+    if (m_blocking && !m_raceAlternate.isNull()) {
+        // connectToServer会在剩余时间内尝试另一地址族
+        return;
+    }
+    if (m_racer || !m_raceAlternate.isNull()) {
+        // 首选地址族失败，结果由另一地址族的连接决定
+        m_primaryFailed = true;
+        m_primaryError = m_socket->errorString();
+        m_raceTimer->stop();
+        if (!m_racer) {
+            startRacer();
+        }
+        return;
+    }
+    m_connecting = false;
+
+    if (error == QAbstractSocket::SslHandshakeFailedError) {
+        m_sessionTickets.remove(m_activeSessionKey);
+    }
+    emit connectionFailed(m_socket->errorString());
+}
+
+void AuthTransport::finishConnection()
+{
+    if (!m_connecting) {
+        return;
+    }
+    m_connecting = false;
+
+    m_lastConnection = ConnectionStats();
+    m_lastConnection.tcpConnectMs = m_tcpConnectMs;
+
+    if (!m_tlsEnabled) {
+        m_totals.plainConnections++;
+        emit connectionEstablished(m_lastConnection);
+        return;
+    }
+
+    m_lastConnection.encrypted = true;
+    m_lastConnection.ticketOffered = m_ticketOffered;
+    m_lastConnection.handshakeMs = m_connectTimer.elapsed() - m_tcpConnectMs;
+    m_lastConnection.protocol = protocolName(m_socket->sessionProtocol());
+    m_lastConnection.cipher = m_socket->sessionCipher().name();
+
+    if (m_ticketOffered) {
+        m_totals.resumedHandshakes++;
+        m_totals.resumedHandshakeMsTotal += m_lastConnection.handshakeMs;
+    } else {
+        m_totals.fullHandshakes++;
+        m_totals.fullHandshakeMsTotal += m_lastConnection.handshakeMs;
+    }
+
+    // TLS 1.2的票据在握手结束时即可获得，TLS 1.3的票据稍后通过信号到达
+    storeSessionTicket();
+
+    qDebug() << "TLS连接已建立:" << m_lastConnection.protocol << m_lastConnection.cipher
+             << (m_ticketOffered ? "会话恢复" : "完整握手")
+             << "TCP连接" << m_lastConnection.tcpConnectMs << "ms, 握手"
+             << m_lastConnection.handshakeMs << "ms";
+
+    emit connectionEstablished(m_lastConnection);
+}
+
+void AuthTransport::onSessionTicketReceived()
+{
+    storeSessionTicket();
+}
+
+void AuthTransport::storeSessionTicket()
+{
+    if (m_activeSessionKey.isEmpty()) {
+        return;
+    }
+    QByteArray ticket = m_socket->sslConfiguration().sessionTicket();
+    if (!ticket.isEmpty()) {
+        m_sessionTickets.insert(m_activeSessionKey, ticket);
+    }
+}
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <QObject>
+#include <QSslSocket>
+#include <QSslConfiguration>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QHostAddress>
+
+class DnsCache;
+class QTimer;
+
+// 认证服务器传输层：在同一个QSslSocket上提供明文TCP或TLS连接，
+// TLS模式下按服务器缓存会话票据，重连时尝试TLS 1.3会话恢复以减少握手耗时。
+// 设置DnsCache后直接连接缓存的地址；主机同时有IPv4和IPv6地址时，异步连接按RFC 8305竞速：
+// 首选地址族在短暂延迟内未连通(或失败)就并行尝试另一地址族，先连通的地址族被记为首选
+class AuthTransport : public QObject
+{
+    Q_OBJECT
+
+public:
+    // 单次连接的建立耗时
+    struct ConnectionStats {
+        bool encrypted = false;         // 是否为TLS连接
+        bool ticketOffered = false;     // 是否携带了缓存的会话票据(恢复握手)
+        qint64 tcpConnectMs = 0;        // TCP三次握手耗时
+        qint64 handshakeMs = 0;         // TLS握手耗时
+        QString protocol;               // 协商的TLS版本
+        QString cipher;                 // 协商的加密套件
+    };
+
+    // 累计统计
+    struct Totals {
+        quint64 plainConnections = 0;
+        quint64 fullHandshakes = 0;
+        quint64 resumedHandshakes = 0;
+        qint64 fullHandshakeMsTotal = 0;
+        qint64 resumedHandshakeMsTotal = 0;
+        quint64 familyFallbacks = 0;    // 连接竞速中另一地址族胜出的次数
+    };
+
+    explicit AuthTransport(QObject* parent = nullptr);
+    ~AuthTransport();
+
+    QSslSocket* socket() const { return m_socket; }
+
+    void setTlsEnabled(bool enabled);
+    bool isTlsEnabled() const { return m_tlsEnabled; }
+
+    // 额外信任的CA证书(用于自签名证书的本地测试服务器)
+    bool setCaCertificateFile(const QString& path);
+
+    // 证书校验使用的主机名，为空时使用连接地址
+    void setPeerVerifyName(const QString& name) { m_peerVerifyName = name; }
+
+    // 域名解析缓存，可由多个传输层共享；为空时由QSslSocket自行解析
+    void setDnsCache(DnsCache* cache) { m_dnsCache = cache; }
+
+    // 是否已建立可发送数据的连接(TLS模式下需握手完成)
+    bool isReady() const;
+
+    // 是否有正在建立的连接(含DNS解析、TCP连接和TLS握手)
+    bool isConnecting() const { return m_connecting; }
+
+    // 阻塞建立连接，失败时通过errorMessage返回原因；已有到同一服务器的连接正在建立时等待其完成
+    bool connectToServer(const QString& host, quint16 port, int timeoutMs, QString* errorMessage = nullptr);
+
+    // 异步建立连接，完成时发出connectionEstablished，失败时发出connectionFailed
+    void beginConnect(const QString& host, quint16 port);
+
+    // 最近一次连接(或正在建立的连接)的目标
+    QString host() const { return m_host; }
+    quint16 port() const { return m_port; }
+    // 放弃正在建立的连接，不发出connectionFailed
+    void cancelConnect();
+
+    // 复制另一个传输层的TLS设置和会话票据(用于额外的并行连接)
+    void copySettingsFrom(const AuthTransport& other);
+
+    // 丢弃所有缓存的会话票据
+    void clearSessionCache();
+
+    ConnectionStats lastConnection() const { return m_lastConnection; }
+    Totals totals() const { return m_totals; }
+
+signals:
+    void connectionEstablished(const AuthTransport::ConnectionStats& stats);
+    void connectionFailed(const QString& errorMessage);
+
+private slots:
+    void onConnected();
+    void onEncrypted();
+    void onSocketError(QAbstractSocket::SocketError error);
+    void onSessionTicketReceived();
+    void onRaceTimeout();
+    void onRacerConnected();
+    void onRacerError();
+
+private:
+    void startConnect(const QString& host, quint16 port, bool allowRace);
+    void connectSocketTo(const QString& connectHost);
+    void startRacer();
+    void discardRacer();
+    QSslConfiguration tlsConfiguration(const QString& sessionKey) const;
+    void finishConnection();
+    void storeSessionTicket();
+
+    QSslSocket* m_socket;
+    bool m_tlsEnabled;
+    QString m_peerVerifyName;
+    QList<QSslCertificate> m_extraCaCertificates;
+    QHash<QString, QByteArray> m_sessionTickets;
+    QString m_activeSessionKey;
+    DnsCache* m_dnsCache;
+
+    // 当前连接的目标，以及地址族竞速状态
+    QString m_host;
+    quint16 m_port;
+    bool m_blocking;
+    QHostAddress m_raceAlternate;       // 尚未尝试的另一地址族地址
+    QTcpSocket* m_racer;
+    QTimer* m_raceTimer;
+    bool m_primaryFailed;
+    QString m_primaryError;
+
+    QElapsedTimer m_connectTimer;
+    bool m_connecting;
+    bool m_ticketOffered;
+    qint64 m_tcpConnectMs;
+    ConnectionStats m_lastConnection;
+    Totals m_totals;
+};
@@ -0,0 +1,150 @@
+#include "BurstCapture.h"
+#include <QDebug>
+#include <QThread>
+
+BurstCapture::BurstCapture(QObject* parent)
+    : QObject(parent),
+    m_active(false),
+    m_collecting(false),
+    m_burstId(0),
+    m_frameCount(0),
+    m_frameIntervalMs(0),
+    m_lastAcceptedMs(0),
+    m_submitted(0),
+    m_completed(0),
+    m_firstSubmitUs(0),
+    m_lastFrameUs(0),
+    m_encodeCpuUs(0)
+{
+    m_pool.setMaxThreadCount(qMax(1, QThread::idealThreadCount()));
+    m_windowTimer.setSingleShot(true);
+    connect(&m_windowTimer, &QTimer::timeout, this, [this]() {
+        if (m_collecting) {
+            qDebug() << "连拍窗口结束，只采集到" << m_submitted << "/" << m_frameCount << "帧";
+            stopCollecting();
+            finishIfDone();
+        }
+    });
+}
+
+BurstCapture::~BurstCapture()
+{
+    m_pool.waitForDone();
+}
+
+bool BurstCapture::start(int frameCount, int windowMs, const CaptureEncoder::Options& options)
+{
+    if (m_active || frameCount < 1) {
+        return false;
+    }
+
+    m_active = true;
+    m_collecting = true;
+    m_burstId++;
+    m_frameCount = frameCount;
+    m_frameIntervalMs = frameCount > 1 ? qMax(0, windowMs) / (frameCount - 1) : 0;
+    m_lastAcceptedMs = 0;
+    m_options = options;
+    m_submitted = 0;
+    m_completed = 0;
+    m_encoded = QList<QByteArray>(frameCount);
+    m_firstSubmitUs = 0;
+    m_lastFrameUs = 0;
+    m_encodeCpuUs = 0;
+    m_clock.start();
+    // 窗口之外留出余量给最后一帧，帧率过低时提前结束
+    m_windowTimer.start(qMax(0, windowMs) + 500);
+    return true;
+}
+
+void BurstCapture::cancel()
+{
+    m_burstId++;
+    m_active = false;
+    m_collecting = false;
+    m_windowTimer.stop();
+    m_encoded.clear();
+}
+
+void BurstCapture::offerFrame(const QVideoFrame& frame)
+{
+    if (!m_collecting || !frame.isValid()) {
+        return;
+    }
+
+    qint64 nowMs = m_clock.elapsed();
+    if (m_submitted > 0 && nowMs - m_lastAcceptedMs < m_frameIntervalMs) {
+        return;
+    }
+    m_lastAcceptedMs = nowMs;
+
+    qint64 nowUs = m_clock.nsecsElapsed() / 1000;
+    if (m_submitted == 0) {
+        m_firstSubmitUs = nowUs;
+    }
+    m_lastFrameUs = nowUs;
+
+    int index = m_submitted++;
+    quint64 burstId = m_burstId;
+    CaptureEncoder::Options options = m_options;
+    m_pool.start([this, burstId, index, frame, options]() {
+        // 每个线程一个编码器，线程池复用线程时编码器也随之复用
+        thread_local CaptureEncoder encoder;
+        QElapsedTimer timer;
+        timer.start();
+        QByteArray jpeg;
+        if (!encoder.encodeFrame(frame, options, &jpeg)
+            && !encoder.encodeImage(frame.toImage(), options, &jpeg)) {
+            jpeg.clear();
+        }
+        qint64 encodeUs = timer.nsecsElapsed() / 1000;
+        QMetaObject::invokeMethod(this, [this, burstId, index, jpeg, encodeUs]() {
+            onFrameEncoded(burstId, index, jpeg, encodeUs);
+        }, Qt::QueuedConnection);
+    });
+
+    if (m_submitted >= m_frameCount) {
+        stopCollecting();
+    }
+}
+
+void BurstCapture::stopCollecting()
+{
+    m_collecting = false;
+    m_windowTimer.stop();
+}
+
+void BurstCapture::onFrameEncoded(quint64 burstId, int index, const QByteArray& jpeg, qint64 encodeUs)
+{
+    if (burstId != m_burstId || !m_active) {
+        return;
+    }
+    m_encoded[index] = jpeg;
+    m_encodeCpuUs += encodeUs;
+    m_completed++;
+    finishIfDone();
+}
+
+void BurstCapture::finishIfDone()
+{
+    if (m_collecting || m_completed < m_submitted) {
+        return;
+    }
+
+    qint64 doneUs = m_clock.nsecsElapsed() / 1000;
+    Result result;
+    for (const QByteArray& jpeg : m_encoded) {
+        if (!jpeg.isEmpty()) {
+            result.frames.append(jpeg);
+        }
+    }
+    result.captureMs = m_lastFrameUs / 1000;
+    result.encodeWallUs = m_submitted > 0 ? doneUs - m_firstSubmitUs : 0;
+    result.encodeCpuUs = m_encodeCpuUs;
+    result.tailUs = m_submitted > 0 ? doneUs - m_lastFrameUs : 0;
+    result.threads = m_pool.maxThreadCount();
+
+    m_active = false;
+    m_encoded.clear();
+    emit finished(result);
+}
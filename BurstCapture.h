@@ -0,0 +1,71 @@
+#pragma once
+
+#include "CaptureEncoder.h"
+#include <QObject>
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QList>
+#include <QThreadPool>
+#include <QTimer>
+#include <QVideoFrame>
+
+// 连拍：从摄像头流中取K帧，在线程池中并行编码为JPEG
+//
+// start()之后帧处理函数把到达的帧交给offerFrame()，在采集窗口内按等间隔取帧。每取到一帧立即提交编码任务，
+// 编码与等待后续帧重叠进行，最后一帧到达后只需再等它自己的编码时间，连拍相对单帧拍照增加的延迟约为采集窗口。
+// 每个工作线程使用自己的CaptureEncoder(libjpeg-turbo句柄不能跨线程共享)。
+// 只保留被选中帧的引用，K较大时会占用摄像头后端的缓冲区，建议不超过8帧。
+class BurstCapture : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Result {
+        QList<QByteArray> frames;       // 按采集顺序，编码失败的帧被剔除
+        qint64 captureMs = 0;           // start()到最后一帧到达
+        qint64 encodeWallUs = 0;        // 第一帧提交编码到全部完成
+        qint64 encodeCpuUs = 0;         // 各帧编码耗时之和，与encodeWallUs之比即并行加速比
+        qint64 tailUs = 0;              // 最后一帧到达后等待编码完成的时间
+        int threads = 0;
+    };
+
+    explicit BurstCapture(QObject* parent = nullptr);
+    ~BurstCapture();
+
+    void setMaxThreads(int threads) { m_pool.setMaxThreadCount(qMax(1, threads)); }
+
+    // 开始一次连拍；已有连拍进行中时返回false
+    bool start(int frameCount, int windowMs, const CaptureEncoder::Options& options);
+    void cancel();
+    bool isActive() const { return m_active; }
+
+    // 由帧处理函数调用(GUI线程)
+    void offerFrame(const QVideoFrame& frame);
+
+signals:
+    // 在GUI线程中发出
+    void finished(const BurstCapture::Result& result);
+
+private:
+    void stopCollecting();
+    void onFrameEncoded(quint64 burstId, int index, const QByteArray& jpeg, qint64 encodeUs);
+    void finishIfDone();
+
+    QThreadPool m_pool;
+    QTimer m_windowTimer;           // 摄像头帧率不足时按时结束采集
+    QElapsedTimer m_clock;
+    CaptureEncoder::Options m_options;
+
+    bool m_active;
+    bool m_collecting;
+    quint64 m_burstId;              // 取消后仍在运行的旧任务结果按编号丢弃
+    int m_frameCount;
+    qint64 m_frameIntervalMs;
+    qint64 m_lastAcceptedMs;
+    int m_submitted;
+    int m_completed;
+    QList<QByteArray> m_encoded;
+    qint64 m_firstSubmitUs;
+    qint64 m_lastFrameUs;
+    qint64 m_encodeCpuUs;
+};
@@ -0,0 +1,46 @@
+#include "CameraView.h"
+#include <QPainter>
+
+CameraView::CameraView(QWidget* parent)
+    : QLabel(parent)
+{
+}
+
+void CameraView::showFrame(PooledBuffer<QImage> frame)
+{
+    m_frame = std::move(frame);
+    update();
+}
+
+void CameraView::showImage(const QImage& image)
+{
+    m_frame = PooledBuffer<QImage>(nullptr, QImage(image));
+    update();
+}
+
+void CameraView::clearFrame()
+{
+    m_frame.reset();
+    *m_frame = QImage();
+    update();
+}
+
+void CameraView::paintEvent(QPaintEvent* event)
+{
+    if (m_frame->isNull()) {
+        QLabel::paintEvent(event);
+        return;
+    }
+
+    // 居中绘制；视图尺寸刚改变、新尺寸的帧尚未到达时按比例缩放
+    QPainter painter(this);
+    drawFrame(&painter);
+    QRect area = contentsRect();
+    QSize size = m_frame->size();
+    if (size.width() > area.width() || size.height() > area.height()) {
+        size.scale(area.size(), Qt::KeepAspectRatio);
+    }
+    QRect target(QPoint(0, 0), size);
+    target.moveCenter(area.center());
+    painter.drawImage(target, *m_frame);
+}
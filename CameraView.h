@@ -0,0 +1,35 @@
+#pragma once
+
+#include <QImage>
+#include <QLabel>
+#include "FrameBufferPool.h"
+
+// 摄像头预览视图：直接绘制池化的预览图像，不经过QPixmap
+//
+// 光栅后端上QPixmap::fromImage()与QImage共享像素，池化图像归还时仍被引用而无法回收，每帧都要重新分配。
+// 这里持有当前帧的池化图像直到下一帧到来，上一帧随即归还缓冲池，稳定运行时预览路径不再分配帧缓冲区。
+// 没有帧时按QLabel显示文字
+class CameraView : public QLabel
+{
+    Q_OBJECT
+
+public:
+    explicit CameraView(QWidget* parent = nullptr);
+
+    // 显示池化的预览图像(尺寸已按视图缩放)，上一帧归还缓冲池
+    void showFrame(PooledBuffer<QImage> frame);
+    // 显示不来自缓冲池的图像(回退路径)
+    void showImage(const QImage& image);
+    // 清除当前帧，恢复显示文字
+    void clearFrame();
+
+    bool hasFrame() const { return !m_frame->isNull(); }
+    // 当前帧的拷贝(拍照回退路径使用)
+    QImage currentFrame() const { return m_frame->copy(); }
+
+protected:
+    void paintEvent(QPaintEvent* event) override;
+
+private:
+    PooledBuffer<QImage> m_frame;
+};
@@ -0,0 +1,276 @@
+#include "CaptureEncoder.h"
+#include "FrameBufferPool.h"
+#include "ImageConversion.h"
+#include <QDebug>
+#include <opencv2/imgcodecs.hpp>
+#include <opencv2/imgproc.hpp>
+#include <cstring>
+
+#ifdef FACEAUTH_HAS_TURBOJPEG
+#include <turbojpeg.h>
+#endif
+
+namespace {
+
+// 对齐到偶数，420/422色度平面按2x采样
+int evenFloor(int value)
+{
+    return value & ~1;
+}
+
+// 计算对齐后的裁剪区域和输出尺寸
+bool computeGeometry(const QSize& frameSize, const CaptureEncoder::Options& options, QRect* crop, QSize* target)
+{
+    QRect rect = options.crop.isEmpty() ? QRect(QPoint(0, 0), frameSize) : options.crop.intersected(QRect(QPoint(0, 0), frameSize));
+    rect = QRect(evenFloor(rect.x()), evenFloor(rect.y()), evenFloor(rect.width()), evenFloor(rect.height()));
+    if (rect.width() < 2 || rect.height() < 2) {
+        return false;
+    }
+
+    QSize size = rect.size();
+    if (options.maxDimension > 0 && qMax(size.width(), size.height()) > options.maxDimension) {
+        size.scale(options.maxDimension, options.maxDimension, Qt::KeepAspectRatio);
+    }
+    *crop = rect;
+    *target = QSize(qMax(2, evenFloor(size.width())), qMax(2, evenFloor(size.height())));
+    return true;
+}
+
+void copyToByteArray(const uchar* data, size_t size, QByteArray* jpeg)
+{
+    // 复用调用方QByteArray已有的容量
+    jpeg->resize(static_cast<qsizetype>(size));
+    if (size > 0) {
+        std::memcpy(jpeg->data(), data, size);
+    }
+}
+
+} // namespace
+
+CaptureEncoder::CaptureEncoder()
+    : m_turboHandle(nullptr)
+{
+#ifdef FACEAUTH_HAS_TURBOJPEG
+    m_turboHandle = tjInitCompress();
+    if (!m_turboHandle) {
+        qDebug() << "初始化libjpeg-turbo失败:" << tjGetErrorStr();
+    }
+#endif
+}
+
+CaptureEncoder::~CaptureEncoder()
+{
+#ifdef FACEAUTH_HAS_TURBOJPEG
+    if (m_turboHandle) {
+        tjDestroy(static_cast<tjhandle>(m_turboHandle));
+    }
+#endif
+}
+
+bool CaptureEncoder::hasTurboJpeg()
+{
+#ifdef FACEAUTH_HAS_TURBOJPEG
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool CaptureEncoder::supportsPixelFormat(QVideoFrameFormat::PixelFormat format)
+{
+    switch (format) {
+    case QVideoFrameFormat::Format_YUV420P:
+    case QVideoFrameFormat::Format_YV12:
+    case QVideoFrameFormat::Format_NV12:
+    case QVideoFrameFormat::Format_NV21:
+        return true;
+    case QVideoFrameFormat::Format_YUYV:
+    case QVideoFrameFormat::Format_UYVY:
+        // 422打包格式只有libjpeg-turbo能直接压缩，OpenCV没有平面422到BGR的转换
+        return hasTurboJpeg();
+    default:
+        return false;
+    }
+}
+
+bool CaptureEncoder::encodeFrame(const QVideoFrame& frame, const Options& options, QByteArray* jpeg)
+{
+    QVideoFrameFormat::PixelFormat pixelFormat = frame.pixelFormat();
+    if (!supportsPixelFormat(pixelFormat)
+        || frame.surfaceFormat().isMirrored()
+        || frame.surfaceFormat().scanLineDirection() != QVideoFrameFormat::TopToBottom
+        || frame.rotation() != QtVideo::Rotation::None) {
+        return false;
+    }
+#ifdef FACEAUTH_HAS_TURBOJPEG
+    if (!m_turboHandle && (pixelFormat == QVideoFrameFormat::Format_YUYV || pixelFormat == QVideoFrameFormat::Format_UYVY)) {
+        return false;
+    }
+#endif
+
+    QRect crop;
+    QSize target;
+    if (!computeGeometry(frame.size(), options, &crop, &target)) {
+        return false;
+    }
+
+    QVideoFrame mappedFrame(frame);
+    if (!mappedFrame.map(QVideoFrame::ReadOnly)) {
+        return false;
+    }
+
+    bool packed422 = pixelFormat == QVideoFrameFormat::Format_YUYV || pixelFormat == QVideoFrameFormat::Format_UYVY;
+    int width = target.width();
+    int height = target.height();
+    int chromaWidth = width / 2;
+    int chromaHeight = packed422 ? height : height / 2;
+    bool encoded = false;
+
+    try {
+        // Y、U、V平面连续存放在一个池化缓冲区中，布局与I420相同，OpenCV回退路径可以直接转换
+        FrameBufferPool& pool = FrameBufferPool::instance();
+        PooledBuffer<cv::Mat> planes = pool.acquireMat(height + 2 * chromaHeight * chromaWidth / width, width, CV_8UC1);
+        uchar* base = planes->data;
+        cv::Mat yPlane(height, width, CV_8UC1, base, width);
+        cv::Mat uPlane(chromaHeight, chromaWidth, CV_8UC1, base + height * width, chromaWidth);
+        cv::Mat vPlane(chromaHeight, chromaWidth, CV_8UC1, base + height * width + chromaHeight * chromaWidth, chromaWidth);
+        cv::Size chromaSize(chromaWidth, chromaHeight);
+
+        // 裁剪只是在映射的平面上取子区域，缩小在同一次resize中完成
+        auto planeView = [&mappedFrame](int plane, int rows, int cols, int type) {
+            return cv::Mat(rows, cols, type, mappedFrame.bits(plane), mappedFrame.bytesPerLine(plane));
+        };
+        int frameWidth = mappedFrame.width();
+        int frameHeight = mappedFrame.height();
+        cv::Rect lumaRect(crop.x(), crop.y(), crop.width(), crop.height());
+        cv::Rect chromaRect(crop.x() / 2, crop.y() / 2, crop.width() / 2, crop.height() / 2);
+
+        switch (pixelFormat) {
+        case QVideoFrameFormat::Format_YUV420P:
+        case QVideoFrameFormat::Format_YV12: {
+            bool swapped = pixelFormat == QVideoFrameFormat::Format_YV12;
+            cv::Mat u = planeView(swapped ? 2 : 1, frameHeight / 2, frameWidth / 2, CV_8UC1);
+            cv::Mat v = planeView(swapped ? 1 : 2, frameHeight / 2, frameWidth / 2, CV_8UC1);
+            cv::resize(planeView(0, frameHeight, frameWidth, CV_8UC1)(lumaRect), yPlane, yPlane.size(), 0, 0, cv::INTER_AREA);
+            cv::resize(u(chromaRect), uPlane, chromaSize, 0, 0, cv::INTER_AREA);
+            cv::resize(v(chromaRect), vPlane, chromaSize, 0, 0, cv::INTER_AREA);
+            break;
+        }
+        case QVideoFrameFormat::Format_NV12:
+        case QVideoFrameFormat::Format_NV21: {
+            // 交错的色度平面按双通道缩小后再拆分，拆分只处理输出尺寸的色度数据
+            cv::resize(planeView(0, frameHeight, frameWidth, CV_8UC1)(lumaRect), yPlane, yPlane.size(), 0, 0, cv::INTER_AREA);
+            PooledBuffer<cv::Mat> chroma = pool.acquireMat(chromaHeight, chromaWidth, CV_8UC2);
+            cv::resize(planeView(1, frameHeight / 2, frameWidth / 2, CV_8UC2)(chromaRect), *chroma, chromaSize, 0, 0, cv::INTER_AREA);
+            bool swapped = pixelFormat == QVideoFrameFormat::Format_NV21;
+            cv::Mat outputs[] = { swapped ? vPlane : uPlane, swapped ? uPlane : vPlane };
+            int fromTo[] = { 0, 0, 1, 1 };
+            cv::mixChannels(&*chroma, 1, outputs, 2, fromTo, 2);
+            break;
+        }
+        case QVideoFrameFormat::Format_YUYV:
+        case QVideoFrameFormat::Format_UYVY: {
+            // 以4通道(每两个像素一组)缩小打包数据，再一次mixChannels拆成Y/U/V平面
+            cv::Mat packed = planeView(0, frameHeight, frameWidth / 2, CV_8UC4);
+            cv::Rect packedRect(crop.x() / 2, crop.y(), crop.width() / 2, crop.height());
+            PooledBuffer<cv::Mat> small = pool.acquireMat(height, chromaWidth, CV_8UC4);
+            cv::resize(packed(packedRect), *small, cv::Size(chromaWidth, height), 0, 0, cv::INTER_AREA);
+            cv::Mat yPairs(height, chromaWidth, CV_8UC2, base, width);
+            cv::Mat outputs[] = { yPairs, uPlane, vPlane };
+            bool yuyv = pixelFormat == QVideoFrameFormat::Format_YUYV;
+            int fromToYuyv[] = { 0, 0, 2, 1, 1, 2, 3, 3 };
+            int fromToUyvy[] = { 1, 0, 3, 1, 0, 2, 2, 3 };
+            cv::mixChannels(&*small, 1, outputs, 3, yuyv ? fromToYuyv : fromToUyvy, 4);
+            break;
+        }
+        default:
+            break;
+        }
+        mappedFrame.unmap();
+
+#ifdef FACEAUTH_HAS_TURBOJPEG
+        if (m_turboHandle) {
+            int subsampling = packed422 ? TJSAMP_422 : TJSAMP_420;
+            unsigned long bufferSize = tjBufSize(width, height, subsampling);
+            PooledBuffer<std::vector<uchar>> buf = pool.acquireEncodeBuffer(bufferSize);
+            buf->resize(bufferSize);
+            const unsigned char* sourcePlanes[3] = { yPlane.data, uPlane.data, vPlane.data };
+            int strides[3] = { int(yPlane.step), int(uPlane.step), int(vPlane.step) };
+            unsigned char* output = buf->data();
+            unsigned long outputSize = bufferSize;
+            if (tjCompressFromYUVPlanes(static_cast<tjhandle>(m_turboHandle), sourcePlanes, width, strides, height,
+                                        subsampling, &output, &outputSize, options.quality, TJFLAG_NOREALLOC) != 0) {
+                qDebug() << "libjpeg-turbo编码失败:" << tjGetErrorStr2(static_cast<tjhandle>(m_turboHandle));
+                return false;
+            }
+            copyToByteArray(output, outputSize, jpeg);
+            return true;
+        }
+#endif
+
+        // 没有libjpeg-turbo时，在输出尺寸的I420数据上转换为BGR
+        PooledBuffer<cv::Mat> bgr = pool.acquireMat(height, width, CV_8UC3);
+        cv::cvtColor(*planes, *bgr, cv::COLOR_YUV2BGR_I420);
+        PooledBuffer<std::vector<uchar>> buf = pool.acquireEncodeBuffer(bgr->total());
+        cv::imencode(".jpg", *bgr, *buf, { cv::IMWRITE_JPEG_QUALITY, options.quality });
+        copyToByteArray(buf->data(), buf->size(), jpeg);
+        encoded = !jpeg->isEmpty();
+    }
+    catch (const cv::Exception& e) {
+        qDebug() << "YUV直接编码异常:" << e.what();
+        if (mappedFrame.isMapped()) {
+            mappedFrame.unmap();
+        }
+    }
+    return encoded;
+}
+
+bool CaptureEncoder::encodeImage(const QImage& image, const Options& options, QByteArray* jpeg)
+{
+    if (image.isNull()) {
+        return false;
+    }
+
+    try {
+        QImage source = image;
+        cv::Mat wrapped = ImageConversion::wrapImage(source);
+        if (wrapped.empty()) {
+            source = image.convertToFormat(QImage::Format_RGB888);
+            wrapped = ImageConversion::wrapImage(source);
+        }
+
+        QRect crop;
+        QSize target;
+        if (!computeGeometry(source.size(), options, &crop, &target)) {
+            return false;
+        }
+        cv::Mat region = wrapped(cv::Rect(crop.x(), crop.y(), crop.width(), crop.height()));
+
+        // 先缩小再转BGR，OpenCV编码需要BGR顺序。用指针引用缩小结果，避免增加池化Mat的引用计数
+        FrameBufferPool& pool = FrameBufferPool::instance();
+        const cv::Mat* scaled = &region;
+        PooledBuffer<cv::Mat> small;
+        if (target != crop.size()) {
+            small = pool.acquireMat(target.height(), target.width(), region.type());
+            cv::resize(region, *small, small->size(), 0, 0, cv::INTER_AREA);
+            scaled = &*small;
+        }
+
+        PooledBuffer<cv::Mat> bgr = pool.acquireMat(scaled->rows, scaled->cols, CV_8UC3);
+        int conversionCode = ImageConversion::bgrConversionCode(source.format());
+        if (conversionCode < 0) {
+            scaled->copyTo(*bgr);
+        } else {
+            cv::cvtColor(*scaled, *bgr, conversionCode);
+        }
+
+        PooledBuffer<std::vector<uchar>> buf = pool.acquireEncodeBuffer(bgr->total());
+        cv::imencode(".jpg", *bgr, *buf, { cv::IMWRITE_JPEG_QUALITY, options.quality });
+        copyToByteArray(buf->data(), buf->size(), jpeg);
+        return !jpeg->isEmpty();
+    }
+    catch (const cv::Exception& e) {
+        qDebug() << "图像编码异常:" << e.what();
+        return false;
+    }
+}
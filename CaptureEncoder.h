@@ -0,0 +1,43 @@
+#pragma once
+
+#include <QByteArray>
+#include <QImage>
+#include <QRect>
+#include <QVideoFrame>
+
+// 拍照编码器：把摄像头帧编码为JPEG
+//
+// 摄像头通常输出YUV(NV12/I420/YUYV)，而JPEG内部本身就是YUV。encodeFrame()直接在映射的
+// YUV平面上完成裁剪和缩小(每个平面一次cv::resize)，然后交给libjpeg-turbo的YUV输入接口压缩，
+// 全程不生成RGB图像。未启用libjpeg-turbo时，420格式在缩小后的平面上转换为BGR再编码，
+// 颜色转换只处理输出尺寸的像素。
+// encodeImage()是原有的QImage → BGR → imencode路径，作为不支持格式的回退和基准测试的对照。
+class CaptureEncoder
+{
+public:
+    struct Options {
+        QRect crop;                 // 相对于原始帧的裁剪区域，为空表示整帧
+        int maxDimension = 640;     // 输出的最长边，只缩小不放大
+        int quality = 90;
+    };
+
+    CaptureEncoder();
+    ~CaptureEncoder();
+    CaptureEncoder(const CaptureEncoder&) = delete;
+    CaptureEncoder& operator=(const CaptureEncoder&) = delete;
+
+    // 编译时是否启用了libjpeg-turbo
+    static bool hasTurboJpeg();
+
+    // 是否可以直接从该像素格式编码(不经过RGB)
+    static bool supportsPixelFormat(QVideoFrameFormat::PixelFormat format);
+
+    // 直接从YUV平面编码；帧格式不支持、镜像或旋转时返回false，调用方应回退到encodeImage()
+    bool encodeFrame(const QVideoFrame& frame, const Options& options, QByteArray* jpeg);
+
+    // 原有路径：QImage转换为BGR后由OpenCV编码
+    bool encodeImage(const QImage& image, const Options& options, QByteArray* jpeg);
+
+private:
+    void* m_turboHandle;
+};
@@ -0,0 +1,124 @@
+#include "DnsCache.h"
+#include <QDebug>
+#include <chrono>
+
+DnsCache::DnsCache(QObject* parent)
+    : QObject(parent),
+    m_ttlMs(300 * 1000),
+    m_maxStaleMs(3600 * 1000)
+{
+}
+
+DnsCache::~DnsCache()
+{
+}
+
+bool DnsCache::lookup(const QString& host, QList<QHostAddress>* addresses)
+{
+    QHostAddress literal;
+    if (literal.setAddress(host)) {
+        *addresses = { literal };
+        return true;
+    }
+
+    QString key = host.toLower();
+    auto it = m_entries.constFind(key);
+    qint64 ageMs = it == m_entries.constEnd() ? 0 : nowMs() - it->resolvedAtMs;
+    if (it != m_entries.constEnd() && ageMs > m_ttlMs + m_maxStaleMs) {
+        // 长时间无法刷新，旧地址可能早已失效
+        m_stats.staleDropped++;
+        m_entries.remove(key);
+        it = m_entries.constEnd();
+    }
+    if (it == m_entries.constEnd() || it->addresses.isEmpty()) {
+        m_stats.misses++;
+        startLookup(key);
+        return false;
+    }
+
+    if (ageMs > m_ttlMs) {
+        m_stats.staleHits++;
+        startLookup(key);
+    } else {
+        m_stats.hits++;
+    }
+    *addresses = ordered(*it);
+    return true;
+}
+
+void DnsCache::prefetch(const QString& host)
+{
+    QHostAddress literal;
+    if (host.isEmpty() || literal.setAddress(host)) {
+        return;
+    }
+    QString key = host.toLower();
+    auto it = m_entries.constFind(key);
+    if (it == m_entries.constEnd() || nowMs() - it->resolvedAtMs > m_ttlMs) {
+        startLookup(key);
+    }
+}
+
+void DnsCache::setPreferredFamily(const QString& host, QAbstractSocket::NetworkLayerProtocol family)
+{
+    auto it = m_entries.find(host.toLower());
+    if (it != m_entries.end()) {
+        it->preferredFamily = family;
+    }
+}
+
+void DnsCache::startLookup(const QString& host)
+{
+    if (m_pending.contains(host)) {
+        return;
+    }
+    m_pending.insert(host);
+    m_stats.lookups++;
+    QHostInfo::lookupHost(host, this, [this, host](const QHostInfo& info) {
+        onLookupFinished(host, info);
+    });
+}
+
+void DnsCache::onLookupFinished(const QString& host, const QHostInfo& info)
+{
+    m_pending.remove(host);
+
+    if (info.error() != QHostInfo::NoError || info.addresses().isEmpty()) {
+        // 保留旧记录，下次使用时再重试
+        m_stats.lookupFailures++;
+        qDebug() << "域名解析失败:" << host << info.errorString();
+        emit resolved(host, false);
+        return;
+    }
+
+    Entry& entry = m_entries[host];
+    entry.addresses = info.addresses();
+    entry.resolvedAtMs = nowMs();
+    emit resolved(host, true);
+}
+
+QList<QHostAddress> DnsCache::ordered(const Entry& entry) const
+{
+    QList<QHostAddress> preferred;
+    QList<QHostAddress> other;
+    for (const QHostAddress& address : entry.addresses) {
+        (address.protocol() == entry.preferredFamily ? preferred : other).append(address);
+    }
+
+    QList<QHostAddress> result;
+    for (int i = 0; i < qMax(preferred.size(), other.size()); ++i) {
+        if (i < preferred.size()) {
+            result.append(preferred[i]);
+        }
+        if (i < other.size()) {
+            result.append(other[i]);
+        }
+    }
+    return result;
+}
+
+qint64 DnsCache::nowMs()
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
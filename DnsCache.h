@@ -0,0 +1,69 @@
+#pragma once
+
+#include <QObject>
+#include <QHash>
+#include <QHostAddress>
+#include <QHostInfo>
+#include <QList>
+#include <QSet>
+#include <QString>
+
+// 服务器域名解析缓存
+//
+// 解析结果按TTL缓存(QHostInfo不提供DNS记录本身的TTL，使用配置值)。过期的记录仍然返回给调用方，
+// 同时在后台重新解析，连接路径上不再等待DNS；解析失败时保留旧记录，网络抖动时仍可直接连接。
+// 过期超过上限的记录不再使用(服务器迁移后不会无限期连到旧地址)，按未命中处理。
+// 返回的地址按首选地址族排在前面、两个地址族交替排列(RFC 8305)，首选地址族由连接竞速的结果更新。
+class DnsCache : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Stats {
+        quint64 hits = 0;           // 命中未过期的记录
+        quint64 staleHits = 0;      // 命中过期记录(同时后台刷新)
+        quint64 staleDropped = 0;   // 过期超过上限而丢弃的记录
+        quint64 misses = 0;
+        quint64 lookups = 0;        // 实际发起的解析次数
+        quint64 lookupFailures = 0;
+    };
+
+    explicit DnsCache(QObject* parent = nullptr);
+    ~DnsCache();
+
+    void setTtl(int seconds) { m_ttlMs = qint64(qMax(1, seconds)) * 1000; }
+    // 记录过期后最多还能使用多久
+    void setMaxStale(int seconds) { m_maxStaleMs = qint64(qMax(0, seconds)) * 1000; }
+
+    // 返回缓存的地址；没有记录时返回false并在后台开始解析。地址字面量直接返回，不进入缓存
+    bool lookup(const QString& host, QList<QHostAddress>* addresses);
+
+    // 没有记录或记录已过期时在后台解析
+    void prefetch(const QString& host);
+
+    // 连接竞速中胜出的地址族，之后该主机的地址以此地址族优先
+    void setPreferredFamily(const QString& host, QAbstractSocket::NetworkLayerProtocol family);
+
+    Stats stats() const { return m_stats; }
+
+signals:
+    void resolved(const QString& host, bool ok);
+
+private:
+    struct Entry {
+        QList<QHostAddress> addresses;
+        qint64 resolvedAtMs = 0;
+        QAbstractSocket::NetworkLayerProtocol preferredFamily = QAbstractSocket::IPv6Protocol;
+    };
+
+    void startLookup(const QString& host);
+    void onLookupFinished(const QString& host, const QHostInfo& info);
+    QList<QHostAddress> ordered(const Entry& entry) const;
+    static qint64 nowMs();
+
+    QHash<QString, Entry> m_entries;
+    QSet<QString> m_pending;
+    qint64 m_ttlMs;
+    qint64 m_maxStaleMs;
+    Stats m_stats;
+};
@@ -0,0 +1,420 @@
+#include "EndpointManager.h"
+#include "AuthTransport.h"
+#include "FaceAuthProtocol.h"
+#include <QDebug>
+#include <QJsonObject>
+#include <QSettings>
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+const double SmoothingFactor = 0.3;     // 滑动平均中新样本的权重
+const int MaxRecentSamples = 32;
+const int DownAfterFailures = 2;
+const double SwitchRatio = 0.8;         // 其他端点快20%以上才切换，避免在相近端点间来回抖动
+const double SwitchMinGainMs = 5.0;
+const double UnmeasuredScore = 1e6;
+
+double smooth(double current, double sample)
+{
+    return current < 0 ? sample : current + SmoothingFactor * (sample - current);
+}
+
+} // namespace
+
+EndpointManager::EndpointManager(AuthTransport* settingsSource, QObject* parent)
+    : QObject(parent),
+    m_settingsSource(settingsSource),
+    m_activeIndex(-1),
+    m_probeTimeoutMs(3000),
+    m_probeSequence(0)
+{
+    m_probeTimer.setInterval(15000);
+    connect(&m_probeTimer, &QTimer::timeout, this, &EndpointManager::probeNow);
+}
+
+EndpointManager::~EndpointManager()
+{
+    while (!m_probes.isEmpty()) {
+        releaseProbe(m_probes.first());
+    }
+}
+
+QList<EndpointManager::Endpoint> EndpointManager::loadEndpoints(QSettings& settings)
+{
+    QList<Endpoint> endpoints;
+    int count = settings.beginReadArray("服务器列表");
+    for (int i = 0; i < count; ++i) {
+        settings.setArrayIndex(i);
+        Endpoint endpoint;
+        endpoint.host = settings.value("地址").toString().trimmed();
+        endpoint.port = quint16(settings.value("端口", 8101).toUInt());
+        if (!endpoint.host.isEmpty() && endpoint.port != 0) {
+            endpoints.append(endpoint);
+        }
+    }
+    settings.endArray();
+
+    if (endpoints.isEmpty()) {
+        Endpoint endpoint;
+        endpoint.host = settings.value("服务器地址", "142.171.34.18").toString();
+        endpoint.port = quint16(settings.value("服务器端口", 8101).toUInt());
+        endpoints.append(endpoint);
+    }
+    return endpoints;
+}
+
+void EndpointManager::saveEndpoints(QSettings& settings, const QList<Endpoint>& endpoints)
+{
+    settings.remove("服务器列表");
+    settings.beginWriteArray("服务器列表", int(endpoints.size()));
+    for (int i = 0; i < endpoints.size(); ++i) {
+        settings.setArrayIndex(i);
+        settings.setValue("地址", endpoints[i].host);
+        settings.setValue("端口", endpoints[i].port);
+    }
+    settings.endArray();
+
+    // 单服务器配置键保留为列表第一项，兼容旧版本
+    if (!endpoints.isEmpty()) {
+        settings.setValue("服务器地址", endpoints.first().host);
+        settings.setValue("服务器端口", endpoints.first().port);
+    }
+}
+
+void EndpointManager::loadSettings()
+{
+    QSettings settings("FaceAuthTeam", "FaceAuthAccess");
+    setProbeInterval(settings.value("端点探测间隔秒", 15).toInt() * 1000);
+    setEndpoints(loadEndpoints(settings));
+}
+
+void EndpointManager::setEndpoints(const QList<Endpoint>& endpoints)
+{
+    // 进行中的探测按旧的下标记录结果，直接丢弃
+    while (!m_probes.isEmpty()) {
+        releaseProbe(m_probes.first());
+    }
+
+    Endpoint previousActive = activeEndpoint();
+    QVector<Entry> entries;
+    for (const Endpoint& endpoint : endpoints) {
+        int existing = indexOf(endpoint.host, endpoint.port);
+        if (existing >= 0) {
+            entries.append(m_entries[existing]);
+        } else {
+            Entry entry;
+            entry.stats.endpoint = endpoint;
+            entries.append(entry);
+        }
+    }
+    m_entries = entries;
+
+    // 在尚无测量数据时使用列表中的第一项，与单服务器配置的行为一致
+    m_activeIndex = indexOf(previousActive.host, previousActive.port);
+    if (m_activeIndex < 0 && !m_entries.isEmpty()) {
+        m_activeIndex = 0;
+    }
+    selectActive();
+
+    Endpoint active = activeEndpoint();
+    if (active.host != previousActive.host || active.port != previousActive.port) {
+        emit activeEndpointChanged(active.host, active.port);
+    }
+    emit statsChanged();
+}
+
+void EndpointManager::setProbeInterval(int ms)
+{
+    m_probeTimer.setInterval(qMax(1000, ms));
+}
+
+QVector<EndpointManager::EndpointStats> EndpointManager::stats() const
+{
+    QVector<EndpointStats> result;
+    result.reserve(m_entries.size());
+    for (const Entry& entry : m_entries) {
+        result.append(entry.stats);
+    }
+    return result;
+}
+
+EndpointManager::Endpoint EndpointManager::activeEndpoint() const
+{
+    if (m_activeIndex < 0 || m_activeIndex >= m_entries.size()) {
+        return Endpoint();
+    }
+    return m_entries[m_activeIndex].stats.endpoint;
+}
+
+QList<EndpointManager::Endpoint> EndpointManager::candidates() const
+{
+    QVector<int> order;
+    for (int i = 0; i < m_entries.size(); ++i) {
+        order.append(i);
+    }
+    std::stable_sort(order.begin(), order.end(), [this](int a, int b) {
+        if (a == m_activeIndex || b == m_activeIndex) {
+            return a == m_activeIndex && b != m_activeIndex;
+        }
+        return routingScore(m_entries[a]) < routingScore(m_entries[b]);
+    });
+
+    QList<Endpoint> result;
+    for (int index : order) {
+        result.append(m_entries[index].stats.endpoint);
+    }
+    return result;
+}
+
+void EndpointManager::reportSuccess(const QString& host, quint16 port)
+{
+    int index = indexOf(host, port);
+    if (index < 0) {
+        return;
+    }
+    EndpointStats& stats = m_entries[index].stats;
+    if (stats.consecutiveFailures > 0 || stats.health == Health::Down || stats.health == Health::Unknown) {
+        stats.health = Health::Healthy;
+    }
+    stats.consecutiveFailures = 0;
+    emit statsChanged();
+}
+
+void EndpointManager::reportFailure(const QString& host, quint16 port, const QString& reason)
+{
+    int index = indexOf(host, port);
+    if (index < 0) {
+        return;
+    }
+    recordFailure(m_entries[index], reason);
+    qDebug() << "端点" << host << port << "业务连接失败:" << reason;
+
+    Endpoint previousActive = activeEndpoint();
+    selectActive();
+    Endpoint active = activeEndpoint();
+    if (active.host != previousActive.host || active.port != previousActive.port) {
+        emit activeEndpointChanged(active.host, active.port);
+    }
+    emit statsChanged();
+}
+
+QString EndpointManager::healthText(Health health)
+{
+    switch (health) {
+    case Health::Healthy:
+        return "正常";
+    case Health::Degraded:
+        return "降级";
+    case Health::Down:
+        return "不可用";
+    default:
+        return "未探测";
+    }
+}
+
+void EndpointManager::start()
+{
+    m_probeTimer.start();
+    probeNow();
+}
+
+void EndpointManager::stop()
+{
+    m_probeTimer.stop();
+    while (!m_probes.isEmpty()) {
+        releaseProbe(m_probes.first());
+    }
+}
+
+void EndpointManager::probeNow()
+{
+    if (!m_probes.isEmpty()) {
+        return;
+    }
+    for (int i = 0; i < m_entries.size(); ++i) {
+        startProbe(i);
+    }
+}
+
+void EndpointManager::startProbe(int index)
+{
+    Probe* probe = new Probe;
+    probe->index = index;
+    probe->transport = new AuthTransport(this);
+    probe->transport->copySettingsFrom(*m_settingsSource);
+    probe->timeout = new QTimer(this);
+    probe->timeout->setSingleShot(true);
+    m_probes.append(probe);
+
+    connect(probe->transport, &AuthTransport::connectionEstablished, this,
+            [this, probe](const AuthTransport::ConnectionStats& stats) {
+        onProbeConnected(probe, stats.tcpConnectMs);
+    });
+    connect(probe->transport, &AuthTransport::connectionFailed, this, [this, probe](const QString& error) {
+        finishProbe(probe, false, false, 0, error);
+    });
+    connect(probe->transport->socket(), &QTcpSocket::readyRead, this, [this, probe]() {
+        onProbeReadyRead(probe);
+    });
+    connect(probe->transport->socket(), &QTcpSocket::disconnected, this, [this, probe]() {
+        finishProbe(probe, false, false, 0, "连接断开");
+    });
+    connect(probe->timeout, &QTimer::timeout, this, [this, probe]() {
+        finishProbe(probe, false, false, 0, probe->pingSent ? "响应超时" : "连接超时");
+    });
+
+    const Endpoint& endpoint = m_entries[index].stats.endpoint;
+    probe->timeout->start(m_probeTimeoutMs);
+    probe->transport->beginConnect(endpoint.host, endpoint.port);
+}
+
+void EndpointManager::onProbeConnected(Probe* probe, qint64 tcpConnectMs)
+{
+    EndpointStats& stats = m_entries[probe->index].stats;
+    stats.rttMs = smooth(stats.rttMs, double(tcpConnectMs));
+
+    // 协议级探测：请求经过服务器的请求队列，排队过长时同样会返回busy
+    QJsonObject ping;
+    ping["type"] = "ping";
+    ping["request_id"] = QString("probe-%1").arg(++m_probeSequence);
+    ping["face_data_size"] = 0;
+    probe->pingTimer.start();
+    probe->pingSent = true;
+    if (probe->transport->socket()->write(FaceAuthProtocol::buildRequestPacket(ping, QByteArray())) == -1) {
+        finishProbe(probe, false, false, 0, probe->transport->socket()->errorString());
+    }
+}
+
+void EndpointManager::onProbeReadyRead(Probe* probe)
+{
+    probe->receiveBuffer.append(probe->transport->socket()->readAll());
+
+    QJsonObject response;
+    int consumed = 0;
+    FaceAuthProtocol::ParseResult result = FaceAuthProtocol::parseResponse(probe->receiveBuffer, &response, &consumed);
+    if (result == FaceAuthProtocol::ParseResult::Incomplete) {
+        return;
+    }
+    if (result != FaceAuthProtocol::ParseResult::Complete) {
+        finishProbe(probe, false, false, 0, "无效的响应");
+        return;
+    }
+
+    // 不认识ping的旧版服务器返回"不支持的请求类型"，同样是一次完整的协议往返
+    double protocolMs = probe->pingTimer.nsecsElapsed() / 1e6;
+    finishProbe(probe, true, response.value("busy").toBool(), protocolMs, QString());
+}
+
+void EndpointManager::finishProbe(Probe* probe, bool ok, bool busy, double protocolMs, const QString& error)
+{
+    Entry& entry = m_entries[probe->index];
+    EndpointStats& stats = entry.stats;
+    stats.probes++;
+
+    if (ok) {
+        stats.lastProtocolMs = protocolMs;
+        stats.protocolMs = smooth(stats.protocolMs, protocolMs);
+        entry.recentProtocolMs.append(protocolMs);
+        if (entry.recentProtocolMs.size() > MaxRecentSamples) {
+            entry.recentProtocolMs.removeFirst();
+        }
+        QList<double> sorted = entry.recentProtocolMs;
+        std::sort(sorted.begin(), sorted.end());
+        int p95Index = qMax(0, int(std::ceil(sorted.size() * 0.95)) - 1);
+        stats.protocolP95Ms = sorted[p95Index];
+
+        stats.consecutiveFailures = 0;
+        stats.lastError = busy ? QString("服务器繁忙") : QString();
+        stats.health = busy ? Health::Degraded : Health::Healthy;
+    } else {
+        recordFailure(entry, error);
+    }
+
+    releaseProbe(probe);
+
+    Endpoint previousActive = activeEndpoint();
+    selectActive();
+    Endpoint active = activeEndpoint();
+    if (active.host != previousActive.host || active.port != previousActive.port) {
+        qDebug() << "切换认证服务器:" << previousActive.host << previousActive.port
+                 << "->" << active.host << active.port;
+        emit activeEndpointChanged(active.host, active.port);
+    }
+    emit statsChanged();
+}
+
+void EndpointManager::releaseProbe(Probe* probe)
+{
+    m_probes.removeOne(probe);
+    probe->timeout->stop();
+    probe->transport->disconnect(this);
+    probe->transport->socket()->disconnect(this);
+    probe->transport->socket()->abort();
+    probe->transport->deleteLater();
+    probe->timeout->deleteLater();
+    delete probe;
+}
+
+void EndpointManager::recordFailure(Entry& entry, const QString& reason)
+{
+    EndpointStats& stats = entry.stats;
+    stats.failures++;
+    stats.consecutiveFailures++;
+    stats.lastError = reason;
+    stats.health = stats.consecutiveFailures >= DownAfterFailures ? Health::Down : Health::Degraded;
+}
+
+int EndpointManager::indexOf(const QString& host, quint16 port) const
+{
+    for (int i = 0; i < m_entries.size(); ++i) {
+        const Endpoint& endpoint = m_entries[i].stats.endpoint;
+        if (endpoint.port == port && endpoint.host.compare(host, Qt::CaseInsensitive) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+double EndpointManager::routingScore(const Entry& entry) const
+{
+    const EndpointStats& stats = entry.stats;
+    if (stats.health == Health::Down) {
+        return UnmeasuredScore * 2;
+    }
+    double score = stats.protocolMs >= 0 ? stats.protocolMs
+                 : (stats.rttMs >= 0 ? stats.rttMs : UnmeasuredScore);
+    if (stats.health == Health::Degraded) {
+        score = score * 4 + 500;
+    }
+    return score;
+}
+
+void EndpointManager::selectActive()
+{
+    int best = -1;
+    for (int i = 0; i < m_entries.size(); ++i) {
+        if (m_entries[i].stats.health == Health::Down) {
+            continue;
+        }
+        if (best < 0 || routingScore(m_entries[i]) < routingScore(m_entries[best])) {
+            best = i;
+        }
+    }
+    if (best < 0) {
+        // 全部不可用时保持当前端点，等待下一轮探测
+        return;
+    }
+    if (m_activeIndex < 0 || m_activeIndex >= m_entries.size()
+        || m_entries[m_activeIndex].stats.health == Health::Down) {
+        m_activeIndex = best;
+        return;
+    }
+
+    double activeScore = routingScore(m_entries[m_activeIndex]);
+    double bestScore = routingScore(m_entries[best]);
+    if (bestScore < activeScore * SwitchRatio && activeScore - bestScore > SwitchMinGainMs) {
+        m_activeIndex = best;
+    }
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QList>
+#include <QString>
+#include <QTimer>
+#include <QVector>
+
+class AuthTransport;
+class QSettings;
+
+// 多服务器端点管理：后台周期性探测每个认证服务器，选择最快且健康的端点
+//
+// 每轮探测对所有端点并行建立连接(沿用主传输层的TLS设置)，记录TCP连接耗时(RTT)，
+// 然后发送一个ping请求并计时到收到RESP(协议级响应时间，包含服务器排队)。
+// 连续失败达到阈值的端点标记为不可用，服务器返回busy或偶发失败的端点标记为降级；
+// 当前端点不可用或降级、或其他端点明显更快时切换，并发出activeEndpointChanged。
+class EndpointManager : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Endpoint {
+        QString host;
+        quint16 port = 0;
+    };
+
+    enum class Health {
+        Unknown,    // 尚未探测
+        Healthy,
+        Degraded,   // 服务器繁忙或最近一次探测失败
+        Down        // 连续失败，暂不路由
+    };
+
+    struct EndpointStats {
+        Endpoint endpoint;
+        Health health = Health::Unknown;
+        double rttMs = -1.0;            // TCP连接耗时的指数滑动平均
+        double protocolMs = -1.0;       // ping往返耗时的指数滑动平均
+        double lastProtocolMs = -1.0;
+        double protocolP95Ms = -1.0;    // 最近若干次ping的P95
+        int consecutiveFailures = 0;
+        quint64 probes = 0;
+        quint64 failures = 0;
+        QString lastError;
+    };
+
+    explicit EndpointManager(AuthTransport* settingsSource, QObject* parent = nullptr);
+    ~EndpointManager();
+
+    // 读写设置中的端点列表；列表为空时回退到单个"服务器地址"/"服务器端口"
+    static QList<Endpoint> loadEndpoints(QSettings& settings);
+    static void saveEndpoints(QSettings& settings, const QList<Endpoint>& endpoints);
+
+    // 重新读取端点列表和探测间隔，保留仍在列表中的端点的统计
+    void loadSettings();
+    void setEndpoints(const QList<Endpoint>& endpoints);
+    void setProbeInterval(int ms);
+    void setProbeTimeout(int ms) { m_probeTimeoutMs = ms; }
+
+    QVector<EndpointStats> stats() const;
+    Endpoint activeEndpoint() const;
+
+    // 按路由优先级排列的端点(不可用的排在最后)，用于连接失败时依次尝试
+    QList<Endpoint> candidates() const;
+
+    // 业务连接的结果，失败会立即触发重新选择
+    void reportSuccess(const QString& host, quint16 port);
+    void reportFailure(const QString& host, quint16 port, const QString& reason);
+
+    static QString healthText(Health health);
+
+public slots:
+    void start();
+    void stop();
+    // 立即开始一轮探测(上一轮未结束时忽略)
+    void probeNow();
+
+signals:
+    void activeEndpointChanged(const QString& host, quint16 port);
+    void statsChanged();
+
+private:
+    struct Entry {
+        EndpointStats stats;
+        QList<double> recentProtocolMs;
+    };
+
+    struct Probe {
+        int index = -1;
+        AuthTransport* transport = nullptr;
+        QTimer* timeout = nullptr;
+        QByteArray receiveBuffer;
+        QElapsedTimer pingTimer;
+        bool pingSent = false;
+    };
+
+    void startProbe(int index);
+    void onProbeConnected(Probe* probe, qint64 tcpConnectMs);
+    void onProbeReadyRead(Probe* probe);
+    void finishProbe(Probe* probe, bool ok, bool busy, double protocolMs, const QString& error);
+    void releaseProbe(Probe* probe);
+    void recordFailure(Entry& entry, const QString& reason);
+    int indexOf(const QString& host, quint16 port) const;
+    double routingScore(const Entry& entry) const;
+    void selectActive();
+
+    AuthTransport* m_settingsSource;
+    QVector<Entry> m_entries;
+    QList<Probe*> m_probes;
+    int m_activeIndex;
+    QTimer m_probeTimer;
+    int m_probeTimeoutMs;
+    quint64 m_probeSequence;
+};
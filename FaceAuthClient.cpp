@@ -15,17 +15,48 @@
 #include <QCamera>
 #include <QBoxLayout>
 #include <QVideoFrame>
+#include <QPainter>
+#include <cstring>
+#include "FrameBufferPool.h"
+#include "ImageConversion.h"
+#include "FaceAuthProtocol.h"
+#include "FaceAuthCore.h"
+#include "OfflineJournal.h"
+#include "JournalReplayer.h"
+#include "KioskController.h"
+#include "CaptureEncoder.h"
+#include "BurstCapture.h"
+#include "FrameRing.h"
+#include "Trace.h"
+#include "Log.h"
+#include <QElapsedTimer>
+#include <QCoreApplication>
+#include <algorithm>
+#include <QTimer>
+
 //构造时初始化
 FaceAuthClient::FaceAuthClient(QWidget* parent)
     : QMainWindow(parent),
     m_socket(nullptr),
+    m_core(nullptr),
+    m_kiosk(nullptr),
+    m_overlayLabel(nullptr),
+    m_overlayTimer(nullptr),
+    m_showFaceTracks(false),
     m_camera(nullptr),
     m_captureSession(nullptr),
     m_videoSink(nullptr),
     m_imageCapture(nullptr),
     m_isCameraActive(false),
-    m_serverAddress("142.171.34.18"),
-    m_serverPort(8101)
+    m_burst(nullptr),
+    m_captureEncoder(new CaptureEncoder),
+    m_frameRing(nullptr),
+    m_traceClockOffsetUs(0),
+    m_traceClockOffsetValid(false),
+    m_frameCount(0),
+    m_fallbackFrameCount(0),
+    m_statsFrameMark(0),
+    m_statsAllocationMark(0)
 {
     ui.setupUi(this);
 
@@ -35,11 +66,41 @@ FaceAuthClient::FaceAuthClient(QWidget* parent)
         return;
     }
 
-    // 初始化网络连接
-    m_socket = new QTcpSocket(this);
+    // 认证核心：连接、请求收发和离线补发，与无界面的门禁守护进程共用
+    m_core = new FaceAuthCore(this);
+    m_socket = m_core->socket();
+    connect(m_core, &FaceAuthCore::statusMessage, ui.statusLabel, &QLabel::setText);
+    connect(m_core, &FaceAuthCore::authFinished, this, &FaceAuthClient::onAuthFinished);
+    connect(m_core, &FaceAuthCore::identifyFinished, this, &FaceAuthClient::handleIdentifyResponse);
+    connect(m_core, &FaceAuthCore::activeEndpointChanged, this, &FaceAuthClient::onActiveEndpointChanged);
+    connect(m_core, &FaceAuthCore::requestsAborted, this, &FaceAuthClient::onRequestsAborted);
+    connect(m_core->replayer(), &JournalReplayer::recordReplayed, this, &FaceAuthClient::onJournalRecordReplayed);
+    connect(m_core->replayer(), &JournalReplayer::replayFinished, this, &FaceAuthClient::onJournalReplayFinished);
+    
+    // 连拍：多帧并行编码，服务器融合各帧特征
+    m_burst = new BurstCapture(this);
+    connect(m_burst, &BurstCapture::finished, this, &FaceAuthClient::onBurstCaptured);
+    
+    // 自助模式：人脸检测自动提交识别请求，结果以不阻塞的浮层显示
+    m_kiosk = new KioskController(this);
+    connect(m_kiosk, &KioskController::faceCaptured, this, &FaceAuthClient::onKioskFaceCaptured);
+    connect(m_kiosk, &KioskController::faceDetected, this, [this]() { m_core->speculativeConnect("face"); });
+    connect(m_core, &FaceAuthCore::identifyDropped, this, [this](const QString& error) {
+        // 连接未建立，排队中的请求都未发出
+        m_pendingIdentify.clear();
+        m_kiosk->resetPresence();
+        showOverlay("网络错误: " + error, false);
+    });
+    
+    m_overlayLabel = new QLabel(ui.cameraView);
+    m_overlayLabel->setAlignment(Qt::AlignCenter);
+    m_overlayLabel->hide();
+    m_overlayTimer = new QTimer(this);
+    m_overlayTimer->setSingleShot(true);
+    connect(m_overlayTimer, &QTimer::timeout, m_overlayLabel, &QLabel::hide);
+    
     connect(m_socket, &QTcpSocket::connected, this, &FaceAuthClient::onSocketConnected);
     connect(m_socket, &QTcpSocket::disconnected, this, &FaceAuthClient::onSocketDisconnected);
-    connect(m_socket, &QTcpSocket::readyRead, this, &FaceAuthClient::onSocketReadyRead);
     connect(m_socket, &QTcpSocket::errorOccurred, this, &FaceAuthClient::onSocketError);
 
     // 初始化摄像头
@@ -59,9 +120,22 @@ FaceAuthClient::FaceAuthClient(QWidget* parent)
     connect(ui.captureButton, &QPushButton::clicked, this, &FaceAuthClient::onCaptureButtonClicked);
     connect(ui.registerButton, &QPushButton::clicked, this, &FaceAuthClient::onRegisterButtonClicked);
     
+    // 开始输入用户名或密码时预连接，点击登录时连接通常已就绪
+    connect(ui.usernameEdit, &QLineEdit::textEdited, this, [this]() { m_core->speculativeConnect("typing"); });
+    connect(ui.passwordEdit, &QLineEdit::textEdited, this, [this]() { m_core->speculativeConnect("typing"); });
+    
     // 绑定菜单事件
     connect(ui.actionServer_Settings, &QAction::triggered, this, &FaceAuthClient::onServerSettingsTriggered);
     connect(ui.actionExit, &QAction::triggered, this, &FaceAuthClient::close);
+    connect(ui.actionKiosk_Mode, &QAction::toggled, this, &FaceAuthClient::onKioskModeToggled);
+    connect(ui.actionEnable_Tracing, &QAction::toggled, this, &FaceAuthClient::onTracingToggled);
+    connect(ui.actionExport_Trace, &QAction::triggered, this, &FaceAuthClient::onExportTraceTriggered);
+    
+    // 性能跟踪：设置项或环境变量FACEAUTH_TRACE=1时启动即开启
+    Trace::setThreadName("GUI");
+    QSettings traceSettings("FaceAuthTeam", "FaceAuthAccess");
+    ui.actionEnable_Tracing->setChecked(traceSettings.value("性能跟踪", false).toBool()
+                                        || qEnvironmentVariableIntValue("FACEAUTH_TRACE") != 0);
     
     // 自动启动摄像头
     startCamera();
@@ -76,26 +150,22 @@ FaceAuthClient::~FaceAuthClient()
     if (m_socket && m_socket->isOpen()) {
         m_socket->close();
     }
+    
+    delete m_captureEncoder;
+    delete m_frameRing;
 }
 
 void FaceAuthClient::onServerSettingsTriggered()
 {
-    ServerSettingsDialog dialog(m_serverAddress, m_serverPort, this);
+    ServerSettingsDialog dialog(m_core->serverAddress(), m_core->serverPort(), this);
+    dialog.setEndpointManager(m_core->endpoints());
     if (dialog.exec() == QDialog::Accepted) {
-        m_serverAddress = dialog.getServerAddress();
-        m_serverPort = dialog.getServerPort();
-        
-        // 如果已经连接，则需要断开重连
-        if (m_socket->state() == QAbstractSocket::ConnectedState) {
-            m_socket->disconnectFromHost();
+        // 对话框已保存服务器列表和TLS设置，由核心断开旧连接、重新应用并保存当前服务器
+        if (m_core->reloadSettings()) {
+            ui.statusLabel->setText("Server settings updated");
+        } else {
+            ui.statusLabel->setText("无法加载TLS CA证书");
         }
-        
-        ui.statusLabel->setText("Server settings updated");
-        
-        // 保存设置到配置文件
-        QSettings settings("FaceAuthTeam", "FaceAuthAccess");
-        settings.setValue("ServerAddress", m_serverAddress);
-        settings.setValue("ServerPort", m_serverPort);
     }
 }
 
@@ -103,7 +173,7 @@ bool FaceAuthClient::initOpenCV()
 {
     try {
         // 输出OpenCV版本信息
-        qDebug() << "OpenCV版本:" << CV_VERSION;
+        LOG_INFO(Log::app) << "OpenCV版本:" << CV_VERSION;
         
         // 执行一个简单的OpenCV操作来测试库是否正确加载
         cv::Mat testMat(10, 10, CV_8UC1, cv::Scalar(0));
@@ -115,28 +185,28 @@ bool FaceAuthClient::initOpenCV()
             // 测试内存分配和深拷贝操作
             cv::Mat testClone = testMat.clone();
             if (testClone.empty()) {
-                qDebug() << "OpenCV克隆操作失败";
+                LOG_WARNING(Log::app) << "OpenCV克隆操作失败";
                 return false;
             }
             
             // 如果没有崩溃，说明基本操作正常
-            qDebug() << "OpenCV初始化成功";
+            LOG_INFO(Log::app) << "OpenCV初始化成功";
         } else {
-            qDebug() << "OpenCV测试矩阵创建失败";
+            LOG_WARNING(Log::app) << "OpenCV测试矩阵创建失败";
         }
         
         return success;
     }
     catch (const cv::Exception& e) {
-        qDebug() << "OpenCV异常:" << e.what();
+        LOG_WARNING(Log::app) << "OpenCV异常:" << e.what();
         return false;
     }
     catch (const std::exception& e) {
-        qDebug() << "标准异常:" << e.what();
+        LOG_WARNING(Log::app) << "标准异常:" << e.what();
         return false;
     }
     catch (...) {
-        qDebug() << "OpenCV初始化过程中发生未知异常";
+        LOG_WARNING(Log::app) << "OpenCV初始化过程中发生未知异常";
         return false;
     }
 }
@@ -182,9 +252,10 @@ bool FaceAuthClient::startCamera()
         // 如果找到了合适格式，设置相机格式
         if (!bestFormat.isNull()) {
             m_camera->setCameraFormat(bestFormat);
-            qDebug() << "设置相机分辨率:" << bestFormat.resolution() 
-                     << "最大帧率:" << bestFormat.maxFrameRate();
+            LOG_INFO(Log::camera) << "设置相机分辨率:" << bestFormat.resolution() 
+                                  << "最大帧率:" << bestFormat.maxFrameRate();
         }
+        createFrameRing(bestFormat.isNull() ? QSize(1280, 720) : bestFormat.resolution());
         
         // 设置捕获会话的相机
         m_captureSession->setCamera(m_camera);
@@ -193,7 +264,7 @@ bool FaceAuthClient::startCamera()
         m_camera->start();
         m_isCameraActive = true;
         
-        qDebug() << "相机已启动";
+        LOG_INFO(Log::camera) << "相机已启动";
         return true;
     }
     catch (const std::exception& e) {
@@ -218,6 +289,12 @@ void FaceAuthClient::stopCamera()
     }
     
     m_isCameraActive = false;
+    m_lastFrame = QVideoFrame();
+    if (m_burst && m_burst->isActive()) {
+        m_burst->cancel();
+        ui.captureButton->setEnabled(true);
+    }
+    ui.cameraView->clearFrame();
     ui.cameraView->setText("Camera stopped");
 }
 
@@ -227,24 +304,90 @@ void FaceAuthClient::onFrameAvailable(const QVideoFrame &frame)
         return;
     }
     
+    // 保留原始帧的引用(不拷贝像素)，拍照时直接从YUV平面编码
+    m_lastFrame = frame;
+    if (m_burst->isActive()) {
+        m_burst->offerFrame(frame);
+    }
+    
+    if (Trace::enabled()) {
+        traceFrameArrival(frame);
+    }
+    
+    // 自助模式下把帧交给检测流水线(检测器忙时自动丢帧)
+    if (m_kiosk && m_kiosk->isEnabled()) {
+        m_kiosk->offerFrame(frame);
+    }
+    
+    if (m_frameRing) {
+        publishFrame(frame);
+    }
+    
     try {
-        // 仅将QVideoFrame转换为QImage用于UI显示
-        QImage image = frame.toImage();
+        TRACE_SCOPE("preview.paint", "camera");
+        FrameBufferPool& pool = FrameBufferPool::instance();
+        bool previewed = false;
+        
+        // 优先直接映射帧数据并缩放(YUV格式同时转换为RGB)到池化的QImage中，避免每帧toImage()、
+        // 整帧QPixmap和缩放后QPixmap三次分配；视图持有这一帧直到下一帧到来，随后归还缓冲池
+        QVideoFrame mappedFrame(frame);
+        if (!mappedFrame.surfaceFormat().isMirrored()
+            && mappedFrame.surfaceFormat().scanLineDirection() == QVideoFrameFormat::TopToBottom
+            && mappedFrame.rotation() == QtVideo::Rotation::None
+            && mappedFrame.map(QVideoFrame::ReadOnly)) {
+            QImage::Format format = ImageConversion::previewImageFormat(mappedFrame.pixelFormat());
+            QSize targetSize = mappedFrame.size().scaled(ui.cameraView->contentsRect().size(), Qt::KeepAspectRatio);
+            targetSize = QSize(targetSize.width() & ~1, targetSize.height() & ~1);
+            
+            if (format != QImage::Format_Invalid && !targetSize.isEmpty()) {
+                PooledBuffer<QImage> preview = pool.acquireImage(targetSize, format);
+                if (ImageConversion::scaleMappedPreview(mappedFrame, &*preview, &m_previewScratch)) {
+                    drawFaceTracks(&*preview);
+                    ui.cameraView->showFrame(std::move(preview));
+                    previewed = true;
+                }
+            }
+            mappedFrame.unmap();
+        }
         
-        if (image.isNull()) {
-            return;
+        if (!previewed) {
+            // 无法直接映射的帧(镜像、自下而上、旋转、映射失败，或scaleMappedPreview不支持的格式如P010/MJPEG)回退到toImage()
+            QImage image = frame.toImage();
+            
+            if (image.isNull()) {
+                return;
+            }
+            
+            // 显示图像到UI 
+            image = image.scaled(ui.cameraView->contentsRect().size(), Qt::KeepAspectRatio, Qt::SmoothTransformation);
+            drawFaceTracks(&image);
+            ui.cameraView->showImage(image);
+            m_fallbackFrameCount++;
         }
         
-        // 显示图像到UI 
-        QPixmap pixmap = QPixmap::fromImage(image);
-        ui.cameraView->setPixmap(pixmap.scaled(
-            ui.cameraView->size(), Qt::KeepAspectRatio, Qt::SmoothTransformation));
+        // 定期输出缓冲池统计，稳定运行时每帧分配次数应接近0
+        m_frameCount++;
+        if (m_frameCount - m_statsFrameMark >= 300) {
+            FrameBufferPool::Stats stats = pool.stats();
+            double allocsPerFrame = double(stats.allocations - m_statsAllocationMark)
+                                    / double(m_frameCount - m_statsFrameMark);
+            LOG_DEBUG(Log::camera) << "帧缓冲池: 分配=" << stats.allocations << ", 复用=" << stats.reuses
+                                   << ", 丢弃=" << stats.dropped << ", 借出=" << stats.outstanding
+                                   << ", 池内字节=" << stats.pooledBytes << ", 每帧分配=" << allocsPerFrame
+                                   << ", 回退帧=" << m_fallbackFrameCount;
+            if (m_frameRing) {
+                FrameRingWriter::Stats ringStats = m_frameRing->stats();
+                LOG_DEBUG(Log::camera) << "共享帧环: 发布=" << ringStats.published << ", 超出槽容量=" << ringStats.oversized;
+            }
+            m_statsFrameMark = m_frameCount;
+            m_statsAllocationMark = stats.allocations;
+        }
     }
     catch (const std::exception& e) {
-        qDebug() << "处理帧时发生异常:" << e.what();
+        LOG_WARNING(Log::camera) << "处理帧时发生异常:" << e.what();
     }
     catch (...) {
-        qDebug() << "处理帧时发生未知异常";
+        LOG_WARNING(Log::camera) << "处理帧时发生未知异常";
     }
 }
 
@@ -252,64 +395,32 @@ QImage FaceAuthClient::matToQImage(const cv::Mat& mat)
 {
     // 检查图像是否为空
     if (mat.empty()) {
-        qDebug() << "Empty matrix in matToQImage";
+        LOG_WARNING(Log::camera) << "Empty matrix in matToQImage";
         return QImage();
     }
     
-    // 检查数据连续性
-    if (!mat.isContinuous()) {
-        qDebug() << "Matrix is not continuous, creating a continuous copy";
-        return matToQImage(mat.clone());
-    }
-    
     // 检查数据是否有效
     if (mat.data == nullptr) {
-        qDebug() << "Matrix data is null";
+        LOG_WARNING(Log::camera) << "Matrix data is null";
         return QImage();
     }
     
     try {
-        // 根据图像类型转换为QImage
-        if (mat.type() == CV_8UC3) {
-            // BGR → RGB转换
-            cv::Mat rgbMat;
-            cv::cvtColor(mat, rgbMat, cv::COLOR_BGR2RGB);
-            
-            QImage image(rgbMat.data, rgbMat.cols, rgbMat.rows, 
-                    static_cast<int>(rgbMat.step), QImage::Format_RGB888);
-            
-            // 创建深拷贝以避免OpenCV图像被释放后出现问题
-            return image.copy();
-        }
-        else if (mat.type() == CV_8UC1) {
-            // 灰度图像
-            QImage image(mat.data, mat.cols, mat.rows, 
-                    static_cast<int>(mat.step), QImage::Format_Grayscale8);
-                    
-            // 创建深拷贝
-            return image.copy();
-    }
-    else {
-            qDebug() << "Unsupported matrix format: " << mat.type();
-            
-            // 尝试转换为RGB
-            cv::Mat rgbMat;
-            cv::cvtColor(mat, rgbMat, cv::COLOR_BGR2RGB);
-            
-            QImage image(rgbMat.data, rgbMat.cols, rgbMat.rows, 
-                    static_cast<int>(rgbMat.step), QImage::Format_RGB888);
-                    
-            return image.copy();
+        if (mat.type() != CV_8UC1 && mat.type() != CV_8UC3) {
+            LOG_WARNING(Log::camera) << "Unsupported matrix format: " << mat.type();
         }
+        
+        // 直接转换到QImage自己的像素缓冲区，省去中间cv::Mat和image.copy()(其他格式也尝试按BGR转换)
+        return ImageConversion::matToImage(mat);
     }
     catch (const cv::Exception& e) {
-        qDebug() << "OpenCV exception in matToQImage:" << e.what();
+        LOG_WARNING(Log::camera) << "OpenCV exception in matToQImage:" << e.what();
     }
     catch (const std::exception& e) {
-        qDebug() << "Standard exception in matToQImage:" << e.what();
+        LOG_WARNING(Log::camera) << "Standard exception in matToQImage:" << e.what();
     }
     catch (...) {
-        qDebug() << "Unknown exception in matToQImage";
+        LOG_WARNING(Log::camera) << "Unknown exception in matToQImage";
     }
     
     return QImage(); // 出错时返回空图像
@@ -322,40 +433,63 @@ void FaceAuthClient::onCaptureButtonClicked()
         return;
     }
     
+    // 拍照时人脸已在镜头前，接下来通常是登录或注册
+    m_core->speculativeConnect("capture");
+    
     try {
-        // 从相机视图获取当前显示的图像
-        QPixmap currentPixmap = ui.cameraView->pixmap(Qt::ReturnByValue);
-        if (currentPixmap.isNull()) {
-            QMessageBox::warning(this, "错误", "无法获取当前图像");
+        TRACE_SCOPE("capture", "capture");
+        QSettings settings("FaceAuthTeam", "FaceAuthAccess");
+        CaptureEncoder::Options options;
+        options.maxDimension = settings.value("拍照最大边长", 640).toInt();
+        options.quality = settings.value("拍照JPEG质量", 95).toInt();
+        
+        // 连拍：当前帧和之后窗口内的若干帧在线程池中并行编码，全部完成后由onBurstCaptured()保存
+        int burstFrames = qBound(1, settings.value("连拍帧数", 1).toInt(), 8);
+        if (burstFrames > 1 && m_lastFrame.isValid()) {
+            if (!m_burst->start(burstFrames, settings.value("连拍窗口毫秒", 200).toInt(), options)) {
+                return;
+            }
+            m_capturedFaceData.clear();
+            m_capturedFrameLayout = QJsonArray();
+            ui.captureButton->setEnabled(false);
+            ui.statusLabel->setText("连拍中...");
+            m_burst->offerFrame(m_lastFrame);
+            encodeCaptureThumbnail(QImage());
             return;
         }
         
-        // 转换为QImage，并确保是RGB格式
-        QImage capturedImage = currentPixmap.toImage().convertToFormat(QImage::Format_RGB888);
-        
-        // 将QImage直接转换为cv::Mat
-        cv::Mat capturedFrame(
-            capturedImage.height(),
-            capturedImage.width(),
-            CV_8UC3,
-            const_cast<uchar*>(capturedImage.constBits()),
-            capturedImage.bytesPerLine()
-        );
-        
-        // 由于QImage是RGB格式，OpenCV是BGR格式，需要转换颜色空间
-        cv::Mat bgrFrame;
-        cv::cvtColor(capturedFrame, bgrFrame, cv::COLOR_RGB2BGR);
+        // 优先直接从摄像头的YUV平面编码，裁剪、缩小和压缩之间不生成RGB图像
+        QElapsedTimer timer;
+        timer.start();
+        qint64 encodeStartUs = Trace::spanStart();
+        bool fused = m_lastFrame.isValid() && m_captureEncoder->encodeFrame(m_lastFrame, options, &m_capturedFaceData);
+        
+        QImage fallbackImage;
+        if (!fused) {
+            // 不支持的像素格式回退到当前显示的预览图像
+            fallbackImage = ui.cameraView->currentFrame();
+            if (fallbackImage.isNull()) {
+                QMessageBox::warning(this, "错误", "无法获取当前图像");
+                return;
+            }
+            if (!m_captureEncoder->encodeImage(fallbackImage, options, &m_capturedFaceData)) {
+                m_capturedFaceData.clear();
+            }
+        }
+        Trace::spanEnd(fused ? "capture.encode_yuv" : "capture.encode_rgb", "capture", encodeStartUs);
         
-        // 将图像编码为JPEG格式（使用内存而非文件）
-        std::vector<uchar> buf;
-        cv::imencode(".jpg", bgrFrame, buf);
-        m_capturedFaceData = QByteArray(reinterpret_cast<const char*>(buf.data()), buf.size());
+        LOG_DEBUG(Log::capture) << "拍照编码:" << (fused ? "YUV直接编码" : "RGB回退路径") << ", 像素格式"
+                                << m_lastFrame.pixelFormat() << ", 耗时" << timer.nsecsElapsed() / 1000 << "us, 大小"
+                                << m_capturedFaceData.size() << "字节";
         
         if (m_capturedFaceData.isEmpty()) {
             QMessageBox::warning(this, "错误", "图像编码失败");
             return;
         }
         
+        m_capturedFrameLayout = QJsonArray();
+        encodeCaptureThumbnail(fused ? QImage() : fallbackImage);
+        
         // 在UI上显示"已捕获"消息
         ui.statusLabel->setText("成功捕获人脸图像");
     }
@@ -372,6 +506,56 @@ void FaceAuthClient::onCaptureButtonClicked()
     }
 }
 
+void FaceAuthClient::encodeCaptureThumbnail(const QImage& fallbackImage)
+{
+    // 两阶段上传的预览图：同一帧以小尺寸、低质量再编码一次。fallbackImage为空时从m_lastFrame编码
+    m_capturedThumbnail.clear();
+    QSettings settings("FaceAuthTeam", "FaceAuthAccess");
+    if (!settings.value("两阶段上传", false).toBool()) {
+        return;
+    }
+    
+    CaptureEncoder::Options previewOptions;
+    previewOptions.maxDimension = settings.value("预览图最大边长", 160).toInt();
+    previewOptions.quality = settings.value("预览图JPEG质量", 70).toInt();
+    bool encoded = fallbackImage.isNull() ? m_captureEncoder->encodeFrame(m_lastFrame, previewOptions, &m_capturedThumbnail)
+                                          : m_captureEncoder->encodeImage(fallbackImage, previewOptions, &m_capturedThumbnail);
+    if (!encoded && fallbackImage.isNull()) {
+        encoded = m_captureEncoder->encodeImage(m_lastFrame.toImage(), previewOptions, &m_capturedThumbnail);
+    }
+    if (!encoded) {
+        m_capturedThumbnail.clear();
+    }
+    LOG_DEBUG(Log::capture) << "预览图编码" << Log::field("preview_bytes", int(m_capturedThumbnail.size()));
+}
+
+void FaceAuthClient::onBurstCaptured(const BurstCapture::Result& result)
+{
+    ui.captureButton->setEnabled(true);
+    
+    // 加速比 = 各帧编码耗时之和 / 编码墙钟时间；tail为最后一帧到达后的等待，即连拍相对单帧多出的编码延迟
+    LOG_DEBUG(Log::capture) << "连拍完成" << Log::field("frames", int(result.frames.size()))
+                            << Log::field("capture_ms", result.captureMs)
+                            << Log::field("encode_wall_us", result.encodeWallUs)
+                            << Log::field("encode_cpu_us", result.encodeCpuUs)
+                            << Log::field("speedup", result.encodeWallUs > 0 ? double(result.encodeCpuUs) / result.encodeWallUs : 0.0)
+                            << Log::field("tail_us", result.tailUs) << Log::field("threads", result.threads);
+    
+    if (result.frames.isEmpty()) {
+        ui.statusLabel->setText("连拍失败");
+        QMessageBox::warning(this, "错误", "图像编码失败");
+        return;
+    }
+    
+    if (result.frames.size() == 1) {
+        m_capturedFaceData = result.frames.first();
+        m_capturedFrameLayout = QJsonArray();
+    } else {
+        m_capturedFaceData = FaceAuthProtocol::packFrames(result.frames, &m_capturedFrameLayout);
+    }
+    ui.statusLabel->setText(QString("成功捕获%1帧人脸图像").arg(result.frames.size()));
+}
+
 void FaceAuthClient::onLoginButtonClicked()
 {
     QString username = ui.usernameEdit->text().trimmed();
@@ -391,10 +575,26 @@ void FaceAuthClient::onLoginButtonClicked()
     ui.statusLabel->setText("发送登录请求...");
     ui.loginButton->setEnabled(false);
     
-    // 发送登录请求
-    sendLoginRequest(username, password, m_capturedFaceData);
+    FaceAuthCore::AuthRequest request;
+    request.username = username;
+    request.password = password;
+    request.faceData = m_capturedFaceData;
+    request.frameLayout = m_capturedFrameLayout;
+    
+    // 两阶段上传：预览图比完整图像小时先发送预览图，服务器可能据此直接拒绝
+    QSettings settings("FaceAuthTeam", "FaceAuthAccess");
+    if (settings.value("两阶段上传", false).toBool()) {
+        request.preview = m_capturedThumbnail;
+    }
     
-    // 登录按钮将在收到服务器响应后重新启用
+    // 发送登录请求，登录按钮将在收到服务器响应后重新启用
+    QString error;
+    if (m_core->login(request, &error) == FaceAuthCore::SubmitResult::Failed) {
+        QString errorMsg = "连接失败:" + error;
+        ui.statusLabel->setText(errorMsg);
+        QMessageBox::critical(this, "连接错误", errorMsg);
+        ui.loginButton->setEnabled(true);
+    }
 }
 
 void FaceAuthClient::onRegisterButtonClicked()
@@ -416,10 +616,28 @@ void FaceAuthClient::onRegisterButtonClicked()
     ui.statusLabel->setText("发送注册请求..."); 
     ui.registerButton->setEnabled(false);
     
-    // 发送注册请求
-    sendRegisterRequest(username, password, m_capturedFaceData);
-    
-    // 注册按钮将在收到服务器响应后重新启用
+    FaceAuthCore::AuthRequest request;
+    request.username = username;
+    request.password = password;
+    request.faceData = m_capturedFaceData;
+    request.frameLayout = m_capturedFrameLayout;
+    
+    // 发送注册请求，注册按钮将在收到服务器响应后重新启用
+    QString error;
+    switch (m_core->registerUser(request, &error)) {
+    case FaceAuthCore::SubmitResult::Sent:
+        break;
+    case FaceAuthCore::SubmitResult::Queued:
+        // 网络不可用时已写入离线日志，恢复连接后自动补发，无需重新拍照
+        ui.statusLabel->setText("网络不可用，注册请求已保存，恢复连接后将自动补发");
+        ui.registerButton->setEnabled(true);
+        break;
+    case FaceAuthCore::SubmitResult::Failed:
+        ui.statusLabel->setText("Failed to connect to server: " + error);
+        QMessageBox::critical(this, "Connection Error", "Failed to connect to server: " + error);
+        ui.registerButton->setEnabled(true);
+        break;
+    }
 }
 
 void FaceAuthClient::onSocketConnected()
@@ -427,130 +645,349 @@ void FaceAuthClient::onSocketConnected()
     ui.statusLabel->setText("已连接到服务器");
 }
 
-void FaceAuthClient::onSocketDisconnected()
+void FaceAuthClient::onKioskModeToggled(bool enabled)
 {
-    // 只在状态栏显示断开信息，不显示弹窗
-    ui.statusLabel->setText("与服务器连接断开");
-    qDebug() << "与服务器连接断开";
+    if (enabled && !m_kiosk->hasDetector()) {
+        QSettings settings("FaceAuthTeam", "FaceAuthAccess");
+        QString cascadePath = settings.value("人脸检测模型",
+            QCoreApplication::applicationDirPath() + "/haarcascade_frontalface_default.xml").toString();
+        if (!m_kiosk->loadDetector(cascadePath)) {
+            QMessageBox::warning(this, "自助模式", "无法加载人脸检测模型:\n" + cascadePath);
+            ui.actionKiosk_Mode->setChecked(false);
+            return;
+        }
+    }
     
-    // 重新启用按钮
-    ui.loginButton->setEnabled(true);
-    ui.registerButton->setEnabled(true);
+    // 检测器每隔若干帧运行一次，其余帧由光流跟踪人脸框；低端设备可调大以降低CPU占用
+    QSettings settings("FaceAuthTeam", "FaceAuthAccess");
+    m_kiosk->setDetectionInterval(settings.value("自助检测间隔帧", 5).toInt());
+    m_showFaceTracks = settings.value("自助显示人脸框", true).toBool();
+    m_kiosk->setEnabled(enabled);
+    m_kioskCompletions.clear();
+    m_kioskLatencies.clear();
+    ui.statusLabel->setText(enabled ? "自助模式已开启，请正对摄像头" : "自助模式已关闭");
+    
+    // 自助模式下保持长连接，空闲的预连接不会被断开
+    m_core->setKeepAlive(enabled);
+    if (enabled) {
+        m_core->beginConnect();
+    }
 }
 
-void FaceAuthClient::onSocketError(QAbstractSocket::SocketError error)
+void FaceAuthClient::onKioskFaceCaptured(quint64 personId, const QByteArray& jpeg, qint64 detectedAtMs)
 {
-    // 忽略远程主机关闭连接的错误
-    if (error == QAbstractSocket::RemoteHostClosedError) {
-        qDebug() << "远程主机关闭连接";
+    if (!m_kiosk->isEnabled()) {
         return;
     }
     
-    // 只在状态栏显示错误信息，不显示弹窗
-    QString errorMessage = "网络错误: " + m_socket->errorString();
-    ui.statusLabel->setText(errorMessage);
-    qDebug() << "网络错误:" << m_socket->errorString();
+    // 限制流水线深度，服务器跟不上时丢弃并允许此人重新提交
+    QSettings settings("FaceAuthTeam", "FaceAuthAccess");
+    int maxInFlight = settings.value("自助模式最大并发", 4).toInt();
+    if (m_pendingIdentify.size() >= maxInFlight) {
+        LOG_WARNING(Log::kiosk) << "自助模式在途请求已满，丢弃人员" << personId;
+        m_kiosk->resetPresence();
+        return;
+    }
     
-    // 重新启用UI按钮
-    ui.loginButton->setEnabled(true);
-    ui.registerButton->setEnabled(true);
+    PendingIdentify pending;
+    pending.personId = personId;
+    pending.detectedAtMs = detectedAtMs;
+    m_pendingIdentify.append(pending);
+    Trace::asyncBegin("identify", "kiosk", qint64(personId), detectedAtMs * 1000);
+    
+    showOverlay("正在识别...", true);
+    
+    // 连接未就绪时由核心排队并异步连接，不阻塞检测流水线
+    m_core->identify(QString::number(personId), jpeg);
 }
 
-void FaceAuthClient::onSocketReadyRead()
+void FaceAuthClient::handleIdentifyResponse(bool success, const QJsonObject& response)
 {
-    // 读取所有可用数据
-    QByteArray data = m_socket->readAll();
+    if (m_pendingIdentify.isEmpty()) {
+        LOG_WARNING(Log::kiosk) << "收到无对应请求的识别响应";
+        return;
+    }
+    
+    PendingIdentify pending = m_pendingIdentify.takeFirst();
+    Trace::asyncEnd("identify", "kiosk", qint64(pending.personId));
+    qint64 now = KioskController::nowMs();
+    qint64 latencyMs = now - pending.detectedAtMs;
+    
+    if (success) {
+        QString username = response.value("username").toString();
+        showOverlay("欢迎, " + (username.isEmpty() ? response.value("message").toString() : username), true);
+    } else {
+        showOverlay("未识别: " + response.value("message").toString(), false);
+    }
     
-    // 将新数据添加到缓冲区
-    m_receiveBuffer.append(data);
+    // 最近60秒内完成的人数即为持续的每分钟通过人数
+    m_kioskCompletions.append(now);
+    while (!m_kioskCompletions.isEmpty() && now - m_kioskCompletions.first() > 60000) {
+        m_kioskCompletions.removeFirst();
+    }
+    m_kioskLatencies.append(latencyMs);
+    if (m_kioskLatencies.size() > 100) {
+        m_kioskLatencies.removeFirst();
+    }
     
-    // 处理接收到的数据
-    processServerResponse(m_receiveBuffer);
+    QList<qint64> sorted = m_kioskLatencies;
+    std::sort(sorted.begin(), sorted.end());
+    qint64 total = 0;
+    for (qint64 value : sorted) {
+        total += value;
+    }
+    qint64 p95 = sorted.at(qMin(sorted.size() - 1, int(sorted.size() * 0.95)));
+    
+    KioskController::Stats kioskStats = m_kiosk->stats();
+    LOG_DEBUG(Log::kiosk) << "自助模式: 人员" << pending.personId << "延迟" << latencyMs << "ms,"
+                          << m_kioskCompletions.size() << "人/分钟, 平均" << total / sorted.size() << "ms, P95" << p95
+                          << "ms, 检测" << kioskStats.detections << "次(" << kioskStats.detectionsPerSecond << "次/秒, 间隔"
+                          << m_kiosk->detectionInterval() << "帧), 跟踪帧" << kioskStats.trackedFrames
+                          << ", 跟踪丢失" << kioskStats.trackLosses << ", 丢帧" << kioskStats.framesDropped;
+    ui.statusLabel->setText(QString("自助模式: %1 人/分钟, 平均延迟 %2 ms, P95 %3 ms")
+                            .arg(m_kioskCompletions.size()).arg(total / sorted.size()).arg(p95));
 }
 
-void FaceAuthClient::processServerResponse(const QByteArray& data)
+// 人脸框来自跟踪器，每帧无需运行检测器；检测器确认的框为绿色，光流估计的框为黄色
+void FaceAuthClient::drawFaceTracks(QImage* image)
 {
-    if (data.size() < 8) {
-        // 数据不完整，继续等待更多数据
-        qDebug() << "接收到的数据不完整，只有" << data.size() << "字节，至少需要8字节";
+    if (!m_showFaceTracks || !m_kiosk || !m_kiosk->isEnabled()) {
         return;
     }
-    
-    // 检查响应头部
-    if (data.left(4) != "RESP") {
-        qDebug() << "无效的响应头部:" << data.left(4);
-        // 清空接收缓冲区
-        m_receiveBuffer.clear();
-        
-        // 重新启用UI按钮
-        ui.loginButton->setEnabled(true);
-        ui.registerButton->setEnabled(true);
+    QSize frameSize;
+    QVector<KioskController::FaceTrack> tracks = m_kiosk->tracks(&frameSize);
+    if (tracks.isEmpty() || frameSize.isEmpty()) {
+        return;
+    }
+
+    double sx = double(image->width()) / frameSize.width();
+    double sy = double(image->height()) / frameSize.height();
+    QPainter painter(image);
+    for (const KioskController::FaceTrack& track : tracks) {
+        QRect rect(qRound(track.rect.x() * sx), qRound(track.rect.y() * sy),
+                   qRound(track.rect.width() * sx), qRound(track.rect.height() * sy));
+        painter.setPen(QPen(track.confirmed ? Qt::green : Qt::yellow, 2));
+        painter.drawRect(rect);
+        painter.drawText(rect.topLeft() + QPoint(4, 14), QString("#%1").arg(track.id));
+    }
+}
+
+void FaceAuthClient::traceFrameArrival(const QVideoFrame& frame)
+{
+    qint64 arrivalUs = Trace::nowUs();
+    qint64 startTime = frame.startTime();
+    if (startTime < 0) {
+        Trace::instant("camera.frame", "camera", qint64(m_frameCount));
         return;
     }
     
-    // 读取JSON数据长度 (使用BigEndian)
-    QDataStream stream(data.mid(4, 4));
-    stream.setByteOrder(QDataStream::BigEndian);
-    qint32 jsonLength;
-    stream >> jsonLength;
-    
-    qDebug() << "服务器响应: 头部=" << data.left(4) << ", JSON长度=" << jsonLength;
-    
-    // 检查是否有足够的数据
-    if (data.size() < 8 + jsonLength) {
-        qDebug() << "数据不完整: 接收了" << data.size() << "字节，需要" << (8 + jsonLength) << "字节";
-        // 数据不完整，继续等待
+    // 帧时间戳来自摄像头的媒体时钟，与本机时钟基准不同。以观测到的最小(到达-时间戳)作为时钟偏移，
+    // 每帧的区间长度即为相对该最小值的额外延迟，用于发现采集到显示之间的抖动和排队
+    qint64 offset = arrivalUs - startTime;
+    if (!m_traceClockOffsetValid || offset < m_traceClockOffsetUs) {
+        m_traceClockOffsetUs = offset;
+        m_traceClockOffsetValid = true;
+    }
+    qint64 capturedUs = startTime + m_traceClockOffsetUs;
+    Trace::complete("camera.frame", "camera", capturedUs, arrivalUs - capturedUs, qint64(m_frameCount));
+}
+
+// 共享帧环中的像素格式，读者按FOURCC解释各平面；不支持的格式返回0
+static quint32 frameRingFourcc(QVideoFrameFormat::PixelFormat format)
+{
+    const char* code = nullptr;
+    switch (format) {
+    case QVideoFrameFormat::Format_NV12: code = "NV12"; break;
+    case QVideoFrameFormat::Format_NV21: code = "NV21"; break;
+    case QVideoFrameFormat::Format_YUV420P: code = "I420"; break;
+    case QVideoFrameFormat::Format_YV12: code = "YV12"; break;
+    case QVideoFrameFormat::Format_YUYV: code = "YUYV"; break;
+    case QVideoFrameFormat::Format_UYVY: code = "UYVY"; break;
+    case QVideoFrameFormat::Format_BGRA8888: code = "BGRA"; break;
+    case QVideoFrameFormat::Format_BGRX8888: code = "BGRX"; break;
+    case QVideoFrameFormat::Format_RGBA8888: code = "RGBA"; break;
+    case QVideoFrameFormat::Format_RGBX8888: code = "RGBX"; break;
+    case QVideoFrameFormat::Format_ARGB8888: code = "ARGB"; break;
+    case QVideoFrameFormat::Format_XRGB8888: code = "XRGB"; break;
+    case QVideoFrameFormat::Format_ABGR8888: code = "ABGR"; break;
+    case QVideoFrameFormat::Format_XBGR8888: code = "XBGR"; break;
+    case QVideoFrameFormat::Format_Y8: code = "GREY"; break;
+    case QVideoFrameFormat::Format_Jpeg: code = "MJPG"; break;
+    default: return 0;
+    }
+    return FrameRingInfo::fourccCode(code);
+}
+
+void FaceAuthClient::createFrameRing(const QSize& resolution)
+{
+    QSettings settings("FaceAuthTeam", "FaceAuthAccess");
+    if (m_frameRing || !settings.value("共享摄像头帧", false).toBool()) {
         return;
     }
     
-    // 提取JSON数据
-    QByteArray jsonData = data.mid(8, jsonLength);
+    // 每个槽按4字节每像素预留，能容纳相同分辨率的任何打包或平面格式
+    QString name = settings.value("共享帧环名称", "FaceAuthFrames").toString();
+    int slotCount = qBound(2, settings.value("共享帧环槽数", 4).toInt(), 64);
+    qint64 slotBytes = qint64(resolution.width()) * resolution.height() * 4;
     
-    // 输出原始JSON数据以便调试
-    qDebug() << "原始JSON数据:" << QString(jsonData);
+    FrameRingWriter* ring = new FrameRingWriter(name);
+    // 八进制权限位，读者以其他用户运行时放开组或其他用户的读权限
+    bool modeOk = false;
+    int accessMode = settings.value("共享帧环权限", "0600").toString().toInt(&modeOk, 8);
+    if (modeOk) {
+        ring->setAccessMode(accessMode);
+    }
+    QString error;
+    if (!ring->create(slotCount, slotBytes, &error)) {
+        LOG_WARNING(Log::camera) << "创建共享帧环失败:" << name << error;
+        delete ring;
+        return;
+    }
+    m_frameRing = ring;
+    LOG_INFO(Log::camera) << "共享帧环已创建:" << name << "槽数=" << slotCount << "槽容量=" << slotBytes;
+}
+
+void FaceAuthClient::publishFrame(const QVideoFrame& frame)
+{
+    TRACE_SCOPE("frame_ring.publish", "camera");
+    FrameRingInfo info;
+    info.fourcc = frameRingFourcc(frame.pixelFormat());
+    if (info.fourcc == 0) {
+        return;
+    }
     
-    // 解析JSON
-    QJsonDocument doc = QJsonDocument::fromJson(jsonData);
-    if (doc.isNull() || !doc.isObject()) {
-        qDebug() << "无效的JSON数据";
-        m_receiveBuffer.clear();
-        
-        // 重新启用UI按钮
-        ui.loginButton->setEnabled(true);
-        ui.registerButton->setEnabled(true);
+    // 映射只读取已在内存中的帧，写入共享内存是唯一的一次拷贝；写者从不等待读者
+    QVideoFrame mapped(frame);
+    if (!mapped.map(QVideoFrame::ReadOnly)) {
+        return;
+    }
+    info.width = mapped.width();
+    info.height = mapped.height();
+    info.planeCount = qMin(mapped.planeCount(), int(FrameRingInfo::MaxPlanes));
+    info.timestampUs = mapped.startTime();
+    const uchar* planes[FrameRingInfo::MaxPlanes] = {};
+    for (int i = 0; i < info.planeCount; ++i) {
+        info.bytesPerLine[i] = mapped.bytesPerLine(i);
+        info.planeBytes[i] = mapped.mappedBytes(i);
+        planes[i] = mapped.bits(i);
+    }
+    m_frameRing->publish(info, planes);
+    mapped.unmap();
+}
+
+void FaceAuthClient::onTracingToggled(bool enabled)
+{
+    QSettings settings("FaceAuthTeam", "FaceAuthAccess");
+    settings.setValue("性能跟踪", enabled);
+    Trace::setEnabled(enabled, settings.value("性能跟踪容量", 1 << 16).toInt());
+    m_traceClockOffsetValid = false;
+    ui.actionExport_Trace->setEnabled(enabled || Trace::stats().recorded > 0);
+    LOG_INFO(Log::app) << "性能跟踪" << (enabled ? "已开启" : "已关闭");
+}
+
+void FaceAuthClient::onExportTraceTriggered()
+{
+    QString path = QFileDialog::getSaveFileName(this, "导出性能跟踪",
+        QDir::home().filePath("faceauth-trace.json"), "Chrome Trace (*.json)");
+    if (path.isEmpty()) {
         return;
     }
     
-    QJsonObject response = doc.object();
+    int eventCount = 0;
+    QString error;
+    if (!Trace::exportChromeJson(path, &eventCount, &error)) {
+        QMessageBox::warning(this, "导出失败", error);
+        return;
+    }
     
-    // 处理不同类型的响应
-    QString type = response["type"].toString();
+    Trace::Stats stats = Trace::stats();
+    ui.statusLabel->setText(QString("已导出 %1 个跟踪事件(覆盖 %2 个)，可在 ui.perfetto.dev 中打开")
+                            .arg(eventCount).arg(stats.overwritten));
+}
+
+void FaceAuthClient::showOverlay(const QString& text, bool positive)
+{
+    m_overlayLabel->setText(text);
+    m_overlayLabel->setStyleSheet(QString("QLabel { background-color: %1; color: white; font-size: 20px; padding: 8px; }")
+                                  .arg(positive ? "rgba(0, 128, 0, 180)" : "rgba(192, 0, 0, 180)"));
+    m_overlayLabel->setGeometry(0, ui.cameraView->height() - 56, ui.cameraView->width(), 56);
+    m_overlayLabel->show();
+    m_overlayLabel->raise();
+    m_overlayTimer->start(2500);
+}
+
+void FaceAuthClient::onJournalRecordReplayed(const QJsonObject& request, const QJsonObject& response)
+{
+    if (request.value("type").toString() == "audit") {
+        return;
+    }
     
-    // 解析success字段，支持多种格式(布尔值、字符串、数字)
-    QJsonValue successValue = response.value("success");
-    bool success = false;
+    QString result = FaceAuthProtocol::responseSucceeded(response) ? "成功" : "失败";
+    ui.statusLabel->setText(QString("离线注册已补发 (%1): %2 %3")
+                            .arg(request.value("username").toString(), result,
+                                 response.value("message").toString()));
+}
+
+void FaceAuthClient::onJournalReplayFinished(int succeeded, int rejected, int remaining)
+{
+    OfflineJournal::Stats journalStats = m_core->journal()->stats();
+    JournalReplayer::Stats replayStats = m_core->replayer()->stats();
+    LOG_INFO(Log::journal) << "离线补发结束: 成功" << succeeded << ", 失败" << rejected << ", 剩余" << remaining
+                           << ", 累计审计记录" << replayStats.audited << ", 未确认的审计" << replayStats.deferred
+                           << ", 最近批次" << replayStats.lastBatchRecordsPerSec << "条/秒"
+                           << ", 日志已用" << journalStats.usedBytes << "/" << journalStats.capacityBytes << "字节";
     
-    if (!successValue.isNull()) {
-        if (successValue.isBool()) {
-            success = successValue.toBool();
-        } else if (successValue.isString()) {
-            // 尝试将字符串转换为布尔值
-            QString successStr = successValue.toString().toLower();
-            success = (successStr == "true" || successStr == "1" || successStr == "yes");
-        } else if (successValue.isDouble()) {
-            // 尝试将数字转换为布尔值
-            success = (successValue.toInt() != 0);
-        }
+    if (succeeded + rejected > 0) {
+        ui.statusLabel->setText(QString("离线请求补发完成: 成功%1条, 失败%2条, 剩余%3条")
+                                .arg(succeeded).arg(rejected).arg(remaining));
+    }
+}
+
+void FaceAuthClient::onActiveEndpointChanged(const QString& host, quint16 port)
+{
+    ui.statusLabel->setText(QString("认证服务器切换到 %1:%2").arg(host).arg(port));
+}
+
+void FaceAuthClient::onSocketDisconnected()
+{
+    // 只在状态栏显示断开信息，不显示弹窗
+    ui.statusLabel->setText("与服务器连接断开");
+}
+
+void FaceAuthClient::onRequestsAborted()
+{
+    // 连接断开或响应无法解析，未完成的识别请求不会再有响应
+    if (!m_pendingIdentify.isEmpty()) {
+        m_pendingIdentify.clear();
+        m_kiosk->resetPresence();
     }
     
-    // 如果消息表示成功但success标志为false，则可能是格式问题，尝试通过消息内容推断
-    QString message = response["message"].toString();
-    if (!success && message.contains("successful", Qt::CaseInsensitive)) {
-        qDebug() << "消息内容表明成功，但success标志为false，自动修正为true";
-        success = true;
+    // 重新启用按钮
+    ui.loginButton->setEnabled(true);
+    ui.registerButton->setEnabled(true);
+}
+
+void FaceAuthClient::onSocketError(QAbstractSocket::SocketError error)
+{
+    // 忽略远程主机关闭连接的错误
+    if (error == QAbstractSocket::RemoteHostClosedError) {
+        LOG_DEBUG(Log::net) << "远程主机关闭连接";
+        return;
     }
     
-    qDebug() << "收到服务器响应: 类型=" << type << ", 成功=" << success << ", 消息=" << message;
+    // 只在状态栏显示错误信息，不显示弹窗
+    QString errorMessage = "网络错误: " + m_socket->errorString();
+    ui.statusLabel->setText(errorMessage);
+    LOG_WARNING(Log::net) << "网络错误:" << m_socket->errorString();
+    
+    // 重新启用UI按钮
+    ui.loginButton->setEnabled(true);
+    ui.registerButton->setEnabled(true);
+}
+
+void FaceAuthClient::onAuthFinished(const QString& type, bool success, const QJsonObject& response)
+{
+    QString message = response["message"].toString();
     
     if (type == "login") {
         ui.loginButton->setEnabled(true);
@@ -576,233 +1013,9 @@ void FaceAuthClient::processServerResponse(const QByteArray& data)
         }
     } else {
         ui.statusLabel->setText("未知的响应类型: " + type);
-        qDebug() << "未知的响应类型:" << type;
         
         // 重新启用所有UI按钮
         ui.loginButton->setEnabled(true);
         ui.registerButton->setEnabled(true);
     }
-    
-    // 清空接收缓冲区，准备接收下一个响应
-    m_receiveBuffer.clear();
-}
-
-void FaceAuthClient::sendLoginRequest(const QString& username, const QString& password, const QByteArray& faceData)
-{
-    if (!m_socket) {
-        qDebug() << "Socket未初始化";
-        ui.statusLabel->setText("错误: 未初始化Socket");
-        return;
-    }
-
-    // 禁用登录按钮防止重复点击
-    ui.loginButton->setEnabled(false);
-
-    // 调试输出
-    qDebug() << "准备发送登录请求到" << m_serverAddress << ":" << m_serverPort;
-
-    // 检查是否已连接到服务器，如果没有连接则尝试连接
-    if (m_socket->state() != QAbstractSocket::ConnectedState) {
-        ui.statusLabel->setText("连接到服务器...");
-        qDebug() << "尝试连接到服务器...";
-        
-        // 连接到服务器
-        m_socket->connectToHost(m_serverAddress, m_serverPort);
-        
-        // 等待连接完成
-        if (!m_socket->waitForConnected(5000)) {
-            QString errorMsg = "连接失败:" + m_socket->errorString();
-            ui.statusLabel->setText(errorMsg);
-            QMessageBox::critical(this, "连接错误", errorMsg);
-            qDebug() << "连接失败:" << m_socket->errorString();
-            ui.loginButton->setEnabled(true);
-            return;
-        }
-        
-        qDebug() << "已连接到服务器";
-    }
-    
-    // 创建JSON对象保存登录信息
-    QJsonObject loginData;
-    loginData["type"] = "login";
-    loginData["username"] = username;
-    loginData["password"] = password;
-    loginData["face_data_size"] = faceData.size();
-    
-    // 转换为JSON文档
-    QJsonDocument doc(loginData);
-    QByteArray jsonData = doc.toJson();
-    
-    // 重新构建请求头部 - 使用正确的方式
-    // 创建完整的8字节头部
-    QByteArray packet;
-    
-    // 1. 添加"FACE"作为前4个字节 (直接字符串，不使用QDataStream)
-    packet.append("FACE", 4);
-    
-    // 2. 添加JSON长度作为后4个字节 (使用BigEndian字节序)
-    QByteArray lengthBytes;
-    QDataStream lengthStream(&lengthBytes, QIODevice::WriteOnly);
-    lengthStream.setByteOrder(QDataStream::BigEndian);
-    lengthStream << (qint32)jsonData.size();
-    packet.append(lengthBytes);
-    
-    // 3. 添加JSON数据
-    packet.append(jsonData);
-    
-    // 4. 添加人脸图像数据
-    if (!faceData.isEmpty()) {
-        packet.append(faceData);
-    }
-    
-    // 验证头部是否正确
-    QByteArray header = packet.left(8);
-    qDebug() << "头部内容:" << header.toHex();
-    if (header.left(4) != "FACE") {
-        qDebug() << "错误：头部格式错误，应为'FACE'，实际为:" << header.left(4).toHex();
-        ui.statusLabel->setText("Error: Invalid header format");
-        ui.loginButton->setEnabled(true);
-        return;
-    }
-    
-    // 添加调试信息
-    qDebug() << "头部十六进制:" << header.toHex();
-    qDebug() << "头部大小:" << header.size() << "字节";
-    qDebug() << "JSON大小:" << jsonData.size() << "字节";
-    if (!faceData.isEmpty()) {
-        qDebug() << "人脸数据大小:" << faceData.size() << "字节";
-    } else {
-        qDebug() << "警告：没有人脸数据添加到登录请求";
-    }
-    qDebug() << "总数据包大小:" << packet.size() << "字节";
-    
-    // 发送数据包
-    qint64 bytesSent = m_socket->write(packet);
-    
-    if (bytesSent == -1) {
-        ui.statusLabel->setText("Failed to send data: " + m_socket->errorString());
-        qDebug() << "发送数据失败:" << m_socket->errorString();
-        ui.loginButton->setEnabled(true);
-    } else {
-        ui.statusLabel->setText(QString("Sent %1 bytes to server, awaiting response...").arg(bytesSent));
-        qDebug() << "已发送" << bytesSent << "字节到服务器，等待响应...";
-        
-        // 确保数据发送出去
-        m_socket->flush();
-        
-        // 添加：发送后等待服务器处理
-        if (!m_socket->waitForBytesWritten(3000)) {
-            qDebug() << "发送数据超时，服务器可能没有收到完整数据";
-        }
-    }
-}
-
-void FaceAuthClient::sendRegisterRequest(const QString& username, const QString& password, const QByteArray& faceData)
-{
-    if (!m_socket) {
-        qDebug() << "Socket未初始化";
-        ui.statusLabel->setText("错误: 未初始化Socket");
-        return;
-    }
-
-    // 禁用注册按钮防止重复点击
-    ui.registerButton->setEnabled(false);
-
-    // 调试输出
-    qDebug() << "准备发送注册请求到" << m_serverAddress << ":" << m_serverPort;
-
-    // 检查是否已连接到服务器，如果没有连接则尝试连接
-    if (m_socket->state() != QAbstractSocket::ConnectedState) {
-        ui.statusLabel->setText("Connecting to server...");
-        qDebug() << "尝试连接到服务器...";
-        
-        // 连接到服务器
-        m_socket->connectToHost(m_serverAddress, m_serverPort);
-        
-        // 等待连接完成
-        if (!m_socket->waitForConnected(5000)) {
-            QString errorMsg = "Failed to connect to server: " + m_socket->errorString();
-            ui.statusLabel->setText(errorMsg);
-            QMessageBox::critical(this, "Connection Error", errorMsg);
-            qDebug() << "连接失败:" << m_socket->errorString();
-            ui.registerButton->setEnabled(true);
-            return;
-        }
-        
-        qDebug() << "已连接到服务器";
-    }
-    
-    // 创建JSON对象保存注册信息
-    QJsonObject registerData;
-    registerData["type"] = "register";
-    registerData["username"] = username;
-    registerData["password"] = password;
-    registerData["face_data_size"] = faceData.size();
-    
-    // 转换为JSON文档
-    QJsonDocument doc(registerData);
-    QByteArray jsonData = doc.toJson();
-    
-    // 重新构建请求头部 - 使用正确的方式
-    // 创建完整的8字节头部
-    QByteArray packet;
-    
-    // 1. 添加"FACE"作为前4个字节 (直接字符串，不使用QDataStream)
-    packet.append("FACE", 4);
-    
-    // 2. 添加JSON长度作为后4个字节 (使用BigEndian字节序)
-    QByteArray lengthBytes;
-    QDataStream lengthStream(&lengthBytes, QIODevice::WriteOnly);
-    lengthStream.setByteOrder(QDataStream::BigEndian);
-    lengthStream << (qint32)jsonData.size();
-    packet.append(lengthBytes);
-    
-    // 3. 添加JSON数据
-    packet.append(jsonData);
-    
-    // 4. 添加人脸图像数据
-    if (!faceData.isEmpty()) {
-        packet.append(faceData);
-    }
-    
-    // 验证头部是否正确
-    QByteArray header = packet.left(8);
-    qDebug() << "头部内容:" << header.toHex();
-    if (header.left(4) != "FACE") {
-        qDebug() << "错误：头部格式错误，应为'FACE'，实际为:" << header.left(4).toHex();
-        ui.statusLabel->setText("错误：头部格式错误");
-        ui.registerButton->setEnabled(true);
-        return;
-    }
-    
-    // 添加调试信息
-    qDebug() << "头部十六进制:" << header.toHex();
-    qDebug() << "头部大小:" << header.size() << "字节";
-    qDebug() << "JSON大小:" << jsonData.size() << "字节";
-    if (!faceData.isEmpty()) {
-        qDebug() << "人脸数据大小:" << faceData.size() << "字节";
-    } else {
-        qDebug() << "警告：没有人脸数据添加到注册请求";
-    }
-    qDebug() << "总数据包大小:" << packet.size() << "字节";
-    
-    // 发送数据包
-    qint64 bytesSent = m_socket->write(packet);
-    
-    if (bytesSent == -1) {
-        ui.statusLabel->setText("Failed to send data: " + m_socket->errorString());
-        qDebug() << "发送数据失败:" << m_socket->errorString();
-        ui.registerButton->setEnabled(true);
-    } else {
-        ui.statusLabel->setText(QString("已发送 %1 字节到服务器，等待响应...").arg(bytesSent));
-        qDebug() << "已发送" << bytesSent << "字节到服务器，等待响应...";
-        
-        // 确保数据发送出去
-        m_socket->flush();
-        
-        // 添加：发送后等待服务器处理
-        if (!m_socket->waitForBytesWritten(3000)) {
-            qDebug() << "发送数据超时，服务器可能没有收到完整数据";
-        }
-    }
 }
@@ -2,6 +2,7 @@
 
 #include <QtWidgets/QMainWindow>
 #include "ui_FaceAuthClient.h"
+#include "BurstCapture.h"
 #include <QTcpSocket>
 #include <QBuffer>
 #include <QImage>
@@ -18,8 +19,13 @@
 #include <QJsonDocument>
 #include <QJsonArray>
 #include <QVector>
+#include <QTimer>
+#include <QElapsedTimer>
 
 class ServerSettingsDialog;
+class FaceAuthCore;
+class KioskController;
+class FrameRingWriter;
 
 class FaceAuthClient : public QMainWindow
 {
@@ -34,10 +40,19 @@ private slots:
     void onCaptureButtonClicked();
     void onRegisterButtonClicked();
     void onSocketConnected();
+    void onAuthFinished(const QString& type, bool success, const QJsonObject& response);
+    void onJournalRecordReplayed(const QJsonObject& request, const QJsonObject& response);
+    void onJournalReplayFinished(int succeeded, int rejected, int remaining);
+    void onKioskModeToggled(bool enabled);
+    void onKioskFaceCaptured(quint64 personId, const QByteArray& jpeg, qint64 detectedAtMs);
+    void onTracingToggled(bool enabled);
+    void onExportTraceTriggered();
     void onSocketDisconnected();
+    void onRequestsAborted();
     void onSocketError(QAbstractSocket::SocketError error);
-    void onSocketReadyRead();
     void onServerSettingsTriggered();
+    void onActiveEndpointChanged(const QString& host, quint16 port);
+    void onBurstCaptured(const BurstCapture::Result& result);
     void onFrameAvailable(const QVideoFrame &frame);
 
 private:
@@ -46,19 +61,53 @@ private:
     bool startCamera();
     void stopCamera();
     QImage matToQImage(const cv::Mat& mat);
-    void sendLoginRequest(const QString& username, const QString& password, const QByteArray& faceData = QByteArray());
-    void sendRegisterRequest(const QString& username, const QString& password, const QByteArray& faceData = QByteArray());
-    void processServerResponse(const QByteArray& data);
+    void encodeCaptureThumbnail(const QImage& fallbackImage);
+    void handleIdentifyResponse(bool success, const QJsonObject& response);
+    void showOverlay(const QString& text, bool positive);
+    void traceFrameArrival(const QVideoFrame& frame);
+    void drawFaceTracks(QImage* image);
+    void createFrameRing(const QSize& resolution);
+    void publishFrame(const QVideoFrame& frame);
     
+    // 连接管理、请求收发、预连接和离线补发都在核心中，窗口只负责采集和展示
     QTcpSocket* m_socket;
+    FaceAuthCore* m_core;
+    
+    QByteArray m_capturedThumbnail;             // 两阶段上传的预览图
+    
+    // 自助模式
+    struct PendingIdentify {
+        quint64 personId = 0;
+        qint64 detectedAtMs = 0;
+    };
+    KioskController* m_kiosk;
+    QLabel* m_overlayLabel;
+    QTimer* m_overlayTimer;
+    bool m_showFaceTracks;                      // 在预览上画出跟踪的人脸框
+    QList<PendingIdentify> m_pendingIdentify;   // 已发送(或待发送)、等待响应的识别请求，按发送顺序
+    QList<qint64> m_kioskCompletions;           // 最近60秒内完成识别的时间点
+    QList<qint64> m_kioskLatencies;             // 最近100人的检测到响应延迟
     QCamera* m_camera;
     QMediaCaptureSession* m_captureSession;
     QVideoSink* m_videoSink;
     QImageCapture* m_imageCapture;
     
     bool m_isCameraActive;
-    QString m_serverAddress;
-    quint16 m_serverPort;
     QByteArray m_capturedFaceData;
-    QByteArray m_receiveBuffer;
+    QJsonArray m_capturedFrameLayout;           // 连拍时各帧在m_capturedFaceData中的位置，单帧时为空
+    BurstCapture* m_burst;
+    QVideoFrame m_lastFrame;                    // 最近一帧原始摄像头数据，拍照时直接从YUV编码
+    CaptureEncoder* m_captureEncoder;
+    FrameRingWriter* m_frameRing;               // 把摄像头帧共享给本机其他进程，未开启时为空
+    
+    // 性能跟踪
+    qint64 m_traceClockOffsetUs;                // 摄像头时间戳到本机时钟的偏移估计
+    bool m_traceClockOffsetValid;
+    
+    // 帧缓冲池统计
+    quint64 m_frameCount;
+    quint64 m_fallbackFrameCount;
+    cv::Mat m_previewScratch;                   // YUV预览转换的中间缓冲区，尺寸不变时复用
+    quint64 m_statsFrameMark;
+    quint64 m_statsAllocationMark;
 };
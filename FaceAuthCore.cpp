@@ -0,0 +1,1389 @@
+#include "FaceAuthCore.h"
+#include "FaceAuthProtocol.h"
+#include "OfflineJournal.h"
+#include "JournalReplayer.h"
+#include "EndpointManager.h"
+#include "DnsCache.h"
+#include "Trace.h"
+#include "Log.h"
+#include <QDateTime>
+#include <QDir>
+#include <QRandomGenerator>
+#include <QSettings>
+#include <QStandardPaths>
+#include <QTimer>
+#include <QUuid>
+#include <algorithm>
+
+FaceAuthCore::FaceAuthCore(QObject* parent)
+    : QObject(parent),
+    m_transport(nullptr),
+    m_dnsCache(nullptr),
+    m_endpoints(nullptr),
+    m_journal(nullptr),
+    m_replayer(nullptr),
+    m_serverAddress("142.171.34.18"),
+    m_serverPort(8101),
+    m_blockingConnect(false),
+    m_nonBlocking(false),
+    m_submitConnecting(false),
+    m_submitPort(0),
+    m_keepAlive(false),
+    m_authInFlight(false),
+    m_authAwaitingPrimary(false),
+    m_discardAuthResponses(0),
+    m_authDeadlineTimer(nullptr),
+    m_authRetryTimer(nullptr),
+    m_authTimeoutMs(10000),
+    m_identifyTimeoutMs(2000),
+    m_maxBusyRetries(2),
+    m_maxBackoffMs(5000),
+    m_backoffMs(0),
+    m_backoffTimer(nullptr),
+    m_hedgeEnabled(true),
+    m_hedgePercentile(95),
+    m_hedgeBudgetPerRequest(0.1),
+    m_hedgeTokens(0.0),
+    m_hedgeTransport(nullptr),
+    m_hedgeTimer(nullptr),
+    m_hedgePort(0),
+    m_hedgePending(false),
+    m_hedgeAwaiting(false),
+    m_hedgeDiscard(0),
+    m_deadlineExpirations(0),
+    m_busyResponses(0),
+    m_hedgesSent(0),
+    m_hedgeWins(0),
+    m_speculativeConnectEnabled(true),
+    m_speculativeIdleTimer(nullptr),
+    m_speculativeConnects(0),
+    m_loginAttempts(0),
+    m_warmLogins(0),
+    m_connectingLogins(0),
+    m_fullLoginMsAverage(0.0),
+    m_progressiveBytesSaved(0),
+    m_progressiveMsSaved(0),
+    m_previewRejects(0),
+    m_previewPasses(0),
+    m_identifyInFlight(0),
+    m_traceRequestId(0),
+    m_traceRequestName(nullptr),
+    m_traceAwaitingFirstByte(false)
+{
+    // 传输层按设置选择明文TCP或TLS
+    m_transport = new AuthTransport(this);
+    if (!applyTransportSettings()) {
+        LOG_WARNING(Log::net) << "无法加载TLS CA证书";
+    }
+
+    // 域名解析缓存，主连接、端点探测和离线补发共用
+    QSettings settings("FaceAuthTeam", "FaceAuthAccess");
+    m_dnsCache = new DnsCache(this);
+    m_dnsCache->setTtl(settings.value("DNS缓存秒", 300).toInt());
+    m_dnsCache->setMaxStale(settings.value("DNS过期可用秒", 3600).toInt());
+    m_transport->setDnsCache(m_dnsCache);
+    m_speculativeConnectEnabled = settings.value("预连接", true).toBool();
+    m_speculativeIdleTimer = new QTimer(this);
+    m_speculativeIdleTimer->setSingleShot(true);
+    m_speculativeIdleTimer->setInterval(settings.value("预连接保持秒", 60).toInt() * 1000);
+    connect(m_speculativeIdleTimer, &QTimer::timeout, this, [this]() {
+        if (isIdle() && socket()->state() == QAbstractSocket::ConnectedState) {
+            LOG_DEBUG(Log::net) << "预连接未被使用，断开";
+            socket()->disconnectFromHost();
+        }
+    });
+    connect(m_transport, &AuthTransport::connectionEstablished, this, &FaceAuthCore::onConnectionEstablished);
+
+    // 请求期限、繁忙退避和对冲
+    m_authTimeoutMs = qMax(1000, settings.value("请求期限毫秒", 10000).toInt());
+    m_identifyTimeoutMs = qMax(100, settings.value("识别期限毫秒", 2000).toInt());
+    m_maxBusyRetries = qMax(0, settings.value("繁忙重试次数", 2).toInt());
+    m_maxBackoffMs = qMax(100, settings.value("最大退避毫秒", 5000).toInt());
+    m_hedgeEnabled = settings.value("对冲请求", true).toBool();
+    m_hedgePercentile = qBound(50, settings.value("对冲百分位", 95).toInt(), 99);
+    m_hedgeBudgetPerRequest = qBound(0, settings.value("对冲预算百分比", 10).toInt(), 100) / 100.0;
+    m_authDeadlineTimer = new QTimer(this);
+    m_authDeadlineTimer->setSingleShot(true);
+    connect(m_authDeadlineTimer, &QTimer::timeout, this, &FaceAuthCore::onAuthDeadlineExpired);
+    m_authRetryTimer = new QTimer(this);
+    m_authRetryTimer->setSingleShot(true);
+    connect(m_authRetryTimer, &QTimer::timeout, this, &FaceAuthCore::onAuthRetryTimeout);
+    m_backoffTimer = new QTimer(this);
+    m_backoffTimer->setSingleShot(true);
+    connect(m_backoffTimer, &QTimer::timeout, this, &FaceAuthCore::flushIdentifyOutbox);
+    m_hedgeTimer = new QTimer(this);
+    m_hedgeTimer->setSingleShot(true);
+    connect(m_hedgeTimer, &QTimer::timeout, this, &FaceAuthCore::onHedgeTimeout);
+
+    // 多服务器端点：后台探测各服务器的RTT和协议延迟，请求发往最快且健康的服务器
+    m_endpoints = new EndpointManager(m_transport, this);
+    m_endpoints->loadSettings();
+    m_serverAddress = m_endpoints->activeEndpoint().host;
+    m_serverPort = m_endpoints->activeEndpoint().port;
+    connect(m_endpoints, &EndpointManager::activeEndpointChanged, this, &FaceAuthCore::onActiveEndpointChanged);
+    connect(m_transport, &AuthTransport::connectionEstablished, this, [this]() {
+        if (!m_blockingConnect && !m_submitConnecting) {
+            m_endpoints->reportSuccess(m_serverAddress, m_serverPort);
+        }
+    });
+    connect(m_transport, &AuthTransport::connectionFailed, this, [this](const QString& error) {
+        if (!m_blockingConnect && !m_submitConnecting) {
+            m_endpoints->reportFailure(m_serverAddress, m_serverPort, error);
+        }
+    });
+
+    // 非阻塞模式的登录/注册：连接建立后发送，失败或超时后尝试下一个端点
+    connect(m_transport, &AuthTransport::connectionEstablished, this, &FaceAuthCore::onSubmitConnected);
+    connect(m_transport, &AuthTransport::connectionFailed, this, &FaceAuthCore::onSubmitConnectFailed);
+    m_submitConnectTimer = new QTimer(this);
+    m_submitConnectTimer->setSingleShot(true);
+    connect(m_submitConnectTimer, &QTimer::timeout, this, [this]() {
+        m_transport->cancelConnect();
+        onSubmitConnectFailed("连接超时");
+        // 放弃的连接不会再发出信号，等它的识别请求也不会发出
+        if (!m_transport->isReady() && !m_transport->isConnecting() && !m_identifyOutbox.isEmpty()) {
+            m_identifyOutbox.clear();
+            emit identifyDropped("连接超时");
+        }
+    });
+    m_endpoints->start();
+    m_dnsCache->prefetch(m_serverAddress);
+
+    // 离线请求日志：网络不可用时保存请求，恢复连接后批量补发
+    QString journalDir = QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation);
+    QDir().mkpath(journalDir);
+    m_journal = new OfflineJournal(journalDir + "/offline_journal.bin",
+                                   qint64(settings.value("离线日志容量MB", 64).toInt()) * 1024 * 1024);
+    QString journalError;
+    if (!m_journal->open(&journalError)) {
+        LOG_WARNING(Log::journal) << "无法打开离线日志:" << journalError;
+    }
+    if (!OfflineJournal::canProtectSecrets()) {
+        LOG_WARNING(Log::journal) << "本平台无法加密保存密码，离线时注册请求不写入离线日志(登录审计记录不受影响)";
+    }
+
+    m_replayer = new JournalReplayer(m_journal, m_transport, this);
+    m_replayer->setServer(m_serverAddress, m_serverPort);
+    m_replayer->setMaxConcurrency(settings.value("离线补发并发", 2).toInt());
+    m_replayer->setBatchSize(settings.value("离线补发批量", 16).toInt());
+
+    // 主连接建立时以及定时检查是否有待补发的请求
+    connect(m_transport, &AuthTransport::connectionEstablished, m_replayer, &JournalReplayer::start);
+    QTimer* replayTimer = new QTimer(this);
+    connect(replayTimer, &QTimer::timeout, m_replayer, &JournalReplayer::start);
+    replayTimer->start(30000);
+    QTimer::singleShot(0, m_replayer, &JournalReplayer::start);
+
+    // 识别请求：连接建立后发送排队的数据包，连接失败时它们都未发出
+    connect(m_transport, &AuthTransport::connectionEstablished, this, &FaceAuthCore::flushIdentifyOutbox);
+    connect(m_transport, &AuthTransport::connectionFailed, this, [this](const QString& error) {
+        if (!m_identifyOutbox.isEmpty()) {
+            m_identifyOutbox.clear();
+            emit identifyDropped(error);
+        }
+    });
+
+    connect(socket(), &QTcpSocket::disconnected, this, &FaceAuthCore::onSocketDisconnected);
+    connect(socket(), &QTcpSocket::readyRead, this, &FaceAuthCore::onSocketReadyRead);
+}
+
+FaceAuthCore::~FaceAuthCore()
+{
+    if (socket()->isOpen()) {
+        socket()->close();
+    }
+
+    // 补发器引用离线日志，需先于日志释放
+    delete m_replayer;
+    m_replayer = nullptr;
+    delete m_journal;
+}
+
+bool FaceAuthCore::reloadSettings()
+{
+    // 如果已经连接，则需要断开重连
+    if (socket()->state() == QAbstractSocket::ConnectedState) {
+        socket()->disconnectFromHost();
+    }
+
+    // 设置对话框已保存服务器列表和TLS设置，重新应用到传输层并探测新的列表
+    bool caLoaded = applyTransportSettings();
+    m_endpoints->loadSettings();
+    m_endpoints->probeNow();
+    m_serverAddress = m_endpoints->activeEndpoint().host;
+    m_serverPort = m_endpoints->activeEndpoint().port;
+    m_replayer->setServer(m_serverAddress, m_serverPort);
+    if (m_hedgeTransport) {
+        m_hedgeTransport->socket()->abort();
+        m_hedgeTransport->copySettingsFrom(*m_transport);
+    }
+
+    QSettings settings("FaceAuthTeam", "FaceAuthAccess");
+    settings.setValue("ServerAddress", m_serverAddress);
+    settings.setValue("ServerPort", m_serverPort);
+    return caLoaded;
+}
+
+bool FaceAuthCore::isIdle() const
+{
+    return !m_keepAlive && !m_authInFlight && m_identifyInFlight == 0 && m_identifyOutbox.isEmpty();
+}
+
+bool FaceAuthCore::applyTransportSettings()
+{
+    // 与ServerSettingsDialog使用相同的配置键
+    QSettings settings("FaceAuthTeam", "FaceAuthAccess");
+    m_transport->setTlsEnabled(settings.value("启用TLS", false).toBool());
+    m_transport->setPeerVerifyName(settings.value("TLS证书主机名").toString());
+    return m_transport->setCaCertificateFile(settings.value("TLS CA证书").toString());
+}
+
+void FaceAuthCore::beginConnect()
+{
+    if (m_transport->isReady() || m_transport->isConnecting()) {
+        return;
+    }
+    m_transport->beginConnect(m_serverAddress, m_serverPort);
+}
+
+bool FaceAuthCore::connectToBestEndpoint(QString* errorMessage)
+{
+    // 按路由优先级依次尝试，失败的端点报告给EndpointManager，后续请求自动绕开
+    QList<EndpointManager::Endpoint> candidates = m_endpoints->candidates();
+    int attempts = qMin(int(candidates.size()), 3);
+    m_blockingConnect = true;
+    bool connected = false;
+    for (int i = 0; i < attempts && !connected; ++i) {
+        const EndpointManager::Endpoint& endpoint = candidates[i];
+        QString error;
+        // 首选端点使用完整超时，备用端点缩短超时，整体等待不超过原来的两倍，也不超过请求的剩余期限
+        qint64 timeoutMs = i == 0 ? 5000 : 2500;
+        if (!m_auth.deadline.isForever()) {
+            timeoutMs = qMin(timeoutMs, m_auth.deadline.remainingTime());
+        }
+        if (timeoutMs <= 0) {
+            if (errorMessage) {
+                *errorMessage = "请求超时";
+            }
+            break;
+        }
+        connected = m_transport->connectToServer(endpoint.host, endpoint.port, int(timeoutMs), &error);
+        if (connected) {
+            m_serverAddress = endpoint.host;
+            m_serverPort = endpoint.port;
+            m_endpoints->reportSuccess(endpoint.host, endpoint.port);
+        } else {
+            LOG_WARNING(Log::net) << "连接" << endpoint.host << endpoint.port << "失败:" << error;
+            m_endpoints->reportFailure(endpoint.host, endpoint.port, error);
+            if (errorMessage) {
+                *errorMessage = error;
+            }
+        }
+    }
+    m_blockingConnect = false;
+    return connected;
+}
+
+void FaceAuthCore::speculativeConnect(const char* reason)
+{
+    if (!m_speculativeConnectEnabled || m_serverAddress.isEmpty()
+        || m_transport->isReady() || m_transport->isConnecting()) {
+        return;
+    }
+    // 连接失败时不在每次按键都重试
+    if (m_speculativeThrottle.isValid() && m_speculativeThrottle.elapsed() < 2000) {
+        return;
+    }
+    m_speculativeThrottle.start();
+
+    m_speculativeConnects++;
+    Trace::instant("preconnect", "net");
+    LOG_DEBUG(Log::net) << "预连接(" << reason << ")" << m_serverAddress << ":" << m_serverPort;
+    m_transport->beginConnect(m_serverAddress, m_serverPort);
+    m_speculativeIdleTimer->start();
+}
+
+void FaceAuthCore::onConnectionEstablished(const AuthTransport::ConnectionStats& stats)
+{
+    if (!stats.encrypted) {
+        LOG_DEBUG(Log::net) << "TCP连接耗时:" << stats.tcpConnectMs << "ms";
+        return;
+    }
+
+    AuthTransport::Totals totals = m_transport->totals();
+    LOG_DEBUG(Log::net) << "TLS握手统计: 完整握手" << totals.fullHandshakes << "次, 平均"
+                        << (totals.fullHandshakes ? totals.fullHandshakeMsTotal / qint64(totals.fullHandshakes) : 0) << "ms; 会话恢复"
+                        << totals.resumedHandshakes << "次, 平均"
+                        << (totals.resumedHandshakes ? totals.resumedHandshakeMsTotal / qint64(totals.resumedHandshakes) : 0) << "ms";
+    emit statusMessage(QString("已建立%1安全连接 (%2, 握手%3ms)")
+                       .arg(stats.protocol)
+                       .arg(stats.ticketOffered ? "会话恢复" : "完整握手")
+                       .arg(stats.handshakeMs));
+}
+
+void FaceAuthCore::onActiveEndpointChanged(const QString& host, quint16 port)
+{
+    m_serverAddress = host;
+    m_serverPort = port;
+    m_replayer->setServer(host, port);
+
+    // 空闲的长连接仍指向旧服务器，断开后下一个请求连接新服务器；有在途请求时等其完成
+    QSslSocket* connection = socket();
+    bool idle = !m_authInFlight && m_identifyInFlight == 0 && m_identifyOutbox.isEmpty();
+    if (idle && connection->state() == QAbstractSocket::ConnectedState
+        && (connection->peerName() != host || connection->peerPort() != port)) {
+        connection->disconnectFromHost();
+    }
+    emit activeEndpointChanged(host, port);
+}
+
+void FaceAuthCore::onSocketDisconnected()
+{
+    LOG_INFO(Log::net) << "与服务器连接断开";
+
+    // 连接上未完成的请求不会再有响应
+    m_receiveBuffer.clear();
+    m_identifyInFlight = 0;
+    m_identifyExpired.clear();
+    m_progressiveLogin = ProgressiveLogin();
+    m_authAwaitingPrimary = false;
+    m_discardAuthResponses = 0;
+    if (m_authInFlight && !m_pendingSubmit.active) {
+        finishAuthAttempt();
+        finishRequestTrace();
+    }
+    emit requestsAborted();
+}
+
+void FaceAuthCore::onSocketReadyRead()
+{
+    if (m_traceAwaitingFirstByte) {
+        Trace::instant("response.first_byte", "net", m_traceRequestId);
+        m_traceAwaitingFirstByte = false;
+    }
+
+    // 读取所有可用数据并添加到缓冲区
+    m_receiveBuffer.append(socket()->readAll());
+    qint64 processStartUs = Trace::spanStart();
+
+    // 缓冲区中可能有多个完整响应(识别请求是流水线发送的)，逐个处理
+    while (!m_receiveBuffer.isEmpty()) {
+        QJsonObject response;
+        int consumed = 0;
+        FaceAuthProtocol::ParseResult result = FaceAuthProtocol::parseResponse(m_receiveBuffer, &response, &consumed);
+
+        if (result == FaceAuthProtocol::ParseResult::Incomplete) {
+            // 数据不完整，继续等待更多数据
+            LOG_TRACE(Log::net) << "接收到的数据不完整" << Log::field("buffered_bytes", int(m_receiveBuffer.size()));
+            return;
+        }
+
+        if (result == FaceAuthProtocol::ParseResult::InvalidHeader) {
+            LOG_WARNING(Log::net) << "无效的响应头部:" << m_receiveBuffer.left(4);
+            // 无法再定位后续响应的边界，清空接收缓冲区
+            m_receiveBuffer.clear();
+            m_authAwaitingPrimary = false;
+            m_discardAuthResponses = 0;
+            finishAuthAttempt();
+            m_progressiveLogin = ProgressiveLogin();
+            finishRequestTrace();
+            emit requestsAborted();
+            return;
+        }
+
+        m_receiveBuffer.remove(0, consumed);
+
+        if (result == FaceAuthProtocol::ParseResult::InvalidJson) {
+            LOG_WARNING(Log::net) << "无效的JSON数据" << Log::field("frame_bytes", consumed);
+            m_authAwaitingPrimary = false;
+            finishAuthAttempt();
+            m_progressiveLogin = ProgressiveLogin();
+            finishRequestTrace();
+            emit requestsAborted();
+            continue;
+        }
+
+        // 响应JSON经过脱敏后记录
+        LOG_DEBUG(Log::net) << "服务器响应:" << response << Log::field("frame_bytes", consumed);
+
+        // 登录/注册的响应：已放弃等待的请求(超过期限或对冲请求先返回)的响应按序先到，直接丢弃
+        if (response.value("type").toString() != "identify") {
+            if (m_discardAuthResponses > 0) {
+                m_discardAuthResponses--;
+                LOG_DEBUG(Log::net) << "丢弃已放弃等待的请求的响应" << Log::field("type", response.value("type").toString());
+                continue;
+            }
+            if (m_authAwaitingPrimary) {
+                m_authAwaitingPrimary = false;
+                if (!response.value("busy").toBool() && !response.value("deadline_exceeded").toBool()) {
+                    recordAuthLatency(m_auth.sentTimer.elapsed());
+                }
+            }
+        }
+        handleServerResponse(response, processStartUs);
+    }
+}
+
+void FaceAuthCore::handleServerResponse(const QJsonObject& response, qint64 processStartUs)
+{
+    QString type = response["type"].toString();
+
+    // 解析success字段，支持多种格式(布尔值、字符串、数字)
+    bool success = FaceAuthProtocol::responseSucceeded(response);
+    LOG_DEBUG(Log::net) << "收到服务器响应: 类型=" << type << ", 成功=" << success
+                        << ", 消息=" << response["message"].toString();
+
+    // 在通知调用方之前结束处理计时，结果对话框的等待时间不计入
+    Trace::spanEnd("processServerResponse", "net", processStartUs, m_traceRequestId);
+
+    // 繁忙时退避，恢复正常后退避时长逐步减半
+    bool busy = response.value("busy").toBool();
+    if (busy) {
+        recordBusy(response);
+    } else if (m_backoffMs > 0) {
+        m_backoffMs = m_backoffMs / 2 < 50 ? 0 : m_backoffMs / 2;
+    }
+
+    if (type == "identify") {
+        m_identifyInFlight = qMax(0, m_identifyInFlight - 1);
+        emit identifyFinished(success, response);
+        releaseExpiredIdentifies();
+        return;
+    }
+
+    // 已有结果(或将重试)，不再需要对冲
+    abandonHedge();
+    if (!m_authInFlight) {
+        LOG_DEBUG(Log::net) << "没有等待中的请求，忽略响应" << Log::field("type", type);
+        return;
+    }
+    if (busy && retryBusyAuth(response)) {
+        return;
+    }
+
+    // 预览图通过初筛时继续上传完整图像，请求区间由sendLoginRequest重新开始
+    if (type == "login" && continueProgressiveLogin(response)) {
+        return;
+    }
+
+    if (type != "login" && type != "register") {
+        LOG_WARNING(Log::net) << "未知的响应类型:" << type;
+    }
+    finishRequestTrace();
+    finishAuthAttempt();
+    if (type == "login") {
+        recordLoginSavings(response);
+    }
+    emit authFinished(type, success, response);
+}
+
+bool FaceAuthCore::continueProgressiveLogin(const QJsonObject& response)
+{
+    if (m_progressiveLogin.stage != "preview") {
+        return false;
+    }
+
+    // 不支持两阶段上传的服务器把预览图当作完整登录处理，响应中没有stage。它的结果不可信：拒绝可能只因预览图太小，
+    // 成功则意味着只凭缩略图就通过了人脸比对，两种情况都改为上传完整图像。只有回显stage的服务器的结论才被采纳
+    bool understoodStage = response.value("stage").toString() == "preview";
+    bool undecided = response.value("busy").toBool() || response.value("deadline_exceeded").toBool();
+    bool needMore = response.value("need_more").toBool() || (!undecided && !understoodStage);
+    if (!needMore) {
+        return false;
+    }
+
+    m_previewPasses++;
+    m_progressiveLogin.previewMs = m_loginTimer.elapsed();
+    m_progressiveLogin.stage = "full";
+    LOG_DEBUG(Log::net) << "预览图通过初筛，上传完整图像" << Log::field("preview_ms", m_progressiveLogin.previewMs)
+                        << Log::field("score", response.value("score").toDouble())
+                        << Log::field("server_supports_preview", response.value("stage").toString() == "preview");
+    emit statusMessage("预览图通过初筛，上传完整图像...");
+
+    QString error;
+    if (sendLoginRequest(m_progressiveLogin.username, m_progressiveLogin.password, m_progressiveLogin.fullData,
+                         m_progressiveLogin.fullLayout, "full", &error) != SubmitResult::Sent) {
+        m_progressiveLogin = ProgressiveLogin();
+        finishAuthAttempt();
+        QJsonObject failure;
+        failure["type"] = "login";
+        failure["success"] = false;
+        failure["message"] = "连接失败:" + error;
+        emit authFinished("login", false, failure);
+    }
+    return true;
+}
+
+void FaceAuthCore::recordLoginSavings(const QJsonObject& response)
+{
+    qint64 elapsedMs = m_loginTimer.isValid() ? m_loginTimer.elapsed() : 0;
+    ProgressiveLogin login = m_progressiveLogin;
+    m_progressiveLogin = ProgressiveLogin();
+
+    // 服务器繁忙时没有做出判断，不计入节省，也不计入完整登录的耗时
+    if (response.value("busy").toBool()) {
+        return;
+    }
+
+    qint64 bytesSaved = 0;
+    qint64 msSaved = 0;
+    if (login.stage == "preview") {
+        // 预览阶段即有结果：省去完整图像的上传和比对，节省的时间按完整登录的平均耗时估算
+        m_previewRejects++;
+        bytesSaved = login.fullData.size() - login.previewBytes;
+        msSaved = m_fullLoginMsAverage > 0.0 ? qint64(m_fullLoginMsAverage) - elapsedMs : 0;
+    } else {
+        qint64 fullMs = elapsedMs;
+        if (login.stage == "full") {
+            // 预览图没能提前拒绝：多付出一次预览图上传和往返
+            bytesSaved = -login.previewBytes;
+            msSaved = -login.previewMs;
+            fullMs -= login.previewMs;
+        }
+        m_fullLoginMsAverage = m_fullLoginMsAverage > 0.0 ? 0.7 * m_fullLoginMsAverage + 0.3 * fullMs : double(fullMs);
+    }
+
+    if (login.stage.isEmpty()) {
+        return;
+    }
+    m_progressiveBytesSaved += bytesSaved;
+    m_progressiveMsSaved += msSaved;
+    LOG_INFO(Log::net) << "两阶段上传" << Log::field("outcome", login.stage == "preview" ? "preview_final" : "full_uploaded")
+                       << Log::field("bytes_saved", bytesSaved) << Log::field("ms_saved", msSaved)
+                       << Log::field("elapsed_ms", elapsedMs) << Log::field("preview_rejects", qint64(m_previewRejects))
+                       << Log::field("preview_passes", qint64(m_previewPasses))
+                       << Log::field("total_bytes_saved", m_progressiveBytesSaved)
+                       << Log::field("total_ms_saved", m_progressiveMsSaved);
+}
+
+FaceAuthCore::SubmitResult FaceAuthCore::login(const AuthRequest& request, QString* error)
+{
+    // 在途请求的期限、对冲和响应匹配都依赖m_auth，不能被新请求覆盖
+    if (m_authInFlight) {
+        LOG_WARNING(Log::net) << "已有请求在途，拒绝新的登录请求" << Log::field("in_flight", m_auth.type);
+        if (error) {
+            *error = "已有请求在途";
+        }
+        return SubmitResult::Failed;
+    }
+    beginAuthAttempt("login");
+    m_progressiveLogin = ProgressiveLogin();
+    m_loginTimer.start();
+
+    // 两阶段上传：预览图比完整图像小时先发送预览图，服务器可能据此直接拒绝
+    if (!request.preview.isEmpty() && request.preview.size() < request.faceData.size()) {
+        m_progressiveLogin.stage = "preview";
+        m_progressiveLogin.username = request.username;
+        m_progressiveLogin.password = request.password;
+        m_progressiveLogin.fullData = request.faceData;
+        m_progressiveLogin.fullLayout = request.frameLayout;
+        m_progressiveLogin.previewBytes = request.preview.size();
+        SubmitResult result = sendLoginRequest(request.username, request.password, request.preview, QJsonArray(),
+                                               "preview", error);
+        if (result != SubmitResult::Sent) {
+            m_progressiveLogin = ProgressiveLogin();
+        }
+        return result;
+    }
+
+    return sendLoginRequest(request.username, request.password, request.faceData, request.frameLayout, QString(), error);
+}
+
+FaceAuthCore::SubmitResult FaceAuthCore::sendLoginRequest(const QString& username, const QString& password,
+                                                          const QByteArray& faceData, const QJsonArray& frameLayout,
+                                                          const QString& stage, QString* error)
+{
+    beginRequestTrace("login");
+    LOG_DEBUG(Log::net) << "准备发送登录请求到" << m_serverAddress << ":" << m_serverPort;
+
+    // 预连接命中统计(两阶段上传的第二阶段沿用同一连接，不重复计数)
+    m_speculativeIdleTimer->stop();
+    if (stage != "full") {
+        m_loginAttempts++;
+        if (m_transport->isReady()) {
+            m_warmLogins++;
+        } else if (m_transport->isConnecting()) {
+            m_connectingLogins++;
+        }
+        DnsCache::Stats dnsStats = m_dnsCache->stats();
+        LOG_DEBUG(Log::net) << "预连接: 登录" << m_loginAttempts << "次, 连接已就绪" << m_warmLogins << "次("
+                            << QString::number(100.0 * m_warmLogins / m_loginAttempts, 'f', 1) << "%), 建立中"
+                            << m_connectingLogins << "次, 预连接" << m_speculativeConnects << "次; DNS缓存命中"
+                            << dnsStats.hits << "次, 过期命中" << dnsStats.staleHits << "次, 未命中" << dnsStats.misses << "次";
+    }
+
+    // 检查是否已连接到服务器，如果没有连接则连接并等待(及TLS握手)完成；非阻塞模式下排队，连接建立后发送
+    if (!m_transport->isReady() && m_nonBlocking) {
+        AuthRequest pending;
+        pending.username = username;
+        pending.password = password;
+        pending.faceData = faceData;
+        pending.frameLayout = frameLayout;
+        queueSubmit(pending, stage);
+        return SubmitResult::Sent;
+    }
+    if (!m_transport->isReady()) {
+        emit statusMessage("连接到服务器...");
+        QString connectError;
+        qint64 connectStartUs = Trace::spanStart();
+        bool connected = connectToBestEndpoint(&connectError);
+        Trace::spanEnd("socket.connect", "net", connectStartUs, m_traceRequestId);
+        if (!connected) {
+            finishRequestTrace();
+            LOG_WARNING(Log::net) << "连接失败:" << connectError;
+
+            // 可选：记录离线登录尝试，恢复连接后仅用于服务器审计
+            QSettings settings("FaceAuthTeam", "FaceAuthAccess");
+            if (settings.value("离线登录审计", false).toBool()) {
+                journalRequest("audit", username, QString(), faceData, frameLayout);
+            }
+            if (error) {
+                *error = connectError;
+            }
+            return SubmitResult::Failed;
+        }
+        LOG_DEBUG(Log::net) << "已连接到服务器";
+    }
+
+    return writeLoginRequest(username, password, faceData, frameLayout, stage, error);
+}
+
+FaceAuthCore::SubmitResult FaceAuthCore::writeLoginRequest(const QString& username, const QString& password,
+                                                           const QByteArray& faceData, const QJsonArray& frameLayout,
+                                                           const QString& stage, QString* error)
+{
+    QJsonObject loginData;
+    loginData["type"] = "login";
+    loginData["username"] = username;
+    loginData["password"] = password;
+    FaceAuthProtocol::describePayload(&loginData, faceData, frameLayout);
+    if (!stage.isEmpty()) {
+        loginData["stage"] = stage;
+    }
+
+    // 按FACE协议封包: "FACE" + JSON长度(大端) + JSON + 人脸图像数据，繁忙重试和对冲时重新封包
+    m_auth.header = loginData;
+    m_auth.payload = faceData;
+    QByteArray packet = buildAuthPacket();
+
+    // 只记录尺寸，请求JSON中的密码不进入日志
+    LOG_DEBUG(Log::net) << "发送登录请求" << Log::field("server", m_serverAddress) << Log::field("stage", stage)
+                        << Log::field("json_bytes", qint64(packet.size() - FaceAuthProtocol::HeaderSize - faceData.size()))
+                        << Log::field("face_bytes", int(faceData.size()))
+                        << Log::field("frames", qMax(1, int(frameLayout.size()))) << Log::field("packet_bytes", int(packet.size()));
+    if (faceData.isEmpty()) {
+        LOG_WARNING(Log::net) << "没有人脸数据添加到登录请求";
+    }
+
+    if (!writeRequest(packet, error)) {
+        return SubmitResult::Failed;
+    }
+    return SubmitResult::Sent;
+}
+
+FaceAuthCore::SubmitResult FaceAuthCore::registerUser(const AuthRequest& request, QString* error)
+{
+    if (m_authInFlight) {
+        LOG_WARNING(Log::net) << "已有请求在途，拒绝新的注册请求" << Log::field("in_flight", m_auth.type);
+        if (error) {
+            *error = "已有请求在途";
+        }
+        return SubmitResult::Failed;
+    }
+    beginAuthAttempt("register");
+    beginRequestTrace("register");
+    LOG_DEBUG(Log::net) << "准备发送注册请求到" << m_serverAddress << ":" << m_serverPort;
+    m_speculativeIdleTimer->stop();
+
+    if (!m_transport->isReady() && m_nonBlocking) {
+        queueSubmit(request, QString());
+        return SubmitResult::Sent;
+    }
+    if (!m_transport->isReady()) {
+        emit statusMessage("连接到服务器...");
+        QString connectError;
+        qint64 connectStartUs = Trace::spanStart();
+        bool connected = connectToBestEndpoint(&connectError);
+        Trace::spanEnd("socket.connect", "net", connectStartUs, m_traceRequestId);
+        if (!connected) {
+            finishRequestTrace();
+            // 网络不可用时写入离线日志，恢复连接后自动补发，无需重新拍照
+            if (journalRequest("register", request.username, request.password, request.faceData, request.frameLayout)) {
+                LOG_WARNING(Log::net) << "连接失败，注册请求已写入离线日志:" << connectError;
+                return SubmitResult::Queued;
+            }
+            LOG_WARNING(Log::net) << "连接失败:" << connectError;
+            if (error) {
+                *error = connectError;
+            }
+            return SubmitResult::Failed;
+        }
+        LOG_DEBUG(Log::net) << "已连接到服务器";
+    }
+
+    return writeRegisterRequest(request, error);
+}
+
+FaceAuthCore::SubmitResult FaceAuthCore::writeRegisterRequest(const AuthRequest& request, QString* error)
+{
+    QJsonObject registerData;
+    registerData["type"] = "register";
+    registerData["username"] = request.username;
+    registerData["password"] = request.password;
+    FaceAuthProtocol::describePayload(&registerData, request.faceData, request.frameLayout);
+    m_auth.header = registerData;
+    m_auth.payload = request.faceData;
+    QByteArray packet = buildAuthPacket();
+
+    // 只记录尺寸，请求JSON中的密码不进入日志
+    LOG_DEBUG(Log::net) << "发送注册请求" << Log::field("server", m_serverAddress)
+                        << Log::field("json_bytes", qint64(packet.size() - FaceAuthProtocol::HeaderSize - request.faceData.size()))
+                        << Log::field("face_bytes", int(request.faceData.size()))
+                        << Log::field("frames", qMax(1, int(request.frameLayout.size())))
+                        << Log::field("packet_bytes", int(packet.size()));
+    if (request.faceData.isEmpty()) {
+        LOG_WARNING(Log::net) << "没有人脸数据添加到注册请求";
+    }
+
+    if (!writeRequest(packet, error)) {
+        if (journalRequest("register", request.username, request.password, request.faceData, request.frameLayout)) {
+            return SubmitResult::Queued;
+        }
+        return SubmitResult::Failed;
+    }
+    return SubmitResult::Sent;
+}
+
+void FaceAuthCore::queueSubmit(const AuthRequest& request, const QString& stage)
+{
+    emit statusMessage("连接到服务器...");
+    m_pendingSubmit = PendingSubmit();
+    m_pendingSubmit.active = true;
+    m_pendingSubmit.request = request;
+    m_pendingSubmit.stage = stage;
+    m_pendingSubmit.candidates = m_endpoints->candidates();
+    m_pendingSubmit.connectStartUs = Trace::spanStart();
+    // 连接期间按在途请求处理：期限照常计时，断开不会结束本次请求
+    m_authInFlight = true;
+    connectPendingSubmit();
+}
+
+void FaceAuthCore::connectPendingSubmit()
+{
+    // 与connectToBestEndpoint相同：最多尝试三个端点，首选端点5秒，备用端点2.5秒，不超过请求的剩余期限
+    PendingSubmit& pending = m_pendingSubmit;
+    qint64 timeoutMs = pending.attempt == 0 ? 5000 : 2500;
+    if (!m_auth.deadline.isForever()) {
+        timeoutMs = qMin(timeoutMs, m_auth.deadline.remainingTime());
+    }
+    if (timeoutMs <= 0) {
+        failPendingSubmit(pending.lastError.isEmpty() ? QString("请求超时") : pending.lastError);
+        return;
+    }
+    if (pending.attempt >= 3) {
+        failPendingSubmit(pending.lastError);
+        return;
+    }
+
+    if (m_transport->isConnecting()) {
+        // 预连接(或识别请求发起的连接)正在建立，等它完成而不是重新连接
+        m_submitHost = m_transport->host();
+        m_submitPort = m_transport->port();
+    } else if (!pending.candidates.isEmpty()) {
+        EndpointManager::Endpoint endpoint = pending.candidates.takeFirst();
+        m_submitHost = endpoint.host;
+        m_submitPort = endpoint.port;
+    } else {
+        failPendingSubmit(pending.lastError.isEmpty() ? QString("没有可用的服务器") : pending.lastError);
+        return;
+    }
+    pending.candidates.removeIf([this](const EndpointManager::Endpoint& endpoint) {
+        return endpoint.host == m_submitHost && endpoint.port == m_submitPort;
+    });
+    pending.attempt++;
+
+    // 先记下状态再发起连接，连接结果由onSubmitConnected/onSubmitConnectFailed处理
+    m_submitConnecting = true;
+    m_submitConnectTimer->start(int(timeoutMs));
+    if (!m_transport->isConnecting()) {
+        m_transport->beginConnect(m_submitHost, m_submitPort);
+    }
+}
+
+void FaceAuthCore::onSubmitConnected()
+{
+    if (!m_submitConnecting) {
+        return;
+    }
+    m_submitConnecting = false;
+    m_submitConnectTimer->stop();
+    m_endpoints->reportSuccess(m_submitHost, m_submitPort);
+    if (!m_pendingSubmit.active) {
+        // 请求已结束(超过期限)，连接留给后续请求
+        return;
+    }
+
+    PendingSubmit pending = m_pendingSubmit;
+    m_pendingSubmit = PendingSubmit();
+    m_serverAddress = m_submitHost;
+    m_serverPort = m_submitPort;
+    Trace::spanEnd("socket.connect", "net", pending.connectStartUs, m_traceRequestId);
+    LOG_DEBUG(Log::net) << "已连接到服务器";
+
+    QString type = m_auth.type;
+    QString error;
+    SubmitResult result = type == "register"
+        ? writeRegisterRequest(pending.request, &error)
+        : writeLoginRequest(pending.request.username, pending.request.password, pending.request.faceData,
+                            pending.request.frameLayout, pending.stage, &error);
+    if (result == SubmitResult::Sent) {
+        return;
+    }
+
+    m_progressiveLogin = ProgressiveLogin();
+    finishAuthAttempt();
+    QJsonObject failure;
+    failure["type"] = type;
+    failure["success"] = false;
+    if (result == SubmitResult::Queued) {
+        failure["queued"] = true;
+        failure["message"] = "网络不可用，注册请求已保存，恢复连接后将自动补发";
+    } else {
+        failure["message"] = "连接失败:" + error;
+    }
+    emit authFinished(type, false, failure);
+}
+
+void FaceAuthCore::onSubmitConnectFailed(const QString& error)
+{
+    if (!m_submitConnecting) {
+        return;
+    }
+    m_submitConnecting = false;
+    m_submitConnectTimer->stop();
+    LOG_WARNING(Log::net) << "连接" << m_submitHost << m_submitPort << "失败:" << error;
+    m_endpoints->reportFailure(m_submitHost, m_submitPort, error);
+    if (!m_pendingSubmit.active) {
+        return;
+    }
+    m_pendingSubmit.lastError = error;
+    connectPendingSubmit();
+}
+
+void FaceAuthCore::failPendingSubmit(const QString& error)
+{
+    PendingSubmit pending = m_pendingSubmit;
+    QString type = m_auth.type;
+    Trace::spanEnd("socket.connect", "net", pending.connectStartUs, m_traceRequestId);
+    finishRequestTrace();
+    m_progressiveLogin = ProgressiveLogin();
+    finishAuthAttempt();
+    LOG_WARNING(Log::net) << "连接失败:" << error;
+
+    QJsonObject failure;
+    failure["type"] = type;
+    failure["success"] = false;
+    const AuthRequest& request = pending.request;
+    if (type == "register") {
+        // 与阻塞模式相同，网络不可用时写入离线日志，恢复连接后自动补发
+        if (journalRequest("register", request.username, request.password, request.faceData, request.frameLayout)) {
+            failure["queued"] = true;
+            failure["message"] = "网络不可用，注册请求已保存，恢复连接后将自动补发";
+            emit authFinished(type, false, failure);
+            return;
+        }
+    } else {
+        QSettings settings("FaceAuthTeam", "FaceAuthAccess");
+        if (settings.value("离线登录审计", false).toBool()) {
+            journalRequest("audit", request.username, QString(), request.faceData, request.frameLayout);
+        }
+    }
+    failure["message"] = "连接失败:" + error;
+    emit authFinished(type, false, failure);
+}
+
+bool FaceAuthCore::writeRequest(const QByteArray& packet, QString* error)
+{
+    qint64 writeStartUs = Trace::spanStart();
+    qint64 bytesSent = socket()->write(packet);
+    if (bytesSent == -1) {
+        finishRequestTrace();
+        LOG_WARNING(Log::net) << "发送数据失败:" << socket()->errorString();
+        if (error) {
+            *error = socket()->errorString();
+        }
+        return false;
+    }
+
+    m_authInFlight = true;
+    m_authAwaitingPrimary = true;
+    m_auth.sentTimer.start();
+    emit statusMessage(QString("已发送 %1 字节到服务器，等待响应...").arg(bytesSent));
+    LOG_DEBUG(Log::net) << "已发送" << bytesSent << "字节到服务器，等待响应...";
+
+    // 确保数据发送出去，等待不超过请求的剩余期限；非阻塞模式下由事件循环继续发送
+    socket()->flush();
+    if (!m_nonBlocking && !socket()->waitForBytesWritten(int(qBound<qint64>(1, m_auth.deadline.remainingTime(), 3000)))) {
+        LOG_WARNING(Log::net) << "发送数据超时，服务器可能没有收到完整数据";
+    }
+    Trace::spanEnd("socket.write", "net", writeStartUs, m_traceRequestId);
+    m_traceAwaitingFirstByte = Trace::enabled();
+
+    // 响应慢于最近登录耗时的百分位时对冲，计时从发送时刻开始；
+    // 百分位只统计完整请求的耗时(见recordAuthLatency)，预览图阶段不对冲
+    if (m_auth.hedgeable && m_hedgeEnabled && m_auth.header.value("stage").toString() != "preview") {
+        qint64 delayMs = hedgeDelayMs();
+        if (delayMs >= 0 && delayMs < m_auth.deadline.remainingTime()) {
+            m_hedgeTimer->start(int(qMax<qint64>(0, delayMs - m_auth.sentTimer.elapsed())));
+        }
+    }
+    return true;
+}
+
+void FaceAuthCore::beginAuthAttempt(const QString& type)
+{
+    m_authRetryTimer->stop();
+    abandonHedge();
+    m_auth = AuthAttempt();
+    m_auth.type = type;
+    m_auth.hedgeable = type == "login";
+    m_auth.deadline.setRemainingTime(m_authTimeoutMs);
+    // 对冲预算按登录次数累积，两阶段上传的第二阶段和繁忙重试不重复计入
+    if (m_auth.hedgeable && m_hedgeEnabled) {
+        m_hedgeTokens = qMin(m_hedgeTokens + m_hedgeBudgetPerRequest, 2.0);
+    }
+    m_authDeadlineTimer->start(m_authTimeoutMs);
+}
+
+QByteArray FaceAuthCore::buildAuthPacket() const
+{
+    // 期限以发送时的剩余毫秒数传给服务器，两端不需要同步时钟
+    QJsonObject header = m_auth.header;
+    header["deadline_ms"] = qMax<qint64>(1, m_auth.deadline.remainingTime());
+    return FaceAuthProtocol::buildRequestPacket(header, m_auth.payload);
+}
+
+void FaceAuthCore::finishAuthAttempt()
+{
+    // 正在建立的连接不取消，识别请求可能也在等它
+    m_pendingSubmit = PendingSubmit();
+    m_authInFlight = false;
+    m_authDeadlineTimer->stop();
+    m_authRetryTimer->stop();
+    abandonHedge();
+}
+
+void FaceAuthCore::onAuthDeadlineExpired()
+{
+    if (!m_authInFlight) {
+        return;
+    }
+    if (m_pendingSubmit.active) {
+        // 连接尚未建立，请求还没有发出，按连接失败处理(注册写入离线日志)
+        m_deadlineExpirations++;
+        failPendingSubmit("请求超时");
+        return;
+    }
+
+    // 不断开连接(流水线中的识别请求不受影响)，主连接上的响应稍后按序到达时丢弃
+    m_deadlineExpirations++;
+    if (m_authAwaitingPrimary) {
+        m_authAwaitingPrimary = false;
+        m_discardAuthResponses++;
+    }
+    QString type = m_auth.type;
+    LOG_WARNING(Log::net) << "请求超过期限，放弃等待" << Log::field("type", type)
+                          << Log::field("timeout_ms", m_authTimeoutMs) << Log::field("busy_retries", m_auth.busyRetries)
+                          << Log::field("unanswered", m_discardAuthResponses)
+                          << Log::field("expirations", qint64(m_deadlineExpirations));
+    m_progressiveLogin = ProgressiveLogin();
+    finishRequestTrace();
+    finishAuthAttempt();
+
+    QJsonObject failure;
+    failure["type"] = type;
+    failure["success"] = false;
+    failure["deadline_exceeded"] = true;
+    failure["message"] = "服务器响应超时，请稍后重试";
+    emit authFinished(type, false, failure);
+
+    // 连续两个请求都没有响应，连接可能已失效(对端未关闭的半开连接)，断开后下次请求重新连接
+    if (m_discardAuthResponses >= 2 && socket()->state() == QAbstractSocket::ConnectedState) {
+        LOG_WARNING(Log::net) << "连续多个请求没有响应，断开连接";
+        socket()->abort();
+    }
+}
+
+void FaceAuthCore::recordBusy(const QJsonObject& response)
+{
+    // 以服务器建议的间隔为下限，连续繁忙时翻倍；只向上加抖动，避免各客户端同时重试
+    m_busyResponses++;
+    int retryAfterMs = qMax(0, response.value("retry_after_ms").toInt(200));
+    m_backoffMs = qMax(retryAfterMs, qMin(m_backoffMs * 2, m_maxBackoffMs));
+    int delayMs = m_backoffMs + int(QRandomGenerator::global()->bounded(m_backoffMs / 5 + 1));
+    m_backoffDeadline.setRemainingTime(delayMs);
+    LOG_DEBUG(Log::net) << "服务器繁忙，退避" << Log::field("delay_ms", delayMs)
+                        << Log::field("retry_after_ms", retryAfterMs) << Log::field("busy_responses", qint64(m_busyResponses));
+}
+
+bool FaceAuthCore::backoffActive() const
+{
+    return !m_backoffDeadline.hasExpired();
+}
+
+bool FaceAuthCore::retryBusyAuth(const QJsonObject& response)
+{
+    // 剩余期限不够再等一次时直接报告繁忙
+    qint64 delayMs = qMax<qint64>(0, m_backoffDeadline.remainingTime());
+    if (m_auth.busyRetries >= m_maxBusyRetries || delayMs + 100 >= m_auth.deadline.remainingTime()) {
+        return false;
+    }
+
+    m_auth.busyRetries++;
+    LOG_INFO(Log::net) << "服务器繁忙，退避后重试" << Log::field("type", m_auth.type)
+                       << Log::field("delay_ms", delayMs) << Log::field("retry", m_auth.busyRetries)
+                       << Log::field("message", response.value("message").toString());
+    emit statusMessage(QString("服务器繁忙，%1毫秒后重试...").arg(delayMs));
+    m_authRetryTimer->start(int(delayMs));
+    return true;
+}
+
+void FaceAuthCore::onAuthRetryTimeout()
+{
+    if (!m_authInFlight) {
+        return;
+    }
+
+    QString error = "连接已断开";
+    if (!m_transport->isReady() || !writeRequest(buildAuthPacket(), &error)) {
+        QString type = m_auth.type;
+        m_progressiveLogin = ProgressiveLogin();
+        finishRequestTrace();
+        finishAuthAttempt();
+        QJsonObject failure;
+        failure["type"] = type;
+        failure["success"] = false;
+        failure["message"] = "连接失败:" + error;
+        emit authFinished(type, false, failure);
+    }
+}
+
+void FaceAuthCore::recordAuthLatency(qint64 ms)
+{
+    // 预览图的耗时明显更短，不与完整请求混在一起
+    if (m_auth.type != "login" || m_auth.header.value("stage").toString() == "preview") {
+        return;
+    }
+    m_authLatencyMs.append(ms);
+    if (m_authLatencyMs.size() > 100) {
+        m_authLatencyMs.removeFirst();
+    }
+}
+
+qint64 FaceAuthCore::hedgeDelayMs() const
+{
+    // 样本太少时百分位不可信，不对冲
+    if (m_authLatencyMs.size() < 20) {
+        return -1;
+    }
+    QList<qint64> sorted = m_authLatencyMs;
+    std::sort(sorted.begin(), sorted.end());
+    int index = qMin(int(sorted.size()) - 1, int(sorted.size()) * m_hedgePercentile / 100);
+    return qMax<qint64>(20, sorted[index]);
+}
+
+bool FaceAuthCore::hedgeEndpoint(QString* host, quint16* port) const
+{
+    // 只对冲到探测结果健康的其他服务器，繁忙(降级)或不可用的服务器不再加压
+    QVector<EndpointManager::EndpointStats> stats = m_endpoints->stats();
+    for (const EndpointManager::Endpoint& candidate : m_endpoints->candidates()) {
+        if (candidate.host == m_serverAddress && candidate.port == m_serverPort) {
+            continue;
+        }
+        for (const EndpointManager::EndpointStats& entry : stats) {
+            if (entry.endpoint.host == candidate.host && entry.endpoint.port == candidate.port
+                && entry.health == EndpointManager::Health::Healthy) {
+                *host = candidate.host;
+                *port = candidate.port;
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+void FaceAuthCore::onHedgeTimeout()
+{
+    if (!m_authInFlight || !m_authAwaitingPrimary || !m_auth.hedgeable || m_hedgeAwaiting || m_hedgePending) {
+        return;
+    }
+    // 对冲受预算限制，服务器繁忙时对冲只会放大过载
+    if (backoffActive() || m_hedgeTokens < 1.0) {
+        return;
+    }
+    QString host;
+    quint16 port = 0;
+    if (!hedgeEndpoint(&host, &port)) {
+        return;
+    }
+
+    m_hedgeTokens -= 1.0;
+    m_hedgesSent++;
+    Trace::instant("request.hedge", "net", m_traceRequestId);
+    LOG_INFO(Log::net) << "登录响应慢，向备用服务器发送对冲请求" << Log::field("server", host)
+                       << Log::field("waited_ms", m_auth.sentTimer.elapsed()) << Log::field("hedges", qint64(m_hedgesSent))
+                       << Log::field("hedge_wins", qint64(m_hedgeWins));
+
+    if (!m_hedgeTransport) {
+        m_hedgeTransport = new AuthTransport(this);
+        m_hedgeTransport->copySettingsFrom(*m_transport);
+        m_hedgeTransport->setDnsCache(m_dnsCache);
+        connect(m_hedgeTransport, &AuthTransport::connectionEstablished, this, &FaceAuthCore::onHedgeConnected);
+        connect(m_hedgeTransport, &AuthTransport::connectionFailed, this, [this](const QString& error) {
+            LOG_DEBUG(Log::net) << "对冲连接失败:" << error;
+            m_hedgePending = false;
+            m_endpoints->reportFailure(m_hedgeHost, m_hedgePort, error);
+        });
+        connect(m_hedgeTransport->socket(), &QTcpSocket::readyRead, this, &FaceAuthCore::onHedgeReadyRead);
+        connect(m_hedgeTransport->socket(), &QTcpSocket::disconnected, this, &FaceAuthCore::onHedgeDisconnected);
+    }
+
+    // 对冲连接保持打开，下次对冲到同一服务器时直接复用
+    bool sameTarget = m_hedgeHost == host && m_hedgePort == port;
+    if (sameTarget && m_hedgeTransport->isReady()) {
+        m_hedgePending = true;
+        onHedgeConnected();
+        return;
+    }
+    if (!sameTarget || !m_hedgeTransport->isConnecting()) {
+        m_hedgeTransport->socket()->abort();
+        m_hedgeHost = host;
+        m_hedgePort = port;
+        m_hedgeTransport->beginConnect(host, port);
+    }
+    m_hedgePending = true;
+}
+
+void FaceAuthCore::onHedgeConnected()
+{
+    if (!m_hedgePending) {
+        return;
+    }
+    m_hedgePending = false;
+    if (m_hedgeTransport->socket()->write(buildAuthPacket()) == -1) {
+        LOG_WARNING(Log::net) << "发送对冲请求失败:" << m_hedgeTransport->socket()->errorString();
+        return;
+    }
+    m_hedgeAwaiting = true;
+}
+
+void FaceAuthCore::onHedgeReadyRead()
+{
+    m_hedgeReceiveBuffer.append(m_hedgeTransport->socket()->readAll());
+    while (!m_hedgeReceiveBuffer.isEmpty()) {
+        QJsonObject response;
+        int consumed = 0;
+        FaceAuthProtocol::ParseResult result = FaceAuthProtocol::parseResponse(m_hedgeReceiveBuffer, &response, &consumed);
+        if (result == FaceAuthProtocol::ParseResult::Incomplete) {
+            return;
+        }
+        if (result == FaceAuthProtocol::ParseResult::InvalidHeader) {
+            LOG_WARNING(Log::net) << "对冲连接收到无效的响应头部";
+            m_hedgeTransport->socket()->abort();
+            return;
+        }
+        m_hedgeReceiveBuffer.remove(0, consumed);
+
+        if (m_hedgeDiscard > 0) {
+            m_hedgeDiscard--;
+            continue;
+        }
+        if (!m_hedgeAwaiting) {
+            continue;
+        }
+        m_hedgeAwaiting = false;
+
+        // 备用服务器繁忙、超过期限或响应无法解析时继续等待主连接
+        if (result == FaceAuthProtocol::ParseResult::InvalidJson || response.value("busy").toBool()
+            || response.value("deadline_exceeded").toBool()) {
+            LOG_DEBUG(Log::net) << "对冲请求没有有效结果，继续等待主连接" << Log::field("server", m_hedgeHost);
+            continue;
+        }
+
+        // 对冲请求先返回：主连接上的响应稍后按序到达时丢弃
+        m_hedgeWins++;
+        if (m_authAwaitingPrimary) {
+            m_authAwaitingPrimary = false;
+            m_discardAuthResponses++;
+        }
+        recordAuthLatency(m_auth.sentTimer.elapsed());
+        LOG_INFO(Log::net) << "对冲请求先返回" << Log::field("server", m_hedgeHost)
+                           << Log::field("elapsed_ms", m_auth.sentTimer.elapsed())
+                           << Log::field("hedges", qint64(m_hedgesSent)) << Log::field("hedge_wins", qint64(m_hedgeWins));
+        handleServerResponse(response, Trace::spanStart());
+    }
+}
+
+void FaceAuthCore::onHedgeDisconnected()
+{
+    m_hedgeReceiveBuffer.clear();
+    m_hedgePending = false;
+    m_hedgeAwaiting = false;
+    m_hedgeDiscard = 0;
+}
+
+void FaceAuthCore::abandonHedge()
+{
+    m_hedgeTimer->stop();
+    m_hedgePending = false;
+    if (m_hedgeAwaiting) {
+        m_hedgeAwaiting = false;
+        m_hedgeDiscard++;
+    }
+}
+
+void FaceAuthCore::identify(const QString& personId, const QByteArray& jpeg)
+{
+    QJsonObject identifyData;
+    identifyData["type"] = "identify";
+    identifyData["person_id"] = personId;
+    identifyData["face_data_size"] = qint64(jpeg.size());
+    QueuedIdentify request;
+    request.header = identifyData;
+    request.jpeg = jpeg;
+    request.deadline.setRemainingTime(m_identifyTimeoutMs);
+    m_identifyOutbox.append(request);
+
+    if (m_transport->isReady()) {
+        flushIdentifyOutbox();
+    } else if (socket()->state() == QAbstractSocket::UnconnectedState) {
+        // 异步连接，连接建立后再发送，不阻塞调用方
+        m_transport->beginConnect(m_serverAddress, m_serverPort);
+    }
+}
+
+void FaceAuthCore::flushIdentifyOutbox()
+{
+    // 服务器繁忙时暂停发送，退避结束后继续
+    if (backoffActive()) {
+        if (!m_identifyOutbox.isEmpty() && !m_backoffTimer->isActive()) {
+            m_backoffTimer->start(int(qMax<qint64>(0, m_backoffDeadline.remainingTime())));
+        }
+        return;
+    }
+
+    // 同一连接上按顺序发送，服务器按相同顺序返回响应；排队中已过期的请求不再发送，在本地回复
+    while (!m_identifyOutbox.isEmpty() && m_transport->isReady()) {
+        QueuedIdentify request = m_identifyOutbox.takeFirst();
+        if (request.deadline.hasExpired()) {
+            expireIdentify(request);
+            continue;
+        }
+        request.header["deadline_ms"] = qMax<qint64>(1, request.deadline.remainingTime());
+        if (socket()->write(FaceAuthProtocol::buildRequestPacket(request.header, request.jpeg)) == -1) {
+            LOG_WARNING(Log::net) << "发送识别请求失败:" << socket()->errorString();
+            break;
+        }
+        m_identifyInFlight++;
+    }
+}
+
+void FaceAuthCore::expireIdentify(const QueuedIdentify& request)
+{
+    // 与服务器的超过期限响应相同
+    QJsonObject response;
+    response["type"] = "identify";
+    response["success"] = false;
+    response["deadline_exceeded"] = true;
+    response["person_id"] = request.header.value("person_id");
+    response["message"] = "请求已超过客户端期限";
+    LOG_DEBUG(Log::net) << "识别请求发送前已超过期限" << Log::field("person_id", request.header.value("person_id").toString())
+                        << Log::field("in_flight", m_identifyInFlight);
+
+    if (m_identifyInFlight == 0) {
+        emit identifyFinished(false, response);
+        return;
+    }
+    ExpiredIdentify expired;
+    expired.ahead = m_identifyInFlight;
+    expired.response = response;
+    m_identifyExpired.append(expired);
+}
+
+void FaceAuthCore::releaseExpiredIdentifies()
+{
+    // 收到一个已发送请求的响应后调用
+    for (ExpiredIdentify& expired : m_identifyExpired) {
+        expired.ahead--;
+    }
+    while (!m_identifyExpired.isEmpty() && m_identifyExpired.first().ahead <= 0) {
+        emit identifyFinished(false, m_identifyExpired.takeFirst().response);
+    }
+}
+
+void FaceAuthCore::beginRequestTrace(const char* name)
+{
+    if (!Trace::enabled()) {
+        return;
+    }
+    finishRequestTrace();
+    m_traceRequestId++;
+    m_traceRequestName = name;
+    Trace::asyncBegin(name, "auth", m_traceRequestId);
+}
+
+void FaceAuthCore::finishRequestTrace()
+{
+    if (m_traceRequestName) {
+        Trace::asyncEnd(m_traceRequestName, "auth", m_traceRequestId);
+        m_traceRequestName = nullptr;
+    }
+    m_traceAwaitingFirstByte = false;
+}
+
+bool FaceAuthCore::journalRequest(const QString& type, const QString& username, const QString& password,
+                                  const QByteArray& faceData, const QJsonArray& frameLayout)
+{
+    QJsonObject request;
+    request["type"] = type;
+    request["username"] = username;
+    if (type == "audit") {
+        // 审计记录单独成类型，服务器从不把它当作登录，也就不需要密码
+        request["event"] = "login";
+    } else {
+        // 密码加密后落盘，补发时才解密；无法加密的平台上不保存该请求(启动时已提示)
+        if (!OfflineJournal::canProtectSecrets()) {
+            LOG_DEBUG(Log::journal) << "本平台无法加密保存密码，请求不写入离线日志" << Log::field("type", type);
+            return false;
+        }
+        QString sealed;
+        if (!OfflineJournal::protectSecret(password, &sealed)) {
+            LOG_WARNING(Log::journal) << "加密密码失败，请求不写入离线日志";
+            return false;
+        }
+        request["password_sealed"] = sealed;
+    }
+    FaceAuthProtocol::describePayload(&request, faceData, frameLayout);
+    // 供服务器识别重复补发的请求
+    request["request_id"] = QUuid::createUuid().toString(QUuid::WithoutBraces);
+    request["queued_at"] = QDateTime::currentDateTimeUtc().toString(Qt::ISODateWithMs);
+
+    OfflineJournal::AppendResult result = m_journal->append(request, faceData);
+    OfflineJournal::Stats stats = m_journal->stats();
+    switch (result) {
+    case OfflineJournal::AppendResult::Appended:
+        LOG_DEBUG(Log::journal) << "请求已写入离线日志: 类型=" << type << ", 待补发" << stats.pendingRecords
+                                << "条, 已用" << stats.usedBytes << "/" << stats.capacityBytes << "字节";
+        return true;
+    case OfflineJournal::AppendResult::Duplicate:
+        LOG_DEBUG(Log::journal) << "相同的请求已在离线日志中等待补发";
+        return true;
+    case OfflineJournal::AppendResult::Full:
+        LOG_WARNING(Log::journal) << "离线日志已满，无法保存请求: 已用" << stats.usedBytes << "/" << stats.capacityBytes << "字节";
+        return false;
+    case OfflineJournal::AppendResult::Error:
+        break;
+    }
+    LOG_WARNING(Log::journal) << "离线日志不可用，无法保存请求";
+    return false;
+}
@@ -0,0 +1,264 @@
+#pragma once
+
+#include "AuthTransport.h"
+#include "EndpointManager.h"
+#include <QObject>
+#include <QByteArray>
+#include <QDeadlineTimer>
+#include <QElapsedTimer>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QList>
+#include <QString>
+
+class DnsCache;
+class OfflineJournal;
+class JournalReplayer;
+class QTimer;
+
+// 认证客户端核心：连接管理、请求收发、两阶段上传和离线补发，只依赖QtCore和QtNetwork
+//
+// 图形界面(FaceAuthClient)和无界面的门禁守护进程(FaceAuthDaemon)共用。按QSettings创建传输层、
+// 域名缓存、多端点路由、离线日志和补发器；调用方只负责采集人脸图像和展示结果，
+// 登录/注册的结果由authFinished()通知，识别结果由identifyFinished()按发送顺序通知。
+//
+// 每个请求有期限，剩余时间以deadline_ms写入请求头，服务器出队时已过期的请求不再处理；
+// 登录/注册到期时本地放弃等待并以deadline_exceeded=true的失败结果通知，迟到的响应被丢弃。
+// 登录响应慢于最近登录耗时的指定百分位时，向另一个健康的服务器发送一份对冲请求，先到的响应生效；
+// 对冲次数受预算限制，服务器繁忙时不对冲。收到busy响应后按retry_after_ms指数退避(带抖动)，
+// 退避期间暂停发送识别请求，登录/注册在期限内自动重试。
+//
+// 默认在登录/注册时阻塞等待连接建立(图形界面的按钮操作)。无界面的守护进程只有一个事件循环，
+// 需调用setNonBlocking(true)：连接未就绪时请求排队并异步连接各端点，连接建立后发送，
+// 连接失败的结果同样由authFinished()通知(注册写入离线日志时带queued=true)。
+class FaceAuthCore : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct AuthRequest {
+        QString username;
+        QString password;
+        QByteArray faceData;
+        QJsonArray frameLayout;     // 连拍时各帧在faceData中的位置，单帧时为空
+        QByteArray preview;         // 两阶段上传的预览图，为空或不比faceData小时直接上传完整图像
+    };
+
+    enum class SubmitResult {
+        Sent,       // 已发送，结果由authFinished()通知
+        Queued,     // 网络不可用，已写入离线日志，恢复连接后自动补发
+        Failed      // 错误原因通过error返回
+    };
+
+    explicit FaceAuthCore(QObject* parent = nullptr);
+    ~FaceAuthCore();
+
+    AuthTransport* transport() const { return m_transport; }
+    QSslSocket* socket() const { return m_transport->socket(); }
+    EndpointManager* endpoints() const { return m_endpoints; }
+    OfflineJournal* journal() const { return m_journal; }
+    JournalReplayer* replayer() const { return m_replayer; }
+    QString serverAddress() const { return m_serverAddress; }
+    quint16 serverPort() const { return m_serverPort; }
+
+    // 设置保存后重新应用TLS设置和服务器列表，CA证书无法加载时返回false
+    bool reloadSettings();
+
+    // 调用方还需要这条连接时(如自助模式)设置，空闲的预连接和切换服务器时不会断开
+    void setKeepAlive(bool keepAlive) { m_keepAlive = keepAlive; }
+    // 登录/注册不阻塞等待连接，login()/registerUser()只在参数错误时返回Failed
+    void setNonBlocking(bool nonBlocking) { m_nonBlocking = nonBlocking; }
+    bool isIdle() const;
+    bool isAuthInFlight() const { return m_authInFlight; }
+
+    // 异步连接当前服务器，已连接或正在连接时不做任何事
+    void beginConnect();
+    // 用户即将发起请求时提前解析域名并建立连接，长时间未被使用时自动断开
+    void speculativeConnect(const char* reason);
+
+    // 同一时间只能有一个登录或注册请求在途，已有请求在途时返回Failed(error为"已有请求在途")，不影响在途请求
+    SubmitResult login(const AuthRequest& request, QString* error = nullptr);
+    SubmitResult registerUser(const AuthRequest& request, QString* error = nullptr);
+
+    // 识别请求在同一连接上流水线发送，连接未就绪时排队并异步连接
+    void identify(const QString& personId, const QByteArray& jpeg);
+    int identifyInFlight() const { return m_identifyInFlight + int(m_identifyOutbox.size()); }
+
+signals:
+    void statusMessage(const QString& text);
+    // 登录的两阶段上传在内部完成，只通知最终结果；type为"login"、"register"或未知的响应类型
+    void authFinished(const QString& type, bool success, const QJsonObject& response);
+    void identifyFinished(bool success, const QJsonObject& response);
+    // 连接失败，排队中的识别请求都未发出
+    void identifyDropped(const QString& error);
+    // 连接断开或响应无法解析，在途请求不会再有结果
+    void requestsAborted();
+    void activeEndpointChanged(const QString& host, quint16 port);
+
+private slots:
+    void onConnectionEstablished(const AuthTransport::ConnectionStats& stats);
+    void onActiveEndpointChanged(const QString& host, quint16 port);
+    void onSocketDisconnected();
+    void onSocketReadyRead();
+    void flushIdentifyOutbox();
+    void onAuthDeadlineExpired();
+    void onAuthRetryTimeout();
+    void onHedgeTimeout();
+    void onHedgeConnected();
+    void onHedgeReadyRead();
+    void onHedgeDisconnected();
+    void onSubmitConnected();
+    void onSubmitConnectFailed(const QString& error);
+
+private:
+    // 两阶段上传：先发送预览图，服务器回复need_more后再上传完整图像
+    struct ProgressiveLogin {
+        QString stage;                          // 当前在途的阶段，为空表示单次上传
+        QString username;
+        QString password;
+        QByteArray fullData;
+        QJsonArray fullLayout;
+        qint64 previewBytes = 0;
+        qint64 previewMs = 0;                   // 预览阶段的往返耗时
+    };
+
+    // 当前登录/注册请求，繁忙重试和对冲时以剩余期限重新封包
+    struct AuthAttempt {
+        QString type;
+        QJsonObject header;
+        QByteArray payload;
+        QDeadlineTimer deadline;
+        QElapsedTimer sentTimer;                // 最近一次发送到主连接的时刻
+        int busyRetries = 0;
+        bool hedgeable = false;                 // 只有登录可以对冲，重复注册会失败
+    };
+
+    // 非阻塞模式下等待连接建立的登录/注册
+    struct PendingSubmit {
+        bool active = false;
+        AuthRequest request;                    // 本阶段要发送的数据(两阶段上传时为预览图或完整图像)
+        QString stage;
+        QList<EndpointManager::Endpoint> candidates;
+        int attempt = 0;                        // 下一个要尝试的端点
+        QString lastError;
+        qint64 connectStartUs = 0;
+    };
+
+    struct QueuedIdentify {
+        QJsonObject header;
+        QByteArray jpeg;
+        QDeadlineTimer deadline;
+    };
+
+    // 发送前已过期的识别请求在本地回复；排在它前面的请求都有响应后才通知，调用方按顺序对应结果
+    struct ExpiredIdentify {
+        int ahead = 0;                          // 排在前面、尚未收到响应的已发送请求数
+        QJsonObject response;
+    };
+
+    bool applyTransportSettings();
+    bool connectToBestEndpoint(QString* errorMessage);
+    void beginAuthAttempt(const QString& type);
+    SubmitResult sendLoginRequest(const QString& username, const QString& password, const QByteArray& faceData,
+                                  const QJsonArray& frameLayout, const QString& stage, QString* error);
+    SubmitResult writeLoginRequest(const QString& username, const QString& password, const QByteArray& faceData,
+                                   const QJsonArray& frameLayout, const QString& stage, QString* error);
+    SubmitResult writeRegisterRequest(const AuthRequest& request, QString* error);
+    void queueSubmit(const AuthRequest& request, const QString& stage);
+    void connectPendingSubmit();
+    void failPendingSubmit(const QString& error);
+    QByteArray buildAuthPacket() const;
+    bool writeRequest(const QByteArray& packet, QString* error);
+    void handleServerResponse(const QJsonObject& response, qint64 processStartUs);
+    bool retryBusyAuth(const QJsonObject& response);
+    void recordBusy(const QJsonObject& response);
+    bool backoffActive() const;
+    void finishAuthAttempt();
+    void abandonHedge();
+    bool hedgeEndpoint(QString* host, quint16* port) const;
+    qint64 hedgeDelayMs() const;
+    void recordAuthLatency(qint64 ms);
+    bool continueProgressiveLogin(const QJsonObject& response);
+    void recordLoginSavings(const QJsonObject& response);
+    void expireIdentify(const QueuedIdentify& request);
+    void releaseExpiredIdentifies();
+    void beginRequestTrace(const char* name);
+    void finishRequestTrace();
+    bool journalRequest(const QString& type, const QString& username, const QString& password,
+                        const QByteArray& faceData, const QJsonArray& frameLayout);
+
+    AuthTransport* m_transport;
+    DnsCache* m_dnsCache;
+    EndpointManager* m_endpoints;
+    OfflineJournal* m_journal;
+    JournalReplayer* m_replayer;
+    QString m_serverAddress;
+    quint16 m_serverPort;
+    bool m_blockingConnect;                     // connectToBestEndpoint自行报告结果，忽略传输层信号
+    bool m_nonBlocking;
+    PendingSubmit m_pendingSubmit;
+    bool m_submitConnecting;                    // 非阻塞登录/注册正在连接m_submitHost，结果由它报告
+    QString m_submitHost;
+    quint16 m_submitPort;
+    QTimer* m_submitConnectTimer;               // 单个端点的连接超时
+    bool m_keepAlive;
+    bool m_authInFlight;
+    QByteArray m_receiveBuffer;
+
+    // 期限、繁忙退避和对冲
+    AuthAttempt m_auth;
+    bool m_authAwaitingPrimary;                 // 主连接上有属于当前请求的未到响应
+    int m_discardAuthResponses;                 // 主连接上已放弃等待的登录/注册请求，响应按序到达后丢弃
+    QTimer* m_authDeadlineTimer;
+    QTimer* m_authRetryTimer;
+    int m_authTimeoutMs;
+    int m_identifyTimeoutMs;
+    int m_maxBusyRetries;
+    int m_maxBackoffMs;
+    int m_backoffMs;                            // 当前退避时长，连续繁忙时翻倍，正常响应后减半
+    QDeadlineTimer m_backoffDeadline;
+    QTimer* m_backoffTimer;                     // 退避结束后继续发送排队的识别请求
+    bool m_hedgeEnabled;
+    int m_hedgePercentile;
+    double m_hedgeBudgetPerRequest;             // 每个登录请求积累的对冲额度，额度满1才能对冲一次
+    double m_hedgeTokens;
+    QList<qint64> m_authLatencyMs;              // 最近的登录响应耗时，用于计算对冲延迟
+    AuthTransport* m_hedgeTransport;            // 到备用服务器的连接，首次对冲时创建
+    QTimer* m_hedgeTimer;
+    QString m_hedgeHost;
+    quint16 m_hedgePort;
+    bool m_hedgePending;                        // 对冲连接建立后发送当前请求
+    bool m_hedgeAwaiting;
+    int m_hedgeDiscard;
+    QByteArray m_hedgeReceiveBuffer;
+    quint64 m_deadlineExpirations;
+    quint64 m_busyResponses;
+    quint64 m_hedgesSent;
+    quint64 m_hedgeWins;
+
+    // 预连接
+    bool m_speculativeConnectEnabled;
+    QElapsedTimer m_speculativeThrottle;
+    QTimer* m_speculativeIdleTimer;             // 预连接长时间未被使用时断开
+    quint64 m_speculativeConnects;
+    quint64 m_loginAttempts;
+    quint64 m_warmLogins;                       // 登录时连接已就绪
+    quint64 m_connectingLogins;                 // 登录时预连接仍在建立，只需等待剩余部分
+
+    ProgressiveLogin m_progressiveLogin;
+    QElapsedTimer m_loginTimer;
+    double m_fullLoginMsAverage;                // 完整图像登录耗时的滑动平均，估算提前拒绝节省的时间
+    qint64 m_progressiveBytesSaved;             // 累计节省(负值表示预览阶段的额外开销)
+    qint64 m_progressiveMsSaved;
+    quint64 m_previewRejects;
+    quint64 m_previewPasses;
+
+    QList<QueuedIdentify> m_identifyOutbox;     // 等待连接建立(或繁忙退避结束)后发送的识别请求
+    int m_identifyInFlight;                     // 已发送、等待响应的识别请求
+    QList<ExpiredIdentify> m_identifyExpired;
+
+    // 性能跟踪
+    qint64 m_traceRequestId;
+    const char* m_traceRequestName;             // 当前未结束的登录/注册区间
+    bool m_traceAwaitingFirstByte;
+};
@@ -0,0 +1,219 @@
+#include "FaceAuthProtocol.h"
+#include <QJsonDocument>
+#include <QtEndian>
+
+namespace FaceAuthProtocol
+{
+
+QByteArray buildRequestPacket(const QJsonObject& header, const QByteArray& payload)
+{
+    QByteArray jsonData = QJsonDocument(header).toJson();
+
+    QByteArray packet;
+    packet.reserve(HeaderSize + jsonData.size() + payload.size());
+
+    // 1. "FACE"魔数  2. JSON长度(大端)  3. JSON  4. 人脸图像数据
+    packet.append("FACE", 4);
+    char lengthBytes[4];
+    qToBigEndian<qint32>(static_cast<qint32>(jsonData.size()), lengthBytes);
+    packet.append(lengthBytes, 4);
+    packet.append(jsonData);
+    if (!payload.isEmpty()) {
+        packet.append(payload);
+    }
+    return packet;
+}
+
+QByteArray packFrames(const QList<QByteArray>& frames, QJsonArray* layout)
+{
+    qsizetype total = 0;
+    for (const QByteArray& frame : frames) {
+        total += frame.size();
+    }
+
+    QByteArray payload;
+    payload.reserve(total);
+    QJsonArray entries;
+    for (const QByteArray& frame : frames) {
+        QJsonObject entry;
+        entry["offset"] = qint64(payload.size());
+        entry["length"] = qint64(frame.size());
+        entries.append(entry);
+        payload.append(frame);
+    }
+    if (layout) {
+        *layout = entries;
+    }
+    return payload;
+}
+
+void describePayload(QJsonObject* header, const QByteArray& payload, const QJsonArray& layout)
+{
+    if (layout.isEmpty()) {
+        header->insert("face_data_size", qint64(payload.size()));
+        header->remove("frames");
+    } else {
+        header->insert("frames", layout);
+        header->remove("face_data_size");
+    }
+}
+
+qint64 payloadSize(const QJsonObject& header, qint64 maxSize)
+{
+    if (!header.contains("frames")) {
+        qint64 size = header.value("face_data_size").toInteger();
+        return size > maxSize ? -1 : size;
+    }
+
+    QJsonArray frames = header.value("frames").toArray();
+    if (frames.isEmpty()) {
+        return -1;
+    }
+    qint64 end = 0;
+    for (const QJsonValue& value : frames) {
+        QJsonObject entry = value.toObject();
+        qint64 offset = entry.value("offset").toInteger(-1);
+        qint64 length = entry.value("length").toInteger(-1);
+        if (offset < 0 || length <= 0 || offset > maxSize || length > maxSize - offset) {
+            return -1;
+        }
+        end = qMax(end, offset + length);
+    }
+    return end;
+}
+
+bool splitFrames(const QJsonObject& header, const QByteArray& payload, QList<QByteArray>* frames)
+{
+    frames->clear();
+    if (!header.contains("frames")) {
+        frames->append(payload);
+        return true;
+    }
+
+    const QJsonArray layout = header.value("frames").toArray();
+    for (const QJsonValue& value : layout) {
+        QJsonObject entry = value.toObject();
+        qint64 offset = entry.value("offset").toInteger(-1);
+        qint64 length = entry.value("length").toInteger(-1);
+        if (offset < 0 || length <= 0 || offset > payload.size() || length > payload.size() - offset) {
+            frames->clear();
+            return false;
+        }
+        frames->append(QByteArray::fromRawData(payload.constData() + offset, qsizetype(length)));
+    }
+    return !frames->isEmpty();
+}
+
+ParseResult parseResponse(const QByteArray& buffer, QJsonObject* response, int* consumed)
+{
+    if (buffer.size() < HeaderSize) {
+        return ParseResult::Incomplete;
+    }
+    if (!buffer.startsWith("RESP")) {
+        return ParseResult::InvalidHeader;
+    }
+
+    qint32 jsonLength = qFromBigEndian<qint32>(buffer.constData() + 4);
+    if (jsonLength < 0) {
+        return ParseResult::InvalidHeader;
+    }
+    if (buffer.size() < HeaderSize + jsonLength) {
+        return ParseResult::Incomplete;
+    }
+
+    if (consumed) {
+        *consumed = HeaderSize + jsonLength;
+    }
+
+    QJsonDocument doc = QJsonDocument::fromJson(buffer.mid(HeaderSize, jsonLength));
+    if (doc.isNull() || !doc.isObject()) {
+        return ParseResult::InvalidJson;
+    }
+    if (response) {
+        *response = doc.object();
+    }
+    return ParseResult::Complete;
+}
+
+QByteArray buildResponsePacket(const QJsonObject& response)
+{
+    QByteArray jsonData = QJsonDocument(response).toJson(QJsonDocument::Compact);
+
+    QByteArray packet;
+    packet.reserve(HeaderSize + jsonData.size());
+    packet.append("RESP", 4);
+    char lengthBytes[4];
+    qToBigEndian<qint32>(static_cast<qint32>(jsonData.size()), lengthBytes);
+    packet.append(lengthBytes, 4);
+    packet.append(jsonData);
+    return packet;
+}
+
+ParseResult parseRequest(const QByteArray& buffer, QJsonObject* header, QByteArray* payload, int* consumed,
+                         int maxJsonSize, int maxPayloadSize)
+{
+    if (buffer.size() < HeaderSize) {
+        return ParseResult::Incomplete;
+    }
+    if (!buffer.startsWith("FACE")) {
+        return ParseResult::InvalidHeader;
+    }
+
+    qint32 jsonLength = qFromBigEndian<qint32>(buffer.constData() + 4);
+    if (jsonLength <= 0 || jsonLength > maxJsonSize) {
+        return ParseResult::InvalidHeader;
+    }
+    if (buffer.size() < HeaderSize + jsonLength) {
+        return ParseResult::Incomplete;
+    }
+
+    QJsonDocument doc = QJsonDocument::fromJson(buffer.mid(HeaderSize, jsonLength));
+    if (doc.isNull() || !doc.isObject()) {
+        // 图像长度未知，无法跳过该帧
+        return ParseResult::InvalidHeader;
+    }
+
+    QJsonObject object = doc.object();
+    qint64 payloadBytes = payloadSize(object, maxPayloadSize);
+    if (payloadBytes < 0 || payloadBytes > maxPayloadSize) {
+        return ParseResult::InvalidHeader;
+    }
+    qint64 frameSize = HeaderSize + jsonLength + payloadBytes;
+    if (buffer.size() < frameSize) {
+        return ParseResult::Incomplete;
+    }
+
+    if (header) {
+        *header = object;
+    }
+    if (payload) {
+        *payload = buffer.mid(HeaderSize + jsonLength, payloadBytes);
+    }
+    if (consumed) {
+        *consumed = int(frameSize);
+    }
+    return ParseResult::Complete;
+}
+
+bool responseSucceeded(const QJsonObject& response)
+{
+    QJsonValue successValue = response.value("success");
+    bool success = false;
+
+    if (successValue.isBool()) {
+        success = successValue.toBool();
+    } else if (successValue.isString()) {
+        QString successStr = successValue.toString().toLower();
+        success = (successStr == "true" || successStr == "1" || successStr == "yes");
+    } else if (successValue.isDouble()) {
+        success = (successValue.toInt() != 0);
+    }
+
+    // 消息表示成功但success标志为false时，按消息内容推断
+    if (!success && response.value("message").toString().contains("successful", Qt::CaseInsensitive)) {
+        success = true;
+    }
+    return success;
+}
+
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <QByteArray>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QList>
+
+// FACE/RESP 协议的封包与解析
+//
+// 请求:  "FACE" | JSON长度(4字节, 大端) | JSON | 人脸图像数据(face_data_size字节)
+// 响应:  "RESP" | JSON长度(4字节, 大端) | JSON
+//
+// 多帧请求(连拍)用 "frames": [{"offset": 0, "length": n}, ...] 代替face_data_size，
+// 各帧JPEG依次拼接为负载，负载长度为各帧结束位置的最大值。
+namespace FaceAuthProtocol
+{
+    constexpr int HeaderSize = 8;
+
+    enum class ParseResult {
+        Incomplete,     // 数据不完整，继续等待
+        Complete,       // 解析出一个完整的帧
+        InvalidHeader,  // 帧头不是预期的魔数
+        InvalidJson     // JSON无法解析
+    };
+
+    // 构建一个完整的FACE请求数据包
+    QByteArray buildRequestPacket(const QJsonObject& header, const QByteArray& payload);
+
+    // 把多帧依次拼接为一个负载，layout返回每帧的{offset, length}
+    QByteArray packFrames(const QList<QByteArray>& frames, QJsonArray* layout);
+
+    // 在请求头中描述负载：layout非空时写入frames，否则写入face_data_size
+    void describePayload(QJsonObject* header, const QByteArray& payload, const QJsonArray& layout = QJsonArray());
+
+    // 请求头声明的负载字节数，frames布局无效或任一偏移、长度、总长超过maxSize时返回-1。
+    // 头部来自客户端，偏移和长度先与maxSize比较再相加，不会溢出
+    qint64 payloadSize(const QJsonObject& header, qint64 maxSize);
+
+    // 服务器端：按frames把负载拆分为各帧(不拷贝，引用payload的数据，payload须在使用期间保持有效)，
+    // 没有frames时整个负载作为一帧
+    bool splitFrames(const QJsonObject& header, const QByteArray& payload, QList<QByteArray>* frames);
+
+    // 从缓冲区开头解析一个RESP帧，consumed返回该帧占用的字节数
+    ParseResult parseResponse(const QByteArray& buffer, QJsonObject* response, int* consumed);
+
+    // 服务器端：构建RESP响应数据包
+    QByteArray buildResponsePacket(const QJsonObject& response);
+
+    // 服务器端：从缓冲区开头解析一个FACE帧(含face_data_size字节的图像数据)
+    // 帧头或长度超出限制时返回InvalidHeader，调用方应关闭连接
+    ParseResult parseRequest(const QByteArray& buffer, QJsonObject* header, QByteArray* payload, int* consumed,
+                             int maxJsonSize, int maxPayloadSize);
+
+    // 解析success字段，兼容布尔值、字符串、数字以及仅在消息中表明成功的情况
+    bool responseSucceeded(const QJsonObject& response);
+}
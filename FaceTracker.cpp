@@ -0,0 +1,206 @@
+#include "FaceTracker.h"
+#include <opencv2/video/tracking.hpp>
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+const int GridSize = 8;                 // 每个框内8x8个跟踪点
+const float GridInset = 0.15f;          // 网格离框边缘的比例，避开背景
+const float MaxForwardBackwardError = 2.0f;
+const float MinIou = 0.3f;              // 检测框与跟踪框的最小重叠
+const cv::Size FlowWindow(11, 11);
+const int FlowPyramidLevels = 2;
+
+// 部分排序取中位数，会打乱values的顺序
+float median(std::vector<float>& values)
+{
+    auto middle = values.begin() + values.size() / 2;
+    std::nth_element(values.begin(), middle, values.end());
+    return *middle;
+}
+
+float intersectionOverUnion(const cv::Rect2f& a, const cv::Rect2f& b)
+{
+    float intersection = (a & b).area();
+    float unionArea = a.area() + b.area() - intersection;
+    return unionArea > 0.0f ? intersection / unionArea : 0.0f;
+}
+
+} // namespace
+
+FaceTracker::FaceTracker(int missesBeforeEnd)
+    : m_nextId(1),
+    m_missesBeforeEnd(missesBeforeEnd)
+{
+}
+
+bool FaceTracker::track(const cv::Mat& gray)
+{
+    bool allTracked = true;
+    bool canTrack = !m_previous.empty() && m_previous.size() == gray.size();
+    for (Track& track : m_tracks) {
+        track.confirmed = false;
+        if (track.lost) {
+            allTracked = false;
+            continue;
+        }
+        if (canTrack && trackBox(gray, &track.box)) {
+            track.framesTracked++;
+        } else {
+            track.lost = true;
+            allTracked = false;
+        }
+    }
+
+    // 没有跟踪时也保留本帧：本帧的检测结果从下一帧开始跟踪
+    gray.copyTo(m_previous);
+    return allTracked;
+}
+
+bool FaceTracker::trackBox(const cv::Mat& gray, cv::Rect2f* box)
+{
+    m_points.clear();
+    for (int y = 0; y < GridSize; ++y) {
+        for (int x = 0; x < GridSize; ++x) {
+            float fx = GridInset + (1.0f - 2.0f * GridInset) * (x + 0.5f) / GridSize;
+            float fy = GridInset + (1.0f - 2.0f * GridInset) * (y + 0.5f) / GridSize;
+            m_points.emplace_back(box->x + box->width * fx, box->y + box->height * fy);
+        }
+    }
+
+    // 正向跟踪后再反向跟踪回上一帧，回不到原位的点落在遮挡或无纹理区域
+    cv::calcOpticalFlowPyrLK(m_previous, gray, m_points, m_forward, m_forwardStatus, m_errors,
+                             FlowWindow, FlowPyramidLevels);
+    cv::calcOpticalFlowPyrLK(gray, m_previous, m_forward, m_backward, m_backwardStatus, m_errors,
+                             FlowWindow, FlowPyramidLevels);
+
+    m_values.clear();
+    for (size_t i = 0; i < m_points.size(); ++i) {
+        if (m_forwardStatus[i] && m_backwardStatus[i]) {
+            m_values.push_back(float(cv::norm(m_points[i] - m_backward[i])));
+        }
+    }
+    if (m_values.size() < m_points.size() / 4) {
+        return false;
+    }
+    float errorLimit = std::min(median(m_values), MaxForwardBackwardError);
+
+    m_kept.clear();
+    for (size_t i = 0; i < m_points.size(); ++i) {
+        if (m_forwardStatus[i] && m_backwardStatus[i]
+            && cv::norm(m_points[i] - m_backward[i]) <= errorLimit) {
+            m_kept.push_back(int(i));
+        }
+    }
+    if (m_kept.size() < m_points.size() / 4) {
+        return false;
+    }
+
+    // 平移取位移的中位数，缩放取点间距离比值的中位数，都不受少数错误点影响
+    m_values.clear();
+    for (int i : m_kept) {
+        m_values.push_back(m_forward[i].x - m_points[i].x);
+    }
+    float dx = median(m_values);
+    m_values.clear();
+    for (int i : m_kept) {
+        m_values.push_back(m_forward[i].y - m_points[i].y);
+    }
+    float dy = median(m_values);
+
+    m_values.clear();
+    for (size_t a = 0; a < m_kept.size(); ++a) {
+        for (size_t b = a + 1; b < m_kept.size(); ++b) {
+            double before = cv::norm(m_points[m_kept[a]] - m_points[m_kept[b]]);
+            if (before > 1.0) {
+                m_values.push_back(float(cv::norm(m_forward[m_kept[a]] - m_forward[m_kept[b]]) / before));
+            }
+        }
+    }
+    float scale = m_values.empty() ? 1.0f : median(m_values);
+
+    // 一帧之内人脸不会大幅移动或缩放，超出时视为跟踪失败
+    if (std::abs(dx) > box->width * 0.5f || std::abs(dy) > box->height * 0.5f || scale < 0.8f || scale > 1.25f) {
+        return false;
+    }
+
+    cv::Point2f center(box->x + box->width * 0.5f + dx, box->y + box->height * 0.5f + dy);
+    cv::Size2f size(box->width * scale, box->height * scale);
+    cv::Rect2f moved(center.x - size.width * 0.5f, center.y - size.height * 0.5f, size.width, size.height);
+
+    // 大部分移出画面时结束跟踪
+    cv::Rect2f frame(0.0f, 0.0f, float(gray.cols), float(gray.rows));
+    if ((moved & frame).area() < moved.area() * 0.5f) {
+        return false;
+    }
+    *box = moved;
+    return true;
+}
+
+void FaceTracker::update(const std::vector<cv::Rect>& detections, std::vector<Track>* ended)
+{
+    struct Candidate {
+        float iou;
+        size_t track;
+        size_t detection;
+    };
+
+    // 按重叠程度从大到小贪心匹配
+    std::vector<Candidate> candidates;
+    for (size_t t = 0; t < m_tracks.size(); ++t) {
+        for (size_t d = 0; d < detections.size(); ++d) {
+            float iou = intersectionOverUnion(m_tracks[t].box, cv::Rect2f(detections[d]));
+            if (iou >= MinIou) {
+                candidates.push_back({ iou, t, d });
+            }
+        }
+    }
+    std::sort(candidates.begin(), candidates.end(),
+              [](const Candidate& a, const Candidate& b) { return a.iou > b.iou; });
+
+    std::vector<bool> trackMatched(m_tracks.size(), false);
+    std::vector<bool> detectionMatched(detections.size(), false);
+    for (const Candidate& candidate : candidates) {
+        if (trackMatched[candidate.track] || detectionMatched[candidate.detection]) {
+            continue;
+        }
+        trackMatched[candidate.track] = true;
+        detectionMatched[candidate.detection] = true;
+
+        Track& track = m_tracks[candidate.track];
+        track.box = cv::Rect2f(detections[candidate.detection]);
+        track.lost = false;
+        track.confirmed = true;
+        track.missedDetections = 0;
+        track.framesTracked = 0;
+    }
+
+    std::vector<Track> remaining;
+    remaining.reserve(m_tracks.size() + detections.size());
+    for (size_t t = 0; t < m_tracks.size(); ++t) {
+        if (!trackMatched[t] && ++m_tracks[t].missedDetections >= m_missesBeforeEnd) {
+            if (ended) {
+                ended->push_back(m_tracks[t]);
+            }
+            continue;
+        }
+        remaining.push_back(m_tracks[t]);
+    }
+    for (size_t d = 0; d < detections.size(); ++d) {
+        if (!detectionMatched[d]) {
+            Track track;
+            track.id = m_nextId++;
+            track.box = cv::Rect2f(detections[d]);
+            track.confirmed = true;
+            remaining.push_back(track);
+        }
+    }
+    m_tracks.swap(remaining);
+}
+
+void FaceTracker::clear()
+{
+    m_tracks.clear();
+    m_previous.release();
+}
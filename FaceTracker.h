@@ -0,0 +1,58 @@
+#pragma once
+
+#include <QtGlobal>
+#include <opencv2/core.hpp>
+#include <vector>
+
+// 帧间人脸跟踪：检测器只在部分帧上运行，其余帧在缩小的亮度图上用金字塔LK光流移动人脸框
+//
+// 每帧在人脸框内撒一组网格点，正向和反向各跟踪一次，丢弃前后不一致的点，剩余点位移的中位数即框的平移，
+// 点间距离比值的中位数即缩放(median flow)。有效点太少或位移异常时跟踪丢失，调用方应在本帧运行检测器。
+// 检测结果按IoU与已有跟踪匹配，匹配上的保留编号并以检测框校正位置，未匹配的开始新的跟踪，
+// 连续若干次检测都未确认的跟踪结束。坐标都是调用方传入的亮度图坐标。
+class FaceTracker
+{
+public:
+    struct Track {
+        quint64 id = 0;
+        cv::Rect2f box;
+        bool lost = false;              // 光流跟踪失败，等待检测器确认
+        bool confirmed = false;         // 当前位置来自检测器
+        bool submitted = false;         // 调用方的标记，例如已提交识别
+        int missedDetections = 0;       // 连续未被检测器确认的次数
+        int framesTracked = 0;          // 上次确认之后由光流更新的帧数
+    };
+
+    explicit FaceTracker(int missesBeforeEnd = 3);
+
+    // 每帧调用：用光流把所有跟踪移动到gray上，返回false表示有跟踪丢失
+    bool track(const cv::Mat& gray);
+
+    // 本帧在track()之后运行了检测器：匹配检测结果，结束连续未确认的跟踪(移入ended)
+    void update(const std::vector<cv::Rect>& detections, std::vector<Track>* ended);
+
+    // 结束所有跟踪，编号继续递增，同一个人重新出现时得到新的编号
+    void clear();
+
+    std::vector<Track>& tracks() { return m_tracks; }
+    const std::vector<Track>& tracks() const { return m_tracks; }
+    bool isEmpty() const { return m_tracks.empty(); }
+
+private:
+    bool trackBox(const cv::Mat& gray, cv::Rect2f* box);
+
+    std::vector<Track> m_tracks;
+    cv::Mat m_previous;                 // 上一帧亮度图
+    quint64 m_nextId;
+    int m_missesBeforeEnd;
+
+    // 复用的点缓冲区，避免每帧分配
+    std::vector<cv::Point2f> m_points;
+    std::vector<cv::Point2f> m_forward;
+    std::vector<cv::Point2f> m_backward;
+    std::vector<uchar> m_forwardStatus;
+    std::vector<uchar> m_backwardStatus;
+    std::vector<float> m_errors;
+    std::vector<int> m_kept;
+    std::vector<float> m_values;
+};
@@ -0,0 +1,208 @@
+#include "FrameBufferPool.h"
+#include <QMutexLocker>
+
+namespace {
+
+size_t matBytes(const cv::Mat& mat)
+{
+    return mat.total() * mat.elemSize();
+}
+
+size_t imageBytes(const QImage& image)
+{
+    return static_cast<size_t>(image.sizeInBytes());
+}
+
+} // namespace
+
+FrameBufferPool& FrameBufferPool::instance()
+{
+    static FrameBufferPool pool;
+    return pool;
+}
+
+FrameBufferPool::FrameBufferPool(size_t maxPooledBytes, int maxPerKind)
+    : m_maxPooledBytes(maxPooledBytes),
+    m_maxPerKind(maxPerKind)
+{
+}
+
+FrameBufferPool::~FrameBufferPool()
+{
+    trim();
+}
+
+PooledBuffer<cv::Mat> FrameBufferPool::acquireMat(int rows, int cols, int type)
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        for (size_t i = 0; i < m_freeMats.size(); ++i) {
+            const cv::Mat& candidate = m_freeMats[i];
+            if (candidate.rows == rows && candidate.cols == cols && candidate.type() == type) {
+                cv::Mat mat = std::move(m_freeMats[i]);
+                m_freeMats[i] = std::move(m_freeMats.back());
+                m_freeMats.pop_back();
+                m_stats.pooledBytes -= matBytes(mat);
+                m_stats.reuses++;
+                m_stats.outstanding++;
+                return PooledBuffer<cv::Mat>(this, std::move(mat));
+            }
+        }
+        m_stats.allocations++;
+        m_stats.outstanding++;
+    }
+
+    // 在锁外分配，避免阻塞其他线程
+    return PooledBuffer<cv::Mat>(this, cv::Mat(rows, cols, type));
+}
+
+PooledBuffer<QImage> FrameBufferPool::acquireImage(const QSize& size, QImage::Format format)
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        for (size_t i = 0; i < m_freeImages.size(); ++i) {
+            const QImage& candidate = m_freeImages[i];
+            if (candidate.size() == size && candidate.format() == format) {
+                QImage image = std::move(m_freeImages[i]);
+                m_freeImages[i] = std::move(m_freeImages.back());
+                m_freeImages.pop_back();
+                m_stats.pooledBytes -= imageBytes(image);
+                m_stats.reuses++;
+                m_stats.outstanding++;
+                return PooledBuffer<QImage>(this, std::move(image));
+            }
+        }
+        m_stats.allocations++;
+        m_stats.outstanding++;
+    }
+
+    return PooledBuffer<QImage>(this, QImage(size, format));
+}
+
+PooledBuffer<std::vector<uchar>> FrameBufferPool::acquireEncodeBuffer(size_t reserveBytes)
+{
+    std::vector<uchar> buffer;
+    {
+        QMutexLocker locker(&m_mutex);
+        // 优先选择容量足够的缓冲区，否则取容量最大的一个
+        int best = -1;
+        for (size_t i = 0; i < m_freeEncodeBuffers.size(); ++i) {
+            size_t capacity = m_freeEncodeBuffers[i].capacity();
+            if (capacity >= reserveBytes) {
+                best = static_cast<int>(i);
+                break;
+            }
+            if (best < 0 || capacity > m_freeEncodeBuffers[best].capacity()) {
+                best = static_cast<int>(i);
+            }
+        }
+        if (best >= 0) {
+            buffer = std::move(m_freeEncodeBuffers[best]);
+            m_freeEncodeBuffers[best] = std::move(m_freeEncodeBuffers.back());
+            m_freeEncodeBuffers.pop_back();
+            m_stats.pooledBytes -= buffer.capacity();
+        }
+        if (buffer.capacity() >= reserveBytes) {
+            m_stats.reuses++;
+        } else {
+            m_stats.allocations++;
+        }
+        m_stats.outstanding++;
+    }
+
+    buffer.clear();
+    buffer.reserve(reserveBytes);
+    return PooledBuffer<std::vector<uchar>>(this, std::move(buffer));
+}
+
+FrameBufferPool::Stats FrameBufferPool::stats() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_stats;
+}
+
+void FrameBufferPool::trim()
+{
+    QMutexLocker locker(&m_mutex);
+    m_freeMats.clear();
+    m_freeImages.clear();
+    m_freeEncodeBuffers.clear();
+    m_stats.pooledBytes = 0;
+}
+
+bool FrameBufferPool::reserveRoom(size_t bytes)
+{
+    // 调用方已持有锁
+    return m_stats.pooledBytes + bytes <= m_maxPooledBytes;
+}
+
+void FrameBufferPool::recycle(cv::Mat&& mat)
+{
+    QMutexLocker locker(&m_mutex);
+    m_stats.outstanding--;
+
+    // 外部数据或仍被其他 Mat 头引用的缓冲区不能回收，交给引用计数自行释放
+    if (mat.empty() || !mat.u || mat.u->refcount != 1 || !mat.isContinuous()) {
+        m_stats.dropped++;
+        return;
+    }
+
+    size_t bytes = matBytes(mat);
+    if (static_cast<int>(m_freeMats.size()) >= m_maxPerKind) {
+        m_stats.pooledBytes -= matBytes(m_freeMats.front());
+        m_freeMats.erase(m_freeMats.begin());
+    }
+    if (!reserveRoom(bytes)) {
+        m_stats.dropped++;
+        return;
+    }
+    m_stats.pooledBytes += bytes;
+    m_freeMats.push_back(std::move(mat));
+}
+
+void FrameBufferPool::recycle(QImage&& image)
+{
+    QMutexLocker locker(&m_mutex);
+    m_stats.outstanding--;
+
+    // QImage 隐式共享，仍有其他副本时回收会导致后续写入触发分离拷贝
+    if (image.isNull() || !image.isDetached()) {
+        m_stats.dropped++;
+        return;
+    }
+
+    size_t bytes = imageBytes(image);
+    if (static_cast<int>(m_freeImages.size()) >= m_maxPerKind) {
+        m_stats.pooledBytes -= imageBytes(m_freeImages.front());
+        m_freeImages.erase(m_freeImages.begin());
+    }
+    if (!reserveRoom(bytes)) {
+        m_stats.dropped++;
+        return;
+    }
+    m_stats.pooledBytes += bytes;
+    m_freeImages.push_back(std::move(image));
+}
+
+void FrameBufferPool::recycle(std::vector<uchar>&& buffer)
+{
+    QMutexLocker locker(&m_mutex);
+    m_stats.outstanding--;
+
+    if (buffer.capacity() == 0) {
+        return;
+    }
+
+    size_t bytes = buffer.capacity();
+    if (static_cast<int>(m_freeEncodeBuffers.size()) >= m_maxPerKind) {
+        m_stats.pooledBytes -= m_freeEncodeBuffers.front().capacity();
+        m_freeEncodeBuffers.erase(m_freeEncodeBuffers.begin());
+    }
+    if (!reserveRoom(bytes)) {
+        m_stats.dropped++;
+        return;
+    }
+    buffer.clear();
+    m_stats.pooledBytes += bytes;
+    m_freeEncodeBuffers.push_back(std::move(buffer));
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <QImage>
+#include <QMutex>
+#include <opencv2/core.hpp>
+#include <vector>
+#include <utility>
+
+class FrameBufferPool;
+
+// 池化缓冲区句柄：只能移动不能拷贝，析构时自动归还到缓冲池
+template <typename T>
+class PooledBuffer
+{
+public:
+    PooledBuffer() = default;
+    PooledBuffer(FrameBufferPool* pool, T&& value)
+        : m_pool(pool), m_value(std::move(value)) {}
+    PooledBuffer(PooledBuffer&& other) noexcept
+        : m_pool(std::exchange(other.m_pool, nullptr)), m_value(std::move(other.m_value)) {}
+    PooledBuffer& operator=(PooledBuffer&& other) noexcept
+    {
+        if (this != &other) {
+            reset();
+            m_pool = std::exchange(other.m_pool, nullptr);
+            m_value = std::move(other.m_value);
+        }
+        return *this;
+    }
+    PooledBuffer(const PooledBuffer&) = delete;
+    PooledBuffer& operator=(const PooledBuffer&) = delete;
+    ~PooledBuffer() { reset(); }
+
+    T& operator*() { return m_value; }
+    const T& operator*() const { return m_value; }
+    T* operator->() { return &m_value; }
+    const T* operator->() const { return &m_value; }
+
+    bool isNull() const { return m_pool == nullptr; }
+
+    // 提前归还缓冲区
+    void reset();
+
+private:
+    FrameBufferPool* m_pool = nullptr;
+    T m_value;
+};
+
+// 帧缓冲池：按尺寸和格式回收帧大小的 cv::Mat、QImage 以及 JPEG 编码缓冲区，
+// 使预览和拍照路径在稳定运行时几乎不再向堆申请内存
+class FrameBufferPool
+{
+public:
+    struct Stats {
+        quint64 allocations = 0;    // 未命中缓冲池、实际分配的次数
+        quint64 reuses = 0;         // 命中缓冲池的次数
+        quint64 dropped = 0;        // 因仍被共享或超出上限而未回收的次数
+        quint64 outstanding = 0;    // 已借出尚未归还的缓冲区数量
+        quint64 pooledBytes = 0;    // 池中空闲缓冲区占用的字节数
+    };
+
+    // 进程内共享的缓冲池
+    static FrameBufferPool& instance();
+
+    explicit FrameBufferPool(size_t maxPooledBytes = 64 * 1024 * 1024, int maxPerKind = 8);
+    ~FrameBufferPool();
+
+    PooledBuffer<cv::Mat> acquireMat(int rows, int cols, int type);
+    PooledBuffer<QImage> acquireImage(const QSize& size, QImage::Format format);
+    PooledBuffer<std::vector<uchar>> acquireEncodeBuffer(size_t reserveBytes);
+
+    Stats stats() const;
+
+    // 释放所有空闲缓冲区
+    void trim();
+
+private:
+    friend class PooledBuffer<cv::Mat>;
+    friend class PooledBuffer<QImage>;
+    friend class PooledBuffer<std::vector<uchar>>;
+
+    void recycle(cv::Mat&& mat);
+    void recycle(QImage&& image);
+    void recycle(std::vector<uchar>&& buffer);
+    bool reserveRoom(size_t bytes);
+
+    mutable QMutex m_mutex;
+    std::vector<cv::Mat> m_freeMats;
+    std::vector<QImage> m_freeImages;
+    std::vector<std::vector<uchar>> m_freeEncodeBuffers;
+    size_t m_maxPooledBytes;
+    int m_maxPerKind;
+    Stats m_stats;
+};
+
+template <typename T>
+void PooledBuffer<T>::reset()
+{
+    if (m_pool) {
+        FrameBufferPool* pool = std::exchange(m_pool, nullptr);
+        pool->recycle(std::move(m_value));
+        m_value = T();
+    }
+}
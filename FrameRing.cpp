@@ -0,0 +1,489 @@
+#include "FrameRing.h"
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QFile>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+
+#ifdef Q_OS_WIN
+#include <windows.h>
+#include <aclapi.h>
+#include <sddl.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/sem.h>
+#include <sys/shm.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+const quint32 RingMagic = 0x474E5246;       // "FRNG"
+const quint32 RingVersion = 1;
+const qint64 CacheLine = 64;
+
+// 共享内存中的布局只使用定长类型，写者和读者可以是不同的程序
+struct RingHeader {
+    std::atomic<quint32> magic;             // 最后写入，读者据此判断头部已初始化
+    quint32 version;
+    quint32 slotCount;
+    quint32 headerBytes;
+    quint64 slotBytes;                      // 每个槽的数据区大小
+    quint64 slotStride;                     // 槽头加数据区，按缓存行对齐
+    std::atomic<quint64> epoch;             // 写者每次初始化时递增
+    std::atomic<quint64> published;         // 最新一帧的序号，0表示还没有帧
+    qint64 producerPid;
+};
+
+struct SlotHeader {
+    std::atomic<quint64> lock;              // 奇数表示正在写入
+    quint64 sequence;
+    quint32 fourcc;
+    qint32 width;
+    qint32 height;
+    qint32 planeCount;
+    qint32 bytesPerLine[FrameRingInfo::MaxPlanes];
+    qint32 planeBytes[FrameRingInfo::MaxPlanes];
+    qint64 timestampUs;
+    qint64 publishedMs;
+};
+
+static_assert(std::atomic<quint64>::is_always_lock_free, "共享内存中的原子变量必须是无锁的");
+static_assert(std::atomic<quint32>::is_always_lock_free, "共享内存中的原子变量必须是无锁的");
+
+qint64 alignUp(qint64 value)
+{
+    return (value + CacheLine - 1) / CacheLine * CacheLine;
+}
+
+const qint64 HeaderBytes = alignUp(sizeof(RingHeader));
+const qint64 SlotHeaderBytes = alignUp(sizeof(SlotHeader));
+
+SlotHeader* slotAt(void* base, const RingHeader* header, quint64 sequence)
+{
+    quint64 index = (sequence - 1) % header->slotCount;
+    return reinterpret_cast<SlotHeader*>(static_cast<char*>(base) + header->headerBytes + index * header->slotStride);
+}
+
+#ifdef Q_OS_WIN
+// 按SDDL替换内核对象的访问控制列表；owner始终拥有全部权限
+bool setObjectAccess(HANDLE object, const QString& sddl, QString* error)
+{
+    PSECURITY_DESCRIPTOR descriptor = nullptr;
+    if (!ConvertStringSecurityDescriptorToSecurityDescriptorW(reinterpret_cast<LPCWSTR>(sddl.utf16()), SDDL_REVISION_1,
+                                                              &descriptor, nullptr)) {
+        *error = QString("无法解析访问权限(错误%1)").arg(GetLastError());
+        return false;
+    }
+    BOOL present = FALSE;
+    BOOL defaulted = FALSE;
+    PACL dacl = nullptr;
+    GetSecurityDescriptorDacl(descriptor, &present, &dacl, &defaulted);
+    DWORD result = SetSecurityInfo(object, SE_KERNEL_OBJECT, DACL_SECURITY_INFORMATION | PROTECTED_DACL_SECURITY_INFORMATION,
+                                   nullptr, nullptr, dacl, nullptr);
+    LocalFree(descriptor);
+    if (result != ERROR_SUCCESS) {
+        *error = QString("无法设置访问权限(错误%1)").arg(result);
+        return false;
+    }
+    return true;
+}
+#endif
+
+}
+
+quint32 FrameRingInfo::fourccCode(const char code[4])
+{
+    return quint32(uchar(code[0])) | (quint32(uchar(code[1])) << 8)
+           | (quint32(uchar(code[2])) << 16) | (quint32(uchar(code[3])) << 24);
+}
+
+QString FrameRingInfo::fourccName() const
+{
+    char code[4] = { char(fourcc & 0xFF), char((fourcc >> 8) & 0xFF), char((fourcc >> 16) & 0xFF), char(fourcc >> 24) };
+    return QString::fromLatin1(code, 4);
+}
+
+FrameRingWriter::FrameRingWriter(const QString& name)
+    : m_memory(QSharedMemory::platformSafeKey(name)),
+    m_header(nullptr),
+    m_accessMode(0600)
+{
+}
+
+FrameRingWriter::~FrameRingWriter()
+{
+    if (m_memory.isAttached()) {
+        m_memory.detach();
+    }
+}
+
+bool FrameRingWriter::create(int slotCount, qint64 slotBytes, QString* error)
+{
+    if (slotCount < 2 || slotBytes <= 0) {
+        if (error) {
+            *error = "至少需要2个槽";
+        }
+        return false;
+    }
+
+    qint64 stride = alignUp(SlotHeaderBytes + slotBytes);
+    qint64 totalBytes = HeaderBytes + slotCount * stride;
+    if (!m_memory.create(totalBytes)) {
+        // 上次异常退出遗留的共享内存：容量足够时接管，读者通过纪元变化得知写者已重启
+        if (m_memory.error() != QSharedMemory::AlreadyExists || !m_memory.attach()) {
+            if (error) {
+                *error = m_memory.errorString();
+            }
+            return false;
+        }
+        if (m_memory.size() < totalBytes) {
+            if (error) {
+                *error = QString("已存在容量不足的同名共享内存(%1字节，需要%2字节)").arg(m_memory.size()).arg(totalBytes);
+            }
+            m_memory.detach();
+            return false;
+        }
+    }
+    if (!applyAccessMode(error)) {
+        m_memory.detach();
+        return false;
+    }
+
+    RingHeader* header = static_cast<RingHeader*>(m_memory.data());
+    quint64 epoch = header->magic.load(std::memory_order_acquire) == RingMagic ? header->epoch.load() + 1 : 1;
+    header->magic.store(0, std::memory_order_relaxed);
+    header->version = RingVersion;
+    header->slotCount = quint32(slotCount);
+    header->headerBytes = quint32(HeaderBytes);
+    header->slotBytes = quint64(slotBytes);
+    header->slotStride = quint64(stride);
+    header->published.store(0, std::memory_order_relaxed);
+    header->epoch.store(epoch, std::memory_order_relaxed);
+    header->producerPid = QCoreApplication::applicationPid();
+
+    // 上一个写者可能在写入中途退出，把锁值推进到新的偶数，槽重新可读，旧的零拷贝视图全部失效
+    for (quint64 sequence = 1; sequence <= quint64(slotCount); ++sequence) {
+        SlotHeader* slot = slotAt(m_memory.data(), header, sequence);
+        quint64 lock = slot->lock.load(std::memory_order_relaxed);
+        slot->lock.store(lock + ((lock & 1) ? 1 : 2), std::memory_order_relaxed);
+        slot->sequence = 0;
+    }
+    header->magic.store(RingMagic, std::memory_order_release);
+    m_header = header;
+    return true;
+}
+
+bool FrameRingWriter::applyAccessMode(QString* error)
+{
+    // QSharedMemory总是以只有创建者可访问的权限创建共享内存和锁信号量，创建后再按设置放开。
+    // 读者连接(attach)时要获取锁信号量，所以能读共享内存的用户也需要信号量的读写权限
+    QString message;
+    QNativeIpcKey key = m_memory.nativeIpcKey();
+    int memoryMode = 0600 | m_accessMode;
+    int semaphoreMode = memoryMode | ((memoryMode & 0044) >> 1);
+
+#ifdef Q_OS_WIN
+    // 组和其他用户合并为已通过身份验证的用户(AU)；信号量名称与QSharedMemory内部一致，为共享内存名加"-sem"
+    QString others;
+    if (m_accessMode & 0066) {
+        others = (m_accessMode & 0022) ? "(A;;GRGW;;;AU)" : "(A;;GR;;;AU)";
+    }
+    HANDLE mapping = OpenFileMappingW(WRITE_DAC, FALSE, reinterpret_cast<LPCWSTR>(key.nativeKey().utf16()));
+    HANDLE semaphore = OpenSemaphoreW(WRITE_DAC, FALSE, reinterpret_cast<LPCWSTR>((key.nativeKey() + "-sem").utf16()));
+    bool ok = mapping && semaphore;
+    if (!ok) {
+        message = QString("无法打开共享内存以设置权限(错误%1)").arg(GetLastError());
+    }
+    if (ok) {
+        ok = setObjectAccess(mapping, "D:(A;;GA;;;OW)(A;;GA;;;SY)" + others, &message);
+    }
+    if (ok) {
+        ok = setObjectAccess(semaphore, QString("D:(A;;GA;;;OW)(A;;GA;;;SY)") + (others.isEmpty() ? "" : "(A;;GA;;;AU)"),
+                             &message);
+    }
+    if (mapping) {
+        CloseHandle(mapping);
+    }
+    if (semaphore) {
+        CloseHandle(semaphore);
+    }
+#else
+    bool ok = true;
+    QByteArray path = QFile::encodeName(key.nativeKey());
+    if (key.type() == QNativeIpcKey::Type::PosixRealtime) {
+        int fd = ::shm_open(path.constData(), O_RDWR, 0);
+        ok = fd >= 0 && ::fchmod(fd, mode_t(memoryMode)) == 0;
+        if (fd >= 0) {
+            ::close(fd);
+        }
+#ifdef Q_OS_LINUX
+        // 同名的POSIX信号量在/dev/shm中对应sem.<名称>
+        if (ok) {
+            QByteArray semaphorePath = "/dev/shm/sem." + (path.startsWith('/') ? path.mid(1) : path);
+            ok = ::chmod(semaphorePath.constData(), mode_t(semaphoreMode)) == 0;
+        }
+#else
+        if (ok && (m_accessMode & 0066)) {
+            errno = ENOTSUP;
+            ok = false;
+        }
+#endif
+    } else {
+        // System V的共享内存和信号量都以ftok(名称文件, 'Q')为键
+        key_t systemKey = ::ftok(path.constData(), int(QNativeIpcKey::Type::SystemV));
+        int memoryId = systemKey == -1 ? -1 : ::shmget(systemKey, 0, 0);
+        int semaphoreId = systemKey == -1 ? -1 : ::semget(systemKey, 1, 0);
+        struct shmid_ds memoryInfo;
+        struct semid_ds semaphoreInfo;
+        union {
+            int val;
+            struct semid_ds* buf;
+            unsigned short* array;
+        } semaphoreArg;
+        semaphoreArg.buf = &semaphoreInfo;
+        ok = memoryId != -1 && semaphoreId != -1 && ::shmctl(memoryId, IPC_STAT, &memoryInfo) == 0;
+        if (ok) {
+            memoryInfo.shm_perm.mode = (memoryInfo.shm_perm.mode & ~0777) | memoryMode;
+            ok = ::shmctl(memoryId, IPC_SET, &memoryInfo) == 0;
+        }
+        if (ok) {
+            ok = ::semctl(semaphoreId, 0, IPC_STAT, semaphoreArg) == 0;
+        }
+        if (ok) {
+            semaphoreInfo.sem_perm.mode = (semaphoreInfo.sem_perm.mode & ~0777) | semaphoreMode;
+            ok = ::semctl(semaphoreId, 0, IPC_SET, semaphoreArg) == 0;
+        }
+    }
+    if (!ok) {
+        message = QString("无法设置访问权限%1: %2").arg(memoryMode, 4, 8, QLatin1Char('0')).arg(QString::fromLocal8Bit(strerror(errno)));
+    }
+#endif
+
+    if (!ok && error) {
+        *error = message;
+    }
+    return ok;
+}
+
+qint64 FrameRingWriter::slotBytes() const
+{
+    return m_header ? qint64(static_cast<const RingHeader*>(m_header)->slotBytes) : 0;
+}
+
+bool FrameRingWriter::publish(const FrameRingInfo& info, const uchar* const planes[])
+{
+    if (!m_header || info.planeCount < 1 || info.planeCount > FrameRingInfo::MaxPlanes) {
+        return false;
+    }
+
+    RingHeader* header = static_cast<RingHeader*>(m_header);
+    qint64 totalBytes = 0;
+    for (int i = 0; i < info.planeCount; ++i) {
+        totalBytes += info.planeBytes[i];
+    }
+    if (totalBytes > qint64(header->slotBytes)) {
+        m_stats.oversized++;
+        return false;
+    }
+
+    quint64 sequence = header->published.load(std::memory_order_relaxed) + 1;
+    SlotHeader* slot = slotAt(m_memory.data(), header, sequence);
+
+    // 锁值变为奇数后才改写数据：读者要么看到奇数，要么在读完后发现锁值变了
+    quint64 lock = slot->lock.load(std::memory_order_relaxed);
+    slot->lock.store(lock + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    slot->sequence = sequence;
+    slot->fourcc = info.fourcc;
+    slot->width = info.width;
+    slot->height = info.height;
+    slot->planeCount = info.planeCount;
+    slot->timestampUs = info.timestampUs;
+    slot->publishedMs = QDateTime::currentMSecsSinceEpoch();
+    uchar* data = reinterpret_cast<uchar*>(slot) + SlotHeaderBytes;
+    for (int i = 0; i < FrameRingInfo::MaxPlanes; ++i) {
+        bool used = i < info.planeCount;
+        slot->bytesPerLine[i] = used ? info.bytesPerLine[i] : 0;
+        slot->planeBytes[i] = used ? info.planeBytes[i] : 0;
+        if (used) {
+            std::memcpy(data, planes[i], size_t(info.planeBytes[i]));
+            data += info.planeBytes[i];
+        }
+    }
+
+    slot->lock.store(lock + 2, std::memory_order_release);
+    header->published.store(sequence, std::memory_order_release);
+    m_stats.published++;
+    return true;
+}
+
+FrameRingReader::FrameRingReader(const QString& name)
+    : m_memory(QSharedMemory::platformSafeKey(name)),
+    m_header(nullptr),
+    m_epoch(0),
+    m_lastSequence(0)
+{
+}
+
+FrameRingReader::~FrameRingReader()
+{
+    detach();
+}
+
+bool FrameRingReader::attach(QString* error)
+{
+    if (m_header) {
+        return true;
+    }
+    if (!m_memory.attach(QSharedMemory::ReadOnly)) {
+        if (error) {
+            *error = m_memory.errorString();
+        }
+        return false;
+    }
+
+    const RingHeader* header = static_cast<const RingHeader*>(m_memory.constData());
+    if (m_memory.size() < HeaderBytes || header->magic.load(std::memory_order_acquire) != RingMagic
+        || header->version != RingVersion
+        || m_memory.size() < qint64(header->headerBytes + header->slotCount * header->slotStride)) {
+        if (error) {
+            *error = "共享帧环尚未初始化或版本不兼容";
+        }
+        m_memory.detach();
+        return false;
+    }
+
+    m_header = header;
+    m_epoch = header->epoch.load(std::memory_order_acquire);
+    // 从连接时的最新帧之后开始读
+    m_lastSequence = header->published.load(std::memory_order_acquire);
+    return true;
+}
+
+void FrameRingReader::detach()
+{
+    if (m_memory.isAttached()) {
+        m_memory.detach();
+    }
+    m_header = nullptr;
+}
+
+bool FrameRingReader::next(FrameRingView* view)
+{
+    if (!m_header) {
+        return false;
+    }
+
+    const RingHeader* header = static_cast<const RingHeader*>(m_header);
+    quint64 epoch = header->epoch.load(std::memory_order_acquire);
+    if (epoch != m_epoch) {
+        m_epoch = epoch;
+        m_lastSequence = 0;
+        m_stats.restarts++;
+    }
+
+    // 写者可能在读取过程中继续覆盖，失败时以新的发布序号重试
+    for (int attempt = 0; attempt < 4; ++attempt) {
+        quint64 published = header->published.load(std::memory_order_acquire);
+        if (published <= m_lastSequence) {
+            return false;
+        }
+
+        // 最旧的槽可能正被写入，只把前slotCount-1帧视为可读
+        quint64 oldest = published >= header->slotCount ? published - header->slotCount + 2 : 1;
+        quint64 sequence = qMax(m_lastSequence + 1, oldest);
+        if (readSlot(sequence, view)) {
+            m_stats.dropped += sequence - m_lastSequence - 1;
+            m_stats.received++;
+            m_lastSequence = sequence;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool FrameRingReader::latest(FrameRingView* view)
+{
+    if (!m_header) {
+        return false;
+    }
+
+    const RingHeader* header = static_cast<const RingHeader*>(m_header);
+    quint64 published = header->published.load(std::memory_order_acquire);
+    if (published > m_lastSequence + 1 && header->epoch.load(std::memory_order_acquire) == m_epoch) {
+        // 主动跳过的帧不计为丢帧
+        m_lastSequence = published - 1;
+    }
+    return next(view);
+}
+
+bool FrameRingReader::readSlot(quint64 sequence, FrameRingView* view)
+{
+    const RingHeader* header = static_cast<const RingHeader*>(m_header);
+    SlotHeader* slot = slotAt(const_cast<void*>(m_memory.constData()), header, sequence);
+
+    quint64 lock = slot->lock.load(std::memory_order_acquire);
+    if (lock & 1) {
+        return false;
+    }
+
+    FrameRingView result;
+    result.sequence = slot->sequence;
+    result.info.fourcc = slot->fourcc;
+    result.info.width = slot->width;
+    result.info.height = slot->height;
+    result.info.planeCount = qBound(0, int(slot->planeCount), FrameRingInfo::MaxPlanes);
+    result.info.timestampUs = slot->timestampUs;
+    result.info.publishedMs = slot->publishedMs;
+    const uchar* data = reinterpret_cast<const uchar*>(slot) + SlotHeaderBytes;
+    qint64 offset = 0;
+    for (int i = 0; i < result.info.planeCount; ++i) {
+        result.info.bytesPerLine[i] = slot->bytesPerLine[i];
+        result.info.planeBytes[i] = slot->planeBytes[i];
+        result.planes[i] = data + offset;
+        offset += qMax(0, slot->planeBytes[i]);
+    }
+    result.m_slot = int((sequence - 1) % header->slotCount);
+    result.m_lock = lock;
+
+    // 元数据读完后锁值未变且序号正确，说明读到的是完整的这一帧
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (slot->lock.load(std::memory_order_relaxed) != lock || result.sequence != sequence
+        || offset > qint64(header->slotBytes)) {
+        return false;
+    }
+    *view = result;
+    return true;
+}
+
+bool FrameRingReader::isValid(const FrameRingView& view) const
+{
+    if (!m_header || view.m_slot < 0) {
+        return false;
+    }
+    const RingHeader* header = static_cast<const RingHeader*>(m_header);
+    const SlotHeader* slot = reinterpret_cast<const SlotHeader*>(
+        static_cast<const char*>(m_memory.constData()) + header->headerBytes + quint64(view.m_slot) * header->slotStride);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return slot->lock.load(std::memory_order_relaxed) == view.m_lock;
+}
+
+bool FrameRingReader::copy(const FrameRingView& view, QByteArray* buffer) const
+{
+    qint64 totalBytes = 0;
+    for (int i = 0; i < view.info.planeCount; ++i) {
+        totalBytes += view.info.planeBytes[i];
+    }
+    buffer->resize(totalBytes);
+    char* out = buffer->data();
+    for (int i = 0; i < view.info.planeCount; ++i) {
+        std::memcpy(out, view.planes[i], size_t(view.info.planeBytes[i]));
+        out += view.info.planeBytes[i];
+    }
+    return isValid(view);
+}
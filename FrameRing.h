@@ -0,0 +1,118 @@
+#pragma once
+
+#include <QByteArray>
+#include <QSharedMemory>
+#include <QString>
+
+// 共享内存帧环：把摄像头帧发布给本机的其他进程(读卡器、录像程序等)，它们无需再打开摄像头或再次解码
+//
+// 单写多读，无锁。共享内存由一个头部和N个槽组成，每个槽带一个序号锁(seqlock)：写者先把锁值加1(奇数)，
+// 写入格式信息和像素数据，再加1(偶数)。读者在读取前后各读一次锁值，两次相同且为偶数才说明期间没有被改写。
+// 写者从不等待读者，读得慢的读者只会发现它要的帧已被覆盖，计为丢帧后继续读仍然可用的帧。
+// 读者可以直接在共享内存中处理像素(零拷贝)，处理完后用isValid()确认结果可用；或用copy()取一份完整的拷贝。
+// 帧序号从1开始连续递增；写者重启时纪元(epoch)改变，读者自动从新的序号重新开始。
+// 只依赖QtCore，读卡器、录像程序等读者直接编译FrameRing.cpp即可使用。
+
+// 一帧的格式信息，各平面在槽内依次存放
+struct FrameRingInfo {
+    static constexpr int MaxPlanes = 4;
+
+    quint32 fourcc = 0;                     // 像素格式，如"NV12"、"YUYV"、"BGRA"，见fourccCode()
+    int width = 0;
+    int height = 0;
+    int planeCount = 0;
+    int bytesPerLine[MaxPlanes] = {};
+    int planeBytes[MaxPlanes] = {};
+    qint64 timestampUs = -1;                // 摄像头时间戳，没有时为-1
+    qint64 publishedMs = 0;                 // 发布时刻(UTC毫秒)
+
+    static quint32 fourccCode(const char code[4]);
+    QString fourccName() const;
+};
+
+// 读者看到的一帧：planes指向共享内存，只在isValid()为true期间有意义
+struct FrameRingView {
+    quint64 sequence = 0;
+    FrameRingInfo info;
+    const uchar* planes[FrameRingInfo::MaxPlanes] = {};
+
+private:
+    friend class FrameRingReader;
+    int m_slot = -1;
+    quint64 m_lock = 0;
+};
+
+class FrameRingWriter
+{
+public:
+    struct Stats {
+        quint64 published = 0;
+        quint64 oversized = 0;              // 超过槽容量而未发布的帧
+    };
+
+    explicit FrameRingWriter(const QString& name);
+    ~FrameRingWriter();
+
+    // 共享内存的访问权限，按POSIX权限位(八进制)给出，在create()前设置。默认0600，只有同一用户的读者能连接；
+    // 读者以其他用户运行时需放开组或其他用户的读权限(如0640)，读者连接时使用的锁信号量自动获得相应的读写权限。
+    // Windows上组和其他用户的权限合并为"已通过身份验证的用户"
+    void setAccessMode(int mode) { m_accessMode = mode & 0777; }
+    int accessMode() const { return m_accessMode; }
+
+    // 创建共享内存；同名的共享内存已存在(如上次异常退出遗留)且容量足够时接管并重新初始化
+    bool create(int slotCount, qint64 slotBytes, QString* error = nullptr);
+    bool isCreated() const { return m_header != nullptr; }
+    qint64 slotBytes() const;
+
+    // 发布一帧，planes[i]包含info.planeBytes[i]字节；超过槽容量时返回false。从不阻塞
+    bool publish(const FrameRingInfo& info, const uchar* const planes[]);
+
+    Stats stats() const { return m_stats; }
+
+private:
+    bool applyAccessMode(QString* error);
+
+    QSharedMemory m_memory;
+    void* m_header;
+    int m_accessMode;
+    Stats m_stats;
+};
+
+class FrameRingReader
+{
+public:
+    struct Stats {
+        quint64 received = 0;
+        quint64 dropped = 0;                // 还没读到就被覆盖的帧
+        quint64 restarts = 0;               // 观察到写者重启的次数
+    };
+
+    explicit FrameRingReader(const QString& name);
+    ~FrameRingReader();
+
+    // 以只读方式连接写者创建的共享内存，写者尚未启动时返回false，可稍后重试
+    bool attach(QString* error = nullptr);
+    void detach();
+    bool isAttached() const { return m_header != nullptr; }
+
+    // 按顺序读取下一帧；没有新帧时返回false。读者落后超过槽数时跳过已被覆盖的帧
+    bool next(FrameRingView* view);
+    // 读取最新的一帧，跳过中间所有未读的帧(只关心当前画面的读者使用)
+    bool latest(FrameRingView* view);
+
+    // 处理完零拷贝的像素后调用：返回false表示期间槽已被写者改写，处理结果应丢弃
+    bool isValid(const FrameRingView& view) const;
+    // 把各平面依次拷贝到buffer中，拷贝后校验，被改写时返回false
+    bool copy(const FrameRingView& view, QByteArray* buffer) const;
+
+    Stats stats() const { return m_stats; }
+
+private:
+    bool readSlot(quint64 sequence, FrameRingView* view);
+
+    QSharedMemory m_memory;
+    const void* m_header;
+    quint64 m_epoch;
+    quint64 m_lastSequence;
+    Stats m_stats;
+};
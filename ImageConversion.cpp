@@ -0,0 +1,233 @@
+#include "ImageConversion.h"
+#include <opencv2/imgproc.hpp>
+
+namespace ImageConversion
+{
+
+int cvTypeForImageFormat(QImage::Format format)
+{
+    switch (format) {
+    case QImage::Format_RGB32:
+    case QImage::Format_ARGB32:
+    case QImage::Format_ARGB32_Premultiplied:
+    case QImage::Format_RGBX8888:
+    case QImage::Format_RGBA8888:
+    case QImage::Format_RGBA8888_Premultiplied:
+        return CV_8UC4;
+    case QImage::Format_RGB888:
+    case QImage::Format_BGR888:
+        return CV_8UC3;
+    case QImage::Format_Grayscale8:
+        return CV_8UC1;
+    default:
+        return -1;
+    }
+}
+
+int bgrConversionCode(QImage::Format format)
+{
+    switch (format) {
+    case QImage::Format_RGB32:
+    case QImage::Format_ARGB32:
+    case QImage::Format_ARGB32_Premultiplied:
+        return cv::COLOR_BGRA2BGR;   // 小端序内存布局为B,G,R,A
+    case QImage::Format_RGBX8888:
+    case QImage::Format_RGBA8888:
+    case QImage::Format_RGBA8888_Premultiplied:
+        return cv::COLOR_RGBA2BGR;
+    case QImage::Format_BGR888:
+        return -1;                   // 已是BGR顺序，直接拷贝
+    case QImage::Format_Grayscale8:
+        return cv::COLOR_GRAY2BGR;
+    default:
+        return cv::COLOR_RGB2BGR;
+    }
+}
+
+int grayConversionCode(QImage::Format format)
+{
+    switch (format) {
+    case QImage::Format_RGB32:
+    case QImage::Format_ARGB32:
+    case QImage::Format_ARGB32_Premultiplied:
+        return cv::COLOR_BGRA2GRAY;
+    case QImage::Format_RGBX8888:
+    case QImage::Format_RGBA8888:
+    case QImage::Format_RGBA8888_Premultiplied:
+        return cv::COLOR_RGBA2GRAY;
+    case QImage::Format_BGR888:
+        return cv::COLOR_BGR2GRAY;
+    case QImage::Format_Grayscale8:
+        return -1;
+    default:
+        return cv::COLOR_RGB2GRAY;
+    }
+}
+
+cv::Mat wrapImage(const QImage& image)
+{
+    int cvType = cvTypeForImageFormat(image.format());
+    if (image.isNull() || cvType < 0) {
+        return cv::Mat();
+    }
+    return cv::Mat(image.height(), image.width(), cvType,
+                   const_cast<uchar*>(image.constBits()), image.bytesPerLine());
+}
+
+QImage matToImage(const cv::Mat& mat)
+{
+    if (mat.empty() || mat.data == nullptr) {
+        return QImage();
+    }
+
+    if (mat.type() == CV_8UC1) {
+        QImage image(mat.cols, mat.rows, QImage::Format_Grayscale8);
+        cv::Mat target(image.height(), image.width(), CV_8UC1, image.bits(), image.bytesPerLine());
+        mat.copyTo(target);
+        return image;
+    }
+
+    QImage image(mat.cols, mat.rows, QImage::Format_RGB888);
+    cv::Mat target(image.height(), image.width(), CV_8UC3, image.bits(), image.bytesPerLine());
+    cv::cvtColor(mat, target, cv::COLOR_BGR2RGB);
+    return image;
+}
+
+bool scaleMappedFrame(const QVideoFrame& mappedFrame, QImage* target)
+{
+    QImage::Format format = QVideoFrameFormat::imageFormatFromPixelFormat(mappedFrame.pixelFormat());
+    int cvType = cvTypeForImageFormat(format);
+    if (!mappedFrame.isMapped() || cvType < 0 || target->isNull() || target->format() != format) {
+        return false;
+    }
+
+    cv::Mat source(mappedFrame.height(), mappedFrame.width(), cvType,
+                   const_cast<uchar*>(mappedFrame.bits(0)), mappedFrame.bytesPerLine(0));
+    cv::Mat output(target->height(), target->width(), cvType, target->bits(), target->bytesPerLine());
+    cv::resize(source, output, output.size(), 0, 0, cv::INTER_AREA);
+    return true;
+}
+
+QImage::Format previewImageFormat(QVideoFrameFormat::PixelFormat pixelFormat)
+{
+    switch (pixelFormat) {
+    case QVideoFrameFormat::Format_NV12:
+    case QVideoFrameFormat::Format_NV21:
+    case QVideoFrameFormat::Format_YUV420P:
+    case QVideoFrameFormat::Format_YV12:
+    case QVideoFrameFormat::Format_YUYV:
+    case QVideoFrameFormat::Format_UYVY:
+        return QImage::Format_RGB32;
+    default: {
+        QImage::Format format = QVideoFrameFormat::imageFormatFromPixelFormat(pixelFormat);
+        return cvTypeForImageFormat(format) >= 0 ? format : QImage::Format_Invalid;
+    }
+    }
+}
+
+bool scaleMappedPreview(const QVideoFrame& mappedFrame, QImage* target, cv::Mat* scratch)
+{
+    QVideoFrameFormat::PixelFormat pixelFormat = mappedFrame.pixelFormat();
+    if (!mappedFrame.isMapped() || target->isNull() || target->format() != previewImageFormat(pixelFormat)) {
+        return false;
+    }
+    if (target->format() != QImage::Format_RGB32
+        || target->format() == QVideoFrameFormat::imageFormatFromPixelFormat(pixelFormat)) {
+        return scaleMappedFrame(mappedFrame, target);
+    }
+
+    // RGB32在内存中为BGRA，YUV2BGRA的alpha为255
+    int width = target->width();
+    int height = target->height();
+    int frameWidth = mappedFrame.width();
+    int frameHeight = mappedFrame.height();
+    cv::Mat output(height, width, CV_8UC4, target->bits(), target->bytesPerLine());
+    uchar* bits = const_cast<uchar*>(mappedFrame.bits(0));
+    int stride = mappedFrame.bytesPerLine(0);
+
+    switch (pixelFormat) {
+    case QVideoFrameFormat::Format_NV12:
+    case QVideoFrameFormat::Format_NV21: {
+        if ((width | height) & 1) {
+            return false;
+        }
+        // 先分别缩小Y平面和交错的UV平面，拼成连续的半平面布局后再转换，只转换预览尺寸的像素
+        scratch->create(height * 3 / 2, width, CV_8UC1);
+        cv::Mat luma(height, width, CV_8UC1, scratch->data);
+        cv::Mat chroma(height / 2, width / 2, CV_8UC2, scratch->ptr(height));
+        cv::resize(cv::Mat(frameHeight, frameWidth, CV_8UC1, bits, stride), luma, luma.size(), 0, 0, cv::INTER_AREA);
+        cv::resize(cv::Mat(frameHeight / 2, frameWidth / 2, CV_8UC2, const_cast<uchar*>(mappedFrame.bits(1)),
+                           mappedFrame.bytesPerLine(1)),
+                   chroma, chroma.size(), 0, 0, cv::INTER_AREA);
+        cv::cvtColor(*scratch, output, pixelFormat == QVideoFrameFormat::Format_NV12
+                     ? cv::COLOR_YUV2BGRA_NV12 : cv::COLOR_YUV2BGRA_NV21);
+        return true;
+    }
+    case QVideoFrameFormat::Format_YUV420P:
+    case QVideoFrameFormat::Format_YV12: {
+        if ((width | height) & 1) {
+            return false;
+        }
+        // 两个色度平面按帧中的顺序依次放在Y之后(I420为U、V，YV12为V、U)
+        scratch->create(height * 3 / 2, width, CV_8UC1);
+        cv::Mat luma(height, width, CV_8UC1, scratch->data);
+        cv::resize(cv::Mat(frameHeight, frameWidth, CV_8UC1, bits, stride), luma, luma.size(), 0, 0, cv::INTER_AREA);
+        uchar* chromaBits = scratch->ptr(height);
+        for (int plane = 1; plane <= 2; ++plane) {
+            cv::Mat chroma(height / 2, width / 2, CV_8UC1, chromaBits + (plane - 1) * (width / 2) * (height / 2));
+            cv::resize(cv::Mat(frameHeight / 2, frameWidth / 2, CV_8UC1, const_cast<uchar*>(mappedFrame.bits(plane)),
+                               mappedFrame.bytesPerLine(plane)),
+                       chroma, chroma.size(), 0, 0, cv::INTER_AREA);
+        }
+        cv::cvtColor(*scratch, output, pixelFormat == QVideoFrameFormat::Format_YUV420P
+                     ? cv::COLOR_YUV2BGRA_I420 : cv::COLOR_YUV2BGRA_YV12);
+        return true;
+    }
+    case QVideoFrameFormat::Format_YUYV:
+    case QVideoFrameFormat::Format_UYVY: {
+        // 打包YUV的U、V交错在相邻像素中，不能直接缩放，先在原尺寸上转换
+        scratch->create(frameHeight, frameWidth, CV_8UC4);
+        cv::cvtColor(cv::Mat(frameHeight, frameWidth, CV_8UC2, bits, stride), *scratch,
+                     pixelFormat == QVideoFrameFormat::Format_YUYV ? cv::COLOR_YUV2BGRA_YUY2 : cv::COLOR_YUV2BGRA_UYVY);
+        cv::resize(*scratch, output, output.size(), 0, 0, cv::INTER_AREA);
+        return true;
+    }
+    default:
+        return false;
+    }
+}
+
+bool scaleMappedLuma(const QVideoFrame& mappedFrame, cv::Mat* target)
+{
+    if (!mappedFrame.isMapped() || target->empty() || target->type() != CV_8UC1) {
+        return false;
+    }
+
+    uchar* bits = const_cast<uchar*>(mappedFrame.bits(0));
+    int stride = mappedFrame.bytesPerLine(0);
+    switch (mappedFrame.pixelFormat()) {
+    case QVideoFrameFormat::Format_NV12:
+    case QVideoFrameFormat::Format_NV21:
+    case QVideoFrameFormat::Format_YUV420P:
+    case QVideoFrameFormat::Format_YUV422P:
+    case QVideoFrameFormat::Format_YV12:
+    case QVideoFrameFormat::Format_Y8: {
+        cv::Mat luma(mappedFrame.height(), mappedFrame.width(), CV_8UC1, bits, stride);
+        cv::resize(luma, *target, target->size(), 0, 0, cv::INTER_AREA);
+        return true;
+    }
+    case QVideoFrameFormat::Format_YUYV:
+    case QVideoFrameFormat::Format_UYVY: {
+        // 两个字节一个像素，Y分量在偶数(YUYV)或奇数(UYVY)字节；先缩放再取分量，只处理缩小后的像素
+        cv::Mat packed(mappedFrame.height(), mappedFrame.width(), CV_8UC2, bits, stride);
+        cv::Mat small;
+        cv::resize(packed, small, target->size(), 0, 0, cv::INTER_AREA);
+        cv::extractChannel(small, *target, mappedFrame.pixelFormat() == QVideoFrameFormat::Format_YUYV ? 0 : 1);
+        return true;
+    }
+    default:
+        return false;
+    }
+}
+
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <QImage>
+#include <QVideoFrame>
+#include <opencv2/core.hpp>
+
+// QImage与cv::Mat之间的零拷贝包装和颜色转换辅助函数
+namespace ImageConversion
+{
+    // QImage格式对应的cv::Mat类型，不支持直接包装时返回-1
+    int cvTypeForImageFormat(QImage::Format format);
+
+    // 将上述QImage格式转换为BGR所需的cvtColor代码，无需转换时返回-1
+    int bgrConversionCode(QImage::Format format);
+
+    // 将上述QImage格式转换为灰度所需的cvtColor代码，无需转换时返回-1
+    int grayConversionCode(QImage::Format format);
+
+    // 以cv::Mat包装QImage的像素数据(不拷贝)，格式不支持时返回空Mat
+    cv::Mat wrapImage(const QImage& image);
+
+    // BGR或灰度cv::Mat转换为QImage，直接写入QImage自己的缓冲区；其他类型按BGR处理，OpenCV异常由调用方处理
+    QImage matToImage(const cv::Mat& mat);
+
+    // 把已映射的打包格式视频帧缩放到target中(target的尺寸即输出尺寸，格式须与帧对应的图像格式一致)，
+    // 多平面格式返回false
+    bool scaleMappedFrame(const QVideoFrame& mappedFrame, QImage* target);
+
+    // 预览图像使用的格式：打包RGB格式与帧对应的图像格式相同，常见YUV格式转换为RGB32，其他格式返回Format_Invalid
+    QImage::Format previewImageFormat(QVideoFrameFormat::PixelFormat pixelFormat);
+
+    // 把已映射视频帧缩放到target中(格式须为previewImageFormat()，尺寸即输出尺寸)。YUV格式在缩小后的平面上
+    // 转换颜色(NV12/NV21/YUV420P/YV12要求输出宽高为偶数)，打包YUV先转换再缩放；scratch为复用的中间缓冲区
+    bool scaleMappedPreview(const QVideoFrame& mappedFrame, QImage* target, cv::Mat* scratch);
+
+    // 把已映射视频帧的亮度缩放到target中(CV_8UC1，尺寸即输出尺寸)，平面/半平面YUV直接使用Y平面，
+    // 打包YUV先取出Y分量；RGB等格式返回false，由调用方转换为灰度
+    bool scaleMappedLuma(const QVideoFrame& mappedFrame, cv::Mat* target);
+}
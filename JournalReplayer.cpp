@@ -0,0 +1,318 @@
+#include "JournalReplayer.h"
+#include "AuthTransport.h"
+#include "FaceAuthProtocol.h"
+#include <QDebug>
+
+namespace {
+
+const int InitialRetryDelayMs = 5000;
+const int MaxRetryDelayMs = 5 * 60 * 1000;
+
+} // namespace
+
+JournalReplayer::JournalReplayer(OfflineJournal* journal, AuthTransport* settingsSource, QObject* parent)
+    : QObject(parent),
+    m_journal(journal),
+    m_settingsSource(settingsSource),
+    m_port(0),
+    m_maxConcurrency(2),
+    m_batchSize(16),
+    m_responseTimeoutMs(15000),
+    m_running(false),
+    m_batchActive(false),
+    m_batchCompleted(0),
+    m_roundSucceeded(0),
+    m_roundRejected(0),
+    m_retryDelayMs(InitialRetryDelayMs),
+    m_deferDelayMs(InitialRetryDelayMs)
+{
+    m_retryTimer.setSingleShot(true);
+    connect(&m_retryTimer, &QTimer::timeout, this, &JournalReplayer::start);
+    m_deferTimer.setSingleShot(true);
+    connect(&m_deferTimer, &QTimer::timeout, this, [this]() {
+        m_deferred.clear();
+        start();
+    });
+}
+
+JournalReplayer::~JournalReplayer()
+{
+    releaseWorkers();
+}
+
+void JournalReplayer::setServer(const QString& host, quint16 port)
+{
+    m_host = host;
+    m_port = port;
+}
+
+void JournalReplayer::start()
+{
+    if (m_running || m_host.isEmpty() || !m_journal->isOpen() || activePending() == 0) {
+        return;
+    }
+
+    m_retryTimer.stop();
+    m_running = true;
+    m_roundSucceeded = 0;
+    m_roundRejected = 0;
+    startBatch();
+}
+
+void JournalReplayer::startBatch()
+{
+    m_queue = m_journal->pendingEntries(m_batchSize, m_deferred);
+    if (m_queue.isEmpty()) {
+        releaseWorkers();
+        m_running = false;
+        emit replayFinished(m_roundSucceeded, m_roundRejected, m_deferred.size());
+        return;
+    }
+
+    m_batchActive = true;
+    m_batchCompleted = 0;
+    m_batchTimer.start();
+    m_stats.batches++;
+
+    // 批次之间断开的空闲连接不会再收到connectionEstablished，移除后由下面补足
+    for (int i = m_workers.size() - 1; i >= 0; --i) {
+        Worker* worker = m_workers[i];
+        if (!worker->busy && !worker->transport->isReady() && !worker->transport->isConnecting()) {
+            m_workers.removeAt(i);
+            releaseWorker(worker);
+        }
+    }
+
+    // 复用上一批已建立的连接，不足时新建
+    int workerCount = qMin(m_maxConcurrency, int(m_queue.size()));
+    for (Worker* worker : m_workers) {
+        if (!worker->busy && worker->transport->isReady()) {
+            sendNext(worker);
+        }
+    }
+
+    while (m_workers.size() < workerCount) {
+        Worker* worker = new Worker;
+        worker->transport = new AuthTransport(this);
+        worker->transport->copySettingsFrom(*m_settingsSource);
+        worker->timeout = new QTimer(this);
+        worker->timeout->setSingleShot(true);
+        m_workers.append(worker);
+
+        connect(worker->transport, &AuthTransport::connectionEstablished, this, [this, worker]() {
+            sendNext(worker);
+        });
+        connect(worker->transport, &AuthTransport::connectionFailed, this, [this, worker](const QString& error) {
+            onWorkerFailed(worker, error);
+        });
+        connect(worker->transport->socket(), &QTcpSocket::readyRead, this, [this, worker]() {
+            onWorkerReadyRead(worker);
+        });
+        connect(worker->transport->socket(), &QTcpSocket::disconnected, this, [this, worker]() {
+            if (worker->busy) {
+                onWorkerFailed(worker, "连接断开");
+            }
+        });
+        connect(worker->timeout, &QTimer::timeout, this, [this, worker]() {
+            onWorkerFailed(worker, "响应超时");
+        });
+
+        worker->transport->beginConnect(m_host, m_port);
+    }
+}
+
+void JournalReplayer::sendNext(Worker* worker)
+{
+    if (!m_batchActive || worker->busy) {
+        return;
+    }
+
+    if (m_queue.isEmpty()) {
+        if (m_inFlight.isEmpty()) {
+            finishBatch();
+        }
+        return;
+    }
+
+    worker->current = m_queue.takeFirst();
+    worker->busy = true;
+    m_inFlight.insert(worker->current.offset);
+
+    // 旧版本写入的审计记录是带audit_only的登录请求，改为审计请求发送，不再携带密码
+    if (worker->current.header.value("audit_only").toBool()) {
+        worker->current.header.remove("audit_only");
+        worker->current.header.remove("password");
+        worker->current.header["type"] = "audit";
+        worker->current.header["event"] = "login";
+    }
+
+    // 密码只以加密形式保存在日志中，发送前在内存中解密
+    if (worker->current.header.contains("password_sealed")) {
+        QString password;
+        if (!OfflineJournal::revealSecret(worker->current.header.value("password_sealed").toString(), &password)) {
+            // 换了用户或机器后永远无法解密，按服务器拒绝处理，不再重试
+            QJsonObject response;
+            response["success"] = false;
+            response["message"] = "无法解密离线记录中的密码";
+            m_journal->markReplayed(worker->current.offset);
+            m_inFlight.remove(worker->current.offset);
+            worker->busy = false;
+            m_batchCompleted++;
+            m_stats.rejected++;
+            m_roundRejected++;
+            emit recordReplayed(worker->current.header, response);
+            sendNext(worker);
+            return;
+        }
+        worker->current.header.remove("password_sealed");
+        worker->current.header["password"] = password;
+    }
+
+    QByteArray packet = FaceAuthProtocol::buildRequestPacket(worker->current.header, worker->current.payload);
+    if (worker->transport->socket()->write(packet) == -1) {
+        onWorkerFailed(worker, worker->transport->socket()->errorString());
+        return;
+    }
+    worker->timeout->start(m_responseTimeoutMs);
+    m_stats.sent++;
+}
+
+void JournalReplayer::onWorkerReadyRead(Worker* worker)
+{
+    worker->receiveBuffer.append(worker->transport->socket()->readAll());
+    if (!worker->busy) {
+        worker->receiveBuffer.clear();
+        return;
+    }
+
+    QJsonObject response;
+    int consumed = 0;
+    FaceAuthProtocol::ParseResult result =
+        FaceAuthProtocol::parseResponse(worker->receiveBuffer, &response, &consumed);
+    if (result == FaceAuthProtocol::ParseResult::Incomplete) {
+        return;
+    }
+    if (result != FaceAuthProtocol::ParseResult::Complete) {
+        onWorkerFailed(worker, "无效的服务器响应");
+        return;
+    }
+    worker->receiveBuffer.remove(0, consumed);
+    worker->timeout->stop();
+    m_inFlight.remove(worker->current.offset);
+    worker->busy = false;
+    m_batchCompleted++;
+
+    // 审计记录只有服务器明确回复audited才算已记录；其他回复(不支持的类型、繁忙等)不是最终结果，保留稍后重试
+    if (worker->current.header.value("type").toString() == "audit" && !response.value("audited").toBool()) {
+        qDebug() << "服务器未确认审计记录，稍后重试:" << response.value("message").toString();
+        m_deferred.insert(worker->current.offset);
+        m_stats.deferred++;
+        sendNext(worker);
+        return;
+    }
+
+    // 服务器已给出最终结果，无论成功与否都不再重发
+    m_journal->markReplayed(worker->current.offset);
+    if (worker->current.header.value("type").toString() == "audit") {
+        m_stats.audited++;
+        m_deferDelayMs = InitialRetryDelayMs;
+    } else if (FaceAuthProtocol::responseSucceeded(response)) {
+        m_stats.succeeded++;
+        m_roundSucceeded++;
+    } else {
+        m_stats.rejected++;
+        m_roundRejected++;
+    }
+    emit recordReplayed(worker->current.header, response);
+
+    sendNext(worker);
+}
+
+void JournalReplayer::onWorkerFailed(Worker* worker, const QString& reason)
+{
+    Q_UNUSED(worker);
+    if (!m_running) {
+        return;
+    }
+
+    qDebug() << "离线补发失败:" << reason << ", 已完成" << m_batchCompleted << "条，"
+             << m_retryDelayMs / 1000 << "秒后重试";
+    m_stats.transportErrors++;
+    abortBatch();
+}
+
+void JournalReplayer::finishBatch()
+{
+    m_batchActive = false;
+    m_stats.lastBatchMs = m_batchTimer.elapsed();
+    m_stats.lastBatchRecordsPerSec = m_stats.lastBatchMs > 0
+        ? m_batchCompleted * 1000.0 / m_stats.lastBatchMs : 0.0;
+    m_retryDelayMs = InitialRetryDelayMs;
+
+    OfflineJournal::Stats journalStats = m_journal->stats();
+    qDebug() << "离线补发批次完成:" << m_batchCompleted << "条, 耗时" << m_stats.lastBatchMs
+             << "ms," << m_stats.lastBatchRecordsPerSec << "条/秒, 剩余" << journalStats.pendingRecords << "条";
+
+    // 批次之间没有在途记录，已补发记录占用过半容量时压缩
+    if (journalStats.usedBytes > journalStats.capacityBytes / 2
+        && journalStats.usedBytes > journalStats.pendingBytes * 2) {
+        // 压缩后记录的偏移改变，暂缓的审计记录在下一批重新发送一次
+        if (m_journal->compact()) {
+            m_deferred.clear();
+        }
+    }
+
+    if (activePending() > 0) {
+        // 下一批在事件循环中开始，避免在信号处理中递归
+        QTimer::singleShot(0, this, &JournalReplayer::startBatch);
+        return;
+    }
+
+    releaseWorkers();
+    m_running = false;
+    if (!m_deferred.isEmpty() && !m_deferTimer.isActive()) {
+        m_deferTimer.start(m_deferDelayMs);
+        m_deferDelayMs = qMin(m_deferDelayMs * 2, MaxRetryDelayMs);
+    }
+    emit replayFinished(m_roundSucceeded, m_roundRejected, m_deferred.size());
+}
+
+void JournalReplayer::abortBatch()
+{
+    m_batchActive = false;
+    m_queue.clear();
+    m_inFlight.clear();
+    releaseWorkers();
+    m_running = false;
+
+    m_retryTimer.start(m_retryDelayMs);
+    m_retryDelayMs = qMin(m_retryDelayMs * 2, MaxRetryDelayMs);
+
+    emit replayFinished(m_roundSucceeded, m_roundRejected, int(m_journal->stats().pendingRecords));
+}
+
+int JournalReplayer::activePending() const
+{
+    // 暂缓的审计记录等重试定时器到期后再发送
+    return qMax(0, int(m_journal->stats().pendingRecords) - int(m_deferred.size()));
+}
+
+void JournalReplayer::releaseWorkers()
+{
+    for (Worker* worker : m_workers) {
+        releaseWorker(worker);
+    }
+    m_workers.clear();
+}
+
+void JournalReplayer::releaseWorker(Worker* worker)
+{
+    worker->timeout->stop();
+    disconnect(worker->transport, nullptr, this, nullptr);
+    disconnect(worker->transport->socket(), nullptr, this, nullptr);
+    disconnect(worker->timeout, nullptr, this, nullptr);
+    worker->transport->socket()->abort();
+    worker->transport->deleteLater();
+    worker->timeout->deleteLater();
+    delete worker;
+}
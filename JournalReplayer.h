@@ -0,0 +1,99 @@
+#pragma once
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QJsonObject>
+#include <QList>
+#include <QSet>
+#include <QTimer>
+#include <QVector>
+#include "OfflineJournal.h"
+
+class AuthTransport;
+
+// 离线日志补发器：恢复连接后按批次补发OfflineJournal中的请求
+//
+// 每批最多batchSize条记录，分配到最多maxConcurrency条并行连接上顺序发送，
+// 收到服务器的RESP响应后标记为已补发。连接失败时停止本轮并按指数退避重试。
+// 审计记录只有服务器回复audited才标记为已补发；不支持审计的服务器回复其他结果时保留记录，
+// 本轮不再发送，之后按指数退避重试。
+class JournalReplayer : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Stats {
+        quint64 batches = 0;
+        quint64 sent = 0;
+        quint64 succeeded = 0;          // 服务器返回success
+        quint64 rejected = 0;           // 服务器已处理但返回失败(如用户已存在)
+        quint64 audited = 0;            // 审计记录，服务器回复audited
+        quint64 deferred = 0;           // 服务器未确认audited而保留、稍后重试的审计记录
+        quint64 transportErrors = 0;
+        qint64 lastBatchMs = 0;
+        double lastBatchRecordsPerSec = 0.0;
+    };
+
+    JournalReplayer(OfflineJournal* journal, AuthTransport* settingsSource, QObject* parent = nullptr);
+    ~JournalReplayer();
+
+    void setServer(const QString& host, quint16 port);
+    void setMaxConcurrency(int count) { m_maxConcurrency = qMax(1, count); }
+    void setBatchSize(int count) { m_batchSize = qMax(1, count); }
+    void setResponseTimeout(int ms) { m_responseTimeoutMs = ms; }
+
+    bool isRunning() const { return m_running; }
+    Stats stats() const { return m_stats; }
+
+public slots:
+    // 若有待补发记录且当前未在补发，则开始新一轮补发
+    void start();
+
+signals:
+    void recordReplayed(const QJsonObject& request, const QJsonObject& response);
+    void replayFinished(int succeeded, int rejected, int remaining);
+
+private:
+    struct Worker {
+        AuthTransport* transport = nullptr;
+        QTimer* timeout = nullptr;
+        QByteArray receiveBuffer;
+        bool busy = false;
+        OfflineJournal::Entry current;
+    };
+
+    void startBatch();
+    void sendNext(Worker* worker);
+    void onWorkerReadyRead(Worker* worker);
+    void onWorkerFailed(Worker* worker, const QString& reason);
+    void finishBatch();
+    void abortBatch();
+    void releaseWorkers();
+    void releaseWorker(Worker* worker);
+    int activePending() const;
+
+    OfflineJournal* m_journal;
+    AuthTransport* m_settingsSource;
+    QString m_host;
+    quint16 m_port;
+    int m_maxConcurrency;
+    int m_batchSize;
+    int m_responseTimeoutMs;
+
+    bool m_running;
+    bool m_batchActive;
+    QVector<Worker*> m_workers;
+    QList<OfflineJournal::Entry> m_queue;
+    QSet<quint64> m_inFlight;
+    QElapsedTimer m_batchTimer;
+    int m_batchCompleted;
+    int m_roundSucceeded;
+    int m_roundRejected;
+
+    QTimer m_retryTimer;
+    int m_retryDelayMs;
+    QSet<quint64> m_deferred;           // 等待重试的审计记录，重试前不再放入批次
+    QTimer m_deferTimer;
+    int m_deferDelayMs;
+    Stats m_stats;
+};
@@ -0,0 +1,343 @@
+#include "KioskController.h"
+#include "FrameBufferPool.h"
+#include "ImageConversion.h"
+#include <QDebug>
+#include <opencv2/imgcodecs.hpp>
+#include <opencv2/imgproc.hpp>
+#include <algorithm>
+#include <chrono>
+
+namespace {
+
+const int DetectionWidth = 320;         // 在缩小的灰度图上检测和跟踪
+const int MissesBeforeLeft = 3;         // 连续未被检测器确认的次数，超过即视为离开
+const double FaceMargin = 0.3;          // 裁剪时在人脸框四周保留的比例
+const qint64 RateWindowMs = 2000;       // 检测频率的统计窗口
+
+// 把帧缩小为DetectionWidth宽的亮度图。未旋转、未镜像的YUV帧直接缩放亮度平面，不做颜色转换；
+// 其他格式转换为QImage(同时返回给调用方，提交时编码用)再转灰度
+bool detectionLuma(const QVideoFrame& frame, PooledBuffer<cv::Mat>* gray, QImage* image, double* scale)
+{
+    FrameBufferPool& pool = FrameBufferPool::instance();
+    QVideoFrame mapped(frame);
+    if (!mapped.surfaceFormat().isMirrored()
+        && mapped.surfaceFormat().scanLineDirection() == QVideoFrameFormat::TopToBottom
+        && mapped.rotation() == QtVideo::Rotation::None
+        && mapped.width() > 0
+        && mapped.map(QVideoFrame::ReadOnly)) {
+        *scale = double(DetectionWidth) / mapped.width();
+        *gray = pool.acquireMat(qMax(1, int(mapped.height() * *scale)), DetectionWidth, CV_8UC1);
+        bool scaled = ImageConversion::scaleMappedLuma(mapped, &**gray);
+        mapped.unmap();
+        if (scaled) {
+            return true;
+        }
+    }
+
+    *image = frame.toImage();
+    cv::Mat source = ImageConversion::wrapImage(*image);
+    if (source.empty()) {
+        *image = image->convertToFormat(QImage::Format_RGB32);
+        source = ImageConversion::wrapImage(*image);
+    }
+    if (source.empty()) {
+        return false;
+    }
+
+    // 先缩小再转灰度，只处理约1/4的像素
+    *scale = double(DetectionWidth) / source.cols;
+    int detectionHeight = qMax(1, int(source.rows * *scale));
+    PooledBuffer<cv::Mat> small = pool.acquireMat(detectionHeight, DetectionWidth, source.type());
+    cv::resize(source, *small, small->size(), 0, 0, cv::INTER_AREA);
+
+    *gray = pool.acquireMat(detectionHeight, DetectionWidth, CV_8UC1);
+    int grayCode = ImageConversion::grayConversionCode(image->format());
+    if (grayCode < 0) {
+        small->copyTo(**gray);
+    } else {
+        cv::cvtColor(*small, **gray, grayCode);
+    }
+    return true;
+}
+
+QRect toFrameRect(const cv::Rect2f& box, double scale)
+{
+    return QRect(int(box.x / scale), int(box.y / scale), int(box.width / scale), int(box.height / scale));
+}
+
+} // namespace
+
+KioskController::KioskController(QObject* parent)
+    : QObject(parent),
+    m_detectorLoaded(false),
+    m_enabled(false),
+    m_processing(false),
+    m_resetRequested(false),
+    m_detectionInterval(5),
+    m_minSubmitIntervalMs(1000),
+    m_tracker(MissesBeforeLeft),
+    m_framesSinceDetection(0),
+    m_lastSubmitMs(0),
+    m_rateWindowStartMs(0),
+    m_rateWindowDetections(0),
+    m_framesOffered(0),
+    m_framesDropped(0),
+    m_detections(0),
+    m_trackedFrames(0),
+    m_trackLosses(0),
+    m_facesSubmitted(0),
+    m_detectionsPerSecond(0.0)
+{
+    // 一个线程检测/跟踪，一个线程编码
+    m_pool.setMaxThreadCount(2);
+}
+
+KioskController::~KioskController()
+{
+    m_enabled = false;
+    m_pool.waitForDone();
+}
+
+qint64 KioskController::nowMs()
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+bool KioskController::loadDetector(const QString& cascadePath)
+{
+    m_pool.waitForDone();
+    try {
+        m_detectorLoaded = m_detector.load(cascadePath.toStdString());
+    }
+    catch (const cv::Exception& e) {
+        qDebug() << "加载人脸检测模型异常:" << e.what();
+        m_detectorLoaded = false;
+    }
+    qDebug() << "人脸检测模型" << cascadePath << (m_detectorLoaded ? "加载成功" : "加载失败");
+    return m_detectorLoaded;
+}
+
+void KioskController::setEnabled(bool enabled)
+{
+    m_enabled = enabled && m_detectorLoaded;
+    if (!m_enabled) {
+        resetPresence();
+        QMutexLocker locker(&m_tracksMutex);
+        m_publishedTracks.clear();
+    }
+}
+
+void KioskController::resetPresence()
+{
+    m_resetRequested = true;
+}
+
+KioskController::Stats KioskController::stats() const
+{
+    Stats stats;
+    stats.framesOffered = m_framesOffered;
+    stats.framesDropped = m_framesDropped;
+    stats.detections = m_detections;
+    stats.trackedFrames = m_trackedFrames;
+    stats.trackLosses = m_trackLosses;
+    stats.facesSubmitted = m_facesSubmitted;
+    stats.detectionsPerSecond = m_detectionsPerSecond;
+    return stats;
+}
+
+QVector<KioskController::FaceTrack> KioskController::tracks(QSize* frameSize) const
+{
+    QMutexLocker locker(&m_tracksMutex);
+    if (frameSize) {
+        *frameSize = m_publishedFrameSize;
+    }
+    return m_publishedTracks;
+}
+
+void KioskController::offerFrame(const QVideoFrame& frame)
+{
+    if (!m_enabled) {
+        return;
+    }
+    m_framesOffered++;
+
+    // 上一帧还在处理时丢弃该帧，不积压
+    if (m_processing.exchange(true)) {
+        m_framesDropped++;
+        return;
+    }
+
+    qint64 offeredAtMs = nowMs();
+    m_pool.start([this, frame, offeredAtMs]() {
+        processFrame(frame, offeredAtMs);
+        m_processing = false;
+    });
+}
+
+void KioskController::processFrame(const QVideoFrame& frame, qint64 offeredAtMs)
+{
+    if (m_resetRequested.exchange(false)) {
+        // 结束所有跟踪，镜头前的人在下一次检测后以新的编号重新提交
+        m_tracker.clear();
+        m_framesSinceDetection = 0;
+    }
+    if (!m_enabled) {
+        return;
+    }
+
+    try {
+        PooledBuffer<cv::Mat> gray;
+        QImage image;
+        double scale = 1.0;
+        if (!detectionLuma(frame, &gray, &image, &scale)) {
+            return;
+        }
+
+        // 光流每帧更新人脸框；跟踪丢失或到达检测间隔时运行检测器(画面中没有人脸时同样按间隔检测)
+        bool tracked = m_tracker.track(*gray);
+        if (!tracked) {
+            m_trackLosses++;
+        }
+        bool detect = !tracked || m_framesSinceDetection + 1 >= m_detectionInterval;
+        if (!detect) {
+            m_framesSinceDetection++;
+            if (!m_tracker.isEmpty()) {
+                m_trackedFrames++;
+            }
+            publishTracks(QSize(qRound(gray->cols / scale), qRound(gray->rows / scale)), scale);
+            updateDetectionRate(offeredAtMs);
+            return;
+        }
+        m_framesSinceDetection = 0;
+
+        // 检测在均衡化后的副本上进行，跟踪使用原始亮度
+        FrameBufferPool& pool = FrameBufferPool::instance();
+        PooledBuffer<cv::Mat> equalized = pool.acquireMat(gray->rows, gray->cols, CV_8UC1);
+        cv::equalizeHist(*gray, *equalized);
+
+        std::vector<cv::Rect> faces;
+        m_detector.detectMultiScale(*equalized, faces, 1.1, 4, 0, cv::Size(40, 40));
+        m_detections++;
+        updateDetectionRate(offeredAtMs);
+
+        std::vector<FaceTracker::Track> ended;
+        m_tracker.update(faces, &ended);
+        publishTracks(QSize(qRound(gray->cols / scale), qRound(gray->rows / scale)), scale);
+        for (const FaceTracker::Track& track : ended) {
+            if (track.submitted) {
+                emit personLeft();
+            }
+        }
+
+        if (offeredAtMs - m_lastSubmitMs < m_minSubmitIntervalMs) {
+            return;
+        }
+
+        // 检测器确认、尚未提交的人脸中取面积最大的一个，以跟踪编号提交
+        FaceTracker::Track* candidate = nullptr;
+        for (FaceTracker::Track& track : m_tracker.tracks()) {
+            if (track.confirmed && !track.submitted && (!candidate || track.box.area() > candidate->box.area())) {
+                candidate = &track;
+            }
+        }
+        if (!candidate) {
+            return;
+        }
+
+        // 亮度直接取自视频帧时，只在需要编码时才转换整帧
+        if (image.isNull()) {
+            image = frame.toImage();
+            if (ImageConversion::wrapImage(image).empty()) {
+                image = image.convertToFormat(QImage::Format_RGB32);
+            }
+        }
+        QRect faceRect = toFrameRect(candidate->box, scale);
+
+        candidate->submitted = true;
+        m_lastSubmitMs = offeredAtMs;
+        quint64 personId = candidate->id;
+        emit faceDetected();
+
+        // 编码作为独立任务，处理线程可以立即处理下一帧
+        m_pool.start([this, personId, image, faceRect, offeredAtMs]() {
+            runEncode(personId, image, faceRect, offeredAtMs);
+        });
+    }
+    catch (const cv::Exception& e) {
+        qDebug() << "自助模式人脸检测异常:" << e.what();
+    }
+}
+
+void KioskController::publishTracks(const QSize& frameSize, double scale)
+{
+    QVector<FaceTrack> tracks;
+    tracks.reserve(int(m_tracker.tracks().size()));
+    for (const FaceTracker::Track& track : m_tracker.tracks()) {
+        if (track.lost) {
+            continue;
+        }
+        FaceTrack face;
+        face.id = track.id;
+        face.rect = toFrameRect(track.box, scale);
+        face.confirmed = track.confirmed;
+        tracks.append(face);
+    }
+
+    QMutexLocker locker(&m_tracksMutex);
+    m_publishedTracks.swap(tracks);
+    m_publishedFrameSize = frameSize;
+}
+
+void KioskController::updateDetectionRate(qint64 nowMs)
+{
+    if (m_rateWindowStartMs == 0) {
+        m_rateWindowStartMs = nowMs;
+        m_rateWindowDetections = m_detections;
+        return;
+    }
+    qint64 elapsedMs = nowMs - m_rateWindowStartMs;
+    if (elapsedMs >= RateWindowMs) {
+        m_detectionsPerSecond = double(m_detections - m_rateWindowDetections) * 1000.0 / double(elapsedMs);
+        m_rateWindowStartMs = nowMs;
+        m_rateWindowDetections = m_detections;
+    }
+}
+
+void KioskController::runEncode(quint64 personId, const QImage& image, const QRect& faceRect, qint64 detectedAtMs)
+{
+    if (!m_enabled) {
+        return;
+    }
+
+    try {
+        int marginX = int(faceRect.width() * FaceMargin);
+        int marginY = int(faceRect.height() * FaceMargin);
+        QRect cropRect = faceRect.adjusted(-marginX, -marginY, marginX, marginY).intersected(image.rect());
+        if (cropRect.isEmpty()) {
+            return;
+        }
+
+        cv::Mat source = ImageConversion::wrapImage(image);
+        cv::Mat face = source(cv::Rect(cropRect.x(), cropRect.y(), cropRect.width(), cropRect.height()));
+
+        FrameBufferPool& pool = FrameBufferPool::instance();
+        PooledBuffer<cv::Mat> bgr = pool.acquireMat(face.rows, face.cols, CV_8UC3);
+        int bgrCode = ImageConversion::bgrConversionCode(image.format());
+        if (bgrCode < 0) {
+            face.copyTo(*bgr);
+        } else {
+            cv::cvtColor(face, *bgr, bgrCode);
+        }
+
+        PooledBuffer<std::vector<uchar>> buf = pool.acquireEncodeBuffer(bgr->total());
+        cv::imencode(".jpg", *bgr, *buf, { cv::IMWRITE_JPEG_QUALITY, 85 });
+
+        QByteArray jpeg(reinterpret_cast<const char*>(buf->data()), qsizetype(buf->size()));
+        m_facesSubmitted++;
+        emit faceCaptured(personId, jpeg, detectedAtMs);
+    }
+    catch (const cv::Exception& e) {
+        qDebug() << "自助模式人脸编码异常:" << e.what();
+    }
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include "FaceTracker.h"
+#include <QObject>
+#include <QByteArray>
+#include <QImage>
+#include <QMutex>
+#include <QRect>
+#include <QSize>
+#include <QThreadPool>
+#include <QVector>
+#include <QVideoFrame>
+#include <opencv2/objdetect.hpp>
+#include <atomic>
+
+// 自助(免操作)认证模式的人脸检测、跟踪与编码流水线
+//
+// 帧处理函数把视频帧交给offerFrame()，处理在工作线程上进行，同一时刻最多一帧在处理，
+// 处理忙时到达的帧直接丢弃。检测器每隔若干帧(或有跟踪丢失时)运行一次，其余帧由FaceTracker
+// 在缩小的亮度图上用光流更新人脸框，每个人在镜头前期间保持同一个跟踪编号。
+// 检测器确认的新人脸以跟踪编号提交，裁剪和JPEG编码作为独立任务执行，
+// 因此下一帧的处理、上一人的编码和网络往返可以重叠进行。
+// 同一个人持续停留在镜头前时只提交一次，连续若干次检测都未确认后视为离开。
+class KioskController : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Stats {
+        quint64 framesOffered = 0;
+        quint64 framesDropped = 0;      // 处理忙时丢弃的帧
+        quint64 detections = 0;         // 检测器调用次数
+        quint64 trackedFrames = 0;      // 只由光流更新人脸框的帧
+        quint64 trackLosses = 0;        // 光流跟踪失败而提前运行检测器的次数
+        quint64 facesSubmitted = 0;
+        double detectionsPerSecond = 0.0;   // 最近统计窗口内的检测器调用频率
+    };
+
+    // 人脸框，坐标为原始帧坐标
+    struct FaceTrack {
+        quint64 id = 0;
+        QRect rect;
+        bool confirmed = false;         // 本帧由检测器确认，否则为光流估计
+    };
+
+    explicit KioskController(QObject* parent = nullptr);
+    ~KioskController();
+
+    bool loadDetector(const QString& cascadePath);
+    bool hasDetector() const { return m_detectorLoaded; }
+
+    void setEnabled(bool enabled);
+    bool isEnabled() const { return m_enabled; }
+
+    // 最短提交间隔，避免检测抖动导致同一人被重复提交
+    void setMinSubmitIntervalMs(int ms) { m_minSubmitIntervalMs = ms; }
+
+    // 每隔多少帧运行一次检测器，1表示每帧检测(不跟踪)；越大CPU占用越低，新出现的人被发现得越晚
+    void setDetectionInterval(int frames) { m_detectionInterval = qMax(1, frames); }
+    int detectionInterval() const { return m_detectionInterval; }
+
+    // 由帧处理函数调用(GUI线程)
+    void offerFrame(const QVideoFrame& frame);
+
+    // 允许当前镜头前的人被重新提交(例如请求被丢弃时)
+    void resetPresence();
+
+    Stats stats() const;
+
+    // 最近处理的一帧中的人脸框(可在GUI线程调用)，frameSize返回该帧的尺寸
+    QVector<FaceTrack> tracks(QSize* frameSize = nullptr) const;
+
+    // 单调时钟毫秒数，用于计算每人延迟
+    static qint64 nowMs();
+
+signals:
+    // 在GUI线程中接收：personId为本次出现的人的编号
+    void faceCaptured(quint64 personId, const QByteArray& jpeg, qint64 detectedAtMs);
+    // 检测到新的人脸、开始编码之前发出，可用于提前建立连接
+    void faceDetected();
+    void personLeft();
+
+private:
+    void processFrame(const QVideoFrame& frame, qint64 offeredAtMs);
+    void runEncode(quint64 personId, const QImage& image, const QRect& faceRect, qint64 detectedAtMs);
+    void publishTracks(const QSize& frameSize, double scale);
+    void updateDetectionRate(qint64 nowMs);
+
+    QThreadPool m_pool;
+    cv::CascadeClassifier m_detector;
+    bool m_detectorLoaded;
+    std::atomic<bool> m_enabled;
+    std::atomic<bool> m_processing;
+    std::atomic<bool> m_resetRequested;
+    std::atomic<int> m_detectionInterval;
+    int m_minSubmitIntervalMs;
+
+    // 以下状态只在处理任务中访问，处理任务串行执行
+    FaceTracker m_tracker;
+    int m_framesSinceDetection;
+    qint64 m_lastSubmitMs;
+    qint64 m_rateWindowStartMs;
+    quint64 m_rateWindowDetections;
+
+    mutable QMutex m_tracksMutex;
+    QVector<FaceTrack> m_publishedTracks;
+    QSize m_publishedFrameSize;
+
+    std::atomic<quint64> m_framesOffered;
+    std::atomic<quint64> m_framesDropped;
+    std::atomic<quint64> m_detections;
+    std::atomic<quint64> m_trackedFrames;
+    std::atomic<quint64> m_trackLosses;
+    std::atomic<quint64> m_facesSubmitted;
+    std::atomic<double> m_detectionsPerSecond;
+};
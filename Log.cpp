@@ -0,0 +1,526 @@
+#include "Log.h"
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QSettings>
+#include <QThread>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+namespace Log
+{
+
+namespace {
+
+struct Record {
+    qint64 timestampMs = 0;
+    Level level = Debug;
+    const char* category = "";
+    quintptr threadId = 0;
+    QString message;
+    QList<QPair<const char*, QString>> fields;
+};
+
+// 有界多生产者队列(Dmitry Vyukov的MPMC环形队列)：每个槽位带序号，入队只有一次CAS，
+// 出队只有后台写线程一个消费者
+class RecordQueue
+{
+public:
+    explicit RecordQueue(int capacity)
+    {
+        size_t size = 1;
+        while (size < size_t(qMax(64, capacity))) {
+            size <<= 1;
+        }
+        m_mask = size - 1;
+        m_cells.reset(new Cell[size]);
+        for (size_t i = 0; i < size; ++i) {
+            m_cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    bool push(Record&& record)
+    {
+        size_t position = m_enqueuePosition.load(std::memory_order_relaxed);
+        Cell* cell = nullptr;
+        for (;;) {
+            cell = &m_cells[position & m_mask];
+            size_t sequence = cell->sequence.load(std::memory_order_acquire);
+            intptr_t difference = intptr_t(sequence) - intptr_t(position);
+            if (difference == 0) {
+                if (m_enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (difference < 0) {
+                return false;   // 队列已满
+            } else {
+                position = m_enqueuePosition.load(std::memory_order_relaxed);
+            }
+        }
+        cell->record = std::move(record);
+        cell->sequence.store(position + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool pop(Record* record)
+    {
+        Cell& cell = m_cells[m_dequeuePosition & m_mask];
+        if (cell.sequence.load(std::memory_order_acquire) != m_dequeuePosition + 1) {
+            return false;
+        }
+        *record = std::move(cell.record);
+        cell.record = Record();
+        cell.sequence.store(m_dequeuePosition + m_mask + 1, std::memory_order_release);
+        m_dequeuePosition++;
+        return true;
+    }
+
+private:
+    struct Cell {
+        std::atomic<size_t> sequence{ 0 };
+        Record record;
+    };
+
+    std::unique_ptr<Cell[]> m_cells;
+    size_t m_mask = 0;
+    alignas(64) std::atomic<size_t> m_enqueuePosition{ 0 };
+    alignas(64) size_t m_dequeuePosition = 0;
+};
+
+struct Logger {
+    explicit Logger(const Config& cfg) : config(cfg), queue(cfg.queueCapacity) {}
+
+    Config config;
+    RecordQueue queue;
+    std::thread writer;
+    std::mutex wakeMutex;
+    std::condition_variable wake;
+    std::atomic<bool> writerSleeping{ false };
+    std::atomic<bool> stopping{ false };
+
+    std::atomic<quint64> enqueued{ 0 };
+    std::atomic<quint64> dropped{ 0 };
+    std::atomic<quint64> written{ 0 };
+    std::atomic<quint64> rotations{ 0 };
+    QtMessageHandler previousHandler = nullptr;
+
+    // 以下只在写线程中访问
+    QFile file;
+    qint64 fileBytes = 0;
+    quint64 reportedDropped = 0;
+};
+
+// 日志器一经创建不再释放，关闭后仍可能有其他线程持有指针
+std::atomic<Logger*> g_logger(nullptr);
+
+std::vector<Category*>& categories()
+{
+    static std::vector<Category*> list;
+    return list;
+}
+
+const char* const LevelNames[] = { "trace", "debug", "info", "warning", "error" };
+const char LevelLetters[] = { 'T', 'D', 'I', 'W', 'E' };
+
+void submit(Record&& record)
+{
+    Logger* logger = g_logger.load(std::memory_order_acquire);
+    if (!logger) {
+        // 未启动或已关闭：直接同步输出
+        QByteArray text = QString("%1 %2: %3\n").arg(QChar::fromLatin1(LevelLetters[record.level]))
+                              .arg(QLatin1String(record.category)).arg(record.message).toUtf8();
+        fwrite(text.constData(), 1, size_t(text.size()), stderr);
+        return;
+    }
+
+    Level level = record.level;
+    if (!logger->queue.push(std::move(record))) {
+        logger->dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    logger->enqueued.fetch_add(1, std::memory_order_relaxed);
+
+    // 写线程在等待时才需要唤醒；错过的唤醒最多延迟一个等待周期
+    if (level >= Error || logger->writerSleeping.load(std::memory_order_relaxed)) {
+        logger->wake.notify_one();
+    }
+}
+
+QString rotatedPath(const QString& path, int index)
+{
+    QFileInfo info(path);
+    return info.dir().filePath(QString("%1.%2.%3").arg(info.completeBaseName()).arg(index).arg(info.suffix()));
+}
+
+void openLogFile(Logger* logger)
+{
+    logger->file.setFileName(logger->config.filePath);
+    if (!logger->file.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        fprintf(stderr, "无法打开日志文件: %s\n", qPrintable(logger->config.filePath));
+        return;
+    }
+    logger->fileBytes = logger->file.size();
+}
+
+void rotate(Logger* logger)
+{
+    logger->file.close();
+    const QString& path = logger->config.filePath;
+    QFile::remove(rotatedPath(path, logger->config.maxFiles - 1));
+    for (int index = logger->config.maxFiles - 2; index >= 1; --index) {
+        QFile::rename(rotatedPath(path, index), rotatedPath(path, index + 1));
+    }
+    if (logger->config.maxFiles > 1) {
+        QFile::rename(path, rotatedPath(path, 1));
+    } else {
+        QFile::remove(path);
+    }
+    logger->rotations.fetch_add(1, std::memory_order_relaxed);
+    openLogFile(logger);
+}
+
+void writeRecord(Logger* logger, const Record& record)
+{
+    QDateTime time = QDateTime::fromMSecsSinceEpoch(record.timestampMs);
+
+    if (logger->config.console) {
+        QString line = QString("%1 %2 %3: %4").arg(time.toString("HH:mm:ss.zzz"))
+                           .arg(QChar::fromLatin1(LevelLetters[record.level])).arg(QLatin1String(record.category))
+                           .arg(record.message);
+        for (const auto& field : record.fields) {
+            line += QString(" %1=%2").arg(QLatin1String(field.first)).arg(field.second);
+        }
+        line += '\n';
+        QByteArray text = line.toUtf8();
+        fwrite(text.constData(), 1, size_t(text.size()), stderr);
+    }
+
+    if (!logger->file.isOpen()) {
+        return;
+    }
+
+    QJsonObject json;
+    json["ts"] = time.toString(Qt::ISODateWithMs);
+    json["level"] = LevelNames[record.level];
+    json["cat"] = QLatin1String(record.category);
+    json["tid"] = QString::number(record.threadId, 16);
+    json["msg"] = record.message;
+    for (const auto& field : record.fields) {
+        json[QLatin1String(field.first)] = field.second;
+    }
+    QByteArray line = QJsonDocument(json).toJson(QJsonDocument::Compact);
+    line.append('\n');
+
+    if (logger->fileBytes > 0 && logger->fileBytes + line.size() > logger->config.maxFileBytes) {
+        rotate(logger);
+        if (!logger->file.isOpen()) {
+            return;
+        }
+    }
+    logger->file.write(line);
+    logger->fileBytes += line.size();
+}
+
+int drain(Logger* logger)
+{
+    int count = 0;
+    Record record;
+    while (logger->queue.pop(&record)) {
+        writeRecord(logger, record);
+        count++;
+    }
+
+    quint64 dropped = logger->dropped.load(std::memory_order_relaxed);
+    if (dropped != logger->reportedDropped) {
+        Record notice;
+        notice.timestampMs = QDateTime::currentMSecsSinceEpoch();
+        notice.level = Warning;
+        notice.category = "log";
+        notice.message = QString("日志队列已满，丢弃%1条记录").arg(dropped - logger->reportedDropped);
+        logger->reportedDropped = dropped;
+        writeRecord(logger, notice);
+    }
+
+    if (count > 0) {
+        logger->written.fetch_add(quint64(count), std::memory_order_relaxed);
+        fflush(stderr);
+        if (logger->file.isOpen()) {
+            logger->file.flush();
+        }
+    }
+    return count;
+}
+
+void writerLoop(Logger* logger)
+{
+    if (!logger->config.filePath.isEmpty()) {
+        QDir().mkpath(QFileInfo(logger->config.filePath).absolutePath());
+        openLogFile(logger);
+    }
+
+    for (;;) {
+        if (drain(logger) > 0) {
+            continue;
+        }
+        if (logger->stopping.load(std::memory_order_acquire)) {
+            drain(logger);
+            break;
+        }
+        logger->writerSleeping.store(true, std::memory_order_relaxed);
+        {
+            std::unique_lock<std::mutex> lock(logger->wakeMutex);
+            logger->wake.wait_for(lock, std::chrono::milliseconds(50));
+        }
+        logger->writerSleeping.store(false, std::memory_order_relaxed);
+    }
+    logger->file.close();
+}
+
+void messageHandler(QtMsgType type, const QMessageLogContext& context, const QString& message)
+{
+    Level level = Debug;
+    switch (type) {
+    case QtInfoMsg:
+        level = Info;
+        break;
+    case QtWarningMsg:
+        level = Warning;
+        break;
+    case QtCriticalMsg:
+    case QtFatalMsg:
+        level = Error;
+        break;
+    default:
+        break;
+    }
+    if (!qt.isEnabled(level)) {
+        return;
+    }
+
+    Record record;
+    record.timestampMs = QDateTime::currentMSecsSinceEpoch();
+    record.level = level;
+    record.category = qt.name;
+    record.threadId = quintptr(QThread::currentThreadId());
+    record.message = message;
+    if (context.category && strcmp(context.category, "default") != 0) {
+        record.fields.append({ "qt_category", QString::fromLatin1(context.category) });
+    }
+    submit(std::move(record));
+
+    if (type == QtFatalMsg) {
+        // Qt随后会终止进程，先把队列写完
+        shutdown();
+    }
+}
+
+void applyCategoryLevels(const QString& rules)
+{
+    for (const QString& rule : rules.split(',', Qt::SkipEmptyParts)) {
+        QString name = rule.section('=', 0, 0).trimmed();
+        QString value = rule.section('=', 1, 1).trimmed();
+        for (Category* category : categories()) {
+            if (name == QLatin1String(category->name)) {
+                category->setLevel(parseLevel(value, Debug));
+            }
+        }
+    }
+}
+
+} // namespace
+
+Category app("app");
+Category net("net");
+Category camera("camera");
+Category capture("capture");
+Category kiosk("kiosk");
+Category journal("journal");
+Category gate("gate");
+Category qt("qt");
+
+Category::Category(const char* categoryName, Level defaultLevel)
+    : name(categoryName), m_level(defaultLevel)
+{
+    categories().push_back(this);
+}
+
+Config configFromSettings(const QString& defaultFilePath)
+{
+    QSettings settings("FaceAuthTeam", "FaceAuthAccess");
+    Config config;
+    config.level = parseLevel(settings.value("日志级别", "debug").toString(), Debug);
+    if (qEnvironmentVariableIsSet("FACEAUTH_LOG_LEVEL")) {
+        config.level = parseLevel(qEnvironmentVariable("FACEAUTH_LOG_LEVEL"), config.level);
+    }
+    config.categoryLevels = settings.value("日志分类级别").toString();
+    config.filePath = settings.value("日志文件", defaultFilePath).toString();
+    config.maxFileBytes = qint64(qMax(1, settings.value("日志文件大小MB", 5).toInt())) * 1024 * 1024;
+    config.maxFiles = qMax(1, settings.value("日志文件数", 5).toInt());
+    config.console = settings.value("日志输出到控制台", true).toBool();
+    return config;
+}
+
+void start(const Config& config)
+{
+    if (g_logger.load(std::memory_order_acquire)) {
+        return;
+    }
+    setLevel(config.level);
+    applyCategoryLevels(config.categoryLevels);
+
+    Logger* logger = new Logger(config);
+    logger->writer = std::thread(writerLoop, logger);
+    g_logger.store(logger, std::memory_order_release);
+    logger->previousHandler = qInstallMessageHandler(messageHandler);
+}
+
+void shutdown()
+{
+    Logger* logger = g_logger.exchange(nullptr, std::memory_order_acq_rel);
+    if (!logger) {
+        return;
+    }
+    qInstallMessageHandler(logger->previousHandler);
+    logger->stopping.store(true, std::memory_order_release);
+    logger->wake.notify_one();
+    if (logger->writer.joinable() && logger->writer.get_id() != std::this_thread::get_id()) {
+        logger->writer.join();
+    }
+}
+
+void setLevel(Level level)
+{
+    for (Category* category : categories()) {
+        category->setLevel(level);
+    }
+}
+
+Stats stats()
+{
+    Stats result;
+    Logger* logger = g_logger.load(std::memory_order_acquire);
+    if (logger) {
+        result.enqueued = logger->enqueued.load(std::memory_order_relaxed);
+        result.dropped = logger->dropped.load(std::memory_order_relaxed);
+        result.written = logger->written.load(std::memory_order_relaxed);
+        result.rotations = logger->rotations.load(std::memory_order_relaxed);
+    }
+    return result;
+}
+
+Level parseLevel(const QString& text, Level fallback)
+{
+    QString name = text.trimmed().toLower();
+    for (int level = Trace; level <= Error; ++level) {
+        if (name == QLatin1String(LevelNames[level])) {
+            return Level(level);
+        }
+    }
+    return fallback;
+}
+
+const char* levelName(Level level)
+{
+    return LevelNames[level];
+}
+
+bool isSensitiveKey(const QString& key)
+{
+    QString lower = key.toLower();
+    return lower.contains("password") || lower.contains("passwd") || lower.contains("token")
+        || lower.contains("secret") || lower.contains("ticket") || lower.contains("密码");
+}
+
+Field field(const char* key, const QString& value)
+{
+    return Field{ key, isSensitiveKey(QLatin1String(key)) ? QString("***") : value };
+}
+
+Field field(const char* key, const char* value)
+{
+    return field(key, QString::fromUtf8(value));
+}
+
+Field field(const char* key, qint64 value)
+{
+    return field(key, QString::number(value));
+}
+
+Field field(const char* key, int value)
+{
+    return field(key, QString::number(value));
+}
+
+Field field(const char* key, double value)
+{
+    return field(key, QString::number(value, 'f', 3));
+}
+
+Field field(const char* key, bool value)
+{
+    return field(key, QString(value ? "true" : "false"));
+}
+
+QJsonObject redacted(const QJsonObject& object)
+{
+    QJsonObject result;
+    for (auto it = object.constBegin(); it != object.constEnd(); ++it) {
+        if (isSensitiveKey(it.key())) {
+            result[it.key()] = "***";
+        } else if (it.value().isObject()) {
+            result[it.key()] = redacted(it.value().toObject());
+        } else {
+            result[it.key()] = it.value();
+        }
+    }
+    return result;
+}
+
+Line::Line(const Category& category, Level level)
+    : m_category(category), m_level(level)
+{
+    m_debug.emplace(&m_message);
+    m_debug->noquote();
+}
+
+Line::~Line()
+{
+    // 先销毁QDebug，使最后一段输出写入m_message
+    m_debug.reset();
+    if (m_message.endsWith(' ')) {
+        m_message.chop(1);
+    }
+
+    Record record;
+    record.timestampMs = QDateTime::currentMSecsSinceEpoch();
+    record.level = m_level;
+    record.category = m_category.name;
+    record.threadId = quintptr(QThread::currentThreadId());
+    record.message = std::move(m_message);
+    record.fields = std::move(m_fields);
+    submit(std::move(record));
+}
+
+Line& Line::operator<<(const Field& field)
+{
+    m_fields.append({ field.key, field.value });
+    return *this;
+}
+
+Line& Line::operator<<(const QJsonObject& object)
+{
+    *m_debug << QJsonDocument(redacted(object)).toJson(QJsonDocument::Compact);
+    return *this;
+}
+
+}
@@ -0,0 +1,140 @@
+#pragma once
+
+#include <QDebug>
+#include <QJsonObject>
+#include <QList>
+#include <QPair>
+#include <QString>
+#include <atomic>
+#include <optional>
+
+// 异步结构化日志
+//
+// 调用线程只负责格式化消息并用无锁队列(有界MPMC环形队列)提交记录，不做任何I/O；
+// 后台线程批量写入控制台和按大小轮转的日志文件(每行一个JSON对象)。队列写满时丢弃新记录并计数，
+// 热路径永远不会阻塞在磁盘或控制台上。
+//
+// 级别过滤分两层：低于FACEAUTH_LOG_MIN_LEVEL的日志语句在编译期移除；运行期每个分类有独立的级别。
+// 敏感数据只能通过field()/redacted()记录，键名为password、token等的值在构造记录时即被替换，
+// 不会进入队列或日志文件；不要把凭据直接以<<写入消息文本。
+//
+// start()同时安装Qt消息处理函数，其余模块的qDebug()/qWarning()也经过同一队列输出。
+namespace Log
+{
+    enum Level {
+        Trace = 0,
+        Debug,
+        Info,
+        Warning,
+        Error
+    };
+
+    // 分类对象必须是静态存储期的，构造时登记到全局列表以便按名称设置级别
+    class Category
+    {
+    public:
+        explicit Category(const char* name, Level defaultLevel = Debug);
+        bool isEnabled(Level level) const { return level >= m_level.load(std::memory_order_relaxed); }
+        void setLevel(Level level) { m_level.store(level, std::memory_order_relaxed); }
+
+        const char* const name;
+
+    private:
+        std::atomic<int> m_level;
+    };
+
+    // 客户端使用的日志分类
+    extern Category app;
+    extern Category net;
+    extern Category camera;
+    extern Category capture;
+    extern Category kiosk;
+    extern Category journal;
+    extern Category gate;       // 门禁守护进程
+    extern Category qt;         // 经由qDebug()等进入的消息
+
+    struct Config {
+        Level level = Debug;
+        QString categoryLevels;             // 如"net=trace,camera=warning"
+        QString filePath;                   // 为空时只输出到控制台
+        qint64 maxFileBytes = 5 * 1024 * 1024;
+        int maxFiles = 5;                   // 含当前文件
+        bool console = true;
+        int queueCapacity = 8192;
+    };
+
+    struct Stats {
+        quint64 enqueued = 0;
+        quint64 dropped = 0;                // 队列满时丢弃的记录
+        quint64 written = 0;
+        quint64 rotations = 0;
+    };
+
+    // 从QSettings读取日志配置，环境变量FACEAUTH_LOG_LEVEL可覆盖全局级别
+    Config configFromSettings(const QString& defaultFilePath);
+
+    void start(const Config& config);
+    // 写完队列中剩余的记录并停止后台线程
+    void shutdown();
+    void setLevel(Level level);
+    Stats stats();
+
+    Level parseLevel(const QString& text, Level fallback);
+    const char* levelName(Level level);
+
+    // 结构化字段；敏感键名的值被替换为"***"
+    struct Field {
+        const char* key;
+        QString value;
+    };
+    Field field(const char* key, const QString& value);
+    Field field(const char* key, const char* value);
+    Field field(const char* key, qint64 value);
+    Field field(const char* key, int value);
+    Field field(const char* key, double value);
+    Field field(const char* key, bool value);
+
+    // 递归替换JSON中的敏感字段，用于记录请求或响应体
+    QJsonObject redacted(const QJsonObject& object);
+    bool isSensitiveKey(const QString& key);
+
+    // 一条日志语句，析构时提交
+    class Line
+    {
+    public:
+        Line(const Category& category, Level level);
+        ~Line();
+        Line(const Line&) = delete;
+        Line& operator=(const Line&) = delete;
+
+        template <typename T>
+        Line& operator<<(const T& value)
+        {
+            *m_debug << value;
+            return *this;
+        }
+        Line& operator<<(const Field& field);
+        Line& operator<<(const QJsonObject& object);
+
+    private:
+        const Category& m_category;
+        Level m_level;
+        QString m_message;
+        std::optional<QDebug> m_debug;     // 写入m_message，析构时先销毁以完成输出
+        QList<QPair<const char*, QString>> m_fields;
+    };
+}
+
+#ifndef FACEAUTH_LOG_MIN_LEVEL
+#define FACEAUTH_LOG_MIN_LEVEL 0
+#endif
+
+// 编译期级别判断在前，常量条件为假时整条语句(包括参数求值)被编译器移除
+#define FACEAUTH_LOG(category, level) \
+    if ((level) < FACEAUTH_LOG_MIN_LEVEL || !(category).isEnabled(level)) {} else Log::Line(category, level)
+
+#define LOG_TRACE(category) FACEAUTH_LOG(category, Log::Trace)
+#define LOG_DEBUG(category) FACEAUTH_LOG(category, Log::Debug)
+#define LOG_INFO(category) FACEAUTH_LOG(category, Log::Info)
+#define LOG_WARNING(category) FACEAUTH_LOG(category, Log::Warning)
+#define LOG_ERROR(category) FACEAUTH_LOG(category, Log::Error)
@@ -0,0 +1,549 @@
+#include "OfflineJournal.h"
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDebug>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <cstddef>
+#include <cstring>
+
+#ifdef Q_OS_WIN
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <wincrypt.h>
+#include <io.h>
+#else
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cstdio>
+#endif
+
+namespace {
+
+const char FileMagic[4] = { 'F', 'A', 'J', '1' };
+const quint32 FileVersion = 1;
+const quint32 RecordMagic = 0x43455246;    // "FREC"
+const quint32 StatePending = 0;
+const quint32 StateReplayed = 1;
+
+// 文件头，固定64字节
+struct FileHeader {
+    char magic[4];
+    quint32 version;
+    quint64 capacity;
+    quint64 nextSequence;
+    quint64 writeOffset;        // 仅作参考，恢复时以扫描结果为准
+    quint8 reserved[32];
+};
+static_assert(sizeof(FileHeader) == 64, "FileHeader must be 64 bytes");
+
+// 把已写入的文件内容落盘(flush()只把Qt的缓冲区交给操作系统)
+bool syncFile(QFile& file)
+{
+    if (!file.flush()) {
+        return false;
+    }
+#ifdef Q_OS_WIN
+    return FlushFileBuffers(reinterpret_cast<HANDLE>(_get_osfhandle(file.handle()))) != 0;
+#else
+    return ::fsync(file.handle()) == 0;
+#endif
+}
+
+// 原子地用from替换to：任何时刻崩溃，to要么是旧文件要么是新文件。POSIX上还需同步目录，改名本身才会落盘
+bool replaceFile(const QString& from, const QString& to)
+{
+#ifdef Q_OS_WIN
+    return MoveFileExW(reinterpret_cast<const wchar_t*>(from.utf16()), reinterpret_cast<const wchar_t*>(to.utf16()),
+                       MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+    if (::rename(QFile::encodeName(from).constData(), QFile::encodeName(to).constData()) != 0) {
+        return false;
+    }
+    int dir = ::open(QFile::encodeName(QFileInfo(to).absolutePath()).constData(), O_RDONLY | O_DIRECTORY);
+    if (dir < 0 || ::fsync(dir) != 0) {
+        qDebug() << "离线日志目录同步失败，断电时可能回到压缩前的日志";
+    }
+    if (dir >= 0) {
+        ::close(dir);
+    }
+    return true;
+#endif
+}
+
+// 记录头，后接JSON头和图像数据，整条记录按8字节对齐
+struct RecordHeader {
+    quint32 magic;
+    quint32 state;              // 不参与CRC，补发后原地改写
+    quint64 sequence;
+    quint64 dedupKey;
+    qint64 createdMs;
+    quint32 headerSize;
+    quint32 payloadSize;
+    quint32 crc;
+    quint32 reserved;
+};
+static_assert(sizeof(RecordHeader) == 48, "RecordHeader must be 48 bytes");
+
+quint64 alignUp(quint64 value)
+{
+    return (value + 7) & ~quint64(7);
+}
+
+quint32 crc32Update(quint32 crc, const uchar* data, size_t length)
+{
+    static quint32 table[256];
+    static bool initialized = false;
+    if (!initialized) {
+        for (quint32 i = 0; i < 256; ++i) {
+            quint32 c = i;
+            for (int k = 0; k < 8; ++k) {
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : (c >> 1);
+            }
+            table[i] = c;
+        }
+        initialized = true;
+    }
+
+    crc = ~crc;
+    for (size_t i = 0; i < length; ++i) {
+        crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+quint32 recordCrc(const RecordHeader& record, const uchar* body)
+{
+    quint32 crc = 0;
+    crc = crc32Update(crc, reinterpret_cast<const uchar*>(&record.sequence),
+                      offsetof(RecordHeader, crc) - offsetof(RecordHeader, sequence));
+    return crc32Update(crc, body, size_t(record.headerSize) + record.payloadSize);
+}
+
+} // namespace
+
+OfflineJournal::OfflineJournal(const QString& path, qint64 capacityBytes)
+    : m_path(path),
+    m_capacity(capacityBytes),
+    m_data(nullptr),
+    m_writeOffset(sizeof(FileHeader)),
+    m_nextSequence(1)
+{
+}
+
+OfflineJournal::~OfflineJournal()
+{
+    close();
+}
+
+bool OfflineJournal::open(QString* errorMessage)
+{
+    if (isOpen()) {
+        return true;
+    }
+
+    // 压缩文件原子地替换日志，遗留的.compact是压缩中途崩溃的残留(可能不完整)，原日志仍然完好
+    QString compactPath = m_path + ".compact";
+    if (QFileInfo::exists(compactPath)) {
+        QFile::remove(compactPath);
+    }
+
+    if (!mapFile(errorMessage)) {
+        return false;
+    }
+    recover();
+
+    qDebug() << "离线日志已打开:" << m_path << ", 待补发" << m_pending.size()
+             << "条, 已用" << (m_writeOffset - sizeof(FileHeader)) << "/" << m_capacity << "字节";
+    return true;
+}
+
+bool OfflineJournal::mapFile(QString* errorMessage)
+{
+    m_file.setFileName(m_path);
+    bool created = !m_file.exists() || QFileInfo(m_path).size() < qint64(sizeof(FileHeader));
+
+    if (!m_file.open(QIODevice::ReadWrite)) {
+        if (errorMessage) {
+            *errorMessage = m_file.errorString();
+        }
+        return false;
+    }
+
+    if (created) {
+        // 预分配固定容量，之后只在映射区域内写入
+        if (!m_file.resize(m_capacity)) {
+            if (errorMessage) {
+                *errorMessage = m_file.errorString();
+            }
+            m_file.close();
+            return false;
+        }
+    } else {
+        m_capacity = m_file.size();
+    }
+
+    m_data = m_file.map(0, m_capacity);
+    if (!m_data) {
+        if (errorMessage) {
+            *errorMessage = m_file.errorString();
+        }
+        m_file.close();
+        return false;
+    }
+
+    FileHeader* header = reinterpret_cast<FileHeader*>(m_data);
+    if (created || memcmp(header->magic, FileMagic, 4) != 0 || header->version != FileVersion) {
+        if (!created) {
+            qDebug() << "离线日志文件头无效，重新初始化:" << m_path;
+        }
+        memset(m_data, 0, sizeof(FileHeader) + sizeof(RecordHeader));
+        memcpy(header->magic, FileMagic, 4);
+        header->version = FileVersion;
+        header->capacity = quint64(m_capacity);
+        header->nextSequence = 1;
+        header->writeOffset = sizeof(FileHeader);
+        flush(0, sizeof(FileHeader) + sizeof(RecordHeader));
+    }
+    return true;
+}
+
+void OfflineJournal::recover()
+{
+    const FileHeader* fileHeader = reinterpret_cast<const FileHeader*>(m_data);
+
+    m_pending.clear();
+    m_pendingKeys.clear();
+
+    quint64 offset = sizeof(FileHeader);
+    quint64 lastSequence = 0;
+    while (offset + sizeof(RecordHeader) <= quint64(m_capacity)) {
+        RecordHeader record;
+        memcpy(&record, m_data + offset, sizeof(record));
+
+        // 序号必须递增，否则是压缩或重置前遗留的旧记录
+        if (record.magic != RecordMagic || record.sequence <= lastSequence) {
+            break;
+        }
+        quint64 size = alignUp(sizeof(RecordHeader) + quint64(record.headerSize) + record.payloadSize);
+        if (offset + size > quint64(m_capacity)) {
+            break;
+        }
+        if (recordCrc(record, m_data + offset + sizeof(RecordHeader)) != record.crc) {
+            qDebug() << "离线日志在偏移" << offset << "处发现不完整记录，已截断";
+            break;
+        }
+
+        if (record.state == StatePending) {
+            m_pending[offset] = PendingRecord{ record.sequence, record.dedupKey, size };
+            m_pendingKeys.insert(record.dedupKey);
+        }
+        lastSequence = record.sequence;
+        offset += size;
+    }
+
+    m_writeOffset = offset;
+    m_nextSequence = qMax(fileHeader->nextSequence, lastSequence + 1);
+
+    // 写入结束标记，防止后续扫描越过截断点
+    if (m_writeOffset + sizeof(quint32) <= quint64(m_capacity)) {
+        memset(m_data + m_writeOffset, 0, sizeof(quint32));
+        flush(qint64(m_writeOffset), sizeof(quint32));
+    }
+}
+
+void OfflineJournal::close()
+{
+    if (m_data) {
+        m_file.unmap(m_data);
+        m_data = nullptr;
+    }
+    if (m_file.isOpen()) {
+        m_file.close();
+    }
+}
+
+OfflineJournal::AppendResult OfflineJournal::append(const QJsonObject& header, const QByteArray& payload)
+{
+    if (!isOpen()) {
+        return AppendResult::Error;
+    }
+
+    quint64 dedupKey = dedupKeyFor(header, payload);
+    if (m_pendingKeys.contains(dedupKey)) {
+        m_stats.deduplicated++;
+        return AppendResult::Duplicate;
+    }
+
+    QByteArray json = QJsonDocument(header).toJson(QJsonDocument::Compact);
+    quint64 size = alignUp(sizeof(RecordHeader) + quint64(json.size()) + quint64(payload.size()));
+    if (m_writeOffset + size > quint64(m_capacity)) {
+        m_stats.rejectedFull++;
+        return AppendResult::Full;
+    }
+
+    // 先写入数据，再写入带CRC的记录头；崩溃时CRC不匹配的记录会被丢弃
+    uchar* record = m_data + m_writeOffset;
+    uchar* body = record + sizeof(RecordHeader);
+    memcpy(body, json.constData(), size_t(json.size()));
+    if (!payload.isEmpty()) {
+        memcpy(body + json.size(), payload.constData(), size_t(payload.size()));
+    }
+
+    RecordHeader recordHeader;
+    memset(&recordHeader, 0, sizeof(recordHeader));
+    recordHeader.magic = RecordMagic;
+    recordHeader.state = StatePending;
+    recordHeader.sequence = m_nextSequence;
+    recordHeader.dedupKey = dedupKey;
+    recordHeader.createdMs = QDateTime::currentMSecsSinceEpoch();
+    recordHeader.headerSize = quint32(json.size());
+    recordHeader.payloadSize = quint32(payload.size());
+    recordHeader.crc = recordCrc(recordHeader, body);
+    memcpy(record, &recordHeader, sizeof(recordHeader));
+
+    quint64 flushLength = size;
+    if (m_writeOffset + size + sizeof(quint32) <= quint64(m_capacity)) {
+        memset(record + size, 0, sizeof(quint32));
+        flushLength += sizeof(quint32);
+    }
+    flush(qint64(m_writeOffset), qint64(flushLength));
+
+    m_pending[m_writeOffset] = PendingRecord{ m_nextSequence, dedupKey, size };
+    m_pendingKeys.insert(dedupKey);
+    m_writeOffset += size;
+    m_nextSequence++;
+
+    FileHeader* fileHeader = reinterpret_cast<FileHeader*>(m_data);
+    fileHeader->nextSequence = m_nextSequence;
+    fileHeader->writeOffset = m_writeOffset;
+    flush(0, sizeof(FileHeader));
+
+    m_stats.appended++;
+    return AppendResult::Appended;
+}
+
+QList<OfflineJournal::Entry> OfflineJournal::pendingEntries(int maxCount, const QSet<quint64>& exclude) const
+{
+    QList<Entry> entries;
+    if (!isOpen()) {
+        return entries;
+    }
+
+    for (auto it = m_pending.begin(); it != m_pending.end() && entries.size() < maxCount; ++it) {
+        if (exclude.contains(it->first)) {
+            continue;
+        }
+
+        RecordHeader record;
+        memcpy(&record, m_data + it->first, sizeof(record));
+        const char* body = reinterpret_cast<const char*>(m_data + it->first + sizeof(RecordHeader));
+
+        Entry entry;
+        entry.offset = it->first;
+        entry.sequence = record.sequence;
+        entry.createdMs = record.createdMs;
+        entry.header = QJsonDocument::fromJson(QByteArray(body, int(record.headerSize))).object();
+        entry.payload = QByteArray(body + record.headerSize, int(record.payloadSize));
+        entries.append(entry);
+    }
+    return entries;
+}
+
+void OfflineJournal::markReplayed(quint64 offset)
+{
+    auto it = m_pending.find(offset);
+    if (!isOpen() || it == m_pending.end()) {
+        return;
+    }
+
+    RecordHeader* record = reinterpret_cast<RecordHeader*>(m_data + offset);
+    record->state = StateReplayed;
+    flush(qint64(offset), sizeof(RecordHeader));
+
+    m_pendingKeys.remove(it->second.dedupKey);
+    m_pending.erase(it);
+    m_stats.replayed++;
+
+    // 全部补发完成时直接从头开始写，无需重写文件
+    if (m_pending.empty()) {
+        m_writeOffset = sizeof(FileHeader);
+        memset(m_data + m_writeOffset, 0, sizeof(quint32));
+        flush(qint64(m_writeOffset), sizeof(quint32));
+
+        FileHeader* fileHeader = reinterpret_cast<FileHeader*>(m_data);
+        fileHeader->writeOffset = m_writeOffset;
+        flush(0, sizeof(FileHeader));
+    }
+}
+
+bool OfflineJournal::compact()
+{
+    if (!isOpen()) {
+        return false;
+    }
+
+    quint64 pendingBytes = 0;
+    for (const auto& item : m_pending) {
+        pendingBytes += item.second.size;
+    }
+    if (pendingBytes == m_writeOffset - sizeof(FileHeader)) {
+        return true; // 没有可回收的空间
+    }
+
+    // 将待补发记录写入新文件并落盘后原子替换旧文件，任何时刻崩溃都不会丢失记录
+    QString compactPath = m_path + ".compact";
+    QFile compactFile(compactPath);
+    if (!compactFile.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qDebug() << "离线日志压缩失败:" << compactFile.errorString();
+        return false;
+    }
+
+    FileHeader fileHeader;
+    memset(&fileHeader, 0, sizeof(fileHeader));
+    memcpy(fileHeader.magic, FileMagic, 4);
+    fileHeader.version = FileVersion;
+    fileHeader.capacity = quint64(m_capacity);
+    fileHeader.nextSequence = m_nextSequence;
+    fileHeader.writeOffset = sizeof(FileHeader) + pendingBytes;
+
+    bool ok = compactFile.write(reinterpret_cast<const char*>(&fileHeader), sizeof(fileHeader)) == qint64(sizeof(fileHeader));
+    for (const auto& item : m_pending) {
+        if (!ok) {
+            break;
+        }
+        qint64 size = qint64(item.second.size);
+        ok = compactFile.write(reinterpret_cast<const char*>(m_data + item.first), size) == size;
+    }
+    const quint32 terminator = 0;
+    ok = ok && compactFile.write(reinterpret_cast<const char*>(&terminator), sizeof(terminator)) == qint64(sizeof(terminator));
+    ok = ok && compactFile.resize(m_capacity) && syncFile(compactFile);
+    compactFile.close();
+
+    if (!ok) {
+        qDebug() << "离线日志压缩失败:" << compactFile.errorString();
+        QFile::remove(compactPath);
+        return false;
+    }
+
+    // Windows上映射中的文件不能被替换，先关闭；替换失败时重新打开的仍是原日志
+    close();
+    if (!replaceFile(compactPath, m_path)) {
+        qDebug() << "离线日志压缩后替换失败，继续使用原日志";
+        QFile::remove(compactPath);
+    }
+
+    QString error;
+    if (!open(&error)) {
+        qDebug() << "离线日志压缩后重新打开失败:" << error;
+        return false;
+    }
+    m_stats.compactions++;
+    return true;
+}
+
+OfflineJournal::Stats OfflineJournal::stats() const
+{
+    Stats stats = m_stats;
+    stats.capacityBytes = quint64(m_capacity);
+    stats.usedBytes = m_writeOffset - sizeof(FileHeader);
+    stats.pendingRecords = m_pending.size();
+    for (const auto& item : m_pending) {
+        stats.pendingBytes += item.second.size;
+    }
+    return stats;
+}
+
+void OfflineJournal::flush(qint64 offset, qint64 length)
+{
+    if (!m_data || length <= 0) {
+        return;
+    }
+#ifdef Q_OS_WIN
+    FlushViewOfFile(m_data + offset, static_cast<SIZE_T>(length));
+#else
+    static const qint64 pageSize = sysconf(_SC_PAGESIZE);
+    qint64 start = offset - offset % pageSize;
+    msync(m_data + start, size_t(length + (offset - start)), MS_SYNC);
+#endif
+}
+
+bool OfflineJournal::canProtectSecrets()
+{
+#ifdef Q_OS_WIN
+    return true;
+#else
+    // 没有系统密钥服务，见头文件说明
+    return false;
+#endif
+}
+
+#ifdef Q_OS_WIN
+namespace {
+
+// 附加熵把密文限定在本程序的离线日志中使用
+const char SecretEntropy[] = "FaceAuthAccess/OfflineJournal";
+
+} // namespace
+#endif
+
+bool OfflineJournal::protectSecret(const QString& secret, QString* sealed)
+{
+#ifdef Q_OS_WIN
+    QByteArray plain = secret.toUtf8();
+    DATA_BLOB input{ DWORD(plain.size()), reinterpret_cast<BYTE*>(plain.data()) };
+    DATA_BLOB entropy{ DWORD(sizeof(SecretEntropy) - 1), reinterpret_cast<BYTE*>(const_cast<char*>(SecretEntropy)) };
+    DATA_BLOB output{ 0, nullptr };
+    bool ok = CryptProtectData(&input, nullptr, &entropy, nullptr, nullptr, CRYPTPROTECT_UI_FORBIDDEN, &output) != 0;
+    SecureZeroMemory(plain.data(), size_t(plain.size()));
+    if (!ok) {
+        return false;
+    }
+    *sealed = QString::fromLatin1(QByteArray(reinterpret_cast<const char*>(output.pbData), int(output.cbData)).toBase64());
+    LocalFree(output.pbData);
+    return true;
+#else
+    Q_UNUSED(secret);
+    Q_UNUSED(sealed);
+    return false;
+#endif
+}
+
+bool OfflineJournal::revealSecret(const QString& sealed, QString* secret)
+{
+#ifdef Q_OS_WIN
+    QByteArray cipher = QByteArray::fromBase64(sealed.toLatin1());
+    DATA_BLOB input{ DWORD(cipher.size()), reinterpret_cast<BYTE*>(cipher.data()) };
+    DATA_BLOB entropy{ DWORD(sizeof(SecretEntropy) - 1), reinterpret_cast<BYTE*>(const_cast<char*>(SecretEntropy)) };
+    DATA_BLOB output{ 0, nullptr };
+    if (!CryptUnprotectData(&input, nullptr, &entropy, nullptr, nullptr, CRYPTPROTECT_UI_FORBIDDEN, &output)) {
+        return false;
+    }
+    *secret = QString::fromUtf8(reinterpret_cast<const char*>(output.pbData), int(output.cbData));
+    SecureZeroMemory(output.pbData, output.cbData);
+    LocalFree(output.pbData);
+    return true;
+#else
+    Q_UNUSED(sealed);
+    Q_UNUSED(secret);
+    return false;
+#endif
+}
+
+quint64 OfflineJournal::dedupKeyFor(const QJsonObject& header, const QByteArray& payload)
+{
+    // 同一用户、同一类型、同一张图像视为重复请求
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(header.value("type").toString().toUtf8());
+    hash.addData(QByteArrayView("\n"));
+    hash.addData(header.value("username").toString().toUtf8());
+    hash.addData(QByteArrayView("\n"));
+    hash.addData(payload);
+
+    quint64 key = 0;
+    memcpy(&key, hash.result().constData(), sizeof(key));
+    return key;
+}
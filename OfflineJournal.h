@@ -0,0 +1,98 @@
+#pragma once
+
+#include <QFile>
+#include <QJsonObject>
+#include <QList>
+#include <QSet>
+#include <QString>
+#include <map>
+
+// 离线请求日志：只追加、内存映射的持久化队列
+//
+// 网络不可用时保存待发送的请求(JSON头和人脸图像)，恢复连接后由JournalReplayer补发。
+// 每条记录带CRC校验和递增序号，进程崩溃后重新打开时从头扫描，
+// 遇到不完整或过期的记录即截断，已写入的完整记录不会丢失。
+// 文件在创建时预分配固定容量，写满后拒绝新记录，因此磁盘占用有上界。
+class OfflineJournal
+{
+public:
+    struct Entry {
+        quint64 offset = 0;         // 记录在文件中的偏移，作为标识
+        quint64 sequence = 0;
+        qint64 createdMs = 0;
+        QJsonObject header;
+        QByteArray payload;
+    };
+
+    struct Stats {
+        quint64 capacityBytes = 0;
+        quint64 usedBytes = 0;          // 含已补发但尚未压缩的记录
+        quint64 pendingRecords = 0;
+        quint64 pendingBytes = 0;
+        quint64 appended = 0;
+        quint64 deduplicated = 0;       // 因与待补发记录重复而忽略
+        quint64 rejectedFull = 0;       // 因容量不足而拒绝
+        quint64 replayed = 0;
+        quint64 compactions = 0;
+    };
+
+    enum class AppendResult {
+        Appended,
+        Duplicate,
+        Full,
+        Error
+    };
+
+    explicit OfflineJournal(const QString& path, qint64 capacityBytes = 64 * 1024 * 1024);
+    ~OfflineJournal();
+
+    bool open(QString* errorMessage = nullptr);
+    void close();
+    bool isOpen() const { return m_data != nullptr; }
+
+    AppendResult append(const QJsonObject& header, const QByteArray& payload);
+
+    // 按写入顺序返回最多maxCount条待补发记录，跳过exclude中的偏移
+    QList<Entry> pendingEntries(int maxCount, const QSet<quint64>& exclude = QSet<quint64>()) const;
+
+    // 标记记录已补发(服务器已给出最终响应)
+    void markReplayed(quint64 offset);
+
+    // 将待补发记录重写到新文件中，回收已补发记录占用的空间
+    bool compact();
+
+    bool hasPending() const { return !m_pending.empty(); }
+    Stats stats() const;
+
+    // 记录中的密码等凭据不能明文落盘：用操作系统保护的密钥加密(Windows为当前用户的DPAPI)，
+    // 只有同一用户在本机上才能解密。平台不支持时返回false，调用方不应写入该记录。
+    // 目前只有Windows支持。Linux上没有不依赖桌面会话的系统密钥服务(libsecret需要登录的钥匙串，
+    // 门禁控制器上通常没有)，把密钥放在同一磁盘上的文件里也不比明文安全多少，所以不提供：
+    // Linux上(包括门禁守护进程)注册请求离线时直接失败、不写入日志，不含密码的审计记录不受影响。
+    // FaceAuthCore启动时会在日志中提示一次
+    static bool canProtectSecrets();
+    static bool protectSecret(const QString& secret, QString* sealed);
+    static bool revealSecret(const QString& sealed, QString* secret);
+
+private:
+    struct PendingRecord {
+        quint64 sequence;
+        quint64 dedupKey;
+        quint64 size;
+    };
+
+    bool mapFile(QString* errorMessage);
+    void recover();
+    void flush(qint64 offset, qint64 length);
+    static quint64 dedupKeyFor(const QJsonObject& header, const QByteArray& payload);
+
+    QString m_path;
+    qint64 m_capacity;
+    QFile m_file;
+    uchar* m_data;
+    quint64 m_writeOffset;
+    quint64 m_nextSequence;
+    std::map<quint64, PendingRecord> m_pending;     // 按偏移排序即按写入顺序
+    QSet<quint64> m_pendingKeys;
+    Stats m_stats;
+};
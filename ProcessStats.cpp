@@ -0,0 +1,87 @@
+#include "ProcessStats.h"
+#include <QByteArray>
+#include <QFile>
+#include <QList>
+
+#if defined(Q_OS_WIN)
+#include <windows.h>
+#include <psapi.h>
+#elif defined(Q_OS_UNIX)
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+namespace ProcessStats
+{
+
+#if defined(Q_OS_WIN)
+static qint64 fileTimeTo100ns(const FILETIME& time)
+{
+    return (qint64(time.dwHighDateTime) << 32) | time.dwLowDateTime;
+}
+#endif
+
+Sample sample()
+{
+    Sample result;
+
+#if defined(Q_OS_WIN)
+    PROCESS_MEMORY_COUNTERS memory;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &memory, sizeof(memory))) {
+        result.rssKb = qint64(memory.WorkingSetSize / 1024);
+        result.peakRssKb = qint64(memory.PeakWorkingSetSize / 1024);
+    }
+
+    FILETIME creation, exit, kernel, user, now;
+    if (GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user)) {
+        result.cpuUserMs = fileTimeTo100ns(user) / 10000;
+        result.cpuSystemMs = fileTimeTo100ns(kernel) / 10000;
+        GetSystemTimeAsFileTime(&now);
+        result.uptimeMs = (fileTimeTo100ns(now) - fileTimeTo100ns(creation)) / 10000;
+    }
+#elif defined(Q_OS_UNIX)
+    rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+        result.cpuUserMs = qint64(usage.ru_utime.tv_sec) * 1000 + usage.ru_utime.tv_usec / 1000;
+        result.cpuSystemMs = qint64(usage.ru_stime.tv_sec) * 1000 + usage.ru_stime.tv_usec / 1000;
+#if defined(Q_OS_MACOS)
+        result.peakRssKb = usage.ru_maxrss / 1024;     // macOS以字节为单位
+#else
+        result.peakRssKb = usage.ru_maxrss;
+#endif
+    }
+
+#if defined(Q_OS_LINUX)
+    // /proc/self/status: "VmRSS:     12345 kB"
+    QFile status("/proc/self/status");
+    if (status.open(QIODevice::ReadOnly)) {
+        for (const QByteArray& line : status.readAll().split('\n')) {
+            if (line.startsWith("VmRSS:")) {
+                result.rssKb = line.mid(6).trimmed().split(' ').value(0).toLongLong();
+            } else if (line.startsWith("VmHWM:")) {
+                result.peakRssKb = line.mid(6).trimmed().split(' ').value(0).toLongLong();
+            }
+        }
+    }
+
+    // 进程启动时刻(开机后的时钟滴答数)是/proc/self/stat的第22个字段；进程名可能含空格，从最后一个')'之后计数
+    QFile stat("/proc/self/stat");
+    QFile uptime("/proc/uptime");
+    if (stat.open(QIODevice::ReadOnly) && uptime.open(QIODevice::ReadOnly)) {
+        QByteArray statLine = stat.readAll();
+        QList<QByteArray> fields = statLine.mid(statLine.lastIndexOf(')') + 2).split(' ');
+        long ticksPerSecond = sysconf(_SC_CLK_TCK);
+        bool ok = false;
+        double systemUptime = uptime.readAll().split(' ').value(0).toDouble(&ok);
+        if (fields.size() > 19 && ticksPerSecond > 0 && ok) {
+            qint64 startedMs = fields.at(19).toLongLong() * 1000 / ticksPerSecond;
+            result.uptimeMs = qint64(systemUptime * 1000.0) - startedMs;
+        }
+    }
+#endif
+#endif
+
+    return result;
+}
+
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <QtGlobal>
+
+// 进程资源占用采样：常驻内存、CPU时间和启动耗时，用于比较图形客户端和无界面守护进程的开销
+namespace ProcessStats
+{
+    struct Sample {
+        qint64 rssKb = -1;          // 当前常驻内存(Windows为工作集)，无法获取时为-1
+        qint64 peakRssKb = -1;      // 峰值常驻内存
+        qint64 cpuUserMs = 0;
+        qint64 cpuSystemMs = 0;
+        qint64 uptimeMs = -1;       // 进程创建至今，含main()之前的动态库加载和静态初始化
+    };
+
+    Sample sample();
+}
@@ -1,10 +1,37 @@
 #include "ServerSettingsDialog.h"
+#include "EndpointManager.h"
 #include <QVBoxLayout>
 #include <QHBoxLayout>
 #include <QFormLayout>
 #include <QTcpSocket>
+#include <QSslSocket>
+#include <QSslCertificate>
+#include <QElapsedTimer>
+#include <QFileDialog>
 #include <QTimer>
+#include <memory>
 #include <QMessageBox>
+#include <QHeaderView>
+
+namespace {
+
+enum EndpointColumn {
+    AddressColumn,
+    PortColumn,
+    HealthColumn,
+    RttColumn,
+    ProtocolColumn,
+    P95Column,
+    ProbeColumn,
+    EndpointColumnCount
+};
+
+QString formatMs(double ms)
+{
+    return ms < 0 ? QString("-") : QString::number(ms, 'f', 1);
+}
+
+} // namespace
 
 ServerSettingsDialog::ServerSettingsDialog(QWidget* parent)
     : ServerSettingsDialog("", 8101, parent)
@@ -12,32 +39,55 @@ ServerSettingsDialog::ServerSettingsDialog(QWidget* parent)
 }
 
 ServerSettingsDialog::ServerSettingsDialog(const QString& serverAddress, int serverPort, QWidget* parent)
-    : QDialog(parent)
+    : QDialog(parent),
+    m_endpointManager(nullptr)
 {
     setWindowTitle("服务器设置");   
-    setMinimumWidth(400);
+    setMinimumWidth(640);
     
-    // 创建控件
-    m_serverAddressEdit = new QLineEdit(this);
-    m_serverPortSpinBox = new QSpinBox(this);
-    m_serverPortSpinBox->setRange(1, 65535);
-    m_serverPortSpinBox->setValue(serverPort);
+    // 创建控件：服务器列表，地址和端口可编辑，其余列为探测统计
+    m_endpointTable = new QTableWidget(0, EndpointColumnCount, this);
+    m_endpointTable->setHorizontalHeaderLabels({ "地址", "端口", "状态", "RTT(ms)", "协议延迟(ms)", "P95(ms)", "探测/失败" });
+    m_endpointTable->horizontalHeader()->setSectionResizeMode(AddressColumn, QHeaderView::Stretch);
+    m_endpointTable->verticalHeader()->setVisible(false);
+    m_endpointTable->setSelectionBehavior(QAbstractItemView::SelectRows);
+    m_endpointTable->setSelectionMode(QAbstractItemView::SingleSelection);
+    m_addEndpointButton = new QPushButton("添加", this);
+    m_removeEndpointButton = new QPushButton("删除", this);
     
     if (!serverAddress.isEmpty()) {
-        m_serverAddressEdit->setText(serverAddress);
+        appendEndpointRow(serverAddress, serverPort);
     }
     
+    // TLS设置
+    m_tlsCheckBox = new QCheckBox("启用TLS加密", this);
+    m_caCertificateEdit = new QLineEdit(this);
+    m_caCertificateEdit->setPlaceholderText("可选，自签名证书的CA文件(PEM)");
+    m_browseCaButton = new QPushButton("浏览...", this);
+    m_tlsPeerNameEdit = new QLineEdit(this);
+    m_tlsPeerNameEdit->setPlaceholderText("可选，默认使用服务器地址");
+    
     m_okButton = new QPushButton("确定", this);
     m_cancelButton = new QPushButton("取消", this);
-    m_testConnectionButton = new QPushButton("测试Socket连接", this);
+    m_testConnectionButton = new QPushButton("测试选中的服务器", this);
     
     m_statusLabel = new QLabel("", this);
     m_statusLabel->setWordWrap(true);
     
     // 创建表单布局
+    QHBoxLayout* endpointButtonLayout = new QHBoxLayout;
+    endpointButtonLayout->addWidget(m_addEndpointButton);
+    endpointButtonLayout->addWidget(m_removeEndpointButton);
+    endpointButtonLayout->addStretch();
+    
     QFormLayout* formLayout = new QFormLayout;
-    formLayout->addRow("Socket服务器地址:", m_serverAddressEdit);
-    formLayout->addRow("Socket服务器端口:", m_serverPortSpinBox);
+    formLayout->addRow("", m_tlsCheckBox);
+    
+    QHBoxLayout* caLayout = new QHBoxLayout;
+    caLayout->addWidget(m_caCertificateEdit);
+    caLayout->addWidget(m_browseCaButton);
+    formLayout->addRow("CA证书:", caLayout);
+    formLayout->addRow("证书主机名:", m_tlsPeerNameEdit);
     
     // 创建按钮布局
     QHBoxLayout* buttonLayout = new QHBoxLayout;
@@ -48,6 +98,9 @@ ServerSettingsDialog::ServerSettingsDialog(const QString& serverAddress, int ser
     
     // 创建主布局
     QVBoxLayout* mainLayout = new QVBoxLayout(this);
+    mainLayout->addWidget(new QLabel("Socket服务器(按延迟和健康状态自动选择):", this));
+    mainLayout->addWidget(m_endpointTable);
+    mainLayout->addLayout(endpointButtonLayout);
     mainLayout->addLayout(formLayout);
     mainLayout->addWidget(m_statusLabel);
     mainLayout->addLayout(buttonLayout);
@@ -56,6 +109,9 @@ ServerSettingsDialog::ServerSettingsDialog(const QString& serverAddress, int ser
     connect(m_okButton, &QPushButton::clicked, this, &ServerSettingsDialog::onOkClicked);
     connect(m_cancelButton, &QPushButton::clicked, this, &ServerSettingsDialog::onCancelClicked);
     connect(m_testConnectionButton, &QPushButton::clicked, this, &ServerSettingsDialog::onTestConnectionClicked);
+    connect(m_browseCaButton, &QPushButton::clicked, this, &ServerSettingsDialog::onBrowseCaCertificateClicked);
+    connect(m_addEndpointButton, &QPushButton::clicked, this, &ServerSettingsDialog::onAddEndpointClicked);
+    connect(m_removeEndpointButton, &QPushButton::clicked, this, &ServerSettingsDialog::onRemoveEndpointClicked);
     
     // 加载设置
     loadSettings();
@@ -67,16 +123,63 @@ ServerSettingsDialog::~ServerSettingsDialog()
 
 QString ServerSettingsDialog::getServerAddress() const
 {
-    return m_serverAddressEdit->text().trimmed();
+    QString address;
+    int port = 0;
+    return endpointAt(0, &address, &port) ? address : QString();
 }
 
 int ServerSettingsDialog::getServerPort() const
 {
-    return m_serverPortSpinBox->value();
+    QString address;
+    int port = 0;
+    return endpointAt(0, &address, &port) ? port : 8101;
+}
+
+bool ServerSettingsDialog::isTlsEnabled() const
+{
+    return m_tlsCheckBox->isChecked();
+}
+
+QString ServerSettingsDialog::getCaCertificateFile() const
+{
+    return m_caCertificateEdit->text().trimmed();
+}
+
+QString ServerSettingsDialog::getTlsPeerName() const
+{
+    return m_tlsPeerNameEdit->text().trimmed();
+}
+
+void ServerSettingsDialog::setEndpointManager(EndpointManager* manager)
+{
+    m_endpointManager = manager;
+    if (!manager) {
+        return;
+    }
+    connect(manager, &EndpointManager::statsChanged, this, &ServerSettingsDialog::refreshEndpointStats);
+    refreshEndpointStats();
+    manager->probeNow();
 }
 
 void ServerSettingsDialog::onOkClicked()
 {
+    QString address;
+    int port = 0;
+    bool hasEndpoint = false;
+    for (int row = 0; row < m_endpointTable->rowCount(); ++row) {
+        QString portText = m_endpointTable->item(row, PortColumn) ? m_endpointTable->item(row, PortColumn)->text() : QString();
+        if (endpointAt(row, &address, &port)) {
+            hasEndpoint = true;
+        } else if (!address.isEmpty() || !portText.trimmed().isEmpty()) {
+            QMessageBox::warning(this, "服务器设置", QString("第%1行的地址或端口无效。").arg(row + 1));
+            return;
+        }
+    }
+    if (!hasEndpoint) {
+        QMessageBox::warning(this, "服务器设置", "请至少添加一个服务器。");
+        return;
+    }
+    
     // 保存设置
     saveSettings();
     accept();
@@ -89,11 +192,11 @@ void ServerSettingsDialog::onCancelClicked()
 
 void ServerSettingsDialog::onTestConnectionClicked()
 {
-    QString address = m_serverAddressEdit->text().trimmed();
-    int port = m_serverPortSpinBox->value();
-    
-    if (address.isEmpty()) {
-        m_statusLabel->setText("请输入服务器地址。");
+    QString address;
+    int port = 0;
+    int row = qMax(0, m_endpointTable->currentRow());
+    if (!endpointAt(row, &address, &port)) {
+        m_statusLabel->setText("请输入有效的服务器地址和端口。");
         return;
     }
     
@@ -101,15 +204,37 @@ void ServerSettingsDialog::onTestConnectionClicked()
     m_testConnectionButton->setEnabled(false);
     
     // 创建套接字并测试连接
-    QTcpSocket* socket = new QTcpSocket(this);
+    QSslSocket* socket = new QSslSocket(this);
+    bool useTls = m_tlsCheckBox->isChecked();
     
     // 连接超时定时器
     QTimer* timer = new QTimer(this);
     timer->setSingleShot(true);
     
+    // 记录TCP连接和TLS握手耗时
+    auto elapsed = std::make_shared<QElapsedTimer>();
+    auto tcpConnectMs = std::make_shared<qint64>(0);
+    
     // 连接信号槽
-    connect(socket, &QTcpSocket::connected, [this, socket, timer]() {
-        m_statusLabel->setText("Socket连接成功!");
+    connect(socket, &QTcpSocket::connected, [this, socket, timer, useTls, elapsed, tcpConnectMs]() {
+        *tcpConnectMs = elapsed->elapsed();
+        if (useTls) {
+            m_statusLabel->setText(QString("TCP连接成功(%1ms)，正在进行TLS握手...").arg(*tcpConnectMs));
+            return;
+        }
+        m_statusLabel->setText(QString("Socket连接成功! 耗时%1ms").arg(*tcpConnectMs));
+        m_testConnectionButton->setEnabled(true);
+        timer->stop();
+        socket->disconnectFromHost();
+        socket->deleteLater();
+        timer->deleteLater();
+    });
+    
+    connect(socket, &QSslSocket::encrypted, [this, socket, timer, elapsed, tcpConnectMs]() {
+        m_statusLabel->setText(QString("TLS连接成功! TCP %1ms, 握手 %2ms, 加密套件 %3")
+                               .arg(*tcpConnectMs)
+                               .arg(elapsed->elapsed() - *tcpConnectMs)
+                               .arg(socket->sessionCipher().name()));
         m_testConnectionButton->setEnabled(true);
         timer->stop();
         socket->disconnectFromHost();
@@ -135,7 +260,22 @@ void ServerSettingsDialog::onTestConnectionClicked()
     });
     
     // 开始连接
-    socket->connectToHost(address, port);
+    elapsed->start();
+    if (useTls) {
+        QSslConfiguration config = QSslConfiguration::defaultConfiguration();
+        QString caFile = m_caCertificateEdit->text().trimmed();
+        if (!caFile.isEmpty()) {
+            QList<QSslCertificate> caCertificates = config.caCertificates();
+            caCertificates.append(QSslCertificate::fromPath(caFile, QSsl::Pem));
+            config.setCaCertificates(caCertificates);
+        }
+        socket->setSslConfiguration(config);
+        
+        QString peerName = m_tlsPeerNameEdit->text().trimmed();
+        socket->connectToHostEncrypted(address, port, peerName.isEmpty() ? address : peerName);
+    } else {
+        socket->connectToHost(address, port);
+    }
     
     // 启动超时定时器
     timer->start(5000); // 5秒超时
@@ -145,14 +285,119 @@ void ServerSettingsDialog::loadSettings()
 {
     QSettings settings("FaceAuthTeam", "FaceAuthAccess");
     
-    m_serverAddressEdit->setText(settings.value("服务器地址", "142.171.34.18").toString());
-    m_serverPortSpinBox->setValue(settings.value("服务器端口", 8101).toInt());
+    m_endpointTable->setRowCount(0);
+    for (const EndpointManager::Endpoint& endpoint : EndpointManager::loadEndpoints(settings)) {
+        appendEndpointRow(endpoint.host, endpoint.port);
+    }
+    m_tlsCheckBox->setChecked(settings.value("启用TLS", false).toBool());
+    m_caCertificateEdit->setText(settings.value("TLS CA证书").toString());
+    m_tlsPeerNameEdit->setText(settings.value("TLS证书主机名").toString());
 }
 
 void ServerSettingsDialog::saveSettings()
 {
     QSettings settings("FaceAuthTeam", "FaceAuthAccess");
     
-    settings.setValue("服务器地址", m_serverAddressEdit->text().trimmed());
-    settings.setValue("服务器端口", m_serverPortSpinBox->value());
+    QList<EndpointManager::Endpoint> endpoints;
+    for (int row = 0; row < m_endpointTable->rowCount(); ++row) {
+        EndpointManager::Endpoint endpoint;
+        int port = 0;
+        if (endpointAt(row, &endpoint.host, &port)) {
+            endpoint.port = quint16(port);
+            endpoints.append(endpoint);
+        }
+    }
+    EndpointManager::saveEndpoints(settings, endpoints);
+    settings.setValue("启用TLS", m_tlsCheckBox->isChecked());
+    settings.setValue("TLS CA证书", m_caCertificateEdit->text().trimmed());
+    settings.setValue("TLS证书主机名", m_tlsPeerNameEdit->text().trimmed());
+}
+
+void ServerSettingsDialog::onBrowseCaCertificateClicked()
+{
+    QString path = QFileDialog::getOpenFileName(this, "选择CA证书", QString(),
+                                                "证书文件 (*.pem *.crt);;所有文件 (*)");
+    if (!path.isEmpty()) {
+        m_caCertificateEdit->setText(path);
+    }
+}
+
+void ServerSettingsDialog::onAddEndpointClicked()
+{
+    appendEndpointRow(QString(), 8101);
+    int row = m_endpointTable->rowCount() - 1;
+    m_endpointTable->setCurrentCell(row, AddressColumn);
+    m_endpointTable->editItem(m_endpointTable->item(row, AddressColumn));
+}
+
+void ServerSettingsDialog::onRemoveEndpointClicked()
+{
+    int row = m_endpointTable->currentRow();
+    if (row >= 0) {
+        m_endpointTable->removeRow(row);
+    }
+}
+
+void ServerSettingsDialog::refreshEndpointStats()
+{
+    if (!m_endpointManager) {
+        return;
+    }
+    
+    // 按地址和端口匹配，表格中新增、尚未保存的行显示为空
+    EndpointManager::Endpoint active = m_endpointManager->activeEndpoint();
+    QVector<EndpointManager::EndpointStats> allStats = m_endpointManager->stats();
+    for (int row = 0; row < m_endpointTable->rowCount(); ++row) {
+        QString address;
+        int port = 0;
+        const EndpointManager::EndpointStats* stats = nullptr;
+        if (endpointAt(row, &address, &port)) {
+            for (const EndpointManager::EndpointStats& candidate : allStats) {
+                if (candidate.endpoint.port == port
+                    && candidate.endpoint.host.compare(address, Qt::CaseInsensitive) == 0) {
+                    stats = &candidate;
+                    break;
+                }
+            }
+        }
+        
+        QString health = "-";
+        if (stats) {
+            health = EndpointManager::healthText(stats->health);
+            if (stats->endpoint.host == active.host && stats->endpoint.port == active.port) {
+                health += " (当前)";
+            }
+        }
+        m_endpointTable->item(row, HealthColumn)->setText(health);
+        m_endpointTable->item(row, HealthColumn)->setToolTip(stats ? stats->lastError : QString());
+        m_endpointTable->item(row, RttColumn)->setText(stats ? formatMs(stats->rttMs) : "-");
+        m_endpointTable->item(row, ProtocolColumn)->setText(stats ? formatMs(stats->protocolMs) : "-");
+        m_endpointTable->item(row, P95Column)->setText(stats ? formatMs(stats->protocolP95Ms) : "-");
+        m_endpointTable->item(row, ProbeColumn)->setText(
+            stats ? QString("%1/%2").arg(stats->probes).arg(stats->failures) : "-");
+    }
+}
+
+void ServerSettingsDialog::appendEndpointRow(const QString& address, int port)
+{
+    int row = m_endpointTable->rowCount();
+    m_endpointTable->insertRow(row);
+    m_endpointTable->setItem(row, AddressColumn, new QTableWidgetItem(address));
+    m_endpointTable->setItem(row, PortColumn, new QTableWidgetItem(QString::number(port)));
+    for (int column = HealthColumn; column < EndpointColumnCount; ++column) {
+        QTableWidgetItem* item = new QTableWidgetItem("-");
+        item->setFlags(item->flags() & ~Qt::ItemIsEditable);
+        m_endpointTable->setItem(row, column, item);
+    }
+    refreshEndpointStats();
+}
+
+bool ServerSettingsDialog::endpointAt(int row, QString* address, int* port) const
+{
+    QTableWidgetItem* addressItem = m_endpointTable->item(row, AddressColumn);
+    QTableWidgetItem* portItem = m_endpointTable->item(row, PortColumn);
+    *address = addressItem ? addressItem->text().trimmed() : QString();
+    bool ok = false;
+    *port = portItem ? portItem->text().trimmed().toInt(&ok) : 0;
+    return !address->isEmpty() && ok && *port > 0 && *port <= 65535;
 } 
\ No newline at end of file
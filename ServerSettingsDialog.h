@@ -6,6 +6,10 @@
 #include <QSpinBox>
 #include <QPushButton>
 #include <QLabel>
+#include <QCheckBox>
+#include <QTableWidget>
+
+class EndpointManager;
 
 class ServerSettingsDialog : public QDialog
 {
@@ -18,18 +22,36 @@ public:
 
     QString getServerAddress() const;
     int getServerPort() const;
+    bool isTlsEnabled() const;
+    QString getCaCertificateFile() const;
+    QString getTlsPeerName() const;
+
+    // 显示各端点的实时探测统计，打开对话框时立即探测一轮
+    void setEndpointManager(EndpointManager* manager);
 
 private slots:
     void onOkClicked();
     void onCancelClicked();
     void onTestConnectionClicked();
+    void onBrowseCaCertificateClicked();
+    void onAddEndpointClicked();
+    void onRemoveEndpointClicked();
+    void refreshEndpointStats();
 
 private:
     void loadSettings();
     void saveSettings();
+    void appendEndpointRow(const QString& address, int port);
+    bool endpointAt(int row, QString* address, int* port) const;
 
-    QLineEdit* m_serverAddressEdit;
-    QSpinBox* m_serverPortSpinBox;
+    QTableWidget* m_endpointTable;
+    QPushButton* m_addEndpointButton;
+    QPushButton* m_removeEndpointButton;
+    EndpointManager* m_endpointManager;
+    QCheckBox* m_tlsCheckBox;
+    QLineEdit* m_caCertificateEdit;
+    QPushButton* m_browseCaButton;
+    QLineEdit* m_tlsPeerNameEdit;
     QPushButton* m_okButton;
     QPushButton* m_cancelButton;
     QPushButton* m_testConnectionButton;
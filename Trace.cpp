@@ -0,0 +1,251 @@
+#include "Trace.h"
+#include <QCoreApplication>
+#include <QHash>
+#include <QMutex>
+#include <QSaveFile>
+#include <chrono>
+#include <vector>
+
+namespace Trace
+{
+
+#ifndef FACEAUTH_TRACE_DISABLED
+std::atomic<bool> g_enabled(false);
+#endif
+
+namespace {
+
+struct Slot {
+    // 0: 从未写入；奇数: 正在写入；2*index+2: 第index个事件写入完成
+    std::atomic<quint64> sequence{ 0 };
+    const char* name = nullptr;
+    const char* category = nullptr;
+    qint64 timestampUs = 0;
+    qint64 durationUs = 0;
+    qint64 id = 0;
+    qint64 arg = 0;
+    quint32 threadId = 0;
+    char phase = 0;
+};
+
+struct Ring {
+    explicit Ring(int capacity) : slots(capacity), mask(quint64(capacity) - 1) {}
+    std::vector<Slot> slots;
+    const quint64 mask;
+    std::atomic<quint64> head{ 0 };
+};
+
+// 环形缓冲区一经分配不再释放，写入方无需担心缓冲区在写入过程中被回收
+std::atomic<Ring*> g_ring(nullptr);
+QMutex g_setupMutex;
+QHash<quint32, QByteArray> g_threadNames;
+std::atomic<quint32> g_nextThreadId(1);
+
+quint32 currentThreadId()
+{
+    thread_local quint32 id = g_nextThreadId.fetch_add(1, std::memory_order_relaxed);
+    return id;
+}
+
+void record(char phase, const char* name, const char* category, qint64 timestampUs, qint64 durationUs,
+            qint64 id, qint64 arg)
+{
+    if (!enabled()) {
+        return;
+    }
+    Ring* ring = g_ring.load(std::memory_order_acquire);
+    if (!ring) {
+        return;
+    }
+
+    quint64 index = ring->head.fetch_add(1, std::memory_order_relaxed);
+    Slot& slot = ring->slots[index & ring->mask];
+    slot.sequence.store(2 * index + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.name = name;
+    slot.category = category;
+    slot.timestampUs = timestampUs;
+    slot.durationUs = durationUs;
+    slot.id = id;
+    slot.arg = arg;
+    slot.threadId = currentThreadId();
+    slot.phase = phase;
+    slot.sequence.store(2 * index + 2, std::memory_order_release);
+}
+
+void appendJsonString(QByteArray* out, const char* text)
+{
+    out->append('"');
+    for (const char* p = text; p && *p; ++p) {
+        if (*p == '"' || *p == '\\') {
+            out->append('\\');
+        }
+        out->append(*p);
+    }
+    out->append('"');
+}
+
+} // namespace
+
+void setEnabled(bool enable, int capacity)
+{
+#ifdef FACEAUTH_TRACE_DISABLED
+    Q_UNUSED(enable);
+    Q_UNUSED(capacity);
+#else
+    if (enable && !g_ring.load(std::memory_order_acquire)) {
+        QMutexLocker locker(&g_setupMutex);
+        if (!g_ring.load(std::memory_order_relaxed)) {
+            int slots = 1;
+            while (slots < qMax(1024, capacity)) {
+                slots <<= 1;
+            }
+            g_ring.store(new Ring(slots), std::memory_order_release);
+        }
+    }
+    g_enabled.store(enable, std::memory_order_relaxed);
+#endif
+}
+
+Stats stats()
+{
+    Stats result;
+    Ring* ring = g_ring.load(std::memory_order_acquire);
+    if (ring) {
+        result.capacity = int(ring->slots.size());
+        result.recorded = ring->head.load(std::memory_order_relaxed);
+        result.overwritten = result.recorded > ring->slots.size() ? result.recorded - ring->slots.size() : 0;
+    }
+    return result;
+}
+
+qint64 nowUs()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void setThreadName(const char* name)
+{
+    QMutexLocker locker(&g_setupMutex);
+    g_threadNames.insert(currentThreadId(), QByteArray(name));
+}
+
+void complete(const char* name, const char* category, qint64 startUs, qint64 durationUs, qint64 id, qint64 arg)
+{
+    record('X', name, category, startUs, durationUs, id, arg);
+}
+
+void instant(const char* name, const char* category, qint64 id, qint64 arg)
+{
+    if (enabled()) {
+        record('i', name, category, nowUs(), 0, id, arg);
+    }
+}
+
+void asyncBegin(const char* name, const char* category, qint64 id, qint64 timestampUs)
+{
+    if (enabled()) {
+        record('b', name, category, timestampUs > 0 ? timestampUs : nowUs(), 0, id, 0);
+    }
+}
+
+void asyncEnd(const char* name, const char* category, qint64 id, qint64 timestampUs)
+{
+    if (enabled()) {
+        record('e', name, category, timestampUs > 0 ? timestampUs : nowUs(), 0, id, 0);
+    }
+}
+
+void counter(const char* name, qint64 value)
+{
+    if (enabled()) {
+        record('C', name, "counter", nowUs(), 0, 0, value);
+    }
+}
+
+bool exportChromeJson(const QString& path, int* eventCount, QString* errorMessage)
+{
+    Ring* ring = g_ring.load(std::memory_order_acquire);
+    quint64 head = ring ? ring->head.load(std::memory_order_acquire) : 0;
+    quint64 capacity = ring ? ring->slots.size() : 0;
+    quint64 first = head > capacity ? head - capacity : 0;
+    qint64 pid = QCoreApplication::applicationPid();
+
+    QByteArray json;
+    json.reserve(int((head - first) * 120 + 256));
+    json.append("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    int written = 0;
+
+    {
+        QMutexLocker locker(&g_setupMutex);
+        for (auto it = g_threadNames.constBegin(); it != g_threadNames.constEnd(); ++it) {
+            json.append(QString("{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%1,\"tid\":%2,\"args\":{\"name\":")
+                            .arg(pid).arg(it.key()).toUtf8());
+            appendJsonString(&json, it.value().constData());
+            json.append("}},\n");
+        }
+    }
+
+    for (quint64 index = first; index < head; ++index) {
+        const Slot& slot = ring->slots[index & ring->mask];
+        quint64 expected = 2 * index + 2;
+        if (slot.sequence.load(std::memory_order_acquire) != expected) {
+            continue;   // 正在写入或已被更新的事件覆盖
+        }
+        const char* name = slot.name;
+        const char* category = slot.category;
+        qint64 timestampUs = slot.timestampUs;
+        qint64 durationUs = slot.durationUs;
+        qint64 id = slot.id;
+        qint64 arg = slot.arg;
+        quint32 threadId = slot.threadId;
+        char phase = slot.phase;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.sequence.load(std::memory_order_relaxed) != expected) {
+            continue;
+        }
+
+        json.append("{\"name\":");
+        appendJsonString(&json, name);
+        json.append(",\"cat\":");
+        appendJsonString(&json, category);
+        json.append(QString(",\"ph\":\"%1\",\"ts\":%2,\"pid\":%3,\"tid\":%4")
+                        .arg(QChar::fromLatin1(phase)).arg(timestampUs).arg(pid).arg(threadId).toUtf8());
+        if (phase == 'X') {
+            json.append(",\"dur\":" + QByteArray::number(durationUs));
+        } else if (phase == 'i') {
+            json.append(",\"s\":\"t\"");
+        }
+        if (phase == 'b' || phase == 'e') {
+            json.append(",\"id\":" + QByteArray::number(id));
+        }
+        if (phase == 'C') {
+            json.append(",\"args\":{\"value\":" + QByteArray::number(arg) + "}");
+        } else if (id != 0 || arg != 0) {
+            json.append(",\"args\":{\"id\":" + QByteArray::number(id) + ",\"value\":" + QByteArray::number(arg) + "}");
+        }
+        json.append("},\n");
+        written++;
+    }
+
+    // 去掉最后一个逗号
+    if (json.endsWith(",\n")) {
+        json.chop(2);
+    }
+    json.append("\n]}\n");
+
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly) || file.write(json) != json.size() || !file.commit()) {
+        if (errorMessage) {
+            *errorMessage = file.errorString();
+        }
+        return false;
+    }
+    if (eventCount) {
+        *eventCount = written;
+    }
+    return true;
+}
+
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <QString>
+#include <atomic>
+
+// 单次事件级的延迟跟踪，导出为Chrome trace-event JSON(可直接在Perfetto/chrome://tracing中打开)
+//
+// 事件写入固定容量的无锁环形缓冲区：写入方用fetch_add分配槽位，每个槽位带序号(seqlock)，
+// 导出时跳过正在写入或已被覆盖的槽位。缓冲区写满后覆盖最旧的事件，内存占用固定。
+// 未启用时每个跟踪点只有一次relaxed原子读取；定义FACEAUTH_TRACE_DISABLED则在编译期完全移除。
+// 事件名和类别必须是静态字符串(字符串字面量)，记录时不做任何内存分配。
+namespace Trace
+{
+#ifdef FACEAUTH_TRACE_DISABLED
+    constexpr bool enabled() { return false; }
+#else
+    extern std::atomic<bool> g_enabled;
+    inline bool enabled() { return g_enabled.load(std::memory_order_relaxed); }
+#endif
+
+    struct Stats {
+        quint64 recorded = 0;
+        quint64 overwritten = 0;    // 因缓冲区写满被覆盖的事件数
+        int capacity = 0;
+    };
+
+    // 首次启用时分配capacity个槽位(向上取2的幂)，之后容量不变
+    void setEnabled(bool enabled, int capacity = 1 << 16);
+    Stats stats();
+
+    // 单调时钟微秒数，所有事件使用同一时钟
+    qint64 nowUs();
+
+    // 为当前线程命名，显示在跟踪视图的线程标题上
+    void setThreadName(const char* name);
+
+    // 完整事件(ph=X)：startUs开始，持续durationUs
+    void complete(const char* name, const char* category, qint64 startUs, qint64 durationUs,
+                  qint64 id = 0, qint64 arg = 0);
+    // 瞬时事件(ph=i)
+    void instant(const char* name, const char* category, qint64 id = 0, qint64 arg = 0);
+    // 跨线程/跨回调的异步区间(ph=b/e)，同名同id的begin和end配对
+    void asyncBegin(const char* name, const char* category, qint64 id, qint64 timestampUs = 0);
+    void asyncEnd(const char* name, const char* category, qint64 id, qint64 timestampUs = 0);
+    // 计数器(ph=C)
+    void counter(const char* name, qint64 value);
+
+    // 手动计时，用于不适合作用域计时的代码段：start = spanStart(); ...; spanEnd(name, category, start)
+    inline qint64 spanStart() { return enabled() ? nowUs() : -1; }
+    inline void spanEnd(const char* name, const char* category, qint64 startUs, qint64 id = 0)
+    {
+        if (startUs >= 0) {
+            complete(name, category, startUs, nowUs() - startUs, id);
+        }
+    }
+
+    // 导出当前缓冲区中的全部事件；可以在记录的同时调用
+    bool exportChromeJson(const QString& path, int* eventCount = nullptr, QString* errorMessage = nullptr);
+
+    // 作用域计时，析构时记录一个完整事件
+    class Scope
+    {
+    public:
+        Scope(const char* name, const char* category, qint64 id = 0)
+            : m_name(name), m_category(category), m_id(id), m_startUs(enabled() ? nowUs() : -1) {}
+        ~Scope()
+        {
+            if (m_startUs >= 0) {
+                complete(m_name, m_category, m_startUs, nowUs() - m_startUs, m_id);
+            }
+        }
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        const char* m_name;
+        const char* m_category;
+        qint64 m_id;
+        qint64 m_startUs;
+    };
+}
+
+#define FACEAUTH_TRACE_CONCAT_INNER(a, b) a##b
+#define FACEAUTH_TRACE_CONCAT(a, b) FACEAUTH_TRACE_CONCAT_INNER(a, b)
+#define TRACE_SCOPE(name, category) Trace::Scope FACEAUTH_TRACE_CONCAT(traceScope_, __LINE__)(name, category)
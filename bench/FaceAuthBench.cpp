@@ -0,0 +1,552 @@
+// 客户端热路径基准测试
+//
+// 不需要摄像头和显示器(默认使用offscreen平台)，用合成帧覆盖以下操作，每项在多种帧尺寸和像素格式下测量：
+//   mat_to_qimage   : ImageConversion::matToImage(FaceAuthClient::matToQImage的转换部分)
+//   preview_scale   : onFrameAvailable中的预览缩放，打包格式走映射+cv::resize，多平面格式走toImage()回退
+//   capture_encode  : 拍照编码，rgb为toImage() → 缩小 → BGR → imencode，yuv为CaptureEncoder::encodeFrame
+//   build_request   : sendLoginRequest中的请求JSON和FACE封包(含连拍的多帧负载)
+//   parse_response  : processServerResponse中的RESP解析和success判断(单个响应/流水线中的多个响应)
+//   frame_ring      : FaceAuthClient::publishFrame写入共享帧环，publish无读者，slow_reader同时有一个
+//                     零拷贝读取、每帧处理数毫秒的慢读者(写者耗时应与无读者时相同)
+//
+// 每项先预热，再采集若干个样本；单次操作很快时一个样本包含多次调用，取平均。
+// 结果以JSON输出(schema "faceauth-bench/1")，以 name/variant/size 作为比较的键，中位数作为主要指标。
+//
+// 用法: FaceAuthBench [--samples 30] [--filter 子串] [--output result.json]
+//       FaceAuthBench --compare base.json current.json [--threshold 10] [--min-delta-us 1]
+//       比较模式下当前结果的中位数比基线慢超过阈值(百分比)且超过最小差值时标记为回退，存在回退时退出码为1。
+#include "CaptureEncoder.h"
+#include "FaceAuthProtocol.h"
+#include "FrameBufferPool.h"
+#include "FrameRing.h"
+#include "ImageConversion.h"
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QGuiApplication>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMap>
+#include <QPixmap>
+#include <QSysInfo>
+#include <QThread>
+#include <QVideoFrame>
+#include <QVideoFrameFormat>
+#include <opencv2/core.hpp>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <functional>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace {
+
+const char* SchemaName = "faceauth-bench/1";
+
+struct Result {
+    QString name;
+    QString variant;
+    QString size;
+    int samples = 0;
+    int batch = 1;                  // 每个样本包含的调用次数
+    double medianUs = 0.0;
+    double meanUs = 0.0;
+    double p95Us = 0.0;
+    double minUs = 0.0;
+    qint64 bytes = -1;              // 输出数据的字节数(JPEG、数据包等)，没有时为-1
+
+    QString key() const { return name + "/" + variant + "/" + size; }
+};
+
+class Runner
+{
+public:
+    Runner(int samples, const QString& filter)
+        : m_samples(samples), m_filter(filter)
+    {
+    }
+
+    // operation返回输出字节数(没有时返回-1)，同时防止编译器把调用优化掉
+    void run(const QString& name, const QString& variant, const QString& size, const std::function<qint64()>& operation)
+    {
+        Result result;
+        result.name = name;
+        result.variant = variant;
+        result.size = size;
+        if (!m_filter.isEmpty() && !result.key().contains(m_filter)) {
+            return;
+        }
+
+        // 预热：填充缓冲池、加载编码器，同时估算单次耗时以确定每个样本的调用次数
+        QElapsedTimer timer;
+        timer.start();
+        for (int i = 0; i < 3; ++i) {
+            result.bytes = operation();
+        }
+        double warmupUs = timer.nsecsElapsed() / 1e3 / 3;
+        result.batch = warmupUs >= 50.0 ? 1 : int(std::min(10000.0, std::ceil(50.0 / std::max(warmupUs, 0.01))));
+
+        std::vector<double> samples;
+        samples.reserve(m_samples);
+        for (int s = 0; s < m_samples; ++s) {
+            timer.restart();
+            for (int i = 0; i < result.batch; ++i) {
+                operation();
+            }
+            samples.push_back(timer.nsecsElapsed() / 1e3 / result.batch);
+        }
+
+        std::sort(samples.begin(), samples.end());
+        double total = 0.0;
+        for (double sample : samples) {
+            total += sample;
+        }
+        result.samples = int(samples.size());
+        result.medianUs = samples[samples.size() / 2];
+        result.meanUs = total / samples.size();
+        result.p95Us = samples[std::min(samples.size() - 1, size_t(samples.size() * 0.95))];
+        result.minUs = samples.front();
+        m_results.push_back(result);
+
+        std::fprintf(stderr, "%-15s %-12s %-10s %12.2f %12.2f %12.2f %10lld\n", qPrintable(name), qPrintable(variant),
+                     qPrintable(size), result.medianUs, result.p95Us, result.minUs, static_cast<long long>(result.bytes));
+    }
+
+    const std::vector<Result>& results() const { return m_results; }
+
+private:
+    int m_samples;
+    QString m_filter;
+    std::vector<Result> m_results;
+};
+
+QString sizeLabel(const QSize& size)
+{
+    return QString("%1x%2").arg(size.width()).arg(size.height());
+}
+
+// 填充平滑渐变加噪声，JPEG大小接近真实画面
+QVideoFrame makeFrame(const QSize& size, QVideoFrameFormat::PixelFormat format)
+{
+    QVideoFrame frame(QVideoFrameFormat(size, format));
+    if (!frame.map(QVideoFrame::WriteOnly)) {
+        return QVideoFrame();
+    }
+
+    std::mt19937 random(7);
+    std::uniform_int_distribution<int> noise(-12, 12);
+    auto clamp = [](int value) { return uchar(qBound(0, value, 255)); };
+    for (int plane = 0; plane < frame.planeCount(); ++plane) {
+        uchar* bits = frame.bits(plane);
+        int stride = frame.bytesPerLine(plane);
+        int rows = frame.mappedBytes(plane) / stride;
+        for (int y = 0; y < rows; ++y) {
+            for (int x = 0; x < stride; ++x) {
+                int base = plane == 0 ? (x * 255 / stride + y * 128 / rows) / 2 + 40 : 128 + (x - stride / 2) * 40 / stride;
+                bits[y * stride + x] = clamp(base + noise(random));
+            }
+        }
+    }
+    frame.unmap();
+    return frame;
+}
+
+cv::Mat makeMat(const QSize& size, int type)
+{
+    cv::Mat mat(size.height(), size.width(), type);
+    cv::randu(mat, cv::Scalar::all(0), cv::Scalar::all(255));
+    return mat;
+}
+
+const char* formatName(QVideoFrameFormat::PixelFormat format)
+{
+    switch (format) {
+    case QVideoFrameFormat::Format_BGRA8888: return "BGRA";
+    case QVideoFrameFormat::Format_NV12: return "NV12";
+    case QVideoFrameFormat::Format_YUV420P: return "I420";
+    case QVideoFrameFormat::Format_YUYV: return "YUYV";
+    default: return "?";
+    }
+}
+
+const QSize FrameSizes[] = { QSize(640, 480), QSize(1280, 720), QSize(1920, 1080) };
+const QVideoFrameFormat::PixelFormat FrameFormats[] = {
+    QVideoFrameFormat::Format_BGRA8888, QVideoFrameFormat::Format_NV12,
+    QVideoFrameFormat::Format_YUV420P, QVideoFrameFormat::Format_YUYV
+};
+const QSize PreviewBounds(640, 480);    // 主窗口中摄像头视图的默认尺寸
+
+void benchMatToImage(Runner& runner)
+{
+    for (const QSize& size : FrameSizes) {
+        cv::Mat bgr = makeMat(size, CV_8UC3);
+        cv::Mat gray = makeMat(size, CV_8UC1);
+        runner.run("mat_to_qimage", "BGR", sizeLabel(size), [&]() {
+            return qint64(ImageConversion::matToImage(bgr).sizeInBytes());
+        });
+        runner.run("mat_to_qimage", "GRAY", sizeLabel(size), [&]() {
+            return qint64(ImageConversion::matToImage(gray).sizeInBytes());
+        });
+    }
+}
+
+void benchPreviewScale(Runner& runner)
+{
+    for (const QSize& size : FrameSizes) {
+        for (QVideoFrameFormat::PixelFormat format : FrameFormats) {
+            QVideoFrame frame = makeFrame(size, format);
+            if (!frame.isValid()) {
+                continue;
+            }
+            QImage::Format imageFormat = ImageConversion::previewImageFormat(format);
+            QSize targetSize = size.scaled(PreviewBounds, Qt::KeepAspectRatio);
+            targetSize = QSize(targetSize.width() & ~1, targetSize.height() & ~1);
+
+            if (imageFormat != QImage::Format_Invalid) {
+                // 与onFrameAvailable相同：每帧映射，缩放到池化的预览图像中，视图持有的上一帧在新帧到达时归还
+                FrameBufferPool pool;
+                PooledBuffer<QImage> shown;
+                cv::Mat scratch;
+                quint64 frames = 0;
+                runner.run("preview_scale", QString("%1/map").arg(formatName(format)), sizeLabel(size), [&]() {
+                    QVideoFrame mappedFrame(frame);
+                    if (!mappedFrame.map(QVideoFrame::ReadOnly)) {
+                        return qint64(-1);
+                    }
+                    PooledBuffer<QImage> preview = pool.acquireImage(targetSize, imageFormat);
+                    bool scaled = ImageConversion::scaleMappedPreview(mappedFrame, &*preview, &scratch);
+                    mappedFrame.unmap();
+                    shown = std::move(preview);
+                    ++frames;
+                    return scaled ? qint64(shown->sizeInBytes()) : qint64(-1);
+                });
+                // 预热后缓冲池中有两幅图像轮流使用，稳定运行时每帧分配应为0
+                FrameBufferPool::Stats stats = pool.stats();
+                if (frames > 0) {
+                    std::fprintf(stderr, "  preview pool: frames=%llu allocations=%llu reuses=%llu dropped=%llu\n",
+                                 static_cast<unsigned long long>(frames), static_cast<unsigned long long>(stats.allocations),
+                                 static_cast<unsigned long long>(stats.reuses), static_cast<unsigned long long>(stats.dropped));
+                }
+            }
+            // 旧路径：toImage()后生成整帧和缩放后的QPixmap，每帧分配三次
+            runner.run("preview_scale", QString("%1/toImage").arg(formatName(format)), sizeLabel(size), [&]() {
+                QPixmap pixmap = QPixmap::fromImage(frame.toImage());
+                return qint64(pixmap.scaled(targetSize, Qt::KeepAspectRatio, Qt::SmoothTransformation).width());
+            });
+        }
+    }
+}
+
+void benchCaptureEncode(Runner& runner)
+{
+    CaptureEncoder encoder;
+    CaptureEncoder::Options options;
+    options.maxDimension = 640;
+    options.quality = 95;
+
+    for (const QSize& size : FrameSizes) {
+        for (QVideoFrameFormat::PixelFormat format : FrameFormats) {
+            QVideoFrame frame = makeFrame(size, format);
+            if (!frame.isValid()) {
+                continue;
+            }
+            QSize previewSize = size.scaled(options.maxDimension, options.maxDimension, Qt::KeepAspectRatio);
+            QByteArray jpeg;
+
+            runner.run("capture_encode", QString("%1/rgb").arg(formatName(format)), sizeLabel(size), [&]() {
+                QImage preview = frame.toImage().scaled(previewSize, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+                return encoder.encodeImage(preview, options, &jpeg) ? qint64(jpeg.size()) : qint64(-1);
+            });
+            if (CaptureEncoder::supportsPixelFormat(format)) {
+                runner.run("capture_encode", QString("%1/yuv").arg(formatName(format)), sizeLabel(size), [&]() {
+                    return encoder.encodeFrame(frame, options, &jpeg) ? qint64(jpeg.size()) : qint64(-1);
+                });
+            }
+        }
+    }
+}
+
+void benchBuildRequest(Runner& runner)
+{
+    const int payloadSizes[] = { 16 * 1024, 64 * 1024, 256 * 1024 };
+    for (int payloadSize : payloadSizes) {
+        QByteArray faceData(payloadSize, 'x');
+        QString label = QString("%1KB").arg(payloadSize / 1024);
+
+        runner.run("build_request", "single", label, [&]() {
+            QJsonObject loginData;
+            loginData["type"] = "login";
+            loginData["username"] = "bench-user";
+            loginData["password"] = "bench-password";
+            FaceAuthProtocol::describePayload(&loginData, faceData);
+            return qint64(FaceAuthProtocol::buildRequestPacket(loginData, faceData).size());
+        });
+
+        // 连拍：4帧拼接为一个负载
+        QList<QByteArray> frames(4, faceData);
+        runner.run("build_request", "burst4", label, [&]() {
+            QJsonObject loginData;
+            loginData["type"] = "login";
+            loginData["username"] = "bench-user";
+            loginData["password"] = "bench-password";
+            QJsonArray layout;
+            QByteArray payload = FaceAuthProtocol::packFrames(frames, &layout);
+            FaceAuthProtocol::describePayload(&loginData, payload, layout);
+            return qint64(FaceAuthProtocol::buildRequestPacket(loginData, payload).size());
+        });
+    }
+}
+
+void benchParseResponse(Runner& runner)
+{
+    QJsonObject login;
+    login["type"] = "login";
+    login["success"] = true;
+    login["username"] = "bench-user";
+    login["score"] = 0.93;
+    login["message"] = "登录成功";
+    login["request_id"] = "00000000-0000-0000-0000-000000000000";
+
+    const int counts[] = { 1, 8 };
+    for (int count : counts) {
+        QByteArray stream;
+        for (int i = 0; i < count; ++i) {
+            stream.append(FaceAuthProtocol::buildResponsePacket(login));
+        }
+        runner.run("parse_response", count == 1 ? QString("single") : QString("pipelined%1").arg(count),
+                   QString("%1B").arg(stream.size()), [&]() {
+            // 与processServerResponse相同：逐个解析并从缓冲区移除
+            QByteArray buffer = stream;
+            qint64 succeeded = 0;
+            while (!buffer.isEmpty()) {
+                QJsonObject response;
+                int consumed = 0;
+                if (FaceAuthProtocol::parseResponse(buffer, &response, &consumed) != FaceAuthProtocol::ParseResult::Complete) {
+                    break;
+                }
+                buffer.remove(0, consumed);
+                succeeded += FaceAuthProtocol::responseSucceeded(response) ? 1 : 0;
+            }
+            return succeeded;
+        });
+    }
+}
+
+void benchFrameRing(Runner& runner)
+{
+    const QVideoFrameFormat::PixelFormat formats[] = { QVideoFrameFormat::Format_NV12, QVideoFrameFormat::Format_BGRA8888 };
+    const QSize sizes[] = { QSize(640, 480), QSize(1280, 720) };
+    for (const QSize& size : sizes) {
+        for (QVideoFrameFormat::PixelFormat format : formats) {
+            QVideoFrame frame = makeFrame(size, format);
+            if (!frame.isValid()) {
+                continue;
+            }
+
+            QString name = QString("FaceAuthBench-%1-%2-%3").arg(QCoreApplication::applicationPid())
+                               .arg(formatName(format)).arg(sizeLabel(size));
+            FrameRingWriter writer(name);
+            if (!writer.create(4, qint64(size.width()) * size.height() * 4)) {
+                continue;
+            }
+
+            // 与publishFrame相同：每帧映射后整帧写入槽中
+            auto publish = [&]() {
+                QVideoFrame mapped(frame);
+                if (!mapped.map(QVideoFrame::ReadOnly)) {
+                    return qint64(-1);
+                }
+                FrameRingInfo info;
+                info.fourcc = FrameRingInfo::fourccCode(formatName(format));
+                info.width = mapped.width();
+                info.height = mapped.height();
+                info.planeCount = qMin(mapped.planeCount(), int(FrameRingInfo::MaxPlanes));
+                const uchar* planes[FrameRingInfo::MaxPlanes] = {};
+                qint64 bytes = 0;
+                for (int i = 0; i < info.planeCount; ++i) {
+                    info.bytesPerLine[i] = mapped.bytesPerLine(i);
+                    info.planeBytes[i] = mapped.mappedBytes(i);
+                    planes[i] = mapped.bits(i);
+                    bytes += info.planeBytes[i];
+                }
+                bool published = writer.publish(info, planes);
+                mapped.unmap();
+                return published ? bytes : qint64(-1);
+            };
+            runner.run("frame_ring", QString("%1/publish").arg(formatName(format)), sizeLabel(size), publish);
+
+            // 慢读者持有零拷贝视图逐帧处理，写者不会因此等待
+            std::atomic<bool> stop(false);
+            std::thread reader([&]() {
+                FrameRingReader ring(name);
+                if (!ring.attach()) {
+                    return;
+                }
+                FrameRingView view;
+                volatile uchar sink = 0;
+                while (!stop.load(std::memory_order_relaxed)) {
+                    if (!ring.next(&view)) {
+                        std::this_thread::yield();
+                        continue;
+                    }
+                    sink = sink + view.planes[0][0];
+                    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+                    ring.isValid(view);
+                }
+            });
+            runner.run("frame_ring", QString("%1/slow_reader").arg(formatName(format)), sizeLabel(size), publish);
+            stop.store(true, std::memory_order_relaxed);
+            reader.join();
+        }
+    }
+}
+
+QJsonObject resultsToJson(const std::vector<Result>& results)
+{
+    QJsonObject environment;
+    environment["qt"] = QString(qVersion());
+    environment["opencv"] = QString(CV_VERSION);
+    environment["turbojpeg"] = CaptureEncoder::hasTurboJpeg();
+    environment["cpu"] = QSysInfo::currentCpuArchitecture();
+    environment["os"] = QSysInfo::prettyProductName();
+    environment["threads"] = QThread::idealThreadCount();
+
+    QJsonArray entries;
+    for (const Result& result : results) {
+        QJsonObject entry;
+        entry["name"] = result.name;
+        entry["variant"] = result.variant;
+        entry["size"] = result.size;
+        entry["samples"] = result.samples;
+        entry["batch"] = result.batch;
+        entry["median_us"] = result.medianUs;
+        entry["mean_us"] = result.meanUs;
+        entry["p95_us"] = result.p95Us;
+        entry["min_us"] = result.minUs;
+        if (result.bytes >= 0) {
+            entry["bytes"] = result.bytes;
+        }
+        entries.append(entry);
+    }
+
+    QJsonObject root;
+    root["schema"] = SchemaName;
+    root["environment"] = environment;
+    root["results"] = entries;
+    return root;
+}
+
+bool loadResults(const QString& path, QMap<QString, double>* medians)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        std::fprintf(stderr, "无法打开 %s\n", qPrintable(path));
+        return false;
+    }
+    QJsonObject root = QJsonDocument::fromJson(file.readAll()).object();
+    if (root.value("schema").toString() != SchemaName) {
+        std::fprintf(stderr, "%s 不是 %s 格式的结果\n", qPrintable(path), SchemaName);
+        return false;
+    }
+    for (const QJsonValue& value : root.value("results").toArray()) {
+        QJsonObject entry = value.toObject();
+        QString key = entry.value("name").toString() + "/" + entry.value("variant").toString() + "/"
+                      + entry.value("size").toString();
+        medians->insert(key, entry.value("median_us").toDouble());
+    }
+    return true;
+}
+
+int compareRuns(const QString& basePath, const QString& currentPath, double thresholdPercent, double minDeltaUs)
+{
+    QMap<QString, double> base;
+    QMap<QString, double> current;
+    if (!loadResults(basePath, &base) || !loadResults(currentPath, &current)) {
+        return 2;
+    }
+
+    int regressions = 0;
+    std::printf("%-40s %12s %12s %9s\n", "benchmark", "base us", "current us", "change");
+    for (auto it = current.constBegin(); it != current.constEnd(); ++it) {
+        if (!base.contains(it.key())) {
+            std::printf("%-40s %12s %12.2f %9s  new\n", qPrintable(it.key()), "-", it.value(), "-");
+            continue;
+        }
+        double before = base.value(it.key());
+        double after = it.value();
+        double change = before > 0.0 ? (after - before) * 100.0 / before : 0.0;
+        bool regressed = change > thresholdPercent && after - before > minDeltaUs;
+        bool improved = change < -thresholdPercent && before - after > minDeltaUs;
+        regressions += regressed ? 1 : 0;
+        std::printf("%-40s %12.2f %12.2f %+8.1f%%%s\n", qPrintable(it.key()), before, after, change,
+                    regressed ? "  REGRESSION" : (improved ? "  improved" : ""));
+    }
+    for (auto it = base.constBegin(); it != base.constEnd(); ++it) {
+        if (!current.contains(it.key())) {
+            std::printf("%-40s %12.2f %12s %9s  missing\n", qPrintable(it.key()), it.value(), "-", "-");
+        }
+    }
+
+    std::printf("%d regression(s) over %.1f%% (min delta %.2f us)\n", regressions, thresholdPercent, minDeltaUs);
+    return regressions > 0 ? 1 : 0;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    // 无显示器的环境(CI)也能运行，QPixmap使用离屏光栅实现
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+    QGuiApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("FaceAuth客户端热路径基准测试");
+    parser.addHelpOption();
+    QCommandLineOption samplesOption("samples", "每项的样本数", "count", "30");
+    QCommandLineOption filterOption("filter", "只运行键(name/variant/size)包含该子串的项", "text");
+    QCommandLineOption outputOption({ "o", "output" }, "JSON结果写入文件(默认输出到标准输出)", "path");
+    QCommandLineOption compareOption("compare", "比较两次运行的结果: --compare base.json current.json");
+    QCommandLineOption thresholdOption("threshold", "判为回退的中位数增幅(百分比)", "percent", "10");
+    QCommandLineOption minDeltaOption("min-delta-us", "判为回退的最小绝对差值(微秒)", "us", "1");
+    parser.addOptions({ samplesOption, filterOption, outputOption, compareOption, thresholdOption, minDeltaOption });
+    parser.addPositionalArgument("files", "比较模式下的基线和当前结果文件", "[base.json current.json]");
+    parser.process(app);
+
+    if (parser.isSet(compareOption)) {
+        QStringList files = parser.positionalArguments();
+        if (files.size() != 2) {
+            parser.showHelp(2);
+        }
+        return compareRuns(files[0], files[1], parser.value(thresholdOption).toDouble(),
+                           parser.value(minDeltaOption).toDouble());
+    }
+
+    Runner runner(qMax(1, parser.value(samplesOption).toInt()), parser.value(filterOption));
+    std::fprintf(stderr, "%-15s %-12s %-10s %12s %12s %12s %10s\n", "benchmark", "variant", "size",
+                 "median us", "p95 us", "min us", "bytes");
+    benchMatToImage(runner);
+    benchPreviewScale(runner);
+    benchCaptureEncode(runner);
+    benchBuildRequest(runner);
+    benchParseResponse(runner);
+    benchFrameRing(runner);
+
+    QByteArray json = QJsonDocument(resultsToJson(runner.results())).toJson();
+    if (parser.isSet(outputOption)) {
+        QFile file(parser.value(outputOption));
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate) || file.write(json) != json.size()) {
+            std::fprintf(stderr, "无法写入 %s\n", qPrintable(parser.value(outputOption)));
+            return 2;
+        }
+    } else {
+        std::fwrite(json.constData(), 1, size_t(json.size()), stdout);
+    }
+    return 0;
+}
@@ -0,0 +1,67 @@
+#include "DoorRelay.h"
+#include "Log.h"
+#include <QFile>
+#include <QSettings>
+
+DoorRelay::DoorRelay(QObject* parent)
+    : QObject(parent),
+    m_pulseMs(3000),
+    m_activeLow(false),
+    m_open(false),
+    m_pulses(0)
+{
+    m_closeTimer.setSingleShot(true);
+    connect(&m_closeTimer, &QTimer::timeout, this, [this]() {
+        write(false);
+        LOG_INFO(Log::gate) << "门锁关闭";
+    });
+}
+
+DoorRelay::~DoorRelay()
+{
+    // 退出时不让门保持打开
+    if (m_open) {
+        write(false);
+    }
+}
+
+void DoorRelay::loadSettings()
+{
+    QSettings settings("FaceAuthTeam", "FaceAuthAccess");
+    m_path = settings.value("门锁继电器").toString();
+    m_pulseMs = qMax(100, settings.value("门锁开启毫秒", 3000).toInt());
+    m_activeLow = settings.value("门锁低电平有效", false).toBool();
+    write(false);
+    LOG_INFO(Log::gate) << "门锁继电器" << Log::field("path", m_path.isEmpty() ? QString("(仅日志)") : m_path)
+                        << Log::field("pulse_ms", m_pulseMs) << Log::field("active_low", m_activeLow);
+}
+
+void DoorRelay::pulse(const QString& reason)
+{
+    m_pulses++;
+    if (!m_open && !write(true)) {
+        return;
+    }
+    m_closeTimer.start(m_pulseMs);
+    LOG_INFO(Log::gate) << "门锁开启" << Log::field("reason", reason) << Log::field("pulse_ms", m_pulseMs)
+                        << Log::field("pulses", qint64(m_pulses));
+}
+
+bool DoorRelay::write(bool open)
+{
+    m_open = open;
+    if (m_path.isEmpty()) {
+        return true;
+    }
+
+    // sysfs属性文件每次写入都要重新打开
+    QFile file(m_path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        LOG_ERROR(Log::gate) << "无法写入门锁继电器" << Log::field("path", m_path)
+                             << Log::field("error", file.errorString());
+        m_open = false;
+        return false;
+    }
+    file.write(open != m_activeLow ? "1" : "0");
+    return true;
+}
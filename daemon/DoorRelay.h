@@ -0,0 +1,36 @@
+#pragma once
+
+#include <QObject>
+#include <QString>
+#include <QTimer>
+
+// 门锁继电器：认证通过时输出一个开门脉冲
+//
+// 输出写入一个控制文件，通常是sysfs GPIO的value文件(如/sys/class/gpio/gpio17/value)，
+// 写入"1"/"0"控制继电器；路径为空时只记录日志，便于在没有继电器的机器上调试。
+// 脉冲期间再次开门只延长脉冲，不会重复吸合。
+class DoorRelay : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit DoorRelay(QObject* parent = nullptr);
+    ~DoorRelay();
+
+    // 从QSettings读取"门锁继电器"、"门锁开启毫秒"和"门锁低电平有效"，并把输出置为关闭状态
+    void loadSettings();
+
+    void pulse(const QString& reason);
+    bool isOpen() const { return m_open; }
+    quint64 pulseCount() const { return m_pulses; }
+
+private:
+    bool write(bool open);
+
+    QString m_path;
+    int m_pulseMs;
+    bool m_activeLow;
+    bool m_open;
+    quint64 m_pulses;
+    QTimer m_closeTimer;
+};
@@ -0,0 +1,374 @@
+#include "GateDaemon.h"
+#include "DoorRelay.h"
+#include "FaceAuthCore.h"
+#include "FaceAuthProtocol.h"
+#include "OfflineJournal.h"
+#include "ProcessStats.h"
+#include "Log.h"
+#include <QJsonDocument>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QSettings>
+#include <QTimer>
+
+// 一行命令的最大长度，超过时断开客户端
+static const qint64 MaxCommandBytes = 64 * 1024;
+
+GateDaemon::GateDaemon(const Options& options, QObject* parent)
+    : QObject(parent),
+    m_options(options),
+    m_core(nullptr),
+    m_relay(nullptr),
+    m_server(nullptr),
+    m_camera(nullptr),
+    m_ready(false),
+    m_nextCommandId(1),
+    m_granted(0),
+    m_denied(0)
+{
+    m_core = new FaceAuthCore(this);
+    // 守护进程只有一个事件循环，连接服务器时不能停止处理命令和门锁定时器
+    m_core->setNonBlocking(true);
+    connect(m_core, &FaceAuthCore::statusMessage, this, [](const QString& text) {
+        LOG_DEBUG(Log::gate) << text;
+    });
+    connect(m_core, &FaceAuthCore::authFinished, this, &GateDaemon::onAuthFinished);
+    connect(m_core, &FaceAuthCore::identifyFinished, this, &GateDaemon::onIdentifyFinished);
+    connect(m_core, &FaceAuthCore::requestsAborted, this, &GateDaemon::onRequestsAborted);
+    connect(m_core, &FaceAuthCore::identifyDropped, this, [this](const QString& error) {
+        // 连接未建立，排队中的识别请求都未发出
+        QList<Command> dropped = m_identifying;
+        m_identifying.clear();
+        for (const Command& command : dropped) {
+            reply(command, false, "网络错误: " + error);
+        }
+    });
+    connect(m_core, &FaceAuthCore::activeEndpointChanged, this, [](const QString& host, quint16 port) {
+        LOG_INFO(Log::gate) << "认证服务器切换" << Log::field("host", host) << Log::field("port", int(port));
+    });
+
+    m_relay = new DoorRelay(this);
+
+    // 摄像头采集和JPEG编码在独立线程中进行，不阻塞命令处理和网络收发
+    m_camera = new HeadlessCamera(options.cameraIndex);
+    m_camera->moveToThread(&m_cameraThread);
+    connect(&m_cameraThread, &QThread::finished, m_camera, &QObject::deleteLater);
+    connect(m_camera, &HeadlessCamera::opened, this, &GateDaemon::onCameraOpened);
+    connect(m_camera, &HeadlessCamera::captured, this, &GateDaemon::onCaptured);
+
+    m_server = new QLocalServer(this);
+    connect(m_server, &QLocalServer::newConnection, this, &GateDaemon::onNewConnection);
+}
+
+GateDaemon::~GateDaemon()
+{
+    m_cameraThread.quit();
+    m_cameraThread.wait();
+    logResourceStats("exit");
+}
+
+bool GateDaemon::start(QString* error)
+{
+    m_relay->loadSettings();
+
+    // 只允许同一用户的进程(门禁控制程序)发送命令；上次异常退出遗留的套接字文件先删除
+    QLocalServer::removeServer(m_options.socketName);
+    m_server->setSocketOptions(QLocalServer::UserAccessOption);
+    if (!m_server->listen(m_options.socketName)) {
+        if (error) {
+            *error = m_server->errorString();
+        }
+        return false;
+    }
+    LOG_INFO(Log::gate) << "命令套接字" << Log::field("path", m_server->fullServerName());
+
+    // 门禁请求频繁且对延迟敏感，默认保持到认证服务器的长连接
+    QSettings settings("FaceAuthTeam", "FaceAuthAccess");
+    if (settings.value("门禁保持连接", true).toBool()) {
+        m_core->setKeepAlive(true);
+        m_core->beginConnect();
+    }
+
+    int statsInterval = settings.value("资源统计间隔秒", 300).toInt();
+    if (statsInterval > 0) {
+        QTimer* statsTimer = new QTimer(this);
+        connect(statsTimer, &QTimer::timeout, this, [this]() { logResourceStats("periodic"); });
+        statsTimer->start(statsInterval * 1000);
+    }
+
+    m_cameraThread.setObjectName("Camera");
+    m_cameraThread.start();
+    QMetaObject::invokeMethod(m_camera, &HeadlessCamera::open, Qt::QueuedConnection);
+    return true;
+}
+
+void GateDaemon::onCameraOpened(bool success, const QString& error)
+{
+    if (!success) {
+        // 采集时会再次尝试打开，摄像头稍后接入也能工作
+        LOG_WARNING(Log::gate) << "摄像头不可用:" << error;
+    }
+    if (!m_ready) {
+        m_ready = true;
+        logResourceStats("ready");
+    }
+}
+
+void GateDaemon::onNewConnection()
+{
+    while (QLocalSocket* client = m_server->nextPendingConnection()) {
+        connect(client, &QLocalSocket::disconnected, client, &QObject::deleteLater);
+        connect(client, &QLocalSocket::readyRead, this, [this, client]() {
+            while (client->canReadLine()) {
+                handleLine(client, client->readLine().trimmed());
+            }
+            if (client->bytesAvailable() > MaxCommandBytes) {
+                LOG_WARNING(Log::gate) << "命令过长，断开客户端";
+                client->abort();
+            }
+        });
+    }
+}
+
+void GateDaemon::handleLine(QLocalSocket* client, const QByteArray& line)
+{
+    if (line.isEmpty()) {
+        return;
+    }
+
+    QJsonParseError parseError;
+    QJsonDocument document = QJsonDocument::fromJson(line, &parseError);
+    if (!document.isObject()) {
+        replyError(client, QJsonObject(), "无效的JSON命令: " + parseError.errorString());
+        return;
+    }
+
+    QJsonObject request = document.object();
+    QString cmd = request.value("cmd").toString();
+    if (cmd == "stats") {
+        QJsonObject response = statsJson();
+        response["cmd"] = cmd;
+        response["success"] = true;
+        if (request.contains("id")) {
+            response["id"] = request.value("id");
+        }
+        client->write(QJsonDocument(response).toJson(QJsonDocument::Compact) + "\n");
+        return;
+    }
+    if (cmd != "identify" && cmd != "login" && cmd != "register") {
+        replyError(client, request, "未知的命令: " + cmd);
+        return;
+    }
+
+    bool auth = cmd != "identify";
+    if (auth) {
+        if (request.value("username").toString().trimmed().isEmpty() || request.value("password").toString().isEmpty()) {
+            replyError(client, request, "用户名和密码不能为空");
+            return;
+        }
+        if (m_auth.id != 0) {
+            replyError(client, request, "另一个登录或注册请求正在处理");
+            return;
+        }
+    }
+
+    Command command;
+    command.id = m_nextCommandId++;
+    command.client = client;
+    command.request = request;
+    command.timer.start();
+    if (auth) {
+        m_auth = command;
+    }
+    m_capturing.insert(command.id, command);
+
+    // 与图形客户端使用相同的拍照设置；识别请求只取单帧，与自助模式一致
+    QSettings settings("FaceAuthTeam", "FaceAuthAccess");
+    HeadlessCamera::Options options;
+    options.maxDimension = settings.value("拍照最大边长", 640).toInt();
+    options.quality = settings.value("拍照JPEG质量", 95).toInt();
+    if (auth) {
+        options.frameCount = qBound(1, settings.value("连拍帧数", 1).toInt(), 8);
+        options.windowMs = settings.value("连拍窗口毫秒", 200).toInt();
+    }
+    if (cmd == "login" && settings.value("两阶段上传", false).toBool()) {
+        options.previewMaxDimension = settings.value("预览图最大边长", 160).toInt();
+        options.previewQuality = settings.value("预览图JPEG质量", 70).toInt();
+    }
+
+    // 采集期间提前建立连接
+    m_core->speculativeConnect("gate");
+    quint64 id = command.id;
+    HeadlessCamera* camera = m_camera;
+    QMetaObject::invokeMethod(camera, [camera, id, options]() { camera->capture(id, options); }, Qt::QueuedConnection);
+}
+
+void GateDaemon::onCaptured(quint64 requestId, const HeadlessCamera::Result& result)
+{
+    if (!m_capturing.contains(requestId)) {
+        return;
+    }
+    Command command = m_capturing.take(requestId);
+    QString cmd = command.request.value("cmd").toString();
+    LOG_DEBUG(Log::gate) << "采集完成" << Log::field("cmd", cmd) << Log::field("frames", int(result.frames.size()))
+                         << Log::field("capture_ms", result.captureMs);
+
+    if (!result.error.isEmpty()) {
+        if (m_auth.id == command.id) {
+            m_auth = Command();
+        }
+        reply(command, false, result.error);
+        return;
+    }
+
+    if (cmd == "identify") {
+        m_identifying.append(command);
+        m_core->identify(QString::number(command.id), result.frames.first());
+        return;
+    }
+
+    FaceAuthCore::AuthRequest request;
+    request.username = command.request.value("username").toString().trimmed();
+    request.password = command.request.value("password").toString();
+    if (result.frames.size() == 1) {
+        request.faceData = result.frames.first();
+    } else {
+        request.faceData = FaceAuthProtocol::packFrames(result.frames, &request.frameLayout);
+    }
+    request.preview = result.preview;
+
+    QString error;
+    FaceAuthCore::SubmitResult submitted = cmd == "login" ? m_core->login(request, &error)
+                                                          : m_core->registerUser(request, &error);
+    switch (submitted) {
+    case FaceAuthCore::SubmitResult::Sent:
+        break;
+    case FaceAuthCore::SubmitResult::Queued:
+        m_auth = Command();
+        reply(command, false, "网络不可用，注册请求已保存，恢复连接后将自动补发", { { "queued", true } });
+        break;
+    case FaceAuthCore::SubmitResult::Failed:
+        m_auth = Command();
+        reply(command, false, "连接失败:" + error);
+        break;
+    }
+}
+
+void GateDaemon::onAuthFinished(const QString& type, bool success, const QJsonObject& response)
+{
+    if (m_auth.id == 0) {
+        LOG_WARNING(Log::gate) << "收到无对应命令的响应" << Log::field("type", type);
+        return;
+    }
+    Command command = m_auth;
+    m_auth = Command();
+
+    // 只有验证通过的登录开门，注册成功不开门
+    QJsonObject fields;
+    if (type == "login" && success) {
+        m_relay->pulse("login:" + command.request.value("username").toString());
+        fields["door_opened"] = true;
+        m_granted++;
+    } else if (type == "login") {
+        m_denied++;
+    }
+    if (response.value("queued").toBool()) {
+        fields["queued"] = true;
+    }
+    reply(command, success, response.value("message").toString(), fields);
+}
+
+void GateDaemon::onIdentifyFinished(bool success, const QJsonObject& response)
+{
+    if (m_identifying.isEmpty()) {
+        LOG_WARNING(Log::gate) << "收到无对应命令的识别响应";
+        return;
+    }
+    Command command = m_identifying.takeFirst();
+
+    QJsonObject fields;
+    QString username = response.value("username").toString();
+    if (!username.isEmpty()) {
+        fields["username"] = username;
+    }
+    if (success) {
+        m_relay->pulse("identify:" + username);
+        fields["door_opened"] = true;
+        m_granted++;
+    } else {
+        m_denied++;
+    }
+    reply(command, success, response.value("message").toString(), fields);
+}
+
+void GateDaemon::onRequestsAborted()
+{
+    // 连接断开，已发送的请求不会再有响应；正在采集的命令稍后照常发送
+    QList<Command> aborted = m_identifying;
+    m_identifying.clear();
+    if (m_auth.id != 0 && !m_capturing.contains(m_auth.id) && !m_core->isAuthInFlight()) {
+        aborted.append(m_auth);
+        m_auth = Command();
+    }
+    for (const Command& command : aborted) {
+        reply(command, false, "与服务器连接断开");
+    }
+}
+
+void GateDaemon::reply(const Command& command, bool success, const QString& message, QJsonObject fields)
+{
+    QString cmd = command.request.value("cmd").toString();
+    LOG_INFO(Log::gate) << "命令完成" << Log::field("cmd", cmd) << Log::field("success", success)
+                        << Log::field("elapsed_ms", command.timer.elapsed()) << Log::field("message", message);
+    if (!command.client || command.client->state() != QLocalSocket::ConnectedState) {
+        return;
+    }
+
+    fields["cmd"] = cmd;
+    fields["success"] = success;
+    fields["message"] = message;
+    fields["elapsed_ms"] = command.timer.elapsed();
+    if (command.request.contains("id")) {
+        fields["id"] = command.request.value("id");
+    }
+    command.client->write(QJsonDocument(fields).toJson(QJsonDocument::Compact) + "\n");
+}
+
+void GateDaemon::replyError(QLocalSocket* client, const QJsonObject& request, const QString& message)
+{
+    QJsonObject response;
+    response["cmd"] = request.value("cmd").toString();
+    response["success"] = false;
+    response["message"] = message;
+    if (request.contains("id")) {
+        response["id"] = request.value("id");
+    }
+    client->write(QJsonDocument(response).toJson(QJsonDocument::Compact) + "\n");
+}
+
+QJsonObject GateDaemon::statsJson() const
+{
+    ProcessStats::Sample sample = ProcessStats::sample();
+    QJsonObject stats;
+    stats["rss_kb"] = sample.rssKb;
+    stats["peak_rss_kb"] = sample.peakRssKb;
+    stats["cpu_user_ms"] = sample.cpuUserMs;
+    stats["cpu_system_ms"] = sample.cpuSystemMs;
+    stats["uptime_ms"] = sample.uptimeMs;
+    stats["granted"] = qint64(m_granted);
+    stats["denied"] = qint64(m_denied);
+    stats["door_pulses"] = qint64(m_relay->pulseCount());
+    stats["identify_in_flight"] = m_core->identifyInFlight();
+    stats["journal_pending"] = qint64(m_core->journal()->stats().pendingRecords);
+    return stats;
+}
+
+void GateDaemon::logResourceStats(const char* event)
+{
+    // ready事件的uptime_ms即启动耗时：进程创建到命令套接字监听且摄像头打开
+    ProcessStats::Sample sample = ProcessStats::sample();
+    LOG_INFO(Log::gate) << "资源占用" << Log::field("event", event) << Log::field("rss_kb", sample.rssKb)
+                        << Log::field("peak_rss_kb", sample.peakRssKb) << Log::field("cpu_user_ms", sample.cpuUserMs)
+                        << Log::field("cpu_system_ms", sample.cpuSystemMs) << Log::field("uptime_ms", sample.uptimeMs)
+                        << Log::field("granted", qint64(m_granted)) << Log::field("denied", qint64(m_denied));
+}
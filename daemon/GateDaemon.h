@@ -0,0 +1,76 @@
+#pragma once
+
+#include "HeadlessCamera.h"
+#include <QObject>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QJsonObject>
+#include <QList>
+#include <QPointer>
+#include <QThread>
+
+class FaceAuthCore;
+class DoorRelay;
+class QLocalServer;
+class QLocalSocket;
+
+// 门禁守护进程：本地套接字接收命令，摄像头采集后经FaceAuthCore发往认证服务器，通过时输出开门脉冲
+//
+// 命令和回复都是一行一个JSON对象:
+//   {"cmd":"identify"}                                    1:N识别，通过即开门
+//   {"cmd":"login","username":"..","password":".."}      1:1验证，通过即开门
+//   {"cmd":"register","username":"..","password":".."}   注册，不开门
+//   {"cmd":"stats"}                                       资源占用和计数
+// 回复带有请求中的id(如果有)，识别请求可以连续发送，按发送顺序回复；登录/注册同一时间只处理一个。
+class GateDaemon : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Options {
+        QString socketName = "faceauthd";
+        int cameraIndex = 0;
+    };
+
+    explicit GateDaemon(const Options& options, QObject* parent = nullptr);
+    ~GateDaemon();
+
+    bool start(QString* error);
+
+private slots:
+    void onNewConnection();
+    void onCameraOpened(bool success, const QString& error);
+    void onCaptured(quint64 requestId, const HeadlessCamera::Result& result);
+    void onAuthFinished(const QString& type, bool success, const QJsonObject& response);
+    void onIdentifyFinished(bool success, const QJsonObject& response);
+    void onRequestsAborted();
+
+private:
+    struct Command {
+        quint64 id = 0;
+        QPointer<QLocalSocket> client;
+        QJsonObject request;
+        QElapsedTimer timer;
+    };
+
+    void handleLine(QLocalSocket* client, const QByteArray& line);
+    void reply(const Command& command, bool success, const QString& message, QJsonObject fields = QJsonObject());
+    void replyError(QLocalSocket* client, const QJsonObject& request, const QString& message);
+    QJsonObject statsJson() const;
+    void logResourceStats(const char* event);
+
+    Options m_options;
+    FaceAuthCore* m_core;
+    DoorRelay* m_relay;
+    QLocalServer* m_server;
+    QThread m_cameraThread;
+    HeadlessCamera* m_camera;
+    bool m_ready;
+
+    quint64 m_nextCommandId;
+    QHash<quint64, Command> m_capturing;        // 等待摄像头采集的命令
+    QList<Command> m_identifying;               // 已发送的识别请求，按发送顺序
+    Command m_auth;                             // 在途的登录/注册，id为0表示空闲
+    quint64 m_granted;
+    quint64 m_denied;
+};
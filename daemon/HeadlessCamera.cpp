@@ -0,0 +1,114 @@
+#include "HeadlessCamera.h"
+#include "Log.h"
+#include <QElapsedTimer>
+#include <QThread>
+#include <opencv2/imgcodecs.hpp>
+#include <opencv2/imgproc.hpp>
+#include <vector>
+
+HeadlessCamera::HeadlessCamera(int deviceIndex, QObject* parent)
+    : QObject(parent),
+    m_deviceIndex(deviceIndex)
+{
+}
+
+HeadlessCamera::~HeadlessCamera()
+{
+    if (m_capture.isOpened()) {
+        m_capture.release();
+    }
+}
+
+void HeadlessCamera::open()
+{
+    try {
+        if (!m_capture.open(m_deviceIndex)) {
+            emit opened(false, QString("无法打开摄像头%1").arg(m_deviceIndex));
+            return;
+        }
+        // 与图形客户端选择的格式相同：640x480足够人脸认证使用，也减少每帧的内存和解码开销
+        m_capture.set(cv::CAP_PROP_FRAME_WIDTH, 640);
+        m_capture.set(cv::CAP_PROP_FRAME_HEIGHT, 480);
+        m_capture.set(cv::CAP_PROP_BUFFERSIZE, 1);
+        LOG_INFO(Log::camera) << "摄像头已打开" << Log::field("device", m_deviceIndex)
+                              << Log::field("width", m_capture.get(cv::CAP_PROP_FRAME_WIDTH))
+                              << Log::field("height", m_capture.get(cv::CAP_PROP_FRAME_HEIGHT))
+                              << Log::field("backend", QString::fromStdString(m_capture.getBackendName()));
+        emit opened(true, QString());
+    }
+    catch (const cv::Exception& e) {
+        emit opened(false, QString("OpenCV异常: %1").arg(e.what()));
+    }
+}
+
+void HeadlessCamera::capture(quint64 requestId, const HeadlessCamera::Options& options)
+{
+    Result result;
+    QElapsedTimer timer;
+    timer.start();
+
+    try {
+        if (!m_capture.isOpened() && !m_capture.open(m_deviceIndex)) {
+            result.error = QString("无法打开摄像头%1").arg(m_deviceIndex);
+            emit captured(requestId, result);
+            return;
+        }
+
+        // 空闲期间驱动缓冲区里的帧已经过时，丢弃后再取
+        for (int i = 0; i < 2; ++i) {
+            m_capture.grab();
+        }
+
+        int frameCount = qBound(1, options.frameCount, 8);
+        qint64 intervalMs = frameCount > 1 ? qMax(0, options.windowMs) / (frameCount - 1) : 0;
+        cv::Mat frame;
+        for (int i = 0; i < frameCount; ++i) {
+            if (i > 0) {
+                // 帧率足够时在采集窗口内等间隔取帧
+                qint64 waitMs = i * intervalMs - timer.elapsed();
+                if (waitMs > 0) {
+                    QThread::msleep(quint64(waitMs));
+                }
+            }
+            if (!m_capture.read(frame) || frame.empty()) {
+                LOG_WARNING(Log::camera) << "读取摄像头帧失败" << Log::field("index", i);
+                continue;
+            }
+
+            QByteArray jpeg;
+            if (encode(frame, options.maxDimension, options.quality, &jpeg)) {
+                result.frames.append(jpeg);
+            }
+            if (i == 0 && options.previewMaxDimension > 0
+                && !encode(frame, options.previewMaxDimension, options.previewQuality, &result.preview)) {
+                result.preview.clear();
+            }
+        }
+    }
+    catch (const cv::Exception& e) {
+        result.error = QString("OpenCV异常: %1").arg(e.what());
+    }
+
+    if (result.frames.isEmpty() && result.error.isEmpty()) {
+        result.error = "图像采集失败";
+    }
+    result.captureMs = timer.elapsed();
+    emit captured(requestId, result);
+}
+
+bool HeadlessCamera::encode(const cv::Mat& frame, int maxDimension, int quality, QByteArray* jpeg)
+{
+    cv::Mat scaled = frame;
+    int longest = qMax(frame.cols, frame.rows);
+    if (maxDimension > 0 && longest > maxDimension) {
+        double scale = double(maxDimension) / longest;
+        cv::resize(frame, scaled, cv::Size(), scale, scale, cv::INTER_AREA);
+    }
+
+    std::vector<uchar> buffer;
+    if (!cv::imencode(".jpg", scaled, buffer, { cv::IMWRITE_JPEG_QUALITY, qBound(1, quality, 100) })) {
+        return false;
+    }
+    *jpeg = QByteArray(reinterpret_cast<const char*>(buffer.data()), int(buffer.size()));
+    return true;
+}
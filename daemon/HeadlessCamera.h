@@ -0,0 +1,49 @@
+#pragma once
+
+#include <QObject>
+#include <QByteArray>
+#include <QList>
+#include <QString>
+#include <opencv2/videoio.hpp>
+
+// 无界面摄像头：直接用OpenCV(Linux上为V4L2)采集并编码为JPEG，不依赖QtMultimedia和QtGui
+//
+// 运行在守护进程的摄像头线程中，open()和capture()都通过排队调用进入该线程，结果以信号返回。
+// 设备保持打开以免每次请求都付出数百毫秒的初始化；驱动只保留一个缓冲区，采集前先丢弃积压的旧帧。
+class HeadlessCamera : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Options {
+        int maxDimension = 640;         // 与图形客户端的"拍照最大边长"/"拍照JPEG质量"相同
+        int quality = 95;
+        int previewMaxDimension = 0;    // 两阶段上传的预览图，0表示不生成
+        int previewQuality = 70;
+        int frameCount = 1;             // 连拍帧数，在windowMs内等间隔采集
+        int windowMs = 200;
+    };
+
+    struct Result {
+        QList<QByteArray> frames;       // 按采集顺序，编码失败的帧被剔除
+        QByteArray preview;
+        qint64 captureMs = 0;           // 采集和编码的总耗时
+        QString error;
+    };
+
+    explicit HeadlessCamera(int deviceIndex, QObject* parent = nullptr);
+    ~HeadlessCamera();
+
+    void open();
+    void capture(quint64 requestId, const HeadlessCamera::Options& options);
+
+signals:
+    void opened(bool success, const QString& error);
+    void captured(quint64 requestId, const HeadlessCamera::Result& result);
+
+private:
+    static bool encode(const cv::Mat& frame, int maxDimension, int quality, QByteArray* jpeg);
+
+    int m_deviceIndex;
+    cv::VideoCapture m_capture;
+};
@@ -0,0 +1,73 @@
+#include "GateDaemon.h"
+#include "Log.h"
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QNetworkProxyFactory>
+#include <QSettings>
+#include <QStandardPaths>
+#include <QTimer>
+#include <csignal>
+
+// SIGTERM/SIGINT时退出事件循环，门锁继电器和日志在析构时正常收尾。
+// 信号处理函数中只能设置标志，由事件循环中的定时器检查
+static volatile std::sig_atomic_t g_terminateRequested = 0;
+
+static void handleTerminate(int)
+{
+    g_terminateRequested = 1;
+}
+
+int main(int argc, char* argv[])
+{
+    // 禁用网络代理，与图形客户端一致
+    QNetworkProxyFactory::setUseSystemConfiguration(false);
+
+    QCoreApplication app(argc, argv);
+    // 应用名决定离线日志等数据文件的目录，与图形客户端分开，避免两个进程共用同一个离线日志
+    QCoreApplication::setApplicationName("FaceAuthDaemon");
+    QCoreApplication::setOrganizationName("FaceAuthTeam");
+    QCoreApplication::setApplicationVersion("1.0.0");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("无界面门禁守护进程：本地套接字接收命令，人脸认证通过时控制门锁继电器");
+    parser.addHelpOption();
+    QCommandLineOption socketOption("socket", "本地命令套接字名称", "name", "faceauthd");
+    QCommandLineOption cameraOption("camera", "摄像头设备编号(默认使用设置项\"门禁摄像头\")", "index");
+    parser.addOption(socketOption);
+    parser.addOption(cameraOption);
+    parser.process(app);
+
+    QString logDir = QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation) + "/logs";
+    Log::start(Log::configFromSettings(logDir + "/faceauthd.log"));
+
+    GateDaemon::Options options;
+    options.socketName = parser.value(socketOption);
+    QSettings settings("FaceAuthTeam", "FaceAuthAccess");
+    options.cameraIndex = parser.isSet(cameraOption) ? parser.value(cameraOption).toInt()
+                                                     : settings.value("门禁摄像头", 0).toInt();
+
+    std::signal(SIGTERM, handleTerminate);
+    std::signal(SIGINT, handleTerminate);
+    QTimer terminateTimer;
+    QObject::connect(&terminateTimer, &QTimer::timeout, &app, [&app]() {
+        if (g_terminateRequested) {
+            app.quit();
+        }
+    });
+    terminateTimer.start(200);
+
+    int result = 0;
+    {
+        GateDaemon daemon(options);
+        QString error;
+        if (!daemon.start(&error)) {
+            LOG_ERROR(Log::gate) << "启动失败:" << error;
+            result = 1;
+        } else {
+            result = app.exec();
+        }
+    }
+
+    Log::shutdown();
+    return result;
+}
@@ -5,6 +5,18 @@
 #include <QFile>
 #include <QStandardPaths>
 #include <QNetworkProxyFactory>
+#include <QTimer>
+#include "Log.h"
+#include "ProcessStats.h"
+
+// 与门禁守护进程(FaceAuthDaemon)记录相同的字段，便于比较两种部署方式的启动耗时、内存和CPU占用
+static void logResourceStats(const char* event)
+{
+    ProcessStats::Sample sample = ProcessStats::sample();
+    LOG_INFO(Log::app) << "资源占用" << Log::field("event", event) << Log::field("rss_kb", sample.rssKb)
+                       << Log::field("peak_rss_kb", sample.peakRssKb) << Log::field("cpu_user_ms", sample.cpuUserMs)
+                       << Log::field("cpu_system_ms", sample.cpuSystemMs) << Log::field("uptime_ms", sample.uptimeMs);
+}
 
 int main(int argc, char *argv[])
 {
@@ -18,13 +30,27 @@ int main(int argc, char *argv[])
     QApplication::setOrganizationName("FaceAuthTeam");
     QApplication::setApplicationVersion("1.0.0");
     
+    // 异步日志：写入控制台和按大小轮转的日志文件，qDebug()等也经由后台线程输出
+    QString logDir = QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation) + "/logs";
+    Log::start(Log::configFromSettings(logDir + "/faceauth.log"));
+    
     // 添加OpenCV DLL路径到搜索路径
     QDir::addSearchPath("opencv_dll", "E:/qt_project/opencv/build/x64/vc16/bin");
-    qDebug("OpenCV DLL search path added: %s", qPrintable("E:/qt_project/opencv/build/x64/vc16/bin"));
+    LOG_INFO(Log::app) << "OpenCV DLL search path added:" << "E:/qt_project/opencv/build/x64/vc16/bin";
     
-    // 创建主窗口并显示
-    FaceAuthClient w;
-    w.show();
+    int result = 0;
+    {
+        // 创建主窗口并显示
+        FaceAuthClient w;
+        w.show();
+        
+        // 事件循环开始时窗口已显示、摄像头已启动，此时的uptime_ms即启动耗时
+        QTimer::singleShot(0, []() { logResourceStats("ready"); });
+        result = a.exec();
+    }
+    logResourceStats("exit");
     
-    return a.exec();
+    // 主窗口析构时的日志也要写出
+    Log::shutdown();
+    return result;
 }
@@ -0,0 +1,736 @@
+#include "AuthServer.h"
+#include "FaceAuthProtocol.h"
+#include "FaceMatcher.h"
+#include "SimdKernels.h"
+#include <QDebug>
+#include <QJsonArray>
+#include <arpa/inet.h>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+
+const int ReadChunkSize = 64 * 1024;
+const int MaxReadPerEvent = 1024 * 1024;   // 单次事件最多读取的字节数，避免单个连接占满事件循环
+const int MaxEvents = 256;
+
+qint64 elapsedMicros(std::chrono::steady_clock::time_point from, std::chrono::steady_clock::time_point to)
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(to - from).count();
+}
+
+} // namespace
+
+AuthServer::AuthServer(const Config& config, UserStore* store)
+    : m_config(config),
+    m_store(store),
+    m_galleryCount(0),
+    m_epollFd(-1),
+    m_listenFd(-1),
+    m_eventFd(-1),
+    m_signalFd(-1),
+    m_nextConnectionId(1),
+    m_accepted(0),
+    m_requests(0),
+    m_shedQueueFull(0),
+    m_shedPerConnection(0),
+    m_rejectedConnections(0),
+    m_shedExpired(0),
+    m_shedDeadline(0),
+    m_previewRejected(0),
+    m_previewNeedMore(0),
+    m_processed(0),
+    m_serviceMicrosTotal(0),
+    m_queueMicrosTotal(0),
+    m_statsRequestMark(0)
+{
+}
+
+AuthServer::~AuthServer()
+{
+    // 先停止工作线程，之后不会再有新的完成通知
+    if (m_workers) {
+        m_workers->stop();
+    }
+    for (auto& entry : m_connections) {
+        ::close(entry.first);
+    }
+    for (int fd : { m_listenFd, m_eventFd, m_signalFd, m_epollFd }) {
+        if (fd >= 0) {
+            ::close(fd);
+        }
+    }
+}
+
+bool AuthServer::start(QString* errorMessage)
+{
+    auto fail = [errorMessage](const QString& what) {
+        if (errorMessage) {
+            *errorMessage = what + ": " + QString::fromLocal8Bit(std::strerror(errno));
+        }
+        return false;
+    };
+
+    // 在创建工作线程之前屏蔽信号，信号只通过signalfd送到事件循环
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    if (::pthread_sigmask(SIG_BLOCK, &signals, nullptr) != 0) {
+        return fail("屏蔽信号失败");
+    }
+    ::signal(SIGPIPE, SIG_IGN);
+
+    m_signalFd = ::signalfd(-1, &signals, SFD_NONBLOCK | SFD_CLOEXEC);
+    if (m_signalFd < 0) {
+        return fail("创建signalfd失败");
+    }
+
+    m_listenFd = ::socket(AF_INET6, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (m_listenFd < 0) {
+        return fail("创建监听套接字失败");
+    }
+    int on = 1;
+    int off = 0;
+    ::setsockopt(m_listenFd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    ::setsockopt(m_listenFd, IPPROTO_IPV6, IPV6_V6ONLY, &off, sizeof(off));
+
+    sockaddr_in6 address;
+    std::memset(&address, 0, sizeof(address));
+    address.sin6_family = AF_INET6;
+    address.sin6_addr = in6addr_any;
+    address.sin6_port = htons(m_config.port);
+    if (::bind(m_listenFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+        return fail(QString("绑定端口 %1 失败").arg(m_config.port));
+    }
+    if (::listen(m_listenFd, SOMAXCONN) != 0) {
+        return fail("监听失败");
+    }
+
+    m_eventFd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (m_eventFd < 0) {
+        return fail("创建eventfd失败");
+    }
+
+    m_epollFd = ::epoll_create1(EPOLL_CLOEXEC);
+    if (m_epollFd < 0) {
+        return fail("创建epoll失败");
+    }
+    for (int fd : { m_listenFd, m_eventFd, m_signalFd }) {
+        epoll_event event;
+        std::memset(&event, 0, sizeof(event));
+        event.events = EPOLLIN;
+        event.data.fd = fd;
+        if (::epoll_ctl(m_epollFd, EPOLL_CTL_ADD, fd, &event) != 0) {
+            return fail("注册epoll事件失败");
+        }
+    }
+
+    if (!m_config.galleryPath.isEmpty() && !buildGallery(errorMessage)) {
+        return false;
+    }
+
+    m_workers.reset(new WorkerPool(m_config.workerThreads, size_t(m_config.queueCapacity),
+        [this](AuthJob& job) { processJob(job); }));
+
+    qDebug() << "认证服务器监听端口" << m_config.port << ", 工作线程" << m_workers->threadCount()
+             << ", 队列容量" << m_config.queueCapacity << ", 用户数" << m_store->userCount();
+    return true;
+}
+
+int AuthServer::run()
+{
+    epoll_event events[MaxEvents];
+    auto lastStats = std::chrono::steady_clock::now();
+    bool running = true;
+
+    while (running) {
+        int count = ::epoll_wait(m_epollFd, events, MaxEvents, 1000);
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            qDebug() << "epoll_wait失败:" << std::strerror(errno);
+            return 1;
+        }
+
+        for (int i = 0; i < count; ++i) {
+            int fd = events[i].data.fd;
+            if (fd == m_listenFd) {
+                acceptConnections();
+            } else if (fd == m_eventFd) {
+                drainCompletions();
+            } else if (fd == m_signalFd) {
+                signalfd_siginfo info;
+                while (::read(m_signalFd, &info, sizeof(info)) == sizeof(info)) {
+                    qDebug() << "收到信号" << info.ssi_signo << ", 正在退出";
+                }
+                running = false;
+            } else {
+                auto it = m_connections.find(fd);
+                if (it == m_connections.end()) {
+                    continue;
+                }
+                Connection* connection = it->second.get();
+                if (events[i].events & (EPOLLERR | EPOLLHUP)) {
+                    closeConnection(connection);
+                    continue;
+                }
+                if ((events[i].events & EPOLLOUT) && !flushWrites(connection)) {
+                    closeConnection(connection);
+                    continue;
+                }
+                if (events[i].events & EPOLLIN) {
+                    handleReadable(connection);
+                }
+            }
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        if (now - lastStats >= std::chrono::seconds(m_config.statsIntervalSec)) {
+            logStats();
+            lastStats = now;
+        }
+    }
+
+    logStats();
+    return 0;
+}
+
+void AuthServer::acceptConnections()
+{
+    while (true) {
+        int fd = ::accept4(m_listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                qDebug() << "accept失败:" << std::strerror(errno);
+            }
+            return;
+        }
+
+        if (int(m_connections.size()) >= m_config.maxConnections) {
+            // 连接数已满，直接关闭，客户端表现为连接被重置
+            ::close(fd);
+            m_rejectedConnections++;
+            continue;
+        }
+
+        int on = 1;
+        ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+
+        std::unique_ptr<Connection> connection(new Connection);
+        connection->fd = fd;
+        connection->id = m_nextConnectionId++;
+
+        epoll_event event;
+        std::memset(&event, 0, sizeof(event));
+        event.events = EPOLLIN | EPOLLRDHUP;
+        event.data.fd = fd;
+        if (::epoll_ctl(m_epollFd, EPOLL_CTL_ADD, fd, &event) != 0) {
+            ::close(fd);
+            continue;
+        }
+
+        m_connectionsById[connection->id] = connection.get();
+        m_connections[fd] = std::move(connection);
+        m_accepted++;
+    }
+}
+
+void AuthServer::handleReadable(Connection* connection)
+{
+    int totalRead = 0;
+    bool peerClosed = false;
+    while (totalRead < MaxReadPerEvent) {
+        qsizetype oldSize = connection->readBuffer.size();
+        connection->readBuffer.resize(oldSize + ReadChunkSize);
+        ssize_t received = ::recv(connection->fd, connection->readBuffer.data() + oldSize, ReadChunkSize, 0);
+        connection->readBuffer.resize(oldSize + qMax<ssize_t>(received, 0));
+
+        if (received > 0) {
+            totalRead += int(received);
+            continue;
+        }
+        if (received == 0) {
+            peerClosed = true;
+        } else if (errno == EINTR) {
+            continue;
+        } else if (errno != EAGAIN && errno != EWOULDBLOCK) {
+            peerClosed = true;
+        }
+        break;
+    }
+
+    if (!processFrames(connection) || peerClosed || connection->broken) {
+        closeConnection(connection);
+    }
+}
+
+bool AuthServer::processFrames(Connection* connection)
+{
+    int offset = 0;
+    while (offset < connection->readBuffer.size() && !connection->broken) {
+        // 以视图方式解析剩余数据，处理完后一次性移除已消费的字节
+        QByteArray remaining = QByteArray::fromRawData(connection->readBuffer.constData() + offset,
+                                                       connection->readBuffer.size() - offset);
+        AuthJob job;
+        int consumed = 0;
+        FaceAuthProtocol::ParseResult result = FaceAuthProtocol::parseRequest(
+            remaining, &job.header, &job.payload, &consumed, m_config.maxJsonBytes, m_config.maxPayloadBytes);
+
+        if (result == FaceAuthProtocol::ParseResult::Incomplete) {
+            break;
+        }
+        if (result != FaceAuthProtocol::ParseResult::Complete) {
+            qDebug() << "连接" << connection->id << "收到无效请求帧，关闭连接";
+            return false;
+        }
+        offset += consumed;
+        // payload引用的是读缓冲区，移除前先分离
+        job.payload.detach();
+
+        m_requests++;
+        quint64 sequence = connection->nextSequence++;
+        QString type = job.header.value("type").toString();
+
+        if (type != "login" && type != "register" && type != "audit" && type != "identify" && type != "ping") {
+            QJsonObject response;
+            response["type"] = type;
+            response["success"] = false;
+            response["message"] = "不支持的请求类型";
+            queueResponse(connection, sequence, FaceAuthProtocol::buildResponsePacket(response));
+            continue;
+        }
+
+        if (connection->inFlight >= m_config.maxInFlightPerConnection) {
+            m_shedPerConnection++;
+            queueResponse(connection, sequence,
+                FaceAuthProtocol::buildResponsePacket(busyResponse(type, "连接并发请求过多")));
+            continue;
+        }
+
+        job.connectionId = connection->id;
+        job.sequence = sequence;
+        if (!m_workers->submit(std::move(job))) {
+            m_shedQueueFull++;
+            queueResponse(connection, sequence,
+                FaceAuthProtocol::buildResponsePacket(busyResponse(type, "服务器繁忙")));
+            continue;
+        }
+        connection->inFlight++;
+    }
+
+    if (offset > 0) {
+        connection->readBuffer.remove(0, offset);
+    }
+    return true;
+}
+
+void AuthServer::queueResponse(Connection* connection, quint64 sequence, const QByteArray& packet)
+{
+    connection->ready.emplace(sequence, packet);
+
+    // 只写出连续的响应，保证与请求顺序一致
+    auto it = connection->ready.begin();
+    while (it != connection->ready.end() && it->first == connection->nextToSend) {
+        connection->writeBuffer.append(it->second);
+        it = connection->ready.erase(it);
+        connection->nextToSend++;
+    }
+
+    if (!connection->wantWrite && !flushWrites(connection)) {
+        connection->broken = true;
+    }
+}
+
+bool AuthServer::flushWrites(Connection* connection)
+{
+    while (connection->writeOffset < connection->writeBuffer.size()) {
+        ssize_t sent = ::send(connection->fd, connection->writeBuffer.constData() + connection->writeOffset,
+                              connection->writeBuffer.size() - connection->writeOffset, MSG_NOSIGNAL);
+        if (sent > 0) {
+            connection->writeOffset += sent;
+            continue;
+        }
+        if (sent < 0 && errno == EINTR) {
+            continue;
+        }
+        if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            // 发送缓冲区已满，等待可写事件
+            updateInterest(connection, true);
+            return true;
+        }
+        return false;
+    }
+
+    connection->writeBuffer.clear();
+    connection->writeOffset = 0;
+    updateInterest(connection, false);
+    return true;
+}
+
+void AuthServer::updateInterest(Connection* connection, bool wantWrite)
+{
+    if (connection->wantWrite == wantWrite) {
+        return;
+    }
+    epoll_event event;
+    std::memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN | EPOLLRDHUP | (wantWrite ? EPOLLOUT : 0);
+    event.data.fd = connection->fd;
+    ::epoll_ctl(m_epollFd, EPOLL_CTL_MOD, connection->fd, &event);
+    connection->wantWrite = wantWrite;
+}
+
+void AuthServer::closeConnection(Connection* connection)
+{
+    // 在途请求完成后找不到连接，结果直接丢弃
+    ::epoll_ctl(m_epollFd, EPOLL_CTL_DEL, connection->fd, nullptr);
+    ::close(connection->fd);
+    m_connectionsById.erase(connection->id);
+    m_connections.erase(connection->fd);
+}
+
+void AuthServer::drainCompletions()
+{
+    quint64 counter;
+    while (::read(m_eventFd, &counter, sizeof(counter)) == sizeof(counter)) {
+    }
+
+    std::vector<Completion> completions;
+    {
+        std::lock_guard<std::mutex> lock(m_completionMutex);
+        completions.swap(m_completions);
+    }
+
+    for (Completion& completion : completions) {
+        auto it = m_connectionsById.find(completion.connectionId);
+        if (it == m_connectionsById.end()) {
+            continue;
+        }
+        Connection* connection = it->second;
+        connection->inFlight--;
+        queueResponse(connection, completion.sequence, completion.packet);
+        if (connection->broken) {
+            closeConnection(connection);
+        }
+    }
+}
+
+void AuthServer::processJob(AuthJob& job)
+{
+    auto started = std::chrono::steady_clock::now();
+    qint64 queueMicros = elapsedMicros(job.enqueuedAt, started);
+    QString type = job.header.value("type").toString();
+
+    // 期限从请求到达时算起，不含网络传输时间，判断偏宽松
+    qint64 deadlineMs = job.header.value("deadline_ms").toInteger(-1);
+
+    QJsonObject response;
+    if (deadlineMs >= 0 && queueMicros > deadlineMs * 1000) {
+        m_shedDeadline++;
+        response = deadlineResponse(type);
+    } else if (queueMicros > qint64(m_config.maxQueueWaitMs) * 1000) {
+        m_shedExpired++;
+        response = busyResponse(type, "请求排队超时");
+    } else {
+        if (type == "login") {
+            response = handleLogin(job);
+        } else if (type == "register") {
+            response = handleRegister(job);
+        } else if (type == "audit") {
+            response = handleAudit(job);
+        } else if (type == "ping") {
+            // 客户端端点探测：经过请求队列，往返时间反映排队情况
+            response["type"] = "ping";
+            response["success"] = true;
+            response["message"] = "pong";
+        } else {
+            response = handleIdentify(job);
+        }
+        m_processed++;
+        m_serviceMicrosTotal += quint64(elapsedMicros(started, std::chrono::steady_clock::now()));
+        m_queueMicrosTotal += quint64(queueMicros);
+    }
+
+    // 回显请求ID，便于客户端补发时对应
+    if (job.header.contains("request_id")) {
+        response["request_id"] = job.header.value("request_id");
+    }
+
+    Completion completion{ job.connectionId, job.sequence, FaceAuthProtocol::buildResponsePacket(response) };
+    {
+        std::lock_guard<std::mutex> lock(m_completionMutex);
+        m_completions.push_back(std::move(completion));
+    }
+    quint64 one = 1;
+    ssize_t written = ::write(m_eventFd, &one, sizeof(one));
+    Q_UNUSED(written);
+}
+
+QJsonObject AuthServer::handleLogin(const AuthJob& job)
+{
+    QJsonObject response;
+    response["type"] = "login";
+    response["success"] = false;
+
+    // 所有预览阶段的响应都带stage，客户端据此判断服务器是否支持两阶段上传
+    bool preview = job.header.value("stage").toString() == "preview";
+    if (preview) {
+        response["stage"] = "preview";
+    }
+
+    QString username = job.header.value("username").toString();
+    FaceMatcher::Feature enrolled;
+    if (!m_store->verifyPassword(username, job.header.value("password").toString(), &enrolled)) {
+        response["message"] = "用户名或密码错误";
+        if (preview) {
+            m_previewRejected++;
+        }
+        return response;
+    }
+
+    double brightness = 0.0;
+    FaceMatcher::Feature feature = extractFeature(job, &response, &brightness);
+    if (feature.empty()) {
+        response["message"] = "无法解码人脸图像";
+        if (preview) {
+            m_previewRejected++;
+        }
+        return response;
+    }
+
+    if (preview && (brightness < m_config.previewMinBrightness || brightness > m_config.previewMaxBrightness)) {
+        m_previewRejected++;
+        response["message"] = brightness < m_config.previewMinBrightness ? "光线不足，请调整光照后重拍" : "光线过强，请调整光照后重拍";
+        return response;
+    }
+
+    float score = FaceMatcher::similarity(feature, enrolled);
+    response["score"] = double(score);
+    if (score < (preview ? m_config.previewRejectThreshold : m_config.matchThreshold)) {
+        if (preview) {
+            m_previewRejected++;
+        }
+        response["message"] = "人脸不匹配";
+        return response;
+    }
+
+    // 预览图只能用于拒绝，通过初筛后仍需完整图像比对
+    if (preview) {
+        m_previewNeedMore++;
+        response["need_more"] = true;
+        response["message"] = "需要完整图像";
+        return response;
+    }
+
+    response["success"] = true;
+    response["username"] = username;
+    response["message"] = "登录成功";
+    return response;
+}
+
+QJsonObject AuthServer::handleRegister(const AuthJob& job)
+{
+    QJsonObject response;
+    response["type"] = "register";
+    response["success"] = false;
+
+    QString username = job.header.value("username").toString();
+    QString password = job.header.value("password").toString();
+    if (username.isEmpty() || password.isEmpty()) {
+        response["message"] = "用户名和密码不能为空";
+        return response;
+    }
+
+    FaceMatcher::Feature feature = extractFeature(job, &response);
+    if (feature.empty()) {
+        response["message"] = "无法解码人脸图像";
+        return response;
+    }
+
+    switch (m_store->addUser(username, password, feature)) {
+    case UserStore::AddResult::Added:
+        response["success"] = true;
+        response["message"] = "注册成功";
+        break;
+    case UserStore::AddResult::Exists:
+        response["message"] = "用户已存在";
+        break;
+    case UserStore::AddResult::Error:
+        response["message"] = "服务器存储错误";
+        break;
+    }
+    return response;
+}
+
+// 客户端离线期间的登录尝试，恢复连接后补发。记录不含密码也不比对人脸，只是客户端的陈述，
+// 因此从不返回success，客户端以audited判断已记录
+QJsonObject AuthServer::handleAudit(const AuthJob& job)
+{
+    QJsonObject response;
+    response["type"] = "audit";
+    response["success"] = false;
+    response["audited"] = true;
+    response["message"] = "审计记录已保存";
+    qDebug() << "审计记录:" << job.header.value("event").toString() << "用户" << job.header.value("username").toString()
+             << "于" << job.header.value("queued_at").toString() << "(离线，未验证)";
+    return response;
+}
+
+QJsonObject AuthServer::handleIdentify(const AuthJob& job)
+{
+    QJsonObject response;
+    response["type"] = "identify";
+    response["success"] = false;
+    if (job.header.contains("person_id")) {
+        response["person_id"] = job.header.value("person_id");
+    }
+
+    FaceMatcher::Feature feature = extractFeature(job, &response);
+    if (feature.empty()) {
+        response["message"] = "无法解码人脸图像";
+        return response;
+    }
+
+    float score = -1.0f;
+    QString username;
+    if (m_gallery.isOpen()) {
+        // 检索文件给出top-k候选，构建之后新注册的用户再线性补充比对
+        int topK = qBound(1, job.header.value("top_k").toInt(1), m_config.maxTopK);
+        std::vector<FaceGallery::Match> matches = m_gallery.search(feature.data(), topK, m_config.galleryThreads);
+        QJsonArray candidates;
+        for (const FaceGallery::Match& match : matches) {
+            QJsonObject candidate;
+            candidate["username"] = QString::fromStdString(m_gallery.label(match.index));
+            candidate["score"] = double(match.score);
+            candidates.append(candidate);
+        }
+        if (!matches.empty()) {
+            score = matches.front().score;
+            username = QString::fromStdString(m_gallery.label(matches.front().index));
+        }
+        float recentScore = -1.0f;
+        QString recentUser = m_store->bestMatchFrom(m_galleryCount, feature, &recentScore);
+        if (!recentUser.isEmpty() && recentScore > score) {
+            score = recentScore;
+            username = recentUser;
+        }
+        if (topK > 1) {
+            response["candidates"] = candidates;
+        }
+    } else {
+        username = m_store->bestMatch(feature, &score);
+    }
+    response["score"] = double(score);
+    if (username.isEmpty() || score < m_config.matchThreshold) {
+        response["message"] = "未识别";
+        return response;
+    }
+
+    response["success"] = true;
+    response["username"] = username;
+    response["message"] = "识别成功";
+    return response;
+}
+
+bool AuthServer::buildGallery(QString* errorMessage)
+{
+    // 以当前用户库为快照重建检索文件，运行期间注册的用户在下次启动时并入
+    auto started = std::chrono::steady_clock::now();
+    std::vector<std::string> labels;
+    std::vector<float> features;
+    m_galleryCount = m_store->snapshot(&labels, &features);
+
+    std::string error;
+    FaceGallery::Storage storage = m_config.galleryInt8 ? FaceGallery::Storage::Int8 : FaceGallery::Storage::Float32;
+    std::string path = m_config.galleryPath.toStdString();
+    if (!FaceGallery::write(path, FaceMatcher::FeatureDim, labels, features, storage, &error)
+        || !m_gallery.open(path, &error)) {
+        if (errorMessage) {
+            *errorMessage = "构建检索文件失败: " + QString::fromStdString(error);
+        }
+        return false;
+    }
+
+    qDebug() << "检索文件已构建:" << m_config.galleryPath << m_galleryCount << "个用户,"
+             << (m_config.galleryInt8 ? "int8" : "float32") << ", 内核" << SimdKernels::activeKernel()
+             << ", 耗时" << elapsedMicros(started, std::chrono::steady_clock::now()) / 1000 << "ms";
+    return true;
+}
+
+FaceMatcher::Feature AuthServer::extractFeature(const AuthJob& job, QJsonObject* response, double* brightness) const
+{
+    QList<QByteArray> frames;
+    if (!FaceAuthProtocol::splitFrames(job.header, job.payload, &frames)) {
+        return FaceMatcher::Feature();
+    }
+
+    // 无法解码的帧直接跳过，其余帧的特征平均融合
+    std::vector<FaceMatcher::Feature> features;
+    double brightnessTotal = 0.0;
+    for (const QByteArray& frame : frames) {
+        double frameBrightness = 0.0;
+        FaceMatcher::Feature feature = FaceMatcher::extract(frame, &frameBrightness);
+        if (!feature.empty()) {
+            features.push_back(std::move(feature));
+            brightnessTotal += frameBrightness;
+        }
+    }
+    if (brightness && !features.empty()) {
+        *brightness = brightnessTotal / double(features.size());
+    }
+    if (job.header.contains("frames")) {
+        response->insert("frames_used", int(features.size()));
+    }
+    return FaceMatcher::fuse(features);
+}
+
+QJsonObject AuthServer::busyResponse(const QString& type, const QString& reason) const
+{
+    QJsonObject response;
+    response["type"] = type;
+    response["success"] = false;
+    response["busy"] = true;
+    response["retry_after_ms"] = m_config.retryAfterMs;
+    response["message"] = reason + "，请稍后重试";
+    return response;
+}
+
+QJsonObject AuthServer::deadlineResponse(const QString& type) const
+{
+    QJsonObject response;
+    response["type"] = type;
+    response["success"] = false;
+    response["deadline_exceeded"] = true;
+    response["message"] = "请求已超过客户端期限";
+    return response;
+}
+
+void AuthServer::logStats()
+{
+    quint64 processed = m_processed.load();
+    quint64 requestsSinceMark = m_requests - m_statsRequestMark;
+    m_statsRequestMark = m_requests;
+
+    qDebug().noquote() << QString("连接 %1/%2, 请求 %3 (%4/s), 已处理 %5, 平均处理 %6 ms, 平均排队 %7 ms, "
+                                  "队列 %8/%9, 丢弃: 队列满 %10, 连接超限 %11, 排队超时 %12, 超过期限 %13, 拒绝连接 %14, "
+                                  "预览图: 提前拒绝 %15, 需要完整图像 %16")
+        .arg(m_connections.size()).arg(m_accepted)
+        .arg(m_requests).arg(double(requestsSinceMark) / m_config.statsIntervalSec, 0, 'f', 1)
+        .arg(processed)
+        .arg(processed ? m_serviceMicrosTotal.load() / 1000.0 / processed : 0.0, 0, 'f', 2)
+        .arg(processed ? m_queueMicrosTotal.load() / 1000.0 / processed : 0.0, 0, 'f', 2)
+        .arg(m_workers->queueDepth()).arg(m_workers->queueCapacity())
+        .arg(m_shedQueueFull).arg(m_shedPerConnection).arg(m_shedExpired.load()).arg(m_shedDeadline.load())
+        .arg(m_rejectedConnections)
+        .arg(m_previewRejected.load()).arg(m_previewNeedMore.load());
+}
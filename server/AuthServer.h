@@ -0,0 +1,142 @@
+#pragma once
+
+#include "FaceGallery.h"
+#include "UserStore.h"
+#include "WorkerPool.h"
+#include <QByteArray>
+#include <QJsonObject>
+#include <QString>
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+// FACE/RESP协议的参考认证服务器(Linux)
+//
+// 单线程epoll事件循环负责接受连接和收发数据，完整的FACE帧作为AuthJob提交到有界队列，
+// 由WorkerPool中的工作线程完成图像解码、特征提取和比对，结果经eventfd通知事件循环写回。
+// 同一连接上的响应严格按请求顺序返回，客户端可以在一条连接上流水线发送多个请求。
+//
+// 过载时显式丢弃而不是无限排队，以下情况立即回复 busy=true 和 retry_after_ms:
+//   - 全局请求队列已满
+//   - 单个连接的在途请求数超过上限
+//   - 请求在队列中等待超过 maxQueueWaitMs(客户端大概率已超时，处理它只会加剧拥塞)
+//
+// 请求头中的 deadline_ms 是客户端发送时剩余的等待时间，请求出队时已超过该期限的不再处理，
+// 直接回复 deadline_exceeded=true(客户端已放弃等待，结果没有意义)。
+//
+// 两阶段上传：stage="preview"的登录请求携带低分辨率预览图，服务器只用它提前拒绝(光照异常、
+// 相似度明显低于阈值)，否则回复 need_more=true，由客户端再上传完整图像(stage="full")。
+// 预览图本身永远不会登录成功。
+//
+// 连拍请求的负载包含多帧(请求头frames给出各帧位置)，各帧分别提取特征后平均融合，单帧的模糊或遮挡影响更小。
+class AuthServer
+{
+public:
+    struct Config {
+        quint16 port = 8101;
+        int workerThreads = 4;
+        int queueCapacity = 256;
+        int maxQueueWaitMs = 500;
+        int maxInFlightPerConnection = 16;
+        int maxConnections = 4096;
+        int retryAfterMs = 200;
+        int maxJsonBytes = 64 * 1024;
+        int maxPayloadBytes = 8 * 1024 * 1024;
+        float matchThreshold = 0.80f;
+        float previewRejectThreshold = 0.50f;   // 预览图相似度低于此值时直接拒绝
+        double previewMinBrightness = 40.0;     // 预览图灰度均值超出范围时判为光照异常
+        double previewMaxBrightness = 225.0;
+        QString galleryPath;            // 非空时启动时构建并映射1:N检索文件
+        bool galleryInt8 = false;
+        int galleryThreads = 1;         // 单次检索的并行线程数，工作线程已提供请求级并行
+        int maxTopK = 10;
+        int statsIntervalSec = 10;
+    };
+
+    AuthServer(const Config& config, UserStore* store);
+    ~AuthServer();
+
+    // 创建监听套接字、epoll实例和工作线程
+    bool start(QString* errorMessage = nullptr);
+
+    // 运行事件循环，直到收到SIGINT/SIGTERM
+    int run();
+
+private:
+    struct Connection {
+        int fd = -1;
+        quint64 id = 0;
+        QByteArray readBuffer;
+        QByteArray writeBuffer;
+        qsizetype writeOffset = 0;
+        quint64 nextSequence = 0;       // 下一个到达请求的序号
+        quint64 nextToSend = 0;         // 下一个应写回的响应序号
+        std::map<quint64, QByteArray> ready;    // 已完成但前面还有未完成请求的响应
+        int inFlight = 0;
+        bool wantWrite = false;
+        bool broken = false;            // 写入失败，由事件循环在安全的位置关闭
+    };
+
+    struct Completion {
+        quint64 connectionId;
+        quint64 sequence;
+        QByteArray packet;
+    };
+
+    void acceptConnections();
+    void handleReadable(Connection* connection);
+    bool processFrames(Connection* connection);
+    void queueResponse(Connection* connection, quint64 sequence, const QByteArray& packet);
+    bool flushWrites(Connection* connection);
+    void updateInterest(Connection* connection, bool wantWrite);
+    void closeConnection(Connection* connection);
+    void drainCompletions();
+    void logStats();
+
+    // 以下在工作线程中执行
+    void processJob(AuthJob& job);
+    QJsonObject handleLogin(const AuthJob& job);
+    QJsonObject handleRegister(const AuthJob& job);
+    QJsonObject handleAudit(const AuthJob& job);
+    QJsonObject handleIdentify(const AuthJob& job);
+    QJsonObject busyResponse(const QString& type, const QString& reason) const;
+    QJsonObject deadlineResponse(const QString& type) const;
+    FaceMatcher::Feature extractFeature(const AuthJob& job, QJsonObject* response, double* brightness = nullptr) const;
+    bool buildGallery(QString* errorMessage);
+
+    Config m_config;
+    UserStore* m_store;
+    std::unique_ptr<WorkerPool> m_workers;
+    FaceGallery m_gallery;
+    int m_galleryCount;                 // 检索文件中的用户数，之后注册的用户线性检索
+
+    int m_epollFd;
+    int m_listenFd;
+    int m_eventFd;
+    int m_signalFd;
+
+    quint64 m_nextConnectionId;
+    std::unordered_map<int, std::unique_ptr<Connection>> m_connections;
+    std::unordered_map<quint64, Connection*> m_connectionsById;
+
+    std::mutex m_completionMutex;
+    std::vector<Completion> m_completions;
+
+    // 统计
+    quint64 m_accepted;
+    quint64 m_requests;
+    quint64 m_shedQueueFull;
+    quint64 m_shedPerConnection;
+    quint64 m_rejectedConnections;
+    std::atomic<quint64> m_shedExpired;
+    std::atomic<quint64> m_shedDeadline;
+    std::atomic<quint64> m_previewRejected;
+    std::atomic<quint64> m_previewNeedMore;
+    std::atomic<quint64> m_processed;
+    std::atomic<quint64> m_serviceMicrosTotal;
+    std::atomic<quint64> m_queueMicrosTotal;
+    quint64 m_statsRequestMark;
+};
@@ -0,0 +1,148 @@
+// AuthServer 协议测试
+//
+// 在子进程中以临时用户库启动服务器，父进程通过回环地址发送请求并检查响应，结束时向子进程发送SIGTERM。
+// 返回0表示全部通过。
+#include "AuthServer.h"
+#include "UserStore.h"
+#include "FaceAuthProtocol.h"
+#include <QByteArray>
+#include <QJsonObject>
+#include <QTemporaryDir>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+
+namespace {
+
+int connectToServer(quint16 port)
+{
+    // 子进程启动需要一点时间，最多等待5秒
+    for (int attempt = 0; attempt < 100; ++attempt) {
+        int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        sockaddr_in address;
+        std::memset(&address, 0, sizeof(address));
+        address.sin_family = AF_INET;
+        address.sin_port = htons(port);
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (fd >= 0 && ::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0) {
+            return fd;
+        }
+        if (fd >= 0) {
+            ::close(fd);
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+    return -1;
+}
+
+bool exchange(int fd, const QJsonObject& header, const QByteArray& payload, QJsonObject* response)
+{
+    QByteArray packet = FaceAuthProtocol::buildRequestPacket(header, payload);
+    qsizetype sent = 0;
+    while (sent < packet.size()) {
+        ssize_t written = ::send(fd, packet.constData() + sent, size_t(packet.size() - sent), MSG_NOSIGNAL);
+        if (written <= 0) {
+            return false;
+        }
+        sent += written;
+    }
+
+    QByteArray buffer;
+    char chunk[4096];
+    for (;;) {
+        int consumed = 0;
+        FaceAuthProtocol::ParseResult result = FaceAuthProtocol::parseResponse(buffer, response, &consumed);
+        if (result == FaceAuthProtocol::ParseResult::Complete) {
+            return true;
+        }
+        if (result != FaceAuthProtocol::ParseResult::Incomplete) {
+            return false;
+        }
+        ssize_t received = ::recv(fd, chunk, sizeof(chunk), 0);
+        if (received <= 0) {
+            return false;
+        }
+        buffer.append(chunk, int(received));
+    }
+}
+
+bool check(bool condition, const char* name)
+{
+    std::printf("%s %s\n", condition ? "PASS" : "FAIL", name);
+    return condition;
+}
+
+}
+
+int main()
+{
+    QTemporaryDir dataDir;
+    if (!dataDir.isValid()) {
+        std::fprintf(stderr, "无法创建临时目录\n");
+        return 1;
+    }
+
+    AuthServer::Config config;
+    config.port = quint16(20000 + ::getpid() % 20000);
+    config.workerThreads = 1;
+    config.statsIntervalSec = 3600;
+
+    pid_t child = ::fork();
+    if (child < 0) {
+        std::fprintf(stderr, "fork失败\n");
+        return 1;
+    }
+    if (child == 0) {
+        UserStore store(dataDir.path());
+        QString error;
+        if (!store.open(&error)) {
+            std::fprintf(stderr, "打开用户库失败: %s\n", qPrintable(error));
+            ::_exit(1);
+        }
+        AuthServer server(config, &store);
+        if (!server.start(&error)) {
+            std::fprintf(stderr, "启动服务器失败: %s\n", qPrintable(error));
+            ::_exit(1);
+        }
+        ::_exit(server.run());
+    }
+
+    bool passed = false;
+    int fd = connectToServer(config.port);
+    if (check(fd >= 0, "connect")) {
+        // 离线登录审计：服务器只记录，回复audited，客户端据此才把记录标为已补发
+        QByteArray faceData(64, '\x5A');
+        QJsonObject audit;
+        audit["type"] = "audit";
+        audit["event"] = "login";
+        audit["username"] = "alice";
+        audit["request_id"] = "audit-1";
+        FaceAuthProtocol::describePayload(&audit, faceData);
+        QJsonObject response;
+        passed = check(exchange(fd, audit, faceData, &response), "audit reply");
+        passed = check(response.value("type").toString() == "audit", "audit type") && passed;
+        passed = check(response.value("audited").toBool(), "audit audited") && passed;
+        passed = check(response.value("request_id").toString() == "audit-1", "audit request_id") && passed;
+
+        // 未知类型仍被拒绝，且不带audited
+        QJsonObject unknown;
+        unknown["type"] = "bogus";
+        FaceAuthProtocol::describePayload(&unknown, QByteArray());
+        passed = check(exchange(fd, unknown, QByteArray(), &response), "unknown reply") && passed;
+        passed = check(!response.value("success").toBool() && !response.value("audited").toBool(), "unknown rejected")
+                 && passed;
+        ::close(fd);
+    }
+
+    ::kill(child, SIGTERM);
+    int status = 0;
+    ::waitpid(child, &status, 0);
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,350 @@
+#include "FaceGallery.h"
+#include "SimdKernels.h"
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+
+namespace {
+
+const char GalleryMagic[4] = { 'F', 'G', 'L', '1' };
+const std::uint32_t GalleryVersion = 1;
+const std::uint64_t Alignment = 64;
+const std::uint64_t MinRowsPerThread = 4096;   // 行数较少时多线程的启动开销大于收益
+
+#pragma pack(push, 1)
+struct FileHeader {
+    char magic[4];
+    std::uint32_t version;
+    std::uint32_t dim;
+    std::uint32_t stride;           // 每行特征占用的字节数
+    std::uint64_t count;
+    std::uint32_t storage;
+    std::uint32_t labelSize;
+    std::uint64_t vectorsOffset;
+    std::uint64_t scalesOffset;     // Float32格式为0
+    std::uint64_t labelsOffset;
+    std::uint8_t reserved[8];
+};
+#pragma pack(pop)
+static_assert(sizeof(FileHeader) == 64, "FileHeader must be 64 bytes");
+
+std::uint64_t alignUp(std::uint64_t value)
+{
+    return (value + Alignment - 1) & ~(Alignment - 1);
+}
+
+// 截断到不超过limit字节且不拆开UTF-8多字节字符的长度(中文名每字3字节)
+std::size_t utf8Truncate(const std::string& text, std::size_t limit)
+{
+    if (text.size() <= limit) {
+        return text.size();
+    }
+    std::size_t size = limit;
+    while (size > 0 && (static_cast<unsigned char>(text[size]) & 0xC0) == 0x80) {
+        --size;
+    }
+    return size;
+}
+
+// 对称量化到[-127, 127]，返回反量化比例
+float quantize(const float* values, int dim, std::int8_t* out)
+{
+    float maxAbs = 0.0f;
+    for (int i = 0; i < dim; ++i) {
+        maxAbs = std::max(maxAbs, std::fabs(values[i]));
+    }
+    float scale = maxAbs > 0.0f ? maxAbs / 127.0f : 1.0f;
+    for (int i = 0; i < dim; ++i) {
+        out[i] = std::int8_t(std::lround(values[i] / scale));
+    }
+    return scale;
+}
+
+// 保持最小堆中为分数最高的k个
+void pushTopK(std::vector<FaceGallery::Match>* heap, int k, std::uint64_t index, float score)
+{
+    auto greater = [](const FaceGallery::Match& a, const FaceGallery::Match& b) { return a.score > b.score; };
+    if (int(heap->size()) < k) {
+        heap->push_back({ index, score });
+        std::push_heap(heap->begin(), heap->end(), greater);
+    } else if (score > heap->front().score) {
+        std::pop_heap(heap->begin(), heap->end(), greater);
+        heap->back() = { index, score };
+        std::push_heap(heap->begin(), heap->end(), greater);
+    }
+}
+
+} // namespace
+
+FaceGallery::FaceGallery()
+    : m_fd(-1),
+    m_data(nullptr),
+    m_size(0),
+    m_count(0),
+    m_dim(0),
+    m_stride(0),
+    m_storage(Storage::Float32),
+    m_vectors(nullptr),
+    m_scales(nullptr),
+    m_labels(nullptr)
+{
+}
+
+FaceGallery::~FaceGallery()
+{
+    close();
+}
+
+bool FaceGallery::write(const std::string& path, int dim, const std::vector<std::string>& labels,
+                        const std::vector<float>& features, Storage storage, std::string* errorMessage)
+{
+    auto fail = [errorMessage](const std::string& what) {
+        if (errorMessage) {
+            *errorMessage = what;
+        }
+        return false;
+    };
+
+    std::uint64_t count = labels.size();
+    if (dim <= 0 || features.size() != count * std::uint64_t(dim)) {
+        return fail("特征矩阵尺寸与标签数量不一致");
+    }
+
+    FileHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, GalleryMagic, sizeof(GalleryMagic));
+    header.version = GalleryVersion;
+    header.dim = std::uint32_t(dim);
+    header.stride = std::uint32_t(alignUp(std::uint64_t(dim) * (storage == Storage::Int8 ? 1 : sizeof(float))));
+    header.count = count;
+    header.storage = std::uint32_t(storage);
+    header.labelSize = LabelSize;
+    header.vectorsOffset = sizeof(FileHeader);
+    std::uint64_t vectorsEnd = header.vectorsOffset + count * header.stride;
+    header.scalesOffset = storage == Storage::Int8 ? alignUp(vectorsEnd) : 0;
+    header.labelsOffset = alignUp(storage == Storage::Int8 ? header.scalesOffset + count * sizeof(float) : vectorsEnd);
+
+    // 先写临时文件再改名，正在被映射的旧文件不受影响
+    std::string tempPath = path + ".tmp";
+    std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+    if (!file) {
+        return fail("无法创建检索文件: " + tempPath);
+    }
+
+    // 逐行写入，内存占用与图库大小无关
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    std::vector<char> rowData(header.stride);
+    std::vector<float> scales;
+    scales.reserve(storage == Storage::Int8 ? count : 0);
+    std::vector<float> normalized(dim);
+    for (std::uint64_t row = 0; row < count; ++row) {
+        const float* source = features.data() + row * dim;
+        double norm = 0.0;
+        for (int i = 0; i < dim; ++i) {
+            norm += double(source[i]) * source[i];
+        }
+        float inverse = norm > 0.0 ? float(1.0 / std::sqrt(norm)) : 0.0f;
+        for (int i = 0; i < dim; ++i) {
+            normalized[i] = source[i] * inverse;
+        }
+
+        if (storage == Storage::Int8) {
+            scales.push_back(quantize(normalized.data(), dim, reinterpret_cast<std::int8_t*>(rowData.data())));
+        } else {
+            std::memcpy(rowData.data(), normalized.data(), dim * sizeof(float));
+        }
+        file.write(rowData.data(), std::streamsize(rowData.size()));
+    }
+
+    auto padTo = [&file](std::uint64_t offset) {
+        std::uint64_t position = std::uint64_t(file.tellp());
+        if (offset > position) {
+            std::vector<char> zeros(std::size_t(offset - position), 0);
+            file.write(zeros.data(), std::streamsize(zeros.size()));
+        }
+    };
+    if (storage == Storage::Int8) {
+        padTo(header.scalesOffset);
+        file.write(reinterpret_cast<const char*>(scales.data()), std::streamsize(scales.size() * sizeof(float)));
+    }
+    padTo(header.labelsOffset);
+    char slot[LabelSize];
+    for (const std::string& label : labels) {
+        std::memset(slot, 0, sizeof(slot));
+        std::memcpy(slot, label.data(), utf8Truncate(label, LabelSize - 1));
+        file.write(slot, sizeof(slot));
+    }
+    file.close();
+    if (!file) {
+        return fail("写入检索文件失败: " + tempPath);
+    }
+    if (std::rename(tempPath.c_str(), path.c_str()) != 0) {
+        return fail("重命名检索文件失败: " + std::string(std::strerror(errno)));
+    }
+    return true;
+}
+
+bool FaceGallery::open(const std::string& path, std::string* errorMessage)
+{
+    close();
+    auto fail = [this, errorMessage](const std::string& what) {
+        if (errorMessage) {
+            *errorMessage = what;
+        }
+        close();
+        return false;
+    };
+
+    m_fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (m_fd < 0) {
+        return fail("无法打开检索文件: " + std::string(std::strerror(errno)));
+    }
+    struct stat info;
+    if (::fstat(m_fd, &info) != 0 || std::size_t(info.st_size) < sizeof(FileHeader)) {
+        return fail("检索文件过小");
+    }
+
+    m_size = std::size_t(info.st_size);
+    void* mapped = ::mmap(nullptr, m_size, PROT_READ, MAP_SHARED, m_fd, 0);
+    if (mapped == MAP_FAILED) {
+        return fail("映射检索文件失败: " + std::string(std::strerror(errno)));
+    }
+    m_data = static_cast<const unsigned char*>(mapped);
+    // 检索是顺序扫描，提示内核预读
+    ::madvise(mapped, m_size, MADV_SEQUENTIAL | MADV_WILLNEED);
+
+    FileHeader header;
+    std::memcpy(&header, m_data, sizeof(header));
+    if (std::memcmp(header.magic, GalleryMagic, sizeof(GalleryMagic)) != 0 || header.version != GalleryVersion
+        || header.labelSize != LabelSize || header.dim == 0
+        || (header.storage != std::uint32_t(Storage::Float32) && header.storage != std::uint32_t(Storage::Int8))) {
+        return fail("检索文件格式无效");
+    }
+    Storage storage = Storage(header.storage);
+    std::uint64_t minStride = std::uint64_t(header.dim) * (storage == Storage::Int8 ? 1 : sizeof(float));
+    if (header.stride < minStride || header.stride % Alignment != 0 || header.vectorsOffset % Alignment != 0
+        || header.vectorsOffset + header.count * header.stride > m_size
+        || header.labelsOffset + header.count * LabelSize > m_size
+        || (storage == Storage::Int8 && header.scalesOffset + header.count * sizeof(float) > m_size)) {
+        return fail("检索文件已损坏");
+    }
+
+    m_count = header.count;
+    m_dim = int(header.dim);
+    m_stride = header.stride;
+    m_storage = storage;
+    m_vectors = m_data + header.vectorsOffset;
+    m_scales = storage == Storage::Int8 ? reinterpret_cast<const float*>(m_data + header.scalesOffset) : nullptr;
+    m_labels = reinterpret_cast<const char*>(m_data + header.labelsOffset);
+    return true;
+}
+
+void FaceGallery::close()
+{
+    if (m_data) {
+        ::munmap(const_cast<unsigned char*>(m_data), m_size);
+    }
+    if (m_fd >= 0) {
+        ::close(m_fd);
+    }
+    m_fd = -1;
+    m_data = nullptr;
+    m_size = 0;
+    m_count = 0;
+    m_dim = 0;
+    m_stride = 0;
+    m_vectors = nullptr;
+    m_scales = nullptr;
+    m_labels = nullptr;
+}
+
+std::string FaceGallery::label(std::uint64_t index) const
+{
+    if (index >= m_count) {
+        return std::string();
+    }
+    const char* slot = m_labels + index * LabelSize;
+    return std::string(slot, strnlen(slot, LabelSize));
+}
+
+void FaceGallery::scanRange(const float* query, const std::int8_t* quantizedQuery, float queryScale,
+                            std::uint64_t begin, std::uint64_t end, int k, std::vector<Match>* heap) const
+{
+    heap->reserve(k);
+    if (m_storage == Storage::Int8) {
+        for (std::uint64_t row = begin; row < end; ++row) {
+            const std::int8_t* vector = reinterpret_cast<const std::int8_t*>(m_vectors + row * m_stride);
+            float score = float(SimdKernels::dotI8(quantizedQuery, vector, m_dim)) * queryScale * m_scales[row];
+            pushTopK(heap, k, row, score);
+        }
+    } else {
+        for (std::uint64_t row = begin; row < end; ++row) {
+            const float* vector = reinterpret_cast<const float*>(m_vectors + row * m_stride);
+            pushTopK(heap, k, row, SimdKernels::dotF32(query, vector, m_dim));
+        }
+    }
+}
+
+std::vector<FaceGallery::Match> FaceGallery::search(const float* query, int k, int threadCount) const
+{
+    std::vector<Match> result;
+    if (!m_data || m_count == 0 || k <= 0) {
+        return result;
+    }
+
+    // 查询同样归一化(int8格式还需量化)，分数即余弦相似度
+    std::vector<float> normalized(query, query + m_dim);
+    double norm = 0.0;
+    for (float value : normalized) {
+        norm += double(value) * value;
+    }
+    if (norm > 0.0) {
+        float inverse = float(1.0 / std::sqrt(norm));
+        for (float& value : normalized) {
+            value *= inverse;
+        }
+    }
+    std::vector<std::int8_t> quantized;
+    float queryScale = 1.0f;
+    if (m_storage == Storage::Int8) {
+        quantized.resize(m_dim);
+        queryScale = quantize(normalized.data(), m_dim, quantized.data());
+    }
+
+    std::uint64_t maxThreads = std::max<std::uint64_t>(1, m_count / MinRowsPerThread);
+    int threads = int(std::min<std::uint64_t>(std::max(1, threadCount), maxThreads));
+    std::vector<std::vector<Match>> partial(threads);
+    std::uint64_t chunk = (m_count + threads - 1) / threads;
+
+    // 主线程扫描最后一段，其余段分给临时线程
+    std::vector<std::thread> workers;
+    workers.reserve(threads - 1);
+    for (int t = 0; t < threads; ++t) {
+        std::uint64_t begin = std::uint64_t(t) * chunk;
+        std::uint64_t end = std::min(m_count, begin + chunk);
+        if (t == threads - 1) {
+            scanRange(normalized.data(), quantized.data(), queryScale, begin, end, k, &partial[t]);
+        } else {
+            workers.emplace_back(&FaceGallery::scanRange, this, normalized.data(), quantized.data(), queryScale,
+                                 begin, end, k, &partial[t]);
+        }
+    }
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+
+    for (const std::vector<Match>& heap : partial) {
+        for (const Match& match : heap) {
+            pushTopK(&result, k, match.index, match.score);
+        }
+    }
+    std::sort(result.begin(), result.end(), [](const Match& a, const Match& b) { return a.score > b.score; });
+    return result;
+}
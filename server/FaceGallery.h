@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// 1:N人脸检索库：内存映射的连续特征文件 + SIMD点积 + 多线程top-k
+//
+// 文件布局(所有区段按64字节对齐，每行特征也按64字节对齐，便于SIMD加载且不跨缓存行):
+//   FileHeader(64字节) | 特征矩阵(count行 x stride字节) | 每行量化比例(仅int8) | 标签(count x 64字节)
+//
+// 特征在写入时归一化，检索分数即余弦相似度。int8格式按行对称量化，
+// 存储和内存带宽降为float的1/4，分数误差通常在0.01以内。
+// 文件以只读方式映射，多个线程可以并发检索同一个FaceGallery。
+class FaceGallery
+{
+public:
+    enum class Storage : std::uint32_t {
+        Float32 = 0,
+        Int8 = 1
+    };
+
+    struct Match {
+        std::uint64_t index = 0;
+        float score = 0.0f;
+    };
+
+    static constexpr int LabelSize = 64;
+
+    FaceGallery();
+    ~FaceGallery();
+    FaceGallery(const FaceGallery&) = delete;
+    FaceGallery& operator=(const FaceGallery&) = delete;
+
+    // 将特征写入新的检索文件，features为count x dim的行主序矩阵
+    static bool write(const std::string& path, int dim, const std::vector<std::string>& labels,
+                      const std::vector<float>& features, Storage storage, std::string* errorMessage = nullptr);
+
+    bool open(const std::string& path, std::string* errorMessage = nullptr);
+    void close();
+    bool isOpen() const { return m_data != nullptr; }
+
+    std::uint64_t count() const { return m_count; }
+    int dim() const { return m_dim; }
+    Storage storage() const { return m_storage; }
+    std::string label(std::uint64_t index) const;
+
+    // 返回分数最高的k个结果(降序)。行数足够多时拆分到threadCount个线程并行扫描
+    std::vector<Match> search(const float* query, int k, int threadCount = 1) const;
+
+private:
+    void scanRange(const float* query, const std::int8_t* quantizedQuery, float queryScale,
+                   std::uint64_t begin, std::uint64_t end, int k, std::vector<Match>* heap) const;
+
+    int m_fd;
+    const unsigned char* m_data;
+    std::size_t m_size;
+    std::uint64_t m_count;
+    int m_dim;
+    std::uint32_t m_stride;
+    Storage m_storage;
+    const unsigned char* m_vectors;
+    const float* m_scales;
+    const char* m_labels;
+};
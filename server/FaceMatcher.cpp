@@ -0,0 +1,94 @@
+#include "FaceMatcher.h"
+#include "SimdKernels.h"
+#include <QDebug>
+#include <opencv2/imgcodecs.hpp>
+#include <opencv2/imgproc.hpp>
+#include <cmath>
+
+namespace FaceMatcher
+{
+
+Feature extract(const QByteArray& imageData, double* brightness)
+{
+    if (imageData.isEmpty()) {
+        return Feature();
+    }
+
+    try {
+        cv::Mat encoded(1, int(imageData.size()), CV_8UC1, const_cast<char*>(imageData.constData()));
+        // 直接解码为灰度，省去一次颜色转换
+        cv::Mat gray = cv::imdecode(encoded, cv::IMREAD_GRAYSCALE);
+        if (gray.empty()) {
+            return Feature();
+        }
+
+        cv::Mat small;
+        cv::resize(gray, small, cv::Size(FeatureSide, FeatureSide), 0, 0, cv::INTER_AREA);
+        if (brightness) {
+            // 面积插值缩小后的均值即原图均值，在均衡化之前取
+            *brightness = cv::mean(small)[0];
+        }
+        cv::equalizeHist(small, small);
+
+        Feature feature(FeatureDim);
+        double mean = cv::mean(small)[0];
+        double norm = 0.0;
+        for (int y = 0; y < FeatureSide; ++y) {
+            const uchar* row = small.ptr<uchar>(y);
+            for (int x = 0; x < FeatureSide; ++x) {
+                float value = float(row[x] - mean);
+                feature[y * FeatureSide + x] = value;
+                norm += double(value) * value;
+            }
+        }
+
+        if (norm <= 0.0) {
+            return Feature();
+        }
+        float scale = float(1.0 / std::sqrt(norm));
+        for (float& value : feature) {
+            value *= scale;
+        }
+        return feature;
+    }
+    catch (const cv::Exception& e) {
+        qDebug() << "人脸图像解码异常:" << e.what();
+        return Feature();
+    }
+}
+
+Feature fuse(const std::vector<Feature>& features)
+{
+    if (features.size() <= 1) {
+        return features.empty() ? Feature() : features.front();
+    }
+
+    Feature fused(FeatureDim, 0.0f);
+    for (const Feature& feature : features) {
+        for (int i = 0; i < FeatureDim; ++i) {
+            fused[i] += feature[i];
+        }
+    }
+    double norm = 0.0;
+    for (float value : fused) {
+        norm += double(value) * value;
+    }
+    if (norm <= 0.0) {
+        return Feature();
+    }
+    float scale = float(1.0 / std::sqrt(norm));
+    for (float& value : fused) {
+        value *= scale;
+    }
+    return fused;
+}
+
+float similarity(const Feature& a, const Feature& b)
+{
+    if (a.size() != b.size() || a.empty()) {
+        return -1.0f;
+    }
+    return SimdKernels::dotF32(a.data(), b.data(), int(a.size()));
+}
+
+}
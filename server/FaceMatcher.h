@@ -0,0 +1,26 @@
+#pragma once
+
+#include <QByteArray>
+#include <vector>
+
+// 参考服务器使用的简单人脸特征
+//
+// 将人脸图像缩放为32x32灰度图并做直方图均衡，去均值后归一化为1024维向量，
+// 两张人脸的相似度为特征的余弦相似度。这只是用于压测协议和服务器流水线的占位实现，
+// 计算量与真实识别模型相比很小，不具备实际的识别精度。
+namespace FaceMatcher
+{
+    constexpr int FeatureSide = 32;
+    constexpr int FeatureDim = FeatureSide * FeatureSide;
+
+    using Feature = std::vector<float>;
+
+    // 从JPEG/PNG数据提取特征，解码失败时返回空向量。brightness非空时输出灰度均值(0-255)
+    Feature extract(const QByteArray& imageData, double* brightness = nullptr);
+
+    // 多帧特征融合：逐维平均后重新归一化，单帧时原样返回，输入为空时返回空向量
+    Feature fuse(const std::vector<Feature>& features);
+
+    // 两个归一化特征的余弦相似度，范围[-1, 1]
+    float similarity(const Feature& a, const Feature& b);
+}
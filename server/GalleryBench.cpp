@@ -0,0 +1,135 @@
+// FaceGallery 1:N检索基准测试
+//
+// 为每个图库规模生成随机特征，分别以float和int8格式写入检索文件并映射，
+// 用带噪声的图库特征作为查询，输出单线程/多线程下的每秒查询数和top-1命中率。
+//
+// 用法: FaceGalleryBench [--dim 512] [--sizes 1000,10000,100000] [--queries 200] [--k 5]
+//                        [--threads N] [--dir /tmp]
+#include "FaceGallery.h"
+#include "SimdKernels.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct Options {
+    int dim = 512;
+    std::vector<std::uint64_t> sizes = { 1000, 10000, 100000 };
+    int queries = 200;
+    int k = 5;
+    int threads = int(std::max(1u, std::thread::hardware_concurrency()));
+    std::string directory = "/tmp";
+};
+
+bool parseOptions(int argc, char* argv[], Options* options)
+{
+    for (int i = 1; i < argc; ++i) {
+        std::string name = argv[i];
+        if (i + 1 >= argc) {
+            return false;
+        }
+        std::string value = argv[++i];
+        if (name == "--dim") {
+            options->dim = std::max(1, std::atoi(value.c_str()));
+        } else if (name == "--queries") {
+            options->queries = std::max(1, std::atoi(value.c_str()));
+        } else if (name == "--k") {
+            options->k = std::max(1, std::atoi(value.c_str()));
+        } else if (name == "--threads") {
+            options->threads = std::max(1, std::atoi(value.c_str()));
+        } else if (name == "--dir") {
+            options->directory = value;
+        } else if (name == "--sizes") {
+            options->sizes.clear();
+            std::stringstream stream(value);
+            std::string item;
+            while (std::getline(stream, item, ',')) {
+                options->sizes.push_back(std::strtoull(item.c_str(), nullptr, 10));
+            }
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    Options options;
+    if (!parseOptions(argc, argv, &options)) {
+        std::fprintf(stderr, "用法: %s [--dim N] [--sizes a,b,c] [--queries N] [--k N] [--threads N] [--dir path]\n", argv[0]);
+        return 1;
+    }
+
+    std::printf("kernel=%s dim=%d queries=%d k=%d\n", SimdKernels::activeKernel(), options.dim, options.queries, options.k);
+    std::printf("%10s %8s %8s %12s %10s %8s\n", "gallery", "storage", "threads", "queries/s", "ms/query", "top1");
+
+    std::mt19937 random(42);
+    std::normal_distribution<float> gaussian(0.0f, 1.0f);
+
+    for (std::uint64_t size : options.sizes) {
+        std::vector<std::string> labels(size);
+        std::vector<float> features(size * options.dim);
+        for (std::uint64_t row = 0; row < size; ++row) {
+            labels[row] = "user" + std::to_string(row);
+        }
+        for (float& value : features) {
+            value = gaussian(random);
+        }
+
+        // 查询为图库中随机一行加上噪声，期望top-1为该行
+        std::vector<std::uint64_t> expected(options.queries);
+        std::vector<float> queries(std::size_t(options.queries) * options.dim);
+        std::uniform_int_distribution<std::uint64_t> pick(0, size - 1);
+        for (int q = 0; q < options.queries; ++q) {
+            expected[q] = pick(random);
+            for (int i = 0; i < options.dim; ++i) {
+                queries[std::size_t(q) * options.dim + i] = features[expected[q] * options.dim + i] + 0.3f * gaussian(random);
+            }
+        }
+
+        for (FaceGallery::Storage storage : { FaceGallery::Storage::Float32, FaceGallery::Storage::Int8 }) {
+            const char* storageName = storage == FaceGallery::Storage::Int8 ? "int8" : "float32";
+            std::string path = options.directory + "/facegallery-bench-" + std::to_string(size) + "-" + storageName + ".fgl";
+            std::string error;
+            FaceGallery gallery;
+            if (!FaceGallery::write(path, options.dim, labels, features, storage, &error) || !gallery.open(path, &error)) {
+                std::fprintf(stderr, "%s\n", error.c_str());
+                return 1;
+            }
+
+            std::vector<int> threadCounts = { 1 };
+            if (options.threads > 1) {
+                threadCounts.push_back(options.threads);
+            }
+            for (int threads : threadCounts) {
+                int hits = 0;
+                auto started = std::chrono::steady_clock::now();
+                for (int q = 0; q < options.queries; ++q) {
+                    std::vector<FaceGallery::Match> matches =
+                        gallery.search(queries.data() + std::size_t(q) * options.dim, options.k, threads);
+                    if (!matches.empty() && matches.front().index == expected[q]) {
+                        hits++;
+                    }
+                }
+                double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+                std::printf("%10llu %8s %8d %12.1f %10.3f %7.1f%%\n", static_cast<unsigned long long>(size), storageName,
+                            threads, options.queries / seconds, seconds * 1000.0 / options.queries,
+                            100.0 * hits / options.queries);
+            }
+
+            gallery.close();
+            std::remove(path.c_str());
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,205 @@
+#include "SimdKernels.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define FACEAUTH_X86 1
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define FACEAUTH_NEON 1
+#endif
+
+namespace {
+
+float dotF32Scalar(const float* a, const float* b, int n)
+{
+    // 四路累加，便于编译器自动向量化
+    float s0 = 0.0f, s1 = 0.0f, s2 = 0.0f, s3 = 0.0f;
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        s0 += a[i] * b[i];
+        s1 += a[i + 1] * b[i + 1];
+        s2 += a[i + 2] * b[i + 2];
+        s3 += a[i + 3] * b[i + 3];
+    }
+    for (; i < n; ++i) {
+        s0 += a[i] * b[i];
+    }
+    return (s0 + s1) + (s2 + s3);
+}
+
+std::int32_t dotI8Scalar(const std::int8_t* a, const std::int8_t* b, int n)
+{
+    std::int32_t sum = 0;
+    for (int i = 0; i < n; ++i) {
+        sum += std::int32_t(a[i]) * std::int32_t(b[i]);
+    }
+    return sum;
+}
+
+#if defined(FACEAUTH_X86)
+
+__attribute__((target("avx2,fma")))
+float dotF32Avx2(const float* a, const float* b, int n)
+{
+    __m256 acc0 = _mm256_setzero_ps();
+    __m256 acc1 = _mm256_setzero_ps();
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), acc0);
+        acc1 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8), acc1);
+    }
+    for (; i + 8 <= n; i += 8) {
+        acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), acc0);
+    }
+    __m256 acc = _mm256_add_ps(acc0, acc1);
+    __m128 sum = _mm_add_ps(_mm256_castps256_ps128(acc), _mm256_extractf128_ps(acc, 1));
+    sum = _mm_hadd_ps(sum, sum);
+    sum = _mm_hadd_ps(sum, sum);
+    float result = _mm_cvtss_f32(sum);
+    for (; i < n; ++i) {
+        result += a[i] * b[i];
+    }
+    return result;
+}
+
+__attribute__((target("avx2")))
+std::int32_t dotI8Avx2(const std::int8_t* a, const std::int8_t* b, int n)
+{
+    // 符号扩展为16位后用madd两两相乘相加，结果为8个32位部分和
+    __m256i acc = _mm256_setzero_si256();
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m256i va = _mm256_cvtepi8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i)));
+        __m256i vb = _mm256_cvtepi8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i)));
+        acc = _mm256_add_epi32(acc, _mm256_madd_epi16(va, vb));
+    }
+    __m128i sum = _mm_add_epi32(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+    sum = _mm_hadd_epi32(sum, sum);
+    sum = _mm_hadd_epi32(sum, sum);
+    std::int32_t result = _mm_cvtsi128_si32(sum);
+    for (; i < n; ++i) {
+        result += std::int32_t(a[i]) * std::int32_t(b[i]);
+    }
+    return result;
+}
+
+bool cpuHasAvx2()
+{
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+}
+
+#elif defined(FACEAUTH_NEON)
+
+// 32位ARMv7的NEON没有跨通道求和(vaddvq)，也不一定有融合乘加，低端门禁设备多为此类
+inline float32x4_t multiplyAdd(float32x4_t acc, float32x4_t a, float32x4_t b)
+{
+#if defined(__ARM_FEATURE_FMA)
+    return vfmaq_f32(acc, a, b);
+#else
+    return vmlaq_f32(acc, a, b);
+#endif
+}
+
+inline float horizontalSum(float32x4_t v)
+{
+#if defined(__aarch64__)
+    return vaddvq_f32(v);
+#else
+    float32x2_t sum = vadd_f32(vget_low_f32(v), vget_high_f32(v));
+    return vget_lane_f32(vpadd_f32(sum, sum), 0);
+#endif
+}
+
+inline std::int32_t horizontalSum(int32x4_t v)
+{
+#if defined(__aarch64__)
+    return vaddvq_s32(v);
+#else
+    int32x2_t sum = vadd_s32(vget_low_s32(v), vget_high_s32(v));
+    return vget_lane_s32(vpadd_s32(sum, sum), 0);
+#endif
+}
+
+float dotF32Neon(const float* a, const float* b, int n)
+{
+    float32x4_t acc0 = vdupq_n_f32(0.0f);
+    float32x4_t acc1 = vdupq_n_f32(0.0f);
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        acc0 = multiplyAdd(acc0, vld1q_f32(a + i), vld1q_f32(b + i));
+        acc1 = multiplyAdd(acc1, vld1q_f32(a + i + 4), vld1q_f32(b + i + 4));
+    }
+    float result = horizontalSum(vaddq_f32(acc0, acc1));
+    for (; i < n; ++i) {
+        result += a[i] * b[i];
+    }
+    return result;
+}
+
+std::int32_t dotI8Neon(const std::int8_t* a, const std::int8_t* b, int n)
+{
+    int32x4_t acc = vdupq_n_s32(0);
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        int8x16_t va = vld1q_s8(a + i);
+        int8x16_t vb = vld1q_s8(b + i);
+        int16x8_t low = vmull_s8(vget_low_s8(va), vget_low_s8(vb));
+        int16x8_t high = vmull_s8(vget_high_s8(va), vget_high_s8(vb));
+        acc = vpadalq_s16(acc, low);
+        acc = vpadalq_s16(acc, high);
+    }
+    std::int32_t result = horizontalSum(acc);
+    for (; i < n; ++i) {
+        result += std::int32_t(a[i]) * std::int32_t(b[i]);
+    }
+    return result;
+}
+
+#endif
+
+struct Kernels {
+    float (*dotF32)(const float*, const float*, int);
+    std::int32_t (*dotI8)(const std::int8_t*, const std::int8_t*, int);
+    const char* name;
+};
+
+Kernels selectKernels()
+{
+#if defined(FACEAUTH_X86)
+    if (cpuHasAvx2()) {
+        return { dotF32Avx2, dotI8Avx2, "avx2" };
+    }
+#elif defined(FACEAUTH_NEON)
+    return { dotF32Neon, dotI8Neon, "neon" };
+#endif
+    return { dotF32Scalar, dotI8Scalar, "scalar" };
+}
+
+const Kernels& kernels()
+{
+    static const Kernels selected = selectKernels();
+    return selected;
+}
+
+} // namespace
+
+namespace SimdKernels
+{
+
+float dotF32(const float* a, const float* b, int n)
+{
+    return kernels().dotF32(a, b, n);
+}
+
+std::int32_t dotI8(const std::int8_t* a, const std::int8_t* b, int n)
+{
+    return kernels().dotI8(a, b, n);
+}
+
+const char* activeKernel()
+{
+    return kernels().name;
+}
+
+}
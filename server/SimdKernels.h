@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstdint>
+
+// 人脸特征比对的点积内核
+//
+// x86-64上运行时检测AVX2+FMA，ARM64上使用NEON，其他平台使用标量实现。
+// 调用方负责传入相同长度的向量，长度不要求是SIMD宽度的倍数。
+namespace SimdKernels
+{
+    float dotF32(const float* a, const float* b, int n);
+    std::int32_t dotI8(const std::int8_t* a, const std::int8_t* b, int n);
+
+    // 当前使用的内核名称，用于日志和基准测试输出
+    const char* activeKernel();
+}
@@ -0,0 +1,176 @@
+#include "UserStore.h"
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QRandomGenerator>
+#include <cstring>
+#include <mutex>
+#include <unistd.h>
+
+UserStore::UserStore(const QString& directory)
+    : m_directory(directory)
+{
+}
+
+UserStore::~UserStore()
+{
+    m_file.close();
+}
+
+QByteArray UserStore::hashPassword(const QByteArray& salt, const QString& password)
+{
+    QCryptographicHash hash(QCryptographicHash::Sha256);
+    hash.addData(salt);
+    hash.addData(password.toUtf8());
+    return hash.result();
+}
+
+bool UserStore::open(QString* errorMessage)
+{
+    if (!QDir().mkpath(m_directory)) {
+        if (errorMessage) {
+            *errorMessage = "无法创建数据目录: " + m_directory;
+        }
+        return false;
+    }
+
+    m_file.setFileName(QDir(m_directory).filePath("users.jsonl"));
+    if (!m_file.open(QIODevice::ReadWrite | QIODevice::Append)) {
+        if (errorMessage) {
+            *errorMessage = m_file.errorString();
+        }
+        return false;
+    }
+
+    // 逐行加载，末尾不完整的行(写入时崩溃)直接跳过
+    m_file.seek(0);
+    int skipped = 0;
+    while (!m_file.atEnd()) {
+        QJsonObject object = QJsonDocument::fromJson(m_file.readLine()).object();
+        QString username = object.value("username").toString();
+        QByteArray featureData = QByteArray::fromBase64(object.value("feature").toString().toLatin1());
+        if (username.isEmpty() || featureData.size() != FaceMatcher::FeatureDim * int(sizeof(float))) {
+            skipped++;
+            continue;
+        }
+
+        User user;
+        user.salt = QByteArray::fromBase64(object.value("salt").toString().toLatin1());
+        user.passwordHash = QByteArray::fromBase64(object.value("password_hash").toString().toLatin1());
+        user.feature.resize(FaceMatcher::FeatureDim);
+        std::memcpy(user.feature.data(), featureData.constData(), featureData.size());
+        if (!m_users.contains(username)) {
+            m_order.append(username);
+        }
+        m_users.insert(username, user);
+    }
+
+    qDebug() << "用户库已加载:" << m_users.size() << "个用户," << skipped << "行无效";
+    return true;
+}
+
+UserStore::AddResult UserStore::addUser(const QString& username, const QString& password,
+                                        const FaceMatcher::Feature& feature)
+{
+    User user;
+    user.salt.resize(16);
+    QRandomGenerator::system()->fillRange(reinterpret_cast<quint32*>(user.salt.data()), 4);
+    user.passwordHash = hashPassword(user.salt, password);
+    user.feature = feature;
+
+    QJsonObject object;
+    object["username"] = username;
+    object["salt"] = QString::fromLatin1(user.salt.toBase64());
+    object["password_hash"] = QString::fromLatin1(user.passwordHash.toBase64());
+    object["feature"] = QString::fromLatin1(QByteArray(reinterpret_cast<const char*>(feature.data()),
+        qsizetype(feature.size() * sizeof(float))).toBase64());
+    object["created_at"] = QDateTime::currentDateTimeUtc().toString(Qt::ISODate);
+    QByteArray line = QJsonDocument(object).toJson(QJsonDocument::Compact) + '\n';
+
+    std::unique_lock<std::shared_mutex> lock(m_mutex);
+    if (m_users.contains(username)) {
+        return AddResult::Exists;
+    }
+
+    // 落盘后才对外可见，确保返回成功的注册在崩溃后仍然存在
+    if (m_file.write(line) != line.size() || !m_file.flush() || ::fdatasync(m_file.handle()) != 0) {
+        qDebug() << "写入用户库失败:" << m_file.errorString();
+        return AddResult::Error;
+    }
+    m_users.insert(username, user);
+    m_order.append(username);
+    return AddResult::Added;
+}
+
+bool UserStore::verifyPassword(const QString& username, const QString& password,
+                               FaceMatcher::Feature* feature) const
+{
+    std::shared_lock<std::shared_mutex> lock(m_mutex);
+    auto it = m_users.constFind(username);
+    if (it == m_users.constEnd()) {
+        return false;
+    }
+
+    QByteArray expected = it->passwordHash;
+    QByteArray actual = hashPassword(it->salt, password);
+    // 定长比较，耗时与匹配位置无关
+    unsigned char diff = expected.size() == actual.size() ? 0 : 1;
+    for (int i = 0; i < qMin(expected.size(), actual.size()); ++i) {
+        diff |= static_cast<unsigned char>(expected[i] ^ actual[i]);
+    }
+    if (diff != 0) {
+        return false;
+    }
+
+    if (feature) {
+        *feature = it->feature;
+    }
+    return true;
+}
+
+QString UserStore::bestMatch(const FaceMatcher::Feature& feature, float* score) const
+{
+    return bestMatchFrom(0, feature, score);
+}
+
+QString UserStore::bestMatchFrom(int firstIndex, const FaceMatcher::Feature& feature, float* score) const
+{
+    std::shared_lock<std::shared_mutex> lock(m_mutex);
+    QString bestUser;
+    float bestScore = -1.0f;
+    for (int i = qMax(0, firstIndex); i < m_order.size(); ++i) {
+        float s = FaceMatcher::similarity(feature, m_users.constFind(m_order.at(i))->feature);
+        if (s > bestScore) {
+            bestScore = s;
+            bestUser = m_order.at(i);
+        }
+    }
+    if (score) {
+        *score = bestScore;
+    }
+    return bestUser;
+}
+
+int UserStore::snapshot(std::vector<std::string>* labels, std::vector<float>* features) const
+{
+    std::shared_lock<std::shared_mutex> lock(m_mutex);
+    labels->clear();
+    features->clear();
+    labels->reserve(m_order.size());
+    features->reserve(size_t(m_order.size()) * FaceMatcher::FeatureDim);
+    for (const QString& username : m_order) {
+        const FaceMatcher::Feature& feature = m_users.constFind(username)->feature;
+        labels->push_back(username.toStdString());
+        features->insert(features->end(), feature.begin(), feature.end());
+    }
+    return m_order.size();
+}
+
+int UserStore::userCount() const
+{
+    std::shared_lock<std::shared_mutex> lock(m_mutex);
+    return m_users.size();
+}
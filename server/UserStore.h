@@ -0,0 +1,61 @@
+#pragma once
+
+#include "FaceMatcher.h"
+#include <QFile>
+#include <QHash>
+#include <QString>
+#include <QStringList>
+#include <shared_mutex>
+#include <string>
+#include <vector>
+
+// 参考服务器的用户存储
+//
+// 用户记录以JSON行的形式追加写入 users.jsonl(用户名、加盐口令哈希、人脸特征)，
+// 启动时全部加载到内存，注册时追加一行并fdatasync后才返回成功。
+// 查询持读锁、注册持写锁，多个工作线程可以并发验证。
+class UserStore
+{
+public:
+    enum class AddResult {
+        Added,
+        Exists,
+        Error
+    };
+
+    explicit UserStore(const QString& directory);
+    ~UserStore();
+
+    bool open(QString* errorMessage = nullptr);
+
+    AddResult addUser(const QString& username, const QString& password, const FaceMatcher::Feature& feature);
+
+    // 用户存在且口令正确时返回true，并通过feature返回其注册特征
+    bool verifyPassword(const QString& username, const QString& password, FaceMatcher::Feature* feature) const;
+
+    // 1:N线性检索，返回相似度最高的用户名，无用户时返回空字符串
+    QString bestMatch(const FaceMatcher::Feature& feature, float* score) const;
+
+    // 只在注册顺序中第firstIndex个及之后的用户中检索(检索文件构建之后新注册的用户)
+    QString bestMatchFrom(int firstIndex, const FaceMatcher::Feature& feature, float* score) const;
+
+    // 按注册顺序导出全部用户名和特征(行主序)，用于构建FaceGallery检索文件
+    int snapshot(std::vector<std::string>* labels, std::vector<float>* features) const;
+
+    int userCount() const;
+
+private:
+    struct User {
+        QByteArray salt;
+        QByteArray passwordHash;
+        FaceMatcher::Feature feature;
+    };
+
+    static QByteArray hashPassword(const QByteArray& salt, const QString& password);
+
+    QString m_directory;
+    QFile m_file;
+    QHash<QString, User> m_users;
+    QStringList m_order;                // 注册顺序
+    mutable std::shared_mutex m_mutex;
+};
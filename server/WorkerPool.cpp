@@ -0,0 +1,44 @@
+#include "WorkerPool.h"
+
+WorkerPool::WorkerPool(int threadCount, size_t queueCapacity, Handler handler)
+    : m_queue(queueCapacity),
+    m_handler(std::move(handler))
+{
+    threadCount = std::max(1, threadCount);
+    m_threads.reserve(threadCount);
+    for (int i = 0; i < threadCount; ++i) {
+        m_threads.emplace_back(&WorkerPool::run, this);
+    }
+}
+
+WorkerPool::~WorkerPool()
+{
+    stop();
+}
+
+bool WorkerPool::submit(AuthJob&& job)
+{
+    job.enqueuedAt = std::chrono::steady_clock::now();
+    return m_queue.tryPush(std::move(job));
+}
+
+void WorkerPool::stop()
+{
+    // 关闭队列后工作线程处理完剩余请求再退出
+    m_queue.close();
+    for (std::thread& thread : m_threads) {
+        if (thread.joinable()) {
+            thread.join();
+        }
+    }
+    m_threads.clear();
+}
+
+void WorkerPool::run()
+{
+    AuthJob job;
+    while (m_queue.pop(job)) {
+        m_handler(job);
+        job = AuthJob();
+    }
+}
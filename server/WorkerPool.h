@@ -0,0 +1,106 @@
+#pragma once
+
+#include <QByteArray>
+#include <QJsonObject>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// 有界阻塞队列：满时tryPush立即失败而不是阻塞，由调用方决定丢弃策略
+template <typename T>
+class BoundedQueue
+{
+public:
+    explicit BoundedQueue(size_t capacity) : m_capacity(capacity), m_closed(false) {}
+
+    bool tryPush(T&& item)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_closed || m_items.size() >= m_capacity) {
+                return false;
+            }
+            m_items.push_back(std::move(item));
+        }
+        m_notEmpty.notify_one();
+        return true;
+    }
+
+    // 阻塞直到取得元素；队列关闭且为空时返回false
+    bool pop(T& item)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_notEmpty.wait(lock, [this] { return m_closed || !m_items.empty(); });
+        if (m_items.empty()) {
+            return false;
+        }
+        item = std::move(m_items.front());
+        m_items.pop_front();
+        return true;
+    }
+
+    void close()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_closed = true;
+        }
+        m_notEmpty.notify_all();
+    }
+
+    size_t size() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_items.size();
+    }
+
+    size_t capacity() const { return m_capacity; }
+
+private:
+    const size_t m_capacity;
+    bool m_closed;
+    std::deque<T> m_items;
+    mutable std::mutex m_mutex;
+    std::condition_variable m_notEmpty;
+};
+
+// 一个待处理的认证请求
+struct AuthJob {
+    quint64 connectionId = 0;
+    quint64 sequence = 0;           // 连接内的请求序号，用于按序返回响应
+    QJsonObject header;
+    QByteArray payload;
+    std::chrono::steady_clock::time_point enqueuedAt;
+};
+
+// 固定数量的工作线程，从有界队列中取出请求执行图像解码和比对
+class WorkerPool
+{
+public:
+    using Handler = std::function<void(AuthJob& job)>;
+
+    WorkerPool(int threadCount, size_t queueCapacity, Handler handler);
+    ~WorkerPool();
+
+    // 队列已满时返回false，调用方应立即回复繁忙
+    bool submit(AuthJob&& job);
+
+    void stop();
+
+    size_t queueDepth() const { return m_queue.size(); }
+    size_t queueCapacity() const { return m_queue.capacity(); }
+    int threadCount() const { return int(m_threads.size()); }
+
+private:
+    void run();
+
+    BoundedQueue<AuthJob> m_queue;
+    Handler m_handler;
+    std::vector<std::thread> m_threads;
+};
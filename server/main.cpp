@@ -0,0 +1,68 @@
+#include "AuthServer.h"
+#include "UserStore.h"
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDebug>
+#include <thread>
+
+int main(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("FaceAuthServer");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("FACE/RESP 协议参考认证服务器");
+    parser.addHelpOption();
+
+    AuthServer::Config config;
+    config.workerThreads = qMax(1, int(std::thread::hardware_concurrency()));
+
+    QCommandLineOption portOption({ "p", "port" }, "监听端口", "port", QString::number(config.port));
+    QCommandLineOption workersOption({ "w", "workers" }, "工作线程数", "count", QString::number(config.workerThreads));
+    QCommandLineOption queueOption("queue", "请求队列容量，满时回复繁忙", "count", QString::number(config.queueCapacity));
+    QCommandLineOption waitOption("max-queue-wait", "请求最长排队时间(毫秒)，超过即丢弃", "ms", QString::number(config.maxQueueWaitMs));
+    QCommandLineOption inFlightOption("max-inflight", "单个连接的最大在途请求数", "count", QString::number(config.maxInFlightPerConnection));
+    QCommandLineOption connectionsOption("max-connections", "最大连接数", "count", QString::number(config.maxConnections));
+    QCommandLineOption retryOption("retry-after", "繁忙响应中建议的重试间隔(毫秒)", "ms", QString::number(config.retryAfterMs));
+    QCommandLineOption thresholdOption("threshold", "人脸相似度阈值", "value", QString::number(config.matchThreshold));
+    QCommandLineOption previewRejectOption("preview-reject", "两阶段上传中预览图的拒绝阈值", "value",
+                                           QString::number(config.previewRejectThreshold));
+    QCommandLineOption dataOption({ "d", "data-dir" }, "用户库目录", "path", "faceauth-data");
+    QCommandLineOption galleryOption("gallery", "1:N检索文件路径，启动时由用户库构建", "path");
+    QCommandLineOption galleryInt8Option("gallery-int8", "检索文件使用int8量化存储");
+    QCommandLineOption galleryThreadsOption("gallery-threads", "单次检索的并行线程数", "count", QString::number(config.galleryThreads));
+    QCommandLineOption statsOption("stats-interval", "统计输出间隔(秒)", "seconds", QString::number(config.statsIntervalSec));
+    parser.addOptions({ portOption, workersOption, queueOption, waitOption, inFlightOption, connectionsOption,
+                        retryOption, thresholdOption, previewRejectOption, dataOption, galleryOption, galleryInt8Option,
+                        galleryThreadsOption, statsOption });
+    parser.process(app);
+
+    config.port = quint16(parser.value(portOption).toUInt());
+    config.workerThreads = qMax(1, parser.value(workersOption).toInt());
+    config.queueCapacity = qMax(1, parser.value(queueOption).toInt());
+    config.maxQueueWaitMs = qMax(1, parser.value(waitOption).toInt());
+    config.maxInFlightPerConnection = qMax(1, parser.value(inFlightOption).toInt());
+    config.maxConnections = qMax(1, parser.value(connectionsOption).toInt());
+    config.retryAfterMs = qMax(0, parser.value(retryOption).toInt());
+    config.matchThreshold = parser.value(thresholdOption).toFloat();
+    config.previewRejectThreshold = parser.value(previewRejectOption).toFloat();
+    config.statsIntervalSec = qMax(1, parser.value(statsOption).toInt());
+    config.galleryPath = parser.value(galleryOption);
+    config.galleryInt8 = parser.isSet(galleryInt8Option);
+    config.galleryThreads = qMax(1, parser.value(galleryThreadsOption).toInt());
+
+    UserStore store(parser.value(dataOption));
+    QString error;
+    if (!store.open(&error)) {
+        qDebug() << "打开用户库失败:" << error;
+        return 1;
+    }
+
+    // 事件循环由AuthServer自己驱动，QCoreApplication只用于命令行解析和Qt Core工具类
+    AuthServer server(config, &store);
+    if (!server.start(&error)) {
+        qDebug() << "启动服务器失败:" << error;
+        return 1;
+    }
+    return server.run();
+}